@@ -59,10 +59,13 @@
 #define ETH_AF_PACKET_BLOCKSIZE_ARG	"blocksz"
 #define ETH_AF_PACKET_FRAMESIZE_ARG	"framesz"
 #define ETH_AF_PACKET_FRAMECOUNT_ARG	"framecnt"
+#define ETH_AF_PACKET_VERSION_ARG	"tpver"
+#define ETH_AF_PACKET_BLOCKTMO_ARG	"blocktmo"
 
 #define DFLT_BLOCK_SIZE		(1 << 12)
 #define DFLT_FRAME_SIZE		(1 << 11)
 #define DFLT_FRAME_COUNT	(1 << 9)
+#define DFLT_BLOCK_TMO		1
 
 #define RTE_PMD_AF_PACKET_MAX_RINGS 16
 
@@ -74,6 +77,12 @@ struct pkt_rx_queue {
 	unsigned int framecount;
 	unsigned int framenum;
 
+	/* TPACKET_V3: rd holds blocks, walked a packet at a time */
+	unsigned int blockcount;
+	unsigned int blocknum;
+	unsigned int pkts_left;
+	struct tpacket3_hdr *ppd;
+
 	struct rte_mempool *mb_pool;
 	uint8_t in_port;
 
@@ -115,6 +124,8 @@ static const char *valid_arguments[] = {
 	ETH_AF_PACKET_BLOCKSIZE_ARG,
 	ETH_AF_PACKET_FRAMESIZE_ARG,
 	ETH_AF_PACKET_FRAMECOUNT_ARG,
+	ETH_AF_PACKET_VERSION_ARG,
+	ETH_AF_PACKET_BLOCKTMO_ARG,
 	NULL
 };
 
@@ -185,6 +196,93 @@ eth_af_packet_rx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	return num_rx;
 }
 
+/*
+ * TPACKET_V3 receive: the kernel hands over whole blocks of variable size
+ * frames, each retired once full or after its timeout. The packets of a
+ * block are copied out over as many bursts as needed before the block is
+ * given back.
+ */
+static uint16_t
+eth_af_packet_rx_v3(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
+{
+	struct tpacket_block_desc *pbd;
+	struct tpacket3_hdr *ppd;
+	struct rte_mbuf *mbuf;
+	uint8_t *pbuf;
+	struct pkt_rx_queue *pkt_q = queue;
+	uint16_t num_rx = 0;
+	unsigned long num_rx_bytes = 0;
+	unsigned int buf_size;
+
+	if (unlikely(nb_pkts == 0))
+		return 0;
+
+	buf_size = rte_pktmbuf_data_room_size(pkt_q->mb_pool) -
+		RTE_PKTMBUF_HEADROOM;
+
+	while (num_rx < nb_pkts) {
+		pbd = (struct tpacket_block_desc *)
+			pkt_q->rd[pkt_q->blocknum].iov_base;
+
+		/* pick up the next retired block */
+		if (pkt_q->pkts_left == 0) {
+			if ((pbd->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+				break;
+			rte_smp_rmb();
+			pkt_q->pkts_left = pbd->hdr.bh1.num_pkts;
+			pkt_q->ppd = (struct tpacket3_hdr *)((uint8_t *)pbd +
+				pbd->hdr.bh1.offset_to_first_pkt);
+		}
+
+		while (pkt_q->pkts_left > 0 && num_rx < nb_pkts) {
+			ppd = pkt_q->ppd;
+
+			if (unlikely(ppd->tp_snaplen > buf_size)) {
+				pkt_q->err_pkts++;
+				goto next;
+			}
+
+			/* on failure the packet is retried in the next burst */
+			mbuf = rte_pktmbuf_alloc(pkt_q->mb_pool);
+			if (unlikely(mbuf == NULL))
+				goto out;
+
+			rte_pktmbuf_pkt_len(mbuf) = rte_pktmbuf_data_len(mbuf) =
+				ppd->tp_snaplen;
+			pbuf = (uint8_t *)ppd + ppd->tp_mac;
+			memcpy(rte_pktmbuf_mtod(mbuf, void *), pbuf,
+			       rte_pktmbuf_data_len(mbuf));
+
+			if (ppd->tp_status & TP_STATUS_VLAN_VALID) {
+				mbuf->vlan_tci = ppd->hv1.tp_vlan_tci;
+				mbuf->ol_flags |= (PKT_RX_VLAN_PKT |
+						   PKT_RX_VLAN_STRIPPED);
+			}
+			mbuf->port = pkt_q->in_port;
+
+			bufs[num_rx++] = mbuf;
+			num_rx_bytes += mbuf->pkt_len;
+next:
+			pkt_q->ppd = (struct tpacket3_hdr *)((uint8_t *)ppd +
+				ppd->tp_next_offset);
+			pkt_q->pkts_left--;
+		}
+
+		/* release the block once all its packets are out */
+		if (pkt_q->pkts_left == 0) {
+			rte_smp_mb();
+			pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+			if (++pkt_q->blocknum >= pkt_q->blockcount)
+				pkt_q->blocknum = 0;
+		}
+	}
+
+out:
+	pkt_q->rx_pkts += num_rx;
+	pkt_q->rx_bytes += num_rx_bytes;
+	return num_rx;
+}
+
 /*
  * Callback to handle sending packets through a real NIC.
  */
@@ -324,7 +422,8 @@ static void
 eth_stats_get(struct rte_eth_dev *dev, struct rte_eth_stats *igb_stats)
 {
 	unsigned i, imax;
-	unsigned long rx_total = 0, tx_total = 0, tx_err_total = 0;
+	unsigned long rx_total = 0, tx_total = 0;
+	unsigned long rx_err_total = 0, tx_err_total = 0;
 	unsigned long rx_bytes_total = 0, tx_bytes_total = 0;
 	const struct pmd_internals *internal = dev->data->dev_private;
 
@@ -333,7 +432,9 @@ eth_stats_get(struct rte_eth_dev *dev, struct rte_eth_stats *igb_stats)
 	for (i = 0; i < imax; i++) {
 		igb_stats->q_ipackets[i] = internal->rx_queue[i].rx_pkts;
 		igb_stats->q_ibytes[i] = internal->rx_queue[i].rx_bytes;
+		igb_stats->q_errors[i] = internal->rx_queue[i].err_pkts;
 		rx_total += igb_stats->q_ipackets[i];
+		rx_err_total += internal->rx_queue[i].err_pkts;
 		rx_bytes_total += igb_stats->q_ibytes[i];
 	}
 
@@ -341,15 +442,16 @@ eth_stats_get(struct rte_eth_dev *dev, struct rte_eth_stats *igb_stats)
 	        internal->nb_queues : RTE_ETHDEV_QUEUE_STAT_CNTRS);
 	for (i = 0; i < imax; i++) {
 		igb_stats->q_opackets[i] = internal->tx_queue[i].tx_pkts;
-		igb_stats->q_errors[i] = internal->tx_queue[i].err_pkts;
+		igb_stats->q_errors[i] += internal->tx_queue[i].err_pkts;
 		igb_stats->q_obytes[i] = internal->tx_queue[i].tx_bytes;
 		tx_total += igb_stats->q_opackets[i];
-		tx_err_total += igb_stats->q_errors[i];
+		tx_err_total += internal->tx_queue[i].err_pkts;
 		tx_bytes_total += igb_stats->q_obytes[i];
 	}
 
 	igb_stats->ipackets = rx_total;
 	igb_stats->ibytes = rx_bytes_total;
+	igb_stats->ierrors = rx_err_total;
 	igb_stats->opackets = tx_total;
 	igb_stats->oerrors = tx_err_total;
 	igb_stats->obytes = tx_bytes_total;
@@ -364,6 +466,7 @@ eth_stats_reset(struct rte_eth_dev *dev)
 	for (i = 0; i < internal->nb_queues; i++) {
 		internal->rx_queue[i].rx_pkts = 0;
 		internal->rx_queue[i].rx_bytes = 0;
+		internal->rx_queue[i].err_pkts = 0;
 	}
 
 	for (i = 0; i < internal->nb_queues; i++) {
@@ -520,6 +623,142 @@ static const struct eth_dev_ops ops = {
 	.stats_reset = eth_stats_reset,
 };
 
+/*
+ * Sets up the TPACKET_V2 Tx ring of a TPACKET_V3 queue, on a socket of its
+ * own since older kernels only have V3 for Rx rings. The socket does not
+ * receive anything.
+ */
+static int
+open_tx_socket_v2(const char *name, const char *ifname,
+		  const struct sockaddr_ll *rx_sockaddr,
+		  const struct tpacket_req *req, struct pkt_tx_queue *tx_queue)
+{
+	struct sockaddr_ll sockaddr = *rx_sockaddr;
+	int tpver = TPACKET_V2;
+	int discard = 1;
+	int sockfd;
+#if defined(PACKET_QDISC_BYPASS)
+	int bypass = 1;
+#endif
+
+	sockfd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (sockfd == -1) {
+		RTE_LOG(ERR, PMD, "%s: could not open AF_PACKET socket\n",
+			name);
+		return -1;
+	}
+
+	if (setsockopt(sockfd, SOL_PACKET, PACKET_VERSION,
+		       &tpver, sizeof(tpver)) == -1 ||
+	    setsockopt(sockfd, SOL_PACKET, PACKET_LOSS,
+		       &discard, sizeof(discard)) == -1 ||
+#if defined(PACKET_QDISC_BYPASS)
+	    setsockopt(sockfd, SOL_PACKET, PACKET_QDISC_BYPASS,
+		       &bypass, sizeof(bypass)) == -1 ||
+#endif
+	    setsockopt(sockfd, SOL_PACKET, PACKET_TX_RING,
+		       req, sizeof(*req)) == -1) {
+		RTE_LOG(ERR, PMD,
+			"%s: could not set up Tx AF_PACKET socket for %s\n",
+			name, ifname);
+		goto error;
+	}
+
+	tx_queue->map = mmap(NULL, req->tp_block_size * req->tp_block_nr,
+			     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+			     sockfd, 0);
+	if (tx_queue->map == MAP_FAILED) {
+		RTE_LOG(ERR, PMD,
+			"%s: call to mmap failed on AF_PACKET socket for %s\n",
+			name, ifname);
+		goto error;
+	}
+
+	/* bound with no protocol to stay out of the Rx path */
+	sockaddr.sll_protocol = 0;
+	if (bind(sockfd, (const struct sockaddr *)&sockaddr,
+		 sizeof(sockaddr)) == -1) {
+		RTE_LOG(ERR, PMD,
+			"%s: could not bind AF_PACKET socket to %s\n",
+			name, ifname);
+		munmap(tx_queue->map, req->tp_block_size * req->tp_block_nr);
+		tx_queue->map = MAP_FAILED;
+		goto error;
+	}
+
+	tx_queue->sockfd = sockfd;
+
+	return 0;
+
+error:
+	close(sockfd);
+	return -1;
+}
+
+/*
+ * Sets up the TPACKET_V3 Rx ring of a queue on its socket, and its
+ * TPACKET_V2 Tx ring.
+ */
+static int
+setup_queue_v3(const char *name, const char *ifname, int sockfd,
+	       const struct sockaddr_ll *sockaddr,
+	       const struct tpacket_req3 *req3, const struct tpacket_req *req,
+	       struct pkt_rx_queue *rx_queue, struct pkt_tx_queue *tx_queue,
+	       unsigned int numa_node)
+{
+	unsigned int i, rdsize;
+
+	if (setsockopt(sockfd, SOL_PACKET, PACKET_RX_RING,
+		       req3, sizeof(*req3)) == -1) {
+		RTE_LOG(ERR, PMD,
+			"%s: could not set PACKET_RX_RING on AF_PACKET "
+			"socket for %s\n", name, ifname);
+		return -1;
+	}
+
+	rx_queue->map = mmap(NULL, req3->tp_block_size * req3->tp_block_nr,
+			     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+			     sockfd, 0);
+	if (rx_queue->map == MAP_FAILED) {
+		RTE_LOG(ERR, PMD,
+			"%s: call to mmap failed on AF_PACKET socket for %s\n",
+			name, ifname);
+		return -1;
+	}
+
+	rdsize = req3->tp_block_nr * sizeof(*(rx_queue->rd));
+	rx_queue->rd = rte_zmalloc_socket(name, rdsize, 0, numa_node);
+	if (rx_queue->rd == NULL)
+		return -1;
+	for (i = 0; i < req3->tp_block_nr; ++i) {
+		rx_queue->rd[i].iov_base = rx_queue->map +
+			(i * req3->tp_block_size);
+		rx_queue->rd[i].iov_len = req3->tp_block_size;
+	}
+	rx_queue->blockcount = req3->tp_block_nr;
+	rx_queue->sockfd = sockfd;
+
+	tx_queue->framecount = req->tp_frame_nr;
+	tx_queue->frame_data_size = req->tp_frame_size;
+	tx_queue->frame_data_size -= TPACKET2_HDRLEN -
+		sizeof(struct sockaddr_ll);
+
+	if (open_tx_socket_v2(name, ifname, sockaddr, req, tx_queue) < 0)
+		return -1;
+
+	rdsize = req->tp_frame_nr * sizeof(*(tx_queue->rd));
+	tx_queue->rd = rte_zmalloc_socket(name, rdsize, 0, numa_node);
+	if (tx_queue->rd == NULL)
+		return -1;
+	for (i = 0; i < req->tp_frame_nr; ++i) {
+		tx_queue->rd[i].iov_base = tx_queue->map +
+			(i * req->tp_frame_size);
+		tx_queue->rd[i].iov_len = req->tp_frame_size;
+	}
+
+	return 0;
+}
+
 /*
  * Opens an AF_PACKET socket
  */
@@ -550,6 +789,8 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
                        unsigned int blockcnt,
                        unsigned int framesize,
                        unsigned int framecnt,
+                       int tpver,
+                       unsigned int blocktmo,
                        struct pmd_internals **internals,
                        struct rte_eth_dev **eth_dev,
                        struct rte_kvargs *kvlist)
@@ -563,9 +804,10 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 	unsigned k_idx;
 	struct sockaddr_ll sockaddr;
 	struct tpacket_req *req;
+	struct tpacket_req3 req3;
 	struct pkt_rx_queue *rx_queue;
 	struct pkt_tx_queue *tx_queue;
-	int rc, tpver, discard;
+	int rc, discard;
 	int qsockfd = -1;
 	unsigned int i, q, rdsize;
 #if defined(PACKET_FANOUT)
@@ -616,6 +858,13 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 	req->tp_frame_size = framesize;
 	req->tp_frame_nr = framecnt;
 
+	memset(&req3, 0, sizeof(req3));
+	req3.tp_block_size = blocksize;
+	req3.tp_block_nr = blockcnt;
+	req3.tp_frame_size = framesize;
+	req3.tp_frame_nr = framecnt;
+	req3.tp_retire_blk_tov = blocktmo;
+
 	ifnamelen = strlen(pair->value);
 	if (ifnamelen < sizeof(ifr.ifr_name)) {
 		memcpy(ifr.ifr_name, pair->value, ifnamelen);
@@ -668,7 +917,6 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 			return -1;
 		}
 
-		tpver = TPACKET_V2;
 		rc = setsockopt(qsockfd, SOL_PACKET, PACKET_VERSION,
 				&tpver, sizeof(tpver));
 		if (rc == -1) {
@@ -688,6 +936,16 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 			goto error;
 		}
 
+		if (tpver == TPACKET_V3) {
+			if (setup_queue_v3(name, pair->value, qsockfd,
+					   &sockaddr, &req3, req,
+					   &(*internals)->rx_queue[q],
+					   &(*internals)->tx_queue[q],
+					   numa_node) < 0)
+				goto error;
+			goto bind;
+		}
+
 #if defined(PACKET_QDISC_BYPASS)
 		bypass = 1;
 		rc = setsockopt(qsockfd, SOL_PACKET, PACKET_QDISC_BYPASS,
@@ -759,6 +1017,7 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 		}
 		tx_queue->sockfd = qsockfd;
 
+bind:
 		rc = bind(qsockfd, (const struct sockaddr*)&sockaddr, sizeof(sockaddr));
 		if (rc == -1) {
 			RTE_LOG(ERR, PMD,
@@ -811,8 +1070,17 @@ rte_pmd_init_internals(struct rte_vdev_device *dev,
 	if (qsockfd != -1)
 		close(qsockfd);
 	for (q = 0; q < nb_queues; q++) {
-		munmap((*internals)->rx_queue[q].map,
-		       2 * req->tp_block_size * req->tp_block_nr);
+		if (tpver == TPACKET_V3) {
+			munmap((*internals)->rx_queue[q].map,
+			       req->tp_block_size * req->tp_block_nr);
+			munmap((*internals)->tx_queue[q].map,
+			       req->tp_block_size * req->tp_block_nr);
+			if ((*internals)->tx_queue[q].sockfd != 0)
+				close((*internals)->tx_queue[q].sockfd);
+		} else {
+			munmap((*internals)->rx_queue[q].map,
+			       2 * req->tp_block_size * req->tp_block_nr);
+		}
 
 		rte_free((*internals)->rx_queue[q].rd);
 		rte_free((*internals)->tx_queue[q].rd);
@@ -841,7 +1109,9 @@ rte_eth_from_packet(struct rte_vdev_device *dev,
 	unsigned int blocksize = DFLT_BLOCK_SIZE;
 	unsigned int framesize = DFLT_FRAME_SIZE;
 	unsigned int framecount = DFLT_FRAME_COUNT;
+	unsigned int blocktmo = DFLT_BLOCK_TMO;
 	unsigned int qpairs = 1;
+	int tpver = TPACKET_V2;
 
 	/* do some parameter checking */
 	if (*sockfd < 0)
@@ -893,6 +1163,38 @@ rte_eth_from_packet(struct rte_vdev_device *dev,
 			}
 			continue;
 		}
+		if (strstr(pair->key, ETH_AF_PACKET_VERSION_ARG) != NULL) {
+			switch (atoi(pair->value)) {
+			case 2:
+				tpver = TPACKET_V2;
+				break;
+			case 3:
+				tpver = TPACKET_V3;
+				break;
+			default:
+				RTE_LOG(ERR, PMD,
+					"%s: invalid tpver value\n",
+				        name);
+				return -1;
+			}
+			continue;
+		}
+		if (strstr(pair->key, ETH_AF_PACKET_BLOCKTMO_ARG) != NULL) {
+			unsigned long tmo;
+			char *end;
+
+			/* the kernel keeps the timeout on 16 bits */
+			tmo = strtoul(pair->value, &end, 10);
+			if (*pair->value == '\0' || *end != '\0' ||
+			    tmo == 0 || tmo > UINT16_MAX) {
+				RTE_LOG(ERR, PMD,
+					"%s: invalid blocktmo value\n",
+				        name);
+				return -1;
+			}
+			blocktmo = tmo;
+			continue;
+		}
 	}
 
 	if (framesize > blocksize) {
@@ -914,15 +1216,24 @@ rte_eth_from_packet(struct rte_vdev_device *dev,
 	RTE_LOG(INFO, PMD, "%s:\tblock count %d\n", name, blockcount);
 	RTE_LOG(INFO, PMD, "%s:\tframe size %d\n", name, framesize);
 	RTE_LOG(INFO, PMD, "%s:\tframe count %d\n", name, framecount);
+	RTE_LOG(INFO, PMD, "%s:\tversion %d\n", name,
+		tpver == TPACKET_V3 ? 3 : 2);
+	if (tpver == TPACKET_V3)
+		RTE_LOG(INFO, PMD, "%s:\tblock timeout %u ms\n", name,
+			blocktmo);
 
 	if (rte_pmd_init_internals(dev, *sockfd, qpairs,
 				   blocksize, blockcount,
 				   framesize, framecount,
+				   tpver, blocktmo,
 				   &internals, &eth_dev,
 				   kvlist) < 0)
 		return -1;
 
-	eth_dev->rx_pkt_burst = eth_af_packet_rx;
+	if (tpver == TPACKET_V3)
+		eth_dev->rx_pkt_burst = eth_af_packet_rx_v3;
+	else
+		eth_dev->rx_pkt_burst = eth_af_packet_rx;
 	eth_dev->tx_pkt_burst = eth_af_packet_tx;
 
 	return 0;
@@ -1012,4 +1323,6 @@ RTE_PMD_REGISTER_PARAM_STRING(net_af_packet,
 	"qpairs=<int> "
 	"blocksz=<int> "
 	"framesz=<int> "
-	"framecnt=<int>");
+	"framecnt=<int> "
+	"tpver=<2|3> "
+	"blocktmo=<int>");
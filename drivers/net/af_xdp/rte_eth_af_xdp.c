@@ -0,0 +1,1315 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include <rte_cycles.h>
+#include <rte_mbuf.h>
+#include <rte_ethdev.h>
+#include <rte_ethdev_vdev.h>
+#include <rte_malloc.h>
+#include <rte_kvargs.h>
+#include <rte_vdev.h>
+
+#define ETH_AF_XDP_IFACE_ARG		"iface"
+#define ETH_AF_XDP_NUM_Q_ARG		"qpairs"
+#define ETH_AF_XDP_START_Q_ARG		"start_queue"
+#define ETH_AF_XDP_MODE_ARG		"xdp_mode"
+
+#define ETH_AF_XDP_MODE_NATIVE		"native"
+#define ETH_AF_XDP_MODE_GENERIC		"generic"
+
+#define RTE_PMD_AF_XDP_MAX_QUEUES 16
+
+/* Fill ring entries posted at most per Rx burst */
+#define ETH_AF_XDP_REFILL_BURST 64
+
+/* Low bits of a UMEM address in unaligned chunk mode, the rest is offset */
+#define ETH_AF_XDP_ADDR_MASK ((1ULL << XSK_UNALIGNED_BUF_OFFSET_SHIFT) - 1)
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+/* Producer and consumer view of an AF_XDP ring mapped from the kernel */
+struct xsk_ring {
+	volatile uint32_t *producer;
+	volatile uint32_t *consumer;
+	volatile uint32_t *flags;
+	void *descs;
+	uint32_t size;
+	uint32_t mask;
+	void *map;
+	size_t map_size;
+};
+
+/*
+ * An Rx queue owns the AF_XDP socket of its queue pair. The UMEM of the
+ * socket is the memory of the Rx mempool, so that the fill ring is fed
+ * with mbuf buffers and received packets land in them.
+ *
+ * The mbufs given to the kernel, on the fill or Tx ring, are kept in
+ * frames[] until it gives them back, indexed by their offset in the UMEM
+ * divided by the size of a mempool object. This tells which ones to free
+ * once the socket is closed.
+ */
+struct pkt_rx_queue {
+	int xsk_fd;
+	uint8_t *umem_base;
+	uint32_t mbuf_offset;	/* from an mbuf to its buffer */
+	uint32_t frame_size;	/* mempool object size */
+	uint32_t nb_frames;
+	uint32_t nb_desc;
+	struct rte_mbuf **frames;
+
+	struct xsk_ring rx;
+	struct xsk_ring fill;
+
+	struct rte_mempool *mb_pool;
+	uint8_t in_port;
+
+	volatile unsigned long rx_pkts;
+	volatile unsigned long err_pkts;
+	volatile unsigned long rx_bytes;
+};
+
+struct pkt_tx_queue {
+	struct pkt_rx_queue *pair;
+	uint32_t nb_desc;
+
+	struct xsk_ring tx;
+	struct xsk_ring comp;
+
+	volatile unsigned long tx_pkts;
+	volatile unsigned long err_pkts;
+	volatile unsigned long tx_bytes;
+};
+
+struct pmd_internals {
+	unsigned int nb_queues;
+	unsigned int start_queue;
+
+	int if_index;
+	char *if_name;
+	struct ether_addr eth_addr;
+
+	/* XDP program redirecting the queues to their sockets */
+	int xdp_mode;		/* XDP_FLAGS_*_MODE, 0 to try native first */
+	uint32_t xdp_flags;	/* of the attached program */
+	int prog_fd;
+	int xskmap_fd;
+
+	struct pkt_rx_queue rx_queue[RTE_PMD_AF_XDP_MAX_QUEUES];
+	struct pkt_tx_queue tx_queue[RTE_PMD_AF_XDP_MAX_QUEUES];
+};
+
+static const char *valid_arguments[] = {
+	ETH_AF_XDP_IFACE_ARG,
+	ETH_AF_XDP_NUM_Q_ARG,
+	ETH_AF_XDP_START_Q_ARG,
+	ETH_AF_XDP_MODE_ARG,
+	NULL
+};
+
+static struct rte_eth_link pmd_link = {
+	.link_speed = ETH_SPEED_NUM_10G,
+	.link_duplex = ETH_LINK_FULL_DUPLEX,
+	.link_status = ETH_LINK_DOWN,
+	.link_autoneg = ETH_LINK_SPEED_AUTONEG
+};
+
+static inline uint64_t
+mbuf_to_addr(const struct pkt_rx_queue *umem, const struct rte_mbuf *mbuf)
+{
+	return (uint8_t *)mbuf->buf_addr - umem->umem_base;
+}
+
+static inline struct rte_mbuf *
+addr_to_mbuf(const struct pkt_rx_queue *umem, uint64_t addr)
+{
+	return (struct rte_mbuf *)(umem->umem_base +
+		(addr & ETH_AF_XDP_ADDR_MASK) - umem->mbuf_offset);
+}
+
+/* Slot of an mbuf in frames[], unique as mempool objects do not overlap */
+static inline struct rte_mbuf **
+mbuf_to_frame(const struct pkt_rx_queue *umem, const struct rte_mbuf *mbuf)
+{
+	return &umem->frames[((const uint8_t *)mbuf - umem->umem_base) /
+			     umem->frame_size];
+}
+
+/*
+ * Posts fresh mbuf buffers to the fill ring, for the kernel to receive
+ * packets into.
+ */
+static void
+af_xdp_refill(struct pkt_rx_queue *rxq, uint32_t max)
+{
+	struct xsk_ring *fill = &rxq->fill;
+	struct rte_mbuf *mbufs[ETH_AF_XDP_REFILL_BURST];
+	uint64_t *addrs = fill->descs;
+	uint32_t prod, n, i;
+
+	prod = *fill->producer;
+	n = fill->size - (prod - *fill->consumer);
+	n = RTE_MIN(n, RTE_MIN(max, (uint32_t)ETH_AF_XDP_REFILL_BURST));
+	if (n == 0 || rte_pktmbuf_alloc_bulk(rxq->mb_pool, mbufs, n) != 0)
+		return;
+
+	for (i = 0; i < n; i++) {
+		addrs[(prod + i) & fill->mask] = mbuf_to_addr(rxq, mbufs[i]);
+		*mbuf_to_frame(rxq, mbufs[i]) = mbufs[i];
+	}
+
+	rte_smp_wmb();
+	*fill->producer = prod + n;
+}
+
+static uint16_t
+eth_af_xdp_rx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
+{
+	struct pkt_rx_queue *rxq = queue;
+	struct xsk_ring *rx = &rxq->rx;
+	struct xdp_desc *descs = rx->descs;
+	struct xdp_desc *desc;
+	struct rte_mbuf *mbuf;
+	unsigned long num_rx_bytes = 0;
+	uint32_t cons, num_rx, i;
+
+	cons = *rx->consumer;
+	num_rx = RTE_MIN(*rx->producer - cons, (uint32_t)nb_pkts);
+	if (num_rx == 0) {
+		af_xdp_refill(rxq, ETH_AF_XDP_REFILL_BURST);
+		if (*rxq->fill.flags & XDP_RING_NEED_WAKEUP)
+			recvfrom(rxq->xsk_fd, NULL, 0, MSG_DONTWAIT,
+				 NULL, NULL);
+		return 0;
+	}
+	rte_smp_rmb();
+
+	/* the packets are already in mbufs of the pool */
+	for (i = 0; i < num_rx; i++) {
+		desc = &descs[(cons + i) & rx->mask];
+		mbuf = addr_to_mbuf(rxq, desc->addr);
+		*mbuf_to_frame(rxq, mbuf) = NULL;
+		mbuf->data_off = desc->addr >> XSK_UNALIGNED_BUF_OFFSET_SHIFT;
+		rte_pktmbuf_pkt_len(mbuf) = rte_pktmbuf_data_len(mbuf) =
+			desc->len;
+		mbuf->port = rxq->in_port;
+
+		bufs[i] = mbuf;
+		num_rx_bytes += desc->len;
+	}
+
+	rte_smp_rmb();
+	*rx->consumer = cons + num_rx;
+
+	af_xdp_refill(rxq, num_rx + ETH_AF_XDP_REFILL_BURST / 2);
+
+	rxq->rx_pkts += num_rx;
+	rxq->rx_bytes += num_rx_bytes;
+	return num_rx;
+}
+
+/* Frees the mbufs the kernel is done sending */
+static void
+af_xdp_complete(struct pkt_tx_queue *txq)
+{
+	struct xsk_ring *comp = &txq->comp;
+	uint64_t *addrs = comp->descs;
+	struct rte_mbuf *mbuf;
+	uint32_t cons, n, i;
+
+	cons = *comp->consumer;
+	n = *comp->producer - cons;
+	if (n == 0)
+		return;
+	rte_smp_rmb();
+
+	for (i = 0; i < n; i++) {
+		mbuf = addr_to_mbuf(txq->pair, addrs[(cons + i) & comp->mask]);
+		*mbuf_to_frame(txq->pair, mbuf) = NULL;
+		rte_pktmbuf_free(mbuf);
+	}
+
+	rte_smp_rmb();
+	*comp->consumer = cons + n;
+}
+
+/*
+ * Callback to handle sending packets through the socket. Direct mbufs of
+ * the UMEM mempool are handed to the kernel as they are, the others are
+ * first copied into one.
+ */
+static uint16_t
+eth_af_xdp_tx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
+{
+	struct pkt_tx_queue *txq = queue;
+	struct pkt_rx_queue *umem = txq->pair;
+	struct xsk_ring *tx = &txq->tx;
+	struct xdp_desc *descs = tx->descs;
+	struct xdp_desc *desc;
+	struct rte_mbuf *mbuf, *xmit;
+	unsigned long num_tx_bytes = 0;
+	uint32_t prod, room, num_tx = 0;
+	uint16_t i, max_len;
+	const void *data;
+
+	if (unlikely(nb_pkts == 0))
+		return 0;
+
+	af_xdp_complete(txq);
+
+	prod = *tx->producer;
+	room = tx->size - (prod - *tx->consumer);
+	nb_pkts = RTE_MIN((uint32_t)nb_pkts, room);
+	max_len = rte_pktmbuf_data_room_size(umem->mb_pool) -
+		XDP_PACKET_HEADROOM;
+
+	for (i = 0; i < nb_pkts; i++) {
+		mbuf = bufs[i];
+
+		if (mbuf->pool == umem->mb_pool && RTE_MBUF_DIRECT(mbuf) &&
+		    mbuf->nb_segs == 1) {
+			xmit = mbuf;
+		} else if (mbuf->pkt_len > max_len) {
+			rte_pktmbuf_free(mbuf);
+			txq->err_pkts++;
+			continue;
+		} else {
+			xmit = rte_pktmbuf_alloc(umem->mb_pool);
+			if (unlikely(xmit == NULL))
+				break;
+			data = rte_pktmbuf_read(mbuf, 0, mbuf->pkt_len,
+					rte_pktmbuf_mtod(xmit, void *));
+			if (data != rte_pktmbuf_mtod(xmit, void *))
+				rte_memcpy(rte_pktmbuf_mtod(xmit, void *),
+					   data, mbuf->pkt_len);
+			rte_pktmbuf_pkt_len(xmit) = rte_pktmbuf_data_len(xmit) =
+				mbuf->pkt_len;
+			rte_pktmbuf_free(mbuf);
+		}
+
+		desc = &descs[(prod + num_tx) & tx->mask];
+		desc->addr = mbuf_to_addr(umem, xmit) |
+			((uint64_t)xmit->data_off << XSK_UNALIGNED_BUF_OFFSET_SHIFT);
+		desc->len = xmit->data_len;
+		desc->options = 0;
+		*mbuf_to_frame(umem, xmit) = xmit;
+
+		num_tx++;
+		num_tx_bytes += xmit->data_len;
+	}
+
+	rte_smp_wmb();
+	*tx->producer = prod + num_tx;
+
+	/* kick-off transmits */
+	if (num_tx > 0 && (*tx->flags & XDP_RING_NEED_WAKEUP))
+		sendto(umem->xsk_fd, NULL, 0, MSG_DONTWAIT, NULL, 0);
+
+	txq->tx_pkts += num_tx;
+	txq->tx_bytes += num_tx_bytes;
+	return i;
+}
+
+static int
+af_xdp_bpf(int cmd, union bpf_attr *attr)
+{
+	return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+/*
+ * Creates the map of sockets per queue, and the program redirecting each
+ * received packet to the socket of its queue, if any.
+ */
+static int
+af_xdp_load_prog(struct pmd_internals *internals)
+{
+	union bpf_attr attr;
+	int map_fd, prog_fd;
+	struct bpf_insn prog[] = {
+		/* r2 = ctx->rx_queue_index */
+		{
+			.code = BPF_LDX | BPF_W | BPF_MEM,
+			.dst_reg = BPF_REG_2,
+			.src_reg = BPF_REG_1,
+			.off = offsetof(struct xdp_md, rx_queue_index),
+		},
+		/* r1 = xskmap */
+		{
+			.code = BPF_LD | BPF_DW | BPF_IMM,
+			.dst_reg = BPF_REG_1,
+			.src_reg = BPF_PSEUDO_MAP_FD,
+		},
+		{ .code = 0 },
+		/* r3 = XDP_PASS when the queue has no socket */
+		{
+			.code = BPF_ALU64 | BPF_MOV | BPF_K,
+			.dst_reg = BPF_REG_3,
+			.imm = XDP_PASS,
+		},
+		{ .code = BPF_JMP | BPF_CALL, .imm = BPF_FUNC_redirect_map },
+		{ .code = BPF_JMP | BPF_EXIT },
+	};
+	static const char license[] = "Dual BSD/GPL";
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(int);
+	attr.value_size = sizeof(int);
+	attr.max_entries = internals->start_queue + internals->nb_queues;
+	map_fd = af_xdp_bpf(BPF_MAP_CREATE, &attr);
+	if (map_fd < 0) {
+		RTE_LOG(ERR, PMD, "%s: could not create XSKMAP: %s\n",
+			internals->if_name, strerror(errno));
+		return -1;
+	}
+	prog[1].imm = map_fd;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = (uintptr_t)prog;
+	attr.insn_cnt = RTE_DIM(prog);
+	attr.license = (uintptr_t)license;
+	prog_fd = af_xdp_bpf(BPF_PROG_LOAD, &attr);
+	if (prog_fd < 0) {
+		RTE_LOG(ERR, PMD, "%s: could not load XDP program: %s\n",
+			internals->if_name, strerror(errno));
+		close(map_fd);
+		return -1;
+	}
+
+	internals->xskmap_fd = map_fd;
+	internals->prog_fd = prog_fd;
+
+	return 0;
+}
+
+static void
+af_xdp_unload_prog(struct pmd_internals *internals)
+{
+	close(internals->prog_fd);
+	close(internals->xskmap_fd);
+	internals->prog_fd = -1;
+	internals->xskmap_fd = -1;
+}
+
+static int
+af_xdp_map_update(struct pmd_internals *internals, int key, int *value)
+{
+	union bpf_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = internals->xskmap_fd;
+	attr.key = (uintptr_t)&key;
+	if (value == NULL)
+		return af_xdp_bpf(BPF_MAP_DELETE_ELEM, &attr);
+
+	attr.value = (uintptr_t)value;
+	return af_xdp_bpf(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+/*
+ * Attaches an XDP program to the interface, or detaches it with a
+ * prog_fd of -1, over rtnetlink.
+ */
+static int
+af_xdp_link_set(int if_index, int prog_fd, uint32_t flags)
+{
+	struct {
+		struct nlmsghdr nh;
+		struct ifinfomsg ifi;
+		char attrs[64];
+	} req;
+	struct sockaddr_nl sa = { .nl_family = AF_NETLINK };
+	struct nlattr *nla, *nla_xdp;
+	struct nlmsgerr *err;
+	struct nlmsghdr *nh;
+	char buf[512];
+	int fd, ret;
+
+	memset(&req, 0, sizeof(req));
+	req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
+	req.nh.nlmsg_type = RTM_SETLINK;
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	req.ifi.ifi_family = AF_UNSPEC;
+	req.ifi.ifi_index = if_index;
+
+	nla = (struct nlattr *)((char *)&req + NLMSG_ALIGN(req.nh.nlmsg_len));
+	nla->nla_type = NLA_F_NESTED | IFLA_XDP;
+	nla->nla_len = NLA_HDRLEN;
+
+	nla_xdp = (struct nlattr *)((char *)nla + nla->nla_len);
+	nla_xdp->nla_type = IFLA_XDP_FD;
+	nla_xdp->nla_len = NLA_HDRLEN + sizeof(prog_fd);
+	memcpy((char *)nla_xdp + NLA_HDRLEN, &prog_fd, sizeof(prog_fd));
+	nla->nla_len += NLA_ALIGN(nla_xdp->nla_len);
+
+	nla_xdp = (struct nlattr *)((char *)nla + nla->nla_len);
+	nla_xdp->nla_type = IFLA_XDP_FLAGS;
+	nla_xdp->nla_len = NLA_HDRLEN + sizeof(flags);
+	memcpy((char *)nla_xdp + NLA_HDRLEN, &flags, sizeof(flags));
+	nla->nla_len += NLA_ALIGN(nla_xdp->nla_len);
+
+	req.nh.nlmsg_len += NLA_ALIGN(nla->nla_len);
+
+	fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if (fd < 0)
+		return -errno;
+
+	if (sendto(fd, &req, req.nh.nlmsg_len, 0,
+		   (struct sockaddr *)&sa, sizeof(sa)) < 0 ||
+	    recv(fd, buf, sizeof(buf), 0) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	nh = (struct nlmsghdr *)buf;
+	ret = -EPROTO;
+	if (nh->nlmsg_type == NLMSG_ERROR) {
+		err = NLMSG_DATA(nh);
+		ret = err->error;
+	}
+
+out:
+	close(fd);
+	return ret;
+}
+
+/*
+ * Attaches the program in the mode asked for, else natively if the driver
+ * supports it and generically otherwise.
+ */
+static int
+af_xdp_attach_prog(struct pmd_internals *internals)
+{
+	uint32_t flags = XDP_FLAGS_UPDATE_IF_NOEXIST;
+	int ret;
+
+	if (internals->xdp_mode != XDP_FLAGS_SKB_MODE) {
+		ret = af_xdp_link_set(internals->if_index, internals->prog_fd,
+				      flags | XDP_FLAGS_DRV_MODE);
+		if (ret == 0) {
+			internals->xdp_flags = flags | XDP_FLAGS_DRV_MODE;
+			return 0;
+		}
+		if (internals->xdp_mode == XDP_FLAGS_DRV_MODE) {
+			RTE_LOG(ERR, PMD,
+				"%s: could not attach native XDP program: %s\n",
+				internals->if_name, strerror(-ret));
+			return -1;
+		}
+	}
+
+	ret = af_xdp_link_set(internals->if_index, internals->prog_fd,
+			      flags | XDP_FLAGS_SKB_MODE);
+	if (ret != 0) {
+		RTE_LOG(ERR, PMD, "%s: could not attach XDP program: %s\n",
+			internals->if_name, strerror(-ret));
+		return -1;
+	}
+	internals->xdp_flags = flags | XDP_FLAGS_SKB_MODE;
+
+	return 0;
+}
+
+static int
+af_xdp_map_ring(int fd, const struct xdp_ring_offset *off, uint32_t size,
+		size_t desc_size, off_t pgoff, struct xsk_ring *ring)
+{
+	ring->map_size = off->desc + size * desc_size;
+	ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, fd, pgoff);
+	if (ring->map == MAP_FAILED) {
+		ring->map = NULL;
+		return -1;
+	}
+
+	ring->producer = (uint32_t *)((uint8_t *)ring->map + off->producer);
+	ring->consumer = (uint32_t *)((uint8_t *)ring->map + off->consumer);
+	ring->flags = (uint32_t *)((uint8_t *)ring->map + off->flags);
+	ring->descs = (uint8_t *)ring->map + off->desc;
+	ring->size = size;
+	ring->mask = size - 1;
+
+	return 0;
+}
+
+static void
+af_xdp_unmap_ring(struct xsk_ring *ring)
+{
+	if (ring->map != NULL)
+		munmap(ring->map, ring->map_size);
+	memset(ring, 0, sizeof(*ring));
+}
+
+/*
+ * Unmaps the rings of a queue pair and closes its socket. Each mapping
+ * holds a reference on the socket, so that it is only released, and
+ * unbound from the queue of the interface, once all of them are gone.
+ * The mbufs the kernel still had are then freed.
+ */
+static void
+af_xdp_queue_release(struct pkt_rx_queue *rxq, struct pkt_tx_queue *txq)
+{
+	uint32_t i;
+
+	af_xdp_unmap_ring(&rxq->rx);
+	af_xdp_unmap_ring(&rxq->fill);
+	af_xdp_unmap_ring(&txq->tx);
+	af_xdp_unmap_ring(&txq->comp);
+
+	if (rxq->xsk_fd >= 0)
+		close(rxq->xsk_fd);
+	rxq->xsk_fd = -1;
+
+	if (rxq->frames == NULL)
+		return;
+	for (i = 0; i < rxq->nb_frames; i++)
+		if (rxq->frames[i] != NULL)
+			rte_pktmbuf_free(rxq->frames[i]);
+	rte_free(rxq->frames);
+	rxq->frames = NULL;
+}
+
+/*
+ * Binds a socket to its queue. The kernel gives the queue of a closed
+ * socket back from a work queue, so a restarted port may have to wait.
+ */
+static int
+af_xdp_bind(int fd, const struct sockaddr_xdp *sxdp)
+{
+	unsigned int tries = 100;
+
+	while (bind(fd, (const struct sockaddr *)sxdp, sizeof(*sxdp)) < 0) {
+		if (errno != EBUSY || --tries == 0)
+			return -1;
+		rte_delay_ms(10);
+	}
+
+	return 0;
+}
+
+/*
+ * Opens the AF_XDP socket of a queue pair, with the memory of the Rx
+ * mempool as UMEM, and binds it to its queue of the interface, in
+ * zero-copy mode if the driver supports it.
+ */
+static int
+af_xdp_queue_open(struct rte_eth_dev *dev, unsigned int q)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	struct pkt_rx_queue *rxq = &internals->rx_queue[q];
+	struct pkt_tx_queue *txq = &internals->tx_queue[q];
+	struct rte_mempool *mp = rxq->mb_pool;
+	struct rte_mempool_memhdr *memhdr;
+	struct xdp_mmap_offsets off;
+	struct xdp_umem_reg reg;
+	struct sockaddr_xdp sxdp;
+	socklen_t optlen;
+	size_t page_size = getpagesize();
+	uint8_t *end;
+	int fd, queue_id = internals->start_queue + q;
+
+	/*
+	 * The UMEM is a single virtual area, the chunks of the pool must
+	 * follow each other, up to the page padding between them.
+	 */
+	memhdr = STAILQ_FIRST(&mp->mem_list);
+	rxq->umem_base = RTE_PTR_ALIGN_FLOOR(memhdr->addr, page_size);
+	end = memhdr->addr;
+	STAILQ_FOREACH(memhdr, &mp->mem_list, next) {
+		if ((uint8_t *)memhdr->addr < end ||
+		    (uint8_t *)memhdr->addr >= end + page_size) {
+			RTE_LOG(ERR, PMD,
+				"%s: mempool %s is not virtually contiguous\n",
+				dev->device->name, mp->name);
+			return -1;
+		}
+		end = RTE_PTR_ADD(memhdr->addr, memhdr->len);
+	}
+	end = RTE_PTR_ALIGN_CEIL(end, page_size);
+	rxq->mbuf_offset = sizeof(struct rte_mbuf) + rte_pktmbuf_priv_size(mp);
+
+	rxq->frame_size = mp->header_size + mp->elt_size + mp->trailer_size;
+	rxq->nb_frames = (end - rxq->umem_base) / rxq->frame_size + 1;
+	rxq->frames = rte_zmalloc_socket(dev->device->name,
+			rxq->nb_frames * sizeof(*rxq->frames), 0,
+			mp->socket_id);
+	if (rxq->frames == NULL) {
+		RTE_LOG(ERR, PMD, "%s: could not allocate UMEM frame table\n",
+			dev->device->name);
+		return -1;
+	}
+
+	fd = socket(AF_XDP, SOCK_RAW, 0);
+	if (fd < 0) {
+		RTE_LOG(ERR, PMD, "%s: could not open AF_XDP socket: %s\n",
+			dev->device->name, strerror(errno));
+		rte_free(rxq->frames);
+		rxq->frames = NULL;
+		return -1;
+	}
+	rxq->xsk_fd = fd;
+
+	memset(&reg, 0, sizeof(reg));
+	reg.addr = (uintptr_t)rxq->umem_base;
+	reg.len = end - rxq->umem_base;
+	reg.chunk_size = rte_pktmbuf_data_room_size(mp);
+	reg.flags = XDP_UMEM_UNALIGNED_CHUNK_FLAG;
+	if (setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0) {
+		RTE_LOG(ERR, PMD, "%s: could not register UMEM: %s\n",
+			dev->device->name, strerror(errno));
+		goto error;
+	}
+
+	if (setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &rxq->nb_desc,
+		       sizeof(rxq->nb_desc)) < 0 ||
+	    setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &txq->nb_desc,
+		       sizeof(txq->nb_desc)) < 0 ||
+	    setsockopt(fd, SOL_XDP, XDP_RX_RING, &rxq->nb_desc,
+		       sizeof(rxq->nb_desc)) < 0 ||
+	    setsockopt(fd, SOL_XDP, XDP_TX_RING, &txq->nb_desc,
+		       sizeof(txq->nb_desc)) < 0) {
+		RTE_LOG(ERR, PMD, "%s: could not size AF_XDP rings: %s\n",
+			dev->device->name, strerror(errno));
+		goto error;
+	}
+
+	optlen = sizeof(off);
+	if (getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0 ||
+	    af_xdp_map_ring(fd, &off.fr, rxq->nb_desc, sizeof(uint64_t),
+			    XDP_UMEM_PGOFF_FILL_RING, &rxq->fill) < 0 ||
+	    af_xdp_map_ring(fd, &off.cr, txq->nb_desc, sizeof(uint64_t),
+			    XDP_UMEM_PGOFF_COMPLETION_RING, &txq->comp) < 0 ||
+	    af_xdp_map_ring(fd, &off.rx, rxq->nb_desc, sizeof(struct xdp_desc),
+			    XDP_PGOFF_RX_RING, &rxq->rx) < 0 ||
+	    af_xdp_map_ring(fd, &off.tx, txq->nb_desc, sizeof(struct xdp_desc),
+			    XDP_PGOFF_TX_RING, &txq->tx) < 0) {
+		RTE_LOG(ERR, PMD, "%s: could not map AF_XDP rings: %s\n",
+			dev->device->name, strerror(errno));
+		goto error;
+	}
+
+	while (*rxq->fill.producer - *rxq->fill.consumer < rxq->fill.size) {
+		uint32_t posted = *rxq->fill.producer;
+
+		af_xdp_refill(rxq, rxq->fill.size);
+		if (*rxq->fill.producer == posted)
+			break;
+	}
+
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = internals->if_index;
+	sxdp.sxdp_queue_id = queue_id;
+	sxdp.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+	if (af_xdp_bind(fd, &sxdp) < 0) {
+		sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+		if (af_xdp_bind(fd, &sxdp) < 0) {
+			RTE_LOG(ERR, PMD,
+				"%s: could not bind AF_XDP socket to %s queue %d: %s\n",
+				dev->device->name, internals->if_name,
+				queue_id, strerror(errno));
+			goto error;
+		}
+	}
+
+	if (af_xdp_map_update(internals, queue_id, &fd) < 0) {
+		RTE_LOG(ERR, PMD, "%s: could not insert socket in XSKMAP: %s\n",
+			dev->device->name, strerror(errno));
+		goto error;
+	}
+
+	RTE_LOG(INFO, PMD, "%s: queue %d of %s in %s mode\n",
+		dev->device->name, queue_id, internals->if_name,
+		sxdp.sxdp_flags & XDP_ZEROCOPY ? "zero-copy" : "copy");
+
+	return 0;
+
+error:
+	af_xdp_queue_release(rxq, txq);
+	return -1;
+}
+
+/*
+ * Takes a queue pair out of the map and closes its socket, giving back
+ * all the mbufs the kernel had.
+ */
+static void
+af_xdp_queue_close(struct pmd_internals *internals, unsigned int q)
+{
+	struct pkt_rx_queue *rxq = &internals->rx_queue[q];
+	struct pkt_tx_queue *txq = &internals->tx_queue[q];
+
+	if (rxq->xsk_fd < 0)
+		return;
+
+	af_xdp_map_update(internals, internals->start_queue + q, NULL);
+	af_xdp_queue_release(rxq, txq);
+}
+
+static int
+eth_dev_start(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	unsigned int q;
+
+	if (af_xdp_load_prog(internals) < 0)
+		return -1;
+
+	for (q = 0; q < internals->nb_queues; q++) {
+		if (internals->rx_queue[q].mb_pool == NULL) {
+			RTE_LOG(ERR, PMD, "%s: Rx queue %u not set up\n",
+				dev->device->name, q);
+			goto error;
+		}
+		if (af_xdp_queue_open(dev, q) < 0)
+			goto error;
+	}
+
+	if (af_xdp_attach_prog(internals) < 0)
+		goto error;
+
+	dev->data->dev_link.link_status = ETH_LINK_UP;
+	return 0;
+
+error:
+	while (q-- > 0)
+		af_xdp_queue_close(internals, q);
+	af_xdp_unload_prog(internals);
+	return -1;
+}
+
+/*
+ * This function gets called when the current port gets stopped.
+ */
+static void
+eth_dev_stop(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	unsigned int q;
+	int ret;
+
+	if (internals->prog_fd < 0)
+		return;
+
+	ret = af_xdp_link_set(internals->if_index, -1, internals->xdp_flags);
+	if (ret != 0)
+		RTE_LOG(ERR, PMD, "%s: could not detach XDP program: %s\n",
+			internals->if_name, strerror(-ret));
+
+	for (q = 0; q < internals->nb_queues; q++)
+		af_xdp_queue_close(internals, q);
+
+	af_xdp_unload_prog(internals);
+
+	dev->data->dev_link.link_status = ETH_LINK_DOWN;
+}
+
+static int
+eth_dev_configure(struct rte_eth_dev *dev __rte_unused)
+{
+	return 0;
+}
+
+static void
+eth_dev_info(struct rte_eth_dev *dev, struct rte_eth_dev_info *dev_info)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+
+	dev_info->if_index = internals->if_index;
+	dev_info->max_mac_addrs = 1;
+	dev_info->max_rx_pktlen = (uint32_t)ETH_FRAME_LEN;
+	dev_info->max_rx_queues = (uint16_t)internals->nb_queues;
+	dev_info->max_tx_queues = (uint16_t)internals->nb_queues;
+	dev_info->min_rx_bufsize = XDP_PACKET_HEADROOM + ETH_FRAME_LEN;
+}
+
+static void
+eth_stats_get(struct rte_eth_dev *dev, struct rte_eth_stats *stats)
+{
+	const struct pmd_internals *internals = dev->data->dev_private;
+	/* struct xdp_statistics, grown over kernel releases */
+	struct {
+		uint64_t rx_dropped;
+		uint64_t rx_invalid_descs;
+		uint64_t tx_invalid_descs;
+		uint64_t rx_ring_full;
+		uint64_t rx_fill_ring_empty_descs;
+		uint64_t tx_ring_empty_descs;
+	} xdp_stats;
+	socklen_t optlen;
+	unsigned int i;
+
+	for (i = 0; i < internals->nb_queues; i++) {
+		const struct pkt_rx_queue *rxq = &internals->rx_queue[i];
+		const struct pkt_tx_queue *txq = &internals->tx_queue[i];
+
+		if (i < RTE_ETHDEV_QUEUE_STAT_CNTRS) {
+			stats->q_ipackets[i] = rxq->rx_pkts;
+			stats->q_ibytes[i] = rxq->rx_bytes;
+			stats->q_opackets[i] = txq->tx_pkts;
+			stats->q_obytes[i] = txq->tx_bytes;
+			stats->q_errors[i] = txq->err_pkts;
+		}
+		stats->ipackets += rxq->rx_pkts;
+		stats->ibytes += rxq->rx_bytes;
+		stats->opackets += txq->tx_pkts;
+		stats->obytes += txq->tx_bytes;
+		stats->oerrors += txq->err_pkts;
+
+		if (rxq->xsk_fd < 0)
+			continue;
+
+		memset(&xdp_stats, 0, sizeof(xdp_stats));
+		optlen = sizeof(xdp_stats);
+		if (getsockopt(rxq->xsk_fd, SOL_XDP, XDP_STATISTICS,
+			       &xdp_stats, &optlen) == 0)
+			stats->imissed += xdp_stats.rx_dropped +
+				xdp_stats.rx_ring_full;
+	}
+}
+
+static void
+eth_stats_reset(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	unsigned int i;
+
+	for (i = 0; i < internals->nb_queues; i++) {
+		internals->rx_queue[i].rx_pkts = 0;
+		internals->rx_queue[i].rx_bytes = 0;
+		internals->tx_queue[i].tx_pkts = 0;
+		internals->tx_queue[i].err_pkts = 0;
+		internals->tx_queue[i].tx_bytes = 0;
+	}
+}
+
+static void
+eth_dev_close(struct rte_eth_dev *dev __rte_unused)
+{
+}
+
+static void
+eth_queue_release(void *q __rte_unused)
+{
+}
+
+static int
+eth_link_update(struct rte_eth_dev *dev __rte_unused,
+		int wait_to_complete __rte_unused)
+{
+	return 0;
+}
+
+static int
+eth_rx_queue_setup(struct rte_eth_dev *dev,
+		   uint16_t rx_queue_id,
+		   uint16_t nb_rx_desc,
+		   unsigned int socket_id __rte_unused,
+		   const struct rte_eth_rxconf *rx_conf __rte_unused,
+		   struct rte_mempool *mb_pool)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	struct pkt_rx_queue *pkt_q = &internals->rx_queue[rx_queue_id];
+	unsigned int buf_size;
+
+	/* the buffers are the UMEM chunks, received into past XDP headroom */
+	buf_size = rte_pktmbuf_data_room_size(mb_pool);
+	if (buf_size < XDP_PACKET_HEADROOM + ETH_FRAME_LEN ||
+	    buf_size > (unsigned int)getpagesize()) {
+		RTE_LOG(ERR, PMD,
+			"%s: mbuf data room %u out of AF_XDP chunk bounds\n",
+			dev->device->name, buf_size);
+		return -EINVAL;
+	}
+
+	pkt_q->mb_pool = mb_pool;
+	pkt_q->nb_desc = rte_align32pow2(nb_rx_desc);
+	pkt_q->in_port = dev->data->port_id;
+	dev->data->rx_queues[rx_queue_id] = pkt_q;
+
+	return 0;
+}
+
+static int
+eth_tx_queue_setup(struct rte_eth_dev *dev,
+		   uint16_t tx_queue_id,
+		   uint16_t nb_tx_desc,
+		   unsigned int socket_id __rte_unused,
+		   const struct rte_eth_txconf *tx_conf __rte_unused)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+	struct pkt_tx_queue *pkt_q = &internals->tx_queue[tx_queue_id];
+
+	pkt_q->pair = &internals->rx_queue[tx_queue_id];
+	pkt_q->nb_desc = rte_align32pow2(nb_tx_desc);
+	dev->data->tx_queues[tx_queue_id] = pkt_q;
+
+	return 0;
+}
+
+static void
+eth_dev_change_flags(char *if_name, uint32_t flags, uint32_t mask)
+{
+	struct ifreq ifr;
+	int s;
+
+	s = socket(PF_INET, SOCK_DGRAM, 0);
+	if (s < 0)
+		return;
+
+	snprintf(ifr.ifr_name, IFNAMSIZ, "%s", if_name);
+	if (ioctl(s, SIOCGIFFLAGS, &ifr) < 0)
+		goto out;
+	ifr.ifr_flags &= mask;
+	ifr.ifr_flags |= flags;
+	if (ioctl(s, SIOCSIFFLAGS, &ifr) < 0)
+		goto out;
+out:
+	close(s);
+}
+
+static void
+eth_dev_promiscuous_enable(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+
+	eth_dev_change_flags(internals->if_name, IFF_PROMISC, ~0);
+}
+
+static void
+eth_dev_promiscuous_disable(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *internals = dev->data->dev_private;
+
+	eth_dev_change_flags(internals->if_name, 0, ~IFF_PROMISC);
+}
+
+static const struct eth_dev_ops ops = {
+	.dev_start = eth_dev_start,
+	.dev_stop = eth_dev_stop,
+	.dev_close = eth_dev_close,
+	.dev_configure = eth_dev_configure,
+	.dev_infos_get = eth_dev_info,
+	.promiscuous_enable = eth_dev_promiscuous_enable,
+	.promiscuous_disable = eth_dev_promiscuous_disable,
+	.rx_queue_setup = eth_rx_queue_setup,
+	.tx_queue_setup = eth_tx_queue_setup,
+	.rx_queue_release = eth_queue_release,
+	.tx_queue_release = eth_queue_release,
+	.link_update = eth_link_update,
+	.stats_get = eth_stats_get,
+	.stats_reset = eth_stats_reset,
+};
+
+/* Number of Rx queues of an interface, which bounds the queues to bind */
+static int
+af_xdp_get_nb_rx_queues(const char *if_name)
+{
+	char path[PATH_MAX];
+	struct dirent *e;
+	DIR *dir;
+	int n = 0;
+
+	snprintf(path, sizeof(path), "/sys/class/net/%s/queues", if_name);
+	dir = opendir(path);
+	if (dir == NULL)
+		return -1;
+
+	while ((e = readdir(dir)) != NULL)
+		if (strncmp(e->d_name, "rx-", 3) == 0)
+			n++;
+	closedir(dir);
+
+	return n;
+}
+
+static int
+rte_pmd_init_internals(struct rte_vdev_device *dev,
+		       const char *if_name,
+		       unsigned int nb_queues,
+		       unsigned int start_queue,
+		       int xdp_mode)
+{
+	const char *name = rte_vdev_device_name(dev);
+	const unsigned int numa_node = dev->device.numa_node;
+	struct pmd_internals *internals;
+	struct rte_eth_dev_data *data;
+	struct rte_eth_dev *eth_dev;
+	struct ifreq ifr;
+	unsigned int q;
+	int sockfd;
+
+	if (strlen(if_name) >= sizeof(ifr.ifr_name)) {
+		RTE_LOG(ERR, PMD, "%s: I/F name too long (%s)\n",
+			name, if_name);
+		return -1;
+	}
+
+	RTE_LOG(INFO, PMD,
+		"%s: creating AF_XDP-backed ethdev on numa socket %u\n",
+		name, numa_node);
+
+	data = rte_zmalloc_socket(name, sizeof(*data), 0, numa_node);
+	if (data == NULL)
+		return -1;
+
+	internals = rte_zmalloc_socket(name, sizeof(*internals), 0,
+				       numa_node);
+	if (internals == NULL)
+		goto error_early;
+
+	internals->nb_queues = nb_queues;
+	internals->start_queue = start_queue;
+	internals->xdp_mode = xdp_mode;
+	internals->prog_fd = -1;
+	internals->xskmap_fd = -1;
+	for (q = 0; q < RTE_PMD_AF_XDP_MAX_QUEUES; q++)
+		internals->rx_queue[q].xsk_fd = -1;
+
+	sockfd = socket(PF_INET, SOCK_DGRAM, 0);
+	if (sockfd < 0)
+		goto error;
+
+	snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", if_name);
+	if (ioctl(sockfd, SIOCGIFINDEX, &ifr) == -1) {
+		RTE_LOG(ERR, PMD, "%s: ioctl failed (SIOCGIFINDEX)\n", name);
+		close(sockfd);
+		goto error;
+	}
+	internals->if_index = ifr.ifr_ifindex;
+
+	if (ioctl(sockfd, SIOCGIFHWADDR, &ifr) == -1) {
+		RTE_LOG(ERR, PMD, "%s: ioctl failed (SIOCGIFHWADDR)\n", name);
+		close(sockfd);
+		goto error;
+	}
+	memcpy(&internals->eth_addr, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+	close(sockfd);
+
+	internals->if_name = strdup(if_name);
+	if (internals->if_name == NULL)
+		goto error;
+
+	/* reserve an ethdev entry */
+	eth_dev = rte_eth_vdev_allocate(dev, 0);
+	if (eth_dev == NULL)
+		goto error;
+
+	/*
+	 * now put it all together
+	 * - store queue data in internals,
+	 * - point eth_dev_data to internals
+	 * - and point eth_dev structure to new eth_dev_data structure
+	 */
+	rte_memcpy(data, eth_dev->data, sizeof(*data));
+	data->dev_private = internals;
+	data->nb_rx_queues = (uint16_t)nb_queues;
+	data->nb_tx_queues = (uint16_t)nb_queues;
+	data->dev_link = pmd_link;
+	data->mac_addrs = &internals->eth_addr;
+
+	eth_dev->data = data;
+	eth_dev->dev_ops = &ops;
+	eth_dev->data->dev_flags = RTE_ETH_DEV_DETACHABLE;
+
+	eth_dev->rx_pkt_burst = eth_af_xdp_rx;
+	eth_dev->tx_pkt_burst = eth_af_xdp_tx;
+
+	return 0;
+
+error:
+	free(internals->if_name);
+	rte_free(internals);
+error_early:
+	rte_free(data);
+	return -1;
+}
+
+static int
+rte_pmd_af_xdp_probe(struct rte_vdev_device *dev)
+{
+	const char *name = rte_vdev_device_name(dev);
+	struct rte_kvargs *kvlist;
+	struct rte_kvargs_pair *pair;
+	const char *if_name = NULL;
+	unsigned int qpairs = 1;
+	unsigned long start_queue = 0;
+	int nb_rx_queues;
+	int xdp_mode = 0;
+	unsigned int k_idx;
+	char *end;
+	int ret = -1;
+
+	if (name == NULL)
+		return -1;
+
+	RTE_LOG(INFO, PMD, "Initializing pmd_af_xdp for %s\n", name);
+
+	kvlist = rte_kvargs_parse(rte_vdev_device_args(dev), valid_arguments);
+	if (kvlist == NULL)
+		return -1;
+
+	/*
+	 * Walk arguments for configurable settings
+	 */
+	for (k_idx = 0; k_idx < kvlist->count; k_idx++) {
+		pair = &kvlist->pairs[k_idx];
+		if (strcmp(pair->key, ETH_AF_XDP_IFACE_ARG) == 0) {
+			if_name = pair->value;
+		} else if (strcmp(pair->key, ETH_AF_XDP_NUM_Q_ARG) == 0) {
+			qpairs = atoi(pair->value);
+			if (qpairs < 1 || qpairs > RTE_PMD_AF_XDP_MAX_QUEUES) {
+				RTE_LOG(ERR, PMD,
+					"%s: invalid qpairs value\n", name);
+				goto exit;
+			}
+		} else if (strcmp(pair->key, ETH_AF_XDP_START_Q_ARG) == 0) {
+			start_queue = strtoul(pair->value, &end, 10);
+			if (*pair->value == '\0' || *end != '\0') {
+				RTE_LOG(ERR, PMD,
+					"%s: invalid start_queue value\n",
+					name);
+				goto exit;
+			}
+		} else if (strcmp(pair->key, ETH_AF_XDP_MODE_ARG) == 0) {
+			if (strcmp(pair->value, ETH_AF_XDP_MODE_NATIVE) == 0)
+				xdp_mode = XDP_FLAGS_DRV_MODE;
+			else if (strcmp(pair->value,
+					ETH_AF_XDP_MODE_GENERIC) == 0)
+				xdp_mode = XDP_FLAGS_SKB_MODE;
+			else {
+				RTE_LOG(ERR, PMD,
+					"%s: invalid xdp_mode value\n", name);
+				goto exit;
+			}
+		}
+	}
+
+	if (if_name == NULL) {
+		RTE_LOG(ERR, PMD,
+			"%s: no interface specified for AF_XDP ethdev\n",
+			name);
+		goto exit;
+	}
+
+	nb_rx_queues = af_xdp_get_nb_rx_queues(if_name);
+	if (nb_rx_queues < 0) {
+		RTE_LOG(ERR, PMD, "%s: cannot get the queues of %s\n",
+			name, if_name);
+		goto exit;
+	}
+	if (start_queue >= (unsigned long)nb_rx_queues ||
+	    qpairs > nb_rx_queues - start_queue) {
+		RTE_LOG(ERR, PMD,
+			"%s: queues %lu to %lu out of the %d of %s\n",
+			name, start_queue, start_queue + qpairs - 1,
+			nb_rx_queues, if_name);
+		goto exit;
+	}
+
+	if (dev->device.numa_node == SOCKET_ID_ANY)
+		dev->device.numa_node = rte_socket_id();
+
+	ret = rte_pmd_init_internals(dev, if_name, qpairs, start_queue,
+				     xdp_mode);
+
+exit:
+	rte_kvargs_free(kvlist);
+	return ret;
+}
+
+static int
+rte_pmd_af_xdp_remove(struct rte_vdev_device *dev)
+{
+	struct rte_eth_dev *eth_dev = NULL;
+	struct pmd_internals *internals;
+
+	RTE_LOG(INFO, PMD, "Closing AF_XDP ethdev on numa socket %u\n",
+		rte_socket_id());
+
+	if (dev == NULL)
+		return -1;
+
+	/* find the ethdev entry */
+	eth_dev = rte_eth_dev_allocated(rte_vdev_device_name(dev));
+	if (eth_dev == NULL)
+		return -1;
+
+	eth_dev_stop(eth_dev);
+
+	internals = eth_dev->data->dev_private;
+	free(internals->if_name);
+
+	rte_free(eth_dev->data->dev_private);
+	rte_free(eth_dev->data);
+
+	rte_eth_dev_release_port(eth_dev);
+
+	return 0;
+}
+
+static struct rte_vdev_driver pmd_af_xdp_drv = {
+	.probe = rte_pmd_af_xdp_probe,
+	.remove = rte_pmd_af_xdp_remove,
+};
+
+RTE_PMD_REGISTER_VDEV(net_af_xdp, pmd_af_xdp_drv);
+RTE_PMD_REGISTER_PARAM_STRING(net_af_xdp,
+	"iface=<string> "
+	"qpairs=<int> "
+	"start_queue=<int> "
+	"xdp_mode=<native|generic>");
@@ -116,6 +116,8 @@ extern "C" {
 /**< Layer 2+3 (Ethernet MAC + IP Addresses) transmit load balancing */
 #define BALANCE_XMIT_POLICY_LAYER34		(2)
 /**< Layer 3+4 (IP Addresses + UDP Ports) transmit load balancing */
+#define BALANCE_XMIT_POLICY_RSS			(3)
+/**< RSS hash of the packet if set on Rx, layer 3+4 otherwise */
 
 /**
  * Create a bonded rte_eth_dev device
@@ -369,6 +371,41 @@ rte_eth_bond_link_up_prop_delay_set(uint8_t bonded_port_id, uint32_t delay_ms);
 int
 rte_eth_bond_link_up_prop_delay_get(uint8_t bonded_port_id);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Set the period in milliseconds at which the balance and 802.3ad transmit
+ * hash buckets are remapped to slaves according to their measured load.
+ * Packets are then hashed to 128 buckets with the transmit
+ * policy, and each period buckets are moved from the most to the least
+ * loaded slave. Packets of a moved flow may be reordered once.
+ *
+ * @param bonded_port_id	Port ID of bonded device.
+ * @param interval_ms		Rebalancing period in milliseconds, 0 to
+ *				disable adaptive balancing.
+ *
+ * @return
+ *  0 on success, negative value otherwise.
+ */
+int
+rte_eth_bond_adaptive_balance_set(uint8_t bonded_port_id, uint32_t interval_ms);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the adaptive balancing period of a bonded device.
+ *
+ * @param bonded_port_id	Port ID of bonded device.
+ *
+ * @return
+ *  Rebalancing period in milliseconds, 0 if disabled, negative value
+ *  otherwise.
+ */
+int
+rte_eth_bond_adaptive_balance_get(uint8_t bonded_port_id);
+
 
 #ifdef __cplusplus
 }
@@ -817,6 +817,29 @@ rx_machine_update(struct bond_dev_private *internals, uint8_t slave_id,
 		rx_machine(internals, slave_id, NULL);
 }
 
+/* Dequeue slow packets queued by the RX burst of given slave until a LACPDU
+ * is found. Markers are answered on the way; the LACPDU is returned, or NULL
+ * if the ring holds none.
+ */
+static struct rte_mbuf *
+slow_rx_ring_dequeue(struct bond_dev_private *internals, uint8_t slave_id)
+{
+	struct port *port = &mode_8023ad_ports[slave_id];
+	struct slow_protocol_frame *hdr;
+	void *pkt;
+
+	while (rte_ring_dequeue(port->rx_ring, &pkt) == 0) {
+		hdr = rte_pktmbuf_mtod((struct rte_mbuf *)pkt,
+				struct slow_protocol_frame *);
+		if (hdr->slow_protocol.subtype == SLOW_SUBTYPE_LACP)
+			return pkt;
+
+		bond_mode_8023ad_handle_slow_pkt(internals, slave_id, pkt);
+	}
+
+	return NULL;
+}
+
 static void
 bond_mode_8023ad_periodic_cb(void *arg)
 {
@@ -887,15 +910,10 @@ bond_mode_8023ad_periodic_cb(void *arg)
 		SM_FLAG_SET(port, LACP_ENABLED);
 
 		if (internals->mode4.dedicated_queues.enabled == 0) {
-			/* Find LACP packet to this port. Do not check subtype,
-			 * it is done in function that queued packet
+			/* Find LACP packet to this port, answering the markers
+			 * queued before it.
 			 */
-			int retval = rte_ring_dequeue(port->rx_ring,
-					(void **)&lacp_pkt);
-
-			if (retval != 0)
-				lacp_pkt = NULL;
-
+			lacp_pkt = slow_rx_ring_dequeue(internals, slave_id);
 			rx_machine_update(internals, slave_id, lacp_pkt);
 		} else {
 			uint16_t rx_count = rte_eth_rx_burst(slave_id,
@@ -918,6 +936,9 @@ bond_mode_8023ad_periodic_cb(void *arg)
 		show_warnings(slave_id);
 	}
 
+	/* Publish the distributing slaves to the Tx path */
+	bond_tx_slaves_update(internals);
+
 	rte_eal_alarm_set(internals->mode4.update_timeout_us,
 			bond_mode_8023ad_periodic_cb, arg);
 }
@@ -1357,6 +1378,17 @@ bond_mode_8023ad_handle_slow_pkt(struct bond_dev_private *internals,
 	rte_pktmbuf_free(pkt);
 }
 
+void
+bond_mode_8023ad_queue_slow_pkt(uint8_t slave_id, struct rte_mbuf *pkt)
+{
+	struct port *port = &mode_8023ad_ports[slave_id];
+
+	if (unlikely(rte_ring_enqueue(port->rx_ring, pkt) != 0)) {
+		set_warning_flags(port, WRN_RX_QUEUE_FULL);
+		rte_pktmbuf_free(pkt);
+	}
+}
+
 int
 rte_eth_bond_8023ad_conf_get_v20(uint8_t port_id,
 		struct rte_eth_bond_8023ad_conf *conf)
@@ -1643,6 +1675,8 @@ rte_eth_bond_8023ad_ext_distrib(uint8_t port_id, uint8_t slave_id, int enabled)
 	else
 		ACTOR_STATE_CLR(port, DISTRIBUTING);
 
+	bond_tx_slaves_update(rte_eth_devices[port_id].data->dev_private);
+
 	return 0;
 }
 
@@ -1708,22 +1742,14 @@ bond_mode_8023ad_ext_periodic_cb(void *arg)
 	struct rte_eth_dev *bond_dev = arg;
 	struct bond_dev_private *internals = bond_dev->data->dev_private;
 	struct mode8023ad_private *mode4 = &internals->mode4;
-	struct port *port;
-	void *pkt = NULL;
+	struct rte_mbuf *lacp_pkt;
 	uint16_t i, slave_id;
 
 	for (i = 0; i < internals->active_slave_count; i++) {
 		slave_id = internals->active_slaves[i];
-		port = &mode_8023ad_ports[slave_id];
-
-		if (rte_ring_dequeue(port->rx_ring, &pkt) == 0) {
-			struct rte_mbuf *lacp_pkt = pkt;
-			struct lacpdu_header *lacp;
-
-			lacp = rte_pktmbuf_mtod(lacp_pkt,
-						struct lacpdu_header *);
-			RTE_VERIFY(lacp->lacpdu.subtype == SLOW_SUBTYPE_LACP);
 
+		lacp_pkt = slow_rx_ring_dequeue(internals, slave_id);
+		if (lacp_pkt != NULL) {
 			/* This is LACP frame so pass it to rx callback.
 			 * Callback is responsible for freeing mbuf.
 			 */
@@ -44,8 +44,8 @@
 #include "rte_eth_bond_8023ad.h"
 
 #define BOND_MODE_8023AX_UPDATE_TIMEOUT_MS  100
-/** Maximum number of packets to one slave queued in TX ring. */
-#define BOND_MODE_8023AX_SLAVE_RX_PKTS        3
+/** Maximum number of slow packets from one slave queued in RX ring. */
+#define BOND_MODE_8023AX_SLAVE_RX_PKTS        7
 /** Maximum number of LACP packets from one slave queued in TX ring. */
 #define BOND_MODE_8023AX_SLAVE_TX_PKTS        1
 /**
@@ -281,6 +281,19 @@ void
 bond_mode_8023ad_handle_slow_pkt(struct bond_dev_private *internals,
 	uint8_t slave_id, struct rte_mbuf *pkt);
 
+/**
+ * @internal
+ *
+ * Queues given LACP or marker packet received on the data path to the slave
+ * control ring, from which it is handled by the periodic callback. The packet
+ * is freed if the ring is full.
+ *
+ * @param slave_id Slave port id.
+ * @param pkt Slow packet.
+ */
+void
+bond_mode_8023ad_queue_slow_pkt(uint8_t slave_id, struct rte_mbuf *pkt);
+
 /**
  * @internal
  *
@@ -100,6 +100,8 @@ activate_slave(struct rte_eth_dev *eth_dev, uint8_t port_id)
 	internals->active_slaves[internals->active_slave_count] = port_id;
 	internals->active_slave_count++;
 
+	bond_tx_slaves_update(internals);
+
 	if (internals->mode == BONDING_MODE_TLB)
 		bond_tlb_activate_slave(internals);
 	if (internals->mode == BONDING_MODE_ALB)
@@ -135,6 +137,7 @@ deactivate_slave(struct rte_eth_dev *eth_dev, uint8_t port_id)
 
 	RTE_ASSERT(active_count < RTE_DIM(internals->active_slaves));
 	internals->active_slave_count = active_count;
+	bond_tx_slaves_update(internals);
 
 	if (eth_dev->data->dev_started) {
 		if (internals->mode == BONDING_MODE_8023AD) {
@@ -660,14 +663,22 @@ rte_eth_bond_xmit_policy_set(uint8_t bonded_port_id, uint8_t policy)
 	case BALANCE_XMIT_POLICY_LAYER2:
 		internals->balance_xmit_policy = policy;
 		internals->xmit_hash = xmit_l2_hash;
+		internals->burst_xmit_hash = burst_xmit_l2_hash;
 		break;
 	case BALANCE_XMIT_POLICY_LAYER23:
 		internals->balance_xmit_policy = policy;
 		internals->xmit_hash = xmit_l23_hash;
+		internals->burst_xmit_hash = burst_xmit_l23_hash;
 		break;
 	case BALANCE_XMIT_POLICY_LAYER34:
 		internals->balance_xmit_policy = policy;
 		internals->xmit_hash = xmit_l34_hash;
+		internals->burst_xmit_hash = burst_xmit_l34_hash;
+		break;
+	case BALANCE_XMIT_POLICY_RSS:
+		internals->balance_xmit_policy = policy;
+		internals->xmit_hash = xmit_rss_hash;
+		internals->burst_xmit_hash = burst_xmit_rss_hash;
 		break;
 
 	default:
@@ -771,3 +782,42 @@ rte_eth_bond_link_up_prop_delay_get(uint8_t bonded_port_id)
 
 	return internals->link_up_delay_ms;
 }
+
+int
+rte_eth_bond_adaptive_balance_set(uint8_t bonded_port_id, uint32_t interval_ms)
+{
+	struct rte_eth_dev *bonded_eth_dev;
+	struct bond_dev_private *internals;
+
+	if (valid_bonded_port_id(bonded_port_id) != 0)
+		return -1;
+
+	bonded_eth_dev = &rte_eth_devices[bonded_port_id];
+	internals = bonded_eth_dev->data->dev_private;
+
+	if (!bonded_eth_dev->data->dev_started) {
+		internals->balance.interval_ms = interval_ms;
+		return 0;
+	}
+
+	bond_balance_disable(internals);
+	internals->balance.interval_ms = interval_ms;
+	if (internals->mode == BONDING_MODE_BALANCE ||
+			internals->mode == BONDING_MODE_8023AD)
+		bond_balance_enable(internals);
+
+	return 0;
+}
+
+int
+rte_eth_bond_adaptive_balance_get(uint8_t bonded_port_id)
+{
+	struct bond_dev_private *internals;
+
+	if (valid_bonded_port_id(bonded_port_id) != 0)
+		return -1;
+
+	internals = rte_eth_devices[bonded_port_id].data->dev_private;
+
+	return internals->balance.interval_ms;
+}
@@ -79,6 +79,60 @@ get_vlan_offset(struct ether_hdr *eth_hdr, uint16_t *proto)
 	return vlan_offset;
 }
 
+void
+bond_tx_slaves_update(struct bond_dev_private *internals)
+{
+	struct bond_tx_slaves tx_slaves;
+	uint8_t i;
+
+	/*
+	 * Build the snapshot under the lock too, so that a concurrent update
+	 * working from older slave states cannot publish after this one.
+	 */
+	rte_spinlock_lock(&internals->tx_slaves_lock);
+
+	memset(&tx_slaves, 0, sizeof(tx_slaves));
+	tx_slaves.slave_count = internals->active_slave_count;
+	memcpy(tx_slaves.slaves, internals->active_slaves,
+			sizeof(tx_slaves.slaves[0]) * tx_slaves.slave_count);
+
+	if (internals->mode == BONDING_MODE_8023AD) {
+		for (i = 0; i < tx_slaves.slave_count; i++) {
+			struct port *port =
+				&mode_8023ad_ports[tx_slaves.slaves[i]];
+
+			if (ACTOR_STATE(port, DISTRIBUTING))
+				tx_slaves.distributing[
+					tx_slaves.distributing_count++] = i;
+		}
+	}
+
+	if (memcmp(&tx_slaves, &internals->tx_slaves, sizeof(tx_slaves))) {
+		internals->tx_slaves_seq++;
+		rte_smp_wmb();
+		memcpy(&internals->tx_slaves, &tx_slaves, sizeof(tx_slaves));
+		rte_smp_wmb();
+		internals->tx_slaves_seq++;
+	}
+	rte_spinlock_unlock(&internals->tx_slaves_lock);
+}
+
+/* Copy the Tx slaves snapshot, retrying if it was updated meanwhile */
+static inline void
+bond_tx_slaves_get(const struct bond_dev_private *internals,
+		struct bond_tx_slaves *tx_slaves)
+{
+	uint32_t seq;
+
+	do {
+		seq = internals->tx_slaves_seq;
+		rte_smp_rmb();
+		/* a fixed size copy is cheaper than sizing it on the counts */
+		*tx_slaves = internals->tx_slaves;
+		rte_smp_rmb();
+	} while (unlikely((seq & 1) || seq != internals->tx_slaves_seq));
+}
+
 static uint16_t
 bond_ethdev_rx_burst(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 {
@@ -295,6 +349,46 @@ bond_ethdev_rx_burst_8023ad_fast_queue(void *queue, struct rte_mbuf **bufs,
 	return num_rx_total;
 }
 
+/* Select the position among slave_count Tx slaves of each packet of a burst.
+ * With adaptive balancing, packets are hashed to buckets, whose bytes are
+ * counted per queue, and the buckets are mapped to slaves by a table
+ * rebalanced periodically.
+ */
+static inline void
+bond_tx_select_slaves(struct bond_dev_private *internals,
+		struct bond_tx_queue *bd_tx_q, struct rte_mbuf **bufs,
+		uint16_t nb_pkts, uint8_t slave_count, uint16_t *bufs_slave_idx)
+{
+	const struct bond_balance *balance = &internals->balance;
+	uint16_t i, bucket, slave;
+	uint8_t table_slave_count;
+
+	if (likely(balance->interval_ms == 0)) {
+		internals->burst_xmit_hash(bufs, nb_pkts, slave_count,
+				bufs_slave_idx);
+		return;
+	}
+
+	internals->burst_xmit_hash(bufs, nb_pkts, BOND_BALANCE_BUCKETS,
+			bufs_slave_idx);
+
+	table_slave_count = balance->slave_count;
+	rte_smp_rmb();
+
+	for (i = 0; i < nb_pkts; i++) {
+		bucket = bufs_slave_idx[i];
+		bd_tx_q->bucket_bytes[bucket] += rte_pktmbuf_pkt_len(bufs[i]);
+
+		/* The table may be rebuilt for another slave count meanwhile */
+		slave = balance->bucket_slave[bucket];
+		if (unlikely(table_slave_count != slave_count ||
+				slave >= slave_count))
+			slave = bucket % slave_count;
+
+		bufs_slave_idx[i] = slave;
+	}
+}
+
 static uint16_t
 bond_ethdev_tx_burst_8023ad_fast_queue(void *queue, struct rte_mbuf **bufs,
 		uint16_t nb_pkts)
@@ -302,20 +396,18 @@ bond_ethdev_tx_burst_8023ad_fast_queue(void *queue, struct rte_mbuf **bufs,
 	struct bond_dev_private *internals;
 	struct bond_tx_queue *bd_tx_q;
 
+	struct bond_tx_slaves tx_slaves;
 	uint8_t num_of_slaves;
-	uint8_t slaves[RTE_MAX_ETHPORTS];
-	 /* positions in slaves, not ID */
-	uint8_t distributing_offsets[RTE_MAX_ETHPORTS];
-	uint8_t distributing_count;
+	uint8_t *slaves = tx_slaves.slaves;
 
 	uint16_t num_tx_slave, num_tx_total = 0, num_tx_fail_total = 0;
-	uint16_t i, op_slave_idx;
+	uint16_t i;
 
 	struct rte_mbuf *slave_bufs[RTE_MAX_ETHPORTS][nb_pkts];
+	uint16_t bufs_slave_idx[nb_pkts];
 
 	/* Total amount of packets in slave_bufs */
 	uint16_t slave_nb_pkts[RTE_MAX_ETHPORTS] = { 0 };
-	/* Slow packets placed in each slave */
 
 	if (unlikely(nb_pkts == 0))
 		return 0;
@@ -325,35 +417,25 @@ bond_ethdev_tx_burst_8023ad_fast_queue(void *queue, struct rte_mbuf **bufs,
 
 	/* Copy slave list to protect against slave up/down changes during tx
 	 * bursting */
-	num_of_slaves = internals->active_slave_count;
+	bond_tx_slaves_get(internals, &tx_slaves);
+	num_of_slaves = tx_slaves.slave_count;
 	if (num_of_slaves < 1)
 		return num_tx_total;
 
-	memcpy(slaves, internals->active_slaves, sizeof(slaves[0]) *
-			num_of_slaves);
-
-	distributing_count = 0;
-	for (i = 0; i < num_of_slaves; i++) {
-		struct port *port = &mode_8023ad_ports[slaves[i]];
-		if (ACTOR_STATE(port, DISTRIBUTING))
-			distributing_offsets[distributing_count++] = i;
-	}
+	if (likely(tx_slaves.distributing_count > 0)) {
+		/* Select output slaves using hash based on xmit policy */
+		bond_tx_select_slaves(internals, bd_tx_q, bufs, nb_pkts,
+				tx_slaves.distributing_count, bufs_slave_idx);
 
-	if (likely(distributing_count > 0)) {
-		/* Populate slaves mbuf with the packets which are to be sent */
+		/* Populate slave mbuf arrays with mbufs for that slave.
+		 * Use only slaves that are currently distributing.
+		 */
 		for (i = 0; i < nb_pkts; i++) {
-			/* Select output slave using hash based on xmit policy */
-			op_slave_idx = internals->xmit_hash(bufs[i],
-					distributing_count);
-
-			/* Populate slave mbuf arrays with mbufs for that slave.
-			 * Use only slaves that are currently distributing.
-			 */
 			uint8_t slave_offset =
-					distributing_offsets[op_slave_idx];
-			slave_bufs[slave_offset][slave_nb_pkts[slave_offset]] =
+				tx_slaves.distributing[bufs_slave_idx[i]];
+
+			slave_bufs[slave_offset][slave_nb_pkts[slave_offset]++] =
 					bufs[i];
-			slave_nb_pkts[slave_offset]++;
 		}
 	}
 
@@ -399,7 +481,8 @@ bond_ethdev_rx_burst_8023ad(void *queue, struct rte_mbuf **bufs,
 
 	uint8_t collecting;  /* current slave collecting status */
 	const uint8_t promisc = internals->promiscuous_en;
-	uint8_t i, j, k;
+	uint16_t j, k, num_rx_slave;
+	uint8_t i;
 	uint8_t subtype;
 
 	rte_eth_macaddr_get(internals->port_id, &bond_mac);
@@ -415,55 +498,64 @@ bond_ethdev_rx_burst_8023ad(void *queue, struct rte_mbuf **bufs,
 		idx = 0;
 	}
 	for (i = 0; i < slave_count && num_rx_total < nb_pkts; i++) {
-		j = num_rx_total;
 		collecting = ACTOR_STATE(&mode_8023ad_ports[slaves[idx]],
 					 COLLECTING);
 
 		/* Read packets from this slave */
-		num_rx_total += rte_eth_rx_burst(slaves[idx], bd_rx_q->queue_id,
+		num_rx_slave = rte_eth_rx_burst(slaves[idx], bd_rx_q->queue_id,
 				&bufs[num_rx_total], nb_pkts - num_rx_total);
 
-		for (k = j; k < 2 && k < num_rx_total; k++)
-			rte_prefetch0(rte_pktmbuf_mtod(bufs[k], void *));
+		for (j = 0; j < 2 && j < num_rx_slave; j++)
+			rte_prefetch0(rte_pktmbuf_mtod(bufs[num_rx_total + j],
+						void *));
 
-		/* Handle slow protocol packets. */
-		while (j < num_rx_total) {
+		/* Filter the received packets in place: k is the next free
+		 * slot, j the next packet to check.
+		 */
+		k = num_rx_total;
+		for (j = num_rx_total; j < num_rx_total + num_rx_slave; j++) {
+			struct rte_mbuf *m = bufs[j];
 
-			/* If packet is not pure L2 and is known, skip it */
-			if ((bufs[j]->packet_type & ~RTE_PTYPE_L2_ETHER) != 0) {
-				j++;
+			if (j + 3 < num_rx_total + num_rx_slave)
+				rte_prefetch0(rte_pktmbuf_mtod(bufs[j + 3], void *));
+
+			/* If packet is not pure L2 and is known, keep it */
+			if ((m->packet_type & ~RTE_PTYPE_L2_ETHER) != 0) {
+				bufs[k++] = m;
 				continue;
 			}
 
-			if (j + 3 < num_rx_total)
-				rte_prefetch0(rte_pktmbuf_mtod(bufs[j + 3], void *));
-
-			hdr = rte_pktmbuf_mtod(bufs[j], struct ether_hdr *);
+			hdr = rte_pktmbuf_mtod(m, struct ether_hdr *);
 			subtype = ((struct slow_protocol_frame *)hdr)->slow_protocol.subtype;
 
-			/* Remove packet from array if it is slow packet or slave is not
-			 * in collecting state or bonding interface is not in promiscuous
-			 * mode and packet address does not match. */
-			if (unlikely(is_lacp_packets(hdr->ether_type, subtype, bufs[j]->vlan_tci) ||
-				!collecting || (!promisc &&
+			/* LACPDUs and markers are only queued to the slave
+			 * control ring here, and handled by the mode 4
+			 * periodic callback.
+			 */
+			if (unlikely(is_lacp_packets(hdr->ether_type, subtype,
+					m->vlan_tci))) {
+				bond_mode_8023ad_queue_slow_pkt(slaves[idx], m);
+				continue;
+			}
+
+			/* Drop packet if slave is not in collecting state or
+			 * bonding interface is not in promiscuous mode and
+			 * packet address does not match. */
+			if (unlikely(!collecting || (!promisc &&
 					!is_multicast_ether_addr(&hdr->d_addr) &&
 					!is_same_ether_addr(&bond_mac, &hdr->d_addr)))) {
-
-				if (hdr->ether_type == ether_type_slow_be) {
+				if (hdr->ether_type == ether_type_slow_be)
 					bond_mode_8023ad_handle_slow_pkt(
-					    internals, slaves[idx], bufs[j]);
-				} else
-					rte_pktmbuf_free(bufs[j]);
-
-				/* Packet is managed by mode 4 or dropped, shift the array */
-				num_rx_total--;
-				if (j < num_rx_total) {
-					memmove(&bufs[j], &bufs[j + 1], sizeof(bufs[0]) *
-						(num_rx_total - j));
-				}
-			} else
-				j++;
+					    internals, slaves[idx], m);
+				else
+					rte_pktmbuf_free(m);
+				continue;
+			}
+
+			bufs[k++] = m;
 		}
+		num_rx_total = k;
+
 		if (unlikely(++idx == slave_count))
 			idx = 0;
 	}
@@ -776,18 +868,18 @@ ipv6_hash(struct ipv6_hdr *ipv6_hdr)
 			(word_src_addr[3] ^ word_dst_addr[3]);
 }
 
-uint16_t
-xmit_l2_hash(const struct rte_mbuf *buf, uint8_t slave_count)
+static inline uint32_t
+l2_hash(const struct rte_mbuf *buf)
 {
 	struct ether_hdr *eth_hdr = rte_pktmbuf_mtod(buf, struct ether_hdr *);
 
 	uint32_t hash = ether_hash(eth_hdr);
 
-	return (hash ^= hash >> 8) % slave_count;
+	return hash ^ (hash >> 8);
 }
 
-uint16_t
-xmit_l23_hash(const struct rte_mbuf *buf, uint8_t slave_count)
+static inline uint32_t
+l23_hash(const struct rte_mbuf *buf)
 {
 	struct ether_hdr *eth_hdr = rte_pktmbuf_mtod(buf, struct ether_hdr *);
 	uint16_t proto = eth_hdr->ether_type;
@@ -811,11 +903,11 @@ xmit_l23_hash(const struct rte_mbuf *buf, uint8_t slave_count)
 	hash ^= hash >> 16;
 	hash ^= hash >> 8;
 
-	return hash % slave_count;
+	return hash;
 }
 
-uint16_t
-xmit_l34_hash(const struct rte_mbuf *buf, uint8_t slave_count)
+static inline uint32_t
+l34_hash(const struct rte_mbuf *buf)
 {
 	struct ether_hdr *eth_hdr = rte_pktmbuf_mtod(buf, struct ether_hdr *);
 	uint16_t proto = eth_hdr->ether_type;
@@ -865,7 +957,105 @@ xmit_l34_hash(const struct rte_mbuf *buf, uint8_t slave_count)
 	hash ^= hash >> 16;
 	hash ^= hash >> 8;
 
-	return hash % slave_count;
+	return hash;
+}
+
+/*
+ * The RSS hash set by the Rx NIC is already a flow hash, and it avoids
+ * reading the packet headers at all.
+ */
+static inline uint32_t
+rss_hash(const struct rte_mbuf *buf)
+{
+	uint32_t hash;
+
+	if (!(buf->ol_flags & PKT_RX_RSS_HASH))
+		return l34_hash(buf);
+
+	hash = buf->hash.rss;
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+
+	return hash;
+}
+
+uint16_t
+xmit_l2_hash(const struct rte_mbuf *buf, uint8_t slave_count)
+{
+	return l2_hash(buf) % slave_count;
+}
+
+uint16_t
+xmit_l23_hash(const struct rte_mbuf *buf, uint8_t slave_count)
+{
+	return l23_hash(buf) % slave_count;
+}
+
+uint16_t
+xmit_l34_hash(const struct rte_mbuf *buf, uint8_t slave_count)
+{
+	return l34_hash(buf) % slave_count;
+}
+
+uint16_t
+xmit_rss_hash(const struct rte_mbuf *buf, uint8_t slave_count)
+{
+	return rss_hash(buf) % slave_count;
+}
+
+/* Distance in packets of the header prefetches of the burst hashes */
+#define BURST_HASH_PREFETCH_OFFSET	4
+
+/*
+ * Hash a whole burst in one loop, with the headers of the next packets
+ * prefetched. The hash function is inlined in each policy variant.
+ */
+static __rte_always_inline void
+burst_xmit_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves,
+		uint32_t (*hash)(const struct rte_mbuf *), int prefetch)
+{
+	uint16_t i;
+
+	if (prefetch)
+		for (i = 0; i < BURST_HASH_PREFETCH_OFFSET && i < nb_pkts; i++)
+			rte_prefetch0(rte_pktmbuf_mtod(buf[i], void *));
+
+	for (i = 0; i < nb_pkts; i++) {
+		if (prefetch && i + BURST_HASH_PREFETCH_OFFSET < nb_pkts)
+			rte_prefetch0(rte_pktmbuf_mtod(
+				buf[i + BURST_HASH_PREFETCH_OFFSET], void *));
+
+		slaves[i] = hash(buf[i]) % slave_count;
+	}
+}
+
+void
+burst_xmit_l2_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves)
+{
+	burst_xmit_hash(buf, nb_pkts, slave_count, slaves, l2_hash, 1);
+}
+
+void
+burst_xmit_l23_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves)
+{
+	burst_xmit_hash(buf, nb_pkts, slave_count, slaves, l23_hash, 1);
+}
+
+void
+burst_xmit_l34_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves)
+{
+	burst_xmit_hash(buf, nb_pkts, slave_count, slaves, l34_hash, 1);
+}
+
+void
+burst_xmit_rss_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves)
+{
+	burst_xmit_hash(buf, nb_pkts, slave_count, slaves, rss_hash, 0);
 }
 
 struct bwg_slave {
@@ -1029,6 +1219,148 @@ bond_tlb_enable(struct bond_dev_private *internals)
 	bond_ethdev_update_tlb_slave_cb(internals);
 }
 
+/* Sum the bytes sent per hash bucket on all Tx queues of the bonded device */
+static void
+bond_balance_bucket_bytes(struct bond_dev_private *internals, uint64_t *bytes)
+{
+	struct rte_eth_dev_data *data = rte_eth_devices[internals->port_id].data;
+	struct bond_tx_queue *bd_tx_q;
+	uint16_t q, b;
+
+	memset(bytes, 0, sizeof(bytes[0]) * BOND_BALANCE_BUCKETS);
+	for (q = 0; q < data->nb_tx_queues; q++) {
+		bd_tx_q = data->tx_queues[q];
+		if (bd_tx_q == NULL)
+			continue;
+
+		for (b = 0; b < BOND_BALANCE_BUCKETS; b++)
+			bytes[b] += bd_tx_q->bucket_bytes[b];
+	}
+}
+
+static void
+bond_ethdev_update_balance_cb(void *arg)
+{
+	struct bond_dev_private *internals = arg;
+	struct bond_balance *balance = &internals->balance;
+	struct bond_tx_slaves tx_slaves;
+	uint64_t bucket_load[BOND_BALANCE_BUCKETS];
+	uint64_t load[RTE_MAX_ETHPORTS] = { 0 };
+	uint8_t ports[RTE_MAX_ETHPORTS];
+	uint64_t sum, total = 0, gap, best_load;
+	uint8_t count, i, max, min;
+	uint16_t b, best, moves;
+
+	/* Positions of the Tx slaves are those used by the Tx burst */
+	bond_tx_slaves_get(internals, &tx_slaves);
+	if (internals->mode == BONDING_MODE_8023AD) {
+		count = tx_slaves.distributing_count;
+		for (i = 0; i < count; i++)
+			ports[i] = tx_slaves.slaves[tx_slaves.distributing[i]];
+	} else {
+		count = tx_slaves.slave_count;
+		memcpy(ports, tx_slaves.slaves, count);
+	}
+
+	/* Bytes sent per bucket since the previous run */
+	bond_balance_bucket_bytes(internals, bucket_load);
+	for (b = 0; b < BOND_BALANCE_BUCKETS; b++) {
+		sum = bucket_load[b];
+		bucket_load[b] = sum - balance->bucket_last[b];
+		balance->bucket_last[b] = sum;
+	}
+
+	/* Start again from a round robin table when the slaves changed */
+	if (count != balance->slave_count) {
+		balance->slave_count = 0;
+		rte_smp_wmb();
+		for (b = 0; count > 0 && b < BOND_BALANCE_BUCKETS; b++)
+			balance->bucket_slave[b] = b % count;
+		rte_smp_wmb();
+		balance->slave_count = count;
+	}
+
+	for (b = 0; count > 0 && b < BOND_BALANCE_BUCKETS; b++) {
+		load[balance->bucket_slave[b]] += bucket_load[b];
+		total += bucket_load[b];
+	}
+
+	/* Move buckets from the most to the least loaded slave while their
+	 * gap is above an eighth of the mean slave load. Moving a bucket of
+	 * load l leaves a gap of gap - 2l: take the largest bucket of at most
+	 * half the gap, so that the two slaves do not swap and heavy flows
+	 * are not moved back and forth.
+	 */
+	for (moves = 0; count > 1 && moves < BOND_BALANCE_MAX_MOVES; moves++) {
+		max = 0;
+		min = 0;
+		for (i = 1; i < count; i++) {
+			if (load[i] > load[max])
+				max = i;
+			if (load[i] < load[min])
+				min = i;
+		}
+
+		gap = load[max] - load[min];
+		if (gap <= total / count / 8)
+			break;
+
+		best = BOND_BALANCE_BUCKETS;
+		best_load = 0;
+		for (b = 0; b < BOND_BALANCE_BUCKETS; b++) {
+			if (balance->bucket_slave[b] == max &&
+					bucket_load[b] > best_load &&
+					2 * bucket_load[b] <= gap) {
+				best_load = bucket_load[b];
+				best = b;
+			}
+		}
+		if (best == BOND_BALANCE_BUCKETS)
+			break;
+
+		balance->bucket_slave[best] = min;
+		load[max] -= bucket_load[best];
+		load[min] += bucket_load[best];
+		balance->moves++;
+	}
+
+	/* Keep the balance of this period for the extended statistics */
+	memset(balance->slave_load, 0, sizeof(balance->slave_load));
+	memset(balance->slave_buckets, 0, sizeof(balance->slave_buckets));
+	for (i = 0; i < count; i++)
+		balance->slave_load[ports[i]] = load[i];
+	for (b = 0; count > 0 && b < BOND_BALANCE_BUCKETS; b++)
+		balance->slave_buckets[ports[balance->bucket_slave[b]]]++;
+
+	rte_eal_alarm_set(balance->interval_ms * 1000,
+			bond_ethdev_update_balance_cb, internals);
+}
+
+void
+bond_balance_disable(struct bond_dev_private *internals)
+{
+	rte_eal_alarm_cancel(bond_ethdev_update_balance_cb, internals);
+	internals->balance.slave_count = 0;
+}
+
+void
+bond_balance_enable(struct bond_dev_private *internals)
+{
+	struct bond_balance *balance = &internals->balance;
+
+	if (balance->interval_ms == 0)
+		return;
+
+	/* Loads are measured from now on, starting with a round robin table */
+	bond_balance_bucket_bytes(internals, balance->bucket_last);
+	balance->slave_count = 0;
+	memset(balance->slave_load, 0, sizeof(balance->slave_load));
+	memset(balance->slave_buckets, 0, sizeof(balance->slave_buckets));
+
+	rte_eal_alarm_set(balance->interval_ms * 1000,
+			bond_ethdev_update_balance_cb, internals);
+}
+
 static uint16_t
 bond_ethdev_tx_burst_alb(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 {
@@ -1178,8 +1510,9 @@ bond_ethdev_tx_burst_balance(void *queue, struct rte_mbuf **bufs,
 	struct bond_dev_private *internals;
 	struct bond_tx_queue *bd_tx_q;
 
+	struct bond_tx_slaves tx_slaves;
 	uint8_t num_of_slaves;
-	uint8_t slaves[RTE_MAX_ETHPORTS];
+	uint8_t *slaves = tx_slaves.slaves;
 
 	uint16_t num_tx_total = 0, num_tx_slave = 0, tx_fail_total = 0;
 
@@ -1187,25 +1520,29 @@ bond_ethdev_tx_burst_balance(void *queue, struct rte_mbuf **bufs,
 
 	struct rte_mbuf *slave_bufs[RTE_MAX_ETHPORTS][nb_pkts];
 	uint16_t slave_nb_pkts[RTE_MAX_ETHPORTS] = { 0 };
+	uint16_t bufs_slave_idx[nb_pkts];
+
+	if (unlikely(nb_pkts == 0))
+		return 0;
 
 	bd_tx_q = (struct bond_tx_queue *)queue;
 	internals = bd_tx_q->dev_private;
 
 	/* Copy slave list to protect against slave up/down changes during tx
 	 * bursting */
-	num_of_slaves = internals->active_slave_count;
-	memcpy(slaves, internals->active_slaves,
-			sizeof(internals->active_slaves[0]) * num_of_slaves);
+	bond_tx_slaves_get(internals, &tx_slaves);
+	num_of_slaves = tx_slaves.slave_count;
 
 	if (num_of_slaves < 1)
 		return num_tx_total;
 
+	/* Select output slaves using hash based on xmit policy */
+	bond_tx_select_slaves(internals, bd_tx_q, bufs, nb_pkts,
+			num_of_slaves, bufs_slave_idx);
+
 	/* Populate slaves mbuf with the packets which are to be sent on it  */
 	for (i = 0; i < nb_pkts; i++) {
-		/* Select output slave using hash based on xmit policy */
-		op_slave_id = internals->xmit_hash(bufs[i], num_of_slaves);
-
-		/* Populate slave mbuf arrays with mbufs for that slave */
+		op_slave_id = bufs_slave_idx[i];
 		slave_bufs[op_slave_id][slave_nb_pkts[op_slave_id]++] = bufs[i];
 	}
 
@@ -1239,15 +1576,14 @@ bond_ethdev_tx_burst_8023ad(void *queue, struct rte_mbuf **bufs,
 	struct bond_dev_private *internals;
 	struct bond_tx_queue *bd_tx_q;
 
+	struct bond_tx_slaves tx_slaves;
 	uint8_t num_of_slaves;
-	uint8_t slaves[RTE_MAX_ETHPORTS];
-	 /* positions in slaves, not ID */
-	uint8_t distributing_offsets[RTE_MAX_ETHPORTS];
-	uint8_t distributing_count;
+	uint8_t *slaves = tx_slaves.slaves;
 
 	uint16_t num_tx_slave, num_tx_total = 0, num_tx_fail_total = 0;
-	uint16_t i, j, op_slave_idx;
+	uint16_t i, j;
 	const uint16_t buffs_size = nb_pkts + BOND_MODE_8023AX_SLAVE_TX_PKTS + 1;
+	uint16_t bufs_slave_idx[nb_pkts + 1];
 
 	/* Allocate additional packets in case 8023AD mode. */
 	struct rte_mbuf *slave_bufs[RTE_MAX_ETHPORTS][buffs_size];
@@ -1263,13 +1599,13 @@ bond_ethdev_tx_burst_8023ad(void *queue, struct rte_mbuf **bufs,
 
 	/* Copy slave list to protect against slave up/down changes during tx
 	 * bursting */
-	num_of_slaves = internals->active_slave_count;
+	bond_tx_slaves_get(internals, &tx_slaves);
+	num_of_slaves = tx_slaves.slave_count;
 	if (num_of_slaves < 1)
 		return num_tx_total;
 
-	memcpy(slaves, internals->active_slaves, sizeof(slaves[0]) * num_of_slaves);
-
-	distributing_count = 0;
+	/* Slow packets come from the mode 4 state machines through a ring,
+	 * everything else about the slaves comes from the snapshot */
 	for (i = 0; i < num_of_slaves; i++) {
 		struct port *port = &mode_8023ad_ports[slaves[i]];
 
@@ -1280,22 +1616,21 @@ bond_ethdev_tx_burst_8023ad(void *queue, struct rte_mbuf **bufs,
 
 		for (j = 0; j < slave_slow_nb_pkts[i]; j++)
 			slave_bufs[i][j] = slow_pkts[j];
-
-		if (ACTOR_STATE(port, DISTRIBUTING))
-			distributing_offsets[distributing_count++] = i;
 	}
 
-	if (likely(distributing_count > 0)) {
-		/* Populate slaves mbuf with the packets which are to be sent on it */
+	if (likely(tx_slaves.distributing_count > 0 && nb_pkts > 0)) {
+		/* Select output slaves using hash based on xmit policy */
+		bond_tx_select_slaves(internals, bd_tx_q, bufs, nb_pkts,
+				tx_slaves.distributing_count, bufs_slave_idx);
+
+		/* Populate slave mbuf arrays with mbufs for that slave. Use only
+		 * slaves that are currently distributing. */
 		for (i = 0; i < nb_pkts; i++) {
-			/* Select output slave using hash based on xmit policy */
-			op_slave_idx = internals->xmit_hash(bufs[i], distributing_count);
+			uint8_t slave_offset =
+				tx_slaves.distributing[bufs_slave_idx[i]];
 
-			/* Populate slave mbuf arrays with mbufs for that slave. Use only
-			 * slaves that are currently distributing. */
-			uint8_t slave_offset = distributing_offsets[op_slave_idx];
-			slave_bufs[slave_offset][slave_nb_pkts[slave_offset]] = bufs[i];
-			slave_nb_pkts[slave_offset]++;
+			slave_bufs[slave_offset][slave_nb_pkts[slave_offset]++] =
+					bufs[i];
 		}
 	}
 
@@ -1585,6 +1920,7 @@ bond_ethdev_mode_set(struct rte_eth_dev *eth_dev, int mode)
 	}
 
 	internals->mode = mode;
+	bond_tx_slaves_update(internals);
 
 	return 0;
 }
@@ -1971,6 +2307,10 @@ bond_ethdev_start(struct rte_eth_dev *eth_dev)
 			internals->mode == BONDING_MODE_ALB)
 		bond_tlb_enable(internals);
 
+	if (internals->mode == BONDING_MODE_BALANCE ||
+			internals->mode == BONDING_MODE_8023AD)
+		bond_balance_enable(internals);
+
 	return 0;
 }
 
@@ -2029,7 +2369,10 @@ bond_ethdev_stop(struct rte_eth_dev *eth_dev)
 			tlb_last_obytets[internals->active_slaves[i]] = 0;
 	}
 
+	bond_balance_disable(internals);
+
 	internals->active_slave_count = 0;
+	bond_tx_slaves_update(internals);
 	internals->link_status_polling_enabled = 0;
 	for (i = 0; i < internals->slave_count; i++)
 		internals->slaves[i].last_link_status = 0;
@@ -2399,6 +2742,63 @@ bond_ethdev_stats_reset(struct rte_eth_dev *dev)
 		rte_eth_stats_reset(internals->slaves[i].port_id);
 }
 
+/* Adaptive balancing state: buckets moved, then per slave the bytes sent
+ * during the last period and the number of buckets mapped to it.
+ */
+static int
+bond_ethdev_xstats_get_names(struct rte_eth_dev *dev,
+		struct rte_eth_xstat_name *xstats_names,
+		unsigned int size __rte_unused)
+{
+	struct bond_dev_private *internals = dev->data->dev_private;
+	unsigned int i, count = 0;
+
+	if (xstats_names == NULL)
+		return 1 + 2 * internals->slave_count;
+
+	snprintf(xstats_names[count++].name, sizeof(xstats_names[0].name),
+			"balance_bucket_moves");
+	for (i = 0; i < internals->slave_count; i++) {
+		snprintf(xstats_names[count++].name,
+			 sizeof(xstats_names[0].name),
+			 "slave%u_tx_load_bytes", internals->slaves[i].port_id);
+		snprintf(xstats_names[count++].name,
+			 sizeof(xstats_names[0].name),
+			 "slave%u_tx_buckets", internals->slaves[i].port_id);
+	}
+
+	return count;
+}
+
+static int
+bond_ethdev_xstats_get(struct rte_eth_dev *dev, struct rte_eth_xstat *xstats,
+		unsigned int n)
+{
+	struct bond_dev_private *internals = dev->data->dev_private;
+	const struct bond_balance *balance = &internals->balance;
+	unsigned int i, count = 0;
+	uint8_t port_id;
+
+	if (n < 1 + 2 * (unsigned int)internals->slave_count)
+		return 1 + 2 * internals->slave_count;
+
+	xstats[count].id = count;
+	xstats[count].value = balance->moves;
+	count++;
+	for (i = 0; i < internals->slave_count; i++) {
+		port_id = internals->slaves[i].port_id;
+
+		xstats[count].id = count;
+		xstats[count].value = balance->slave_load[port_id];
+		count++;
+		xstats[count].id = count;
+		xstats[count].value = balance->slave_buckets[port_id];
+		count++;
+	}
+
+	return count;
+}
+
 static void
 bond_ethdev_promiscuous_enable(struct rte_eth_dev *eth_dev)
 {
@@ -2707,6 +3107,8 @@ const struct eth_dev_ops default_dev_ops = {
 	.link_update          = bond_ethdev_link_update,
 	.stats_get            = bond_ethdev_stats_get,
 	.stats_reset          = bond_ethdev_stats_reset,
+	.xstats_get           = bond_ethdev_xstats_get,
+	.xstats_get_names     = bond_ethdev_xstats_get_names,
 	.promiscuous_enable   = bond_ethdev_promiscuous_enable,
 	.promiscuous_disable  = bond_ethdev_promiscuous_disable,
 	.reta_update          = bond_ethdev_rss_reta_update,
@@ -2751,12 +3153,14 @@ bond_alloc(struct rte_vdev_device *dev, uint8_t mode)
 		RTE_ETH_DEV_DETACHABLE;
 
 	rte_spinlock_init(&internals->lock);
+	rte_spinlock_init(&internals->tx_slaves_lock);
 
 	internals->port_id = eth_dev->data->port_id;
 	internals->mode = BONDING_MODE_INVALID;
 	internals->current_primary_port = RTE_MAX_ETHPORTS + 1;
 	internals->balance_xmit_policy = BALANCE_XMIT_POLICY_LAYER2;
 	internals->xmit_hash = xmit_l2_hash;
+	internals->burst_xmit_hash = burst_xmit_l2_hash;
 	internals->user_defined_mac = 0;
 
 	internals->link_status_polling_enabled = 0;
@@ -56,12 +56,18 @@
 #define PMD_BOND_XMIT_POLICY_LAYER2_KVARG	("l2")
 #define PMD_BOND_XMIT_POLICY_LAYER23_KVARG	("l23")
 #define PMD_BOND_XMIT_POLICY_LAYER34_KVARG	("l34")
+#define PMD_BOND_XMIT_POLICY_RSS_KVARG		("rss")
 
 #define RTE_BOND_LOG(lvl, msg, ...)		\
 	RTE_LOG(lvl, PMD, "%s(%d) - " msg "\n", __func__, __LINE__, ##__VA_ARGS__)
 
 #define BONDING_MODE_INVALID 0xFF
 
+/** Number of Tx hash buckets mapped to slaves by adaptive balancing */
+#define BOND_BALANCE_BUCKETS 128
+/** Maximum number of buckets moved to another slave per period */
+#define BOND_BALANCE_MAX_MOVES 8
+
 extern const char *pmd_bond_init_valid_arguments[];
 
 extern struct rte_vdev_driver pmd_bond_drv;
@@ -89,6 +95,8 @@ struct bond_tx_queue {
 	/**< Number of TX descriptors available for the queue */
 	struct rte_eth_txconf tx_conf;
 	/**< Copy of TX configuration structure for queue */
+	uint64_t bucket_bytes[BOND_BALANCE_BUCKETS];
+	/**< Bytes sent per hash bucket, counted with adaptive balancing */
 };
 
 /** Bonded slave devices structure */
@@ -110,8 +118,39 @@ struct bond_slave_details {
 };
 
 
+/** Adaptive balancing state of the balance and 802.3ad Tx hash buckets */
+struct bond_balance {
+	uint32_t interval_ms;
+	/**< Rebalancing period in milliseconds, 0 when disabled */
+	volatile uint8_t slave_count;
+	/**< Number of Tx slaves bucket_slave is built for, 0 if not built */
+	volatile uint8_t bucket_slave[BOND_BALANCE_BUCKETS];
+	/**< Tx slave position of each hash bucket */
+	uint64_t bucket_last[BOND_BALANCE_BUCKETS];
+	/**< Bytes sent per bucket at the previous run */
+	uint64_t slave_load[RTE_MAX_ETHPORTS];
+	/**< Bytes sent per slave port during the last period */
+	uint8_t slave_buckets[RTE_MAX_ETHPORTS];
+	/**< Number of buckets mapped to each slave port */
+	uint64_t moves;
+	/**< Number of buckets moved to another slave */
+};
+
+/** Slaves used by the balance and 802.3ad Tx burst functions */
+struct bond_tx_slaves {
+	uint8_t slave_count;			/**< Number of active slaves */
+	uint8_t slaves[RTE_MAX_ETHPORTS];	/**< Active slave port ids */
+	uint8_t distributing_count;
+	/**< Number of distributing slaves, in mode 4 */
+	uint8_t distributing[RTE_MAX_ETHPORTS];
+	/**< Positions in slaves of the distributing slaves, in mode 4 */
+};
+
 typedef uint16_t (*xmit_hash_t)(const struct rte_mbuf *buf, uint8_t slave_count);
 
+typedef void (*burst_xmit_hash_t)(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves);
+
 /** Link Bonding PMD device private configuration Structure */
 struct bond_dev_private {
 	uint8_t port_id;					/**< Port Id of Bonded Port */
@@ -128,6 +167,8 @@ struct bond_dev_private {
 	/**< Transmit policy - l2 / l23 / l34 for operation in balance mode */
 	xmit_hash_t xmit_hash;
 	/**< Transmit policy hash function */
+	burst_xmit_hash_t burst_xmit_hash;
+	/**< Transmit policy hash function for a whole burst */
 
 	uint8_t user_defined_mac;
 	/**< Flag for whether MAC address is user defined or not */
@@ -148,6 +189,14 @@ struct bond_dev_private {
 	uint8_t active_slave_count;		/**< Number of active slaves */
 	uint8_t active_slaves[RTE_MAX_ETHPORTS];	/**< Active slave list */
 
+	rte_spinlock_t tx_slaves_lock;	/**< Serializes tx_slaves updates */
+	volatile uint32_t tx_slaves_seq;
+	/**< Odd while tx_slaves is being updated */
+	struct bond_tx_slaves tx_slaves;
+	/**< Snapshot of the active slaves read locklessly on Tx */
+	struct bond_balance balance;
+	/**< Adaptive mapping of the Tx hash buckets to slaves */
+
 	uint8_t slave_count;			/**< Number of bonded slaves */
 	struct bond_slave_details slaves[RTE_MAX_ETHPORTS];
 	/**< Arary of bonded slaves details */
@@ -253,6 +302,28 @@ xmit_l23_hash(const struct rte_mbuf *buf, uint8_t slave_count);
 uint16_t
 xmit_l34_hash(const struct rte_mbuf *buf, uint8_t slave_count);
 
+uint16_t
+xmit_rss_hash(const struct rte_mbuf *buf, uint8_t slave_count);
+
+void
+burst_xmit_l2_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves);
+
+void
+burst_xmit_l23_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves);
+
+void
+burst_xmit_l34_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves);
+
+void
+burst_xmit_rss_hash(struct rte_mbuf **buf, uint16_t nb_pkts,
+		uint8_t slave_count, uint16_t *slaves);
+
+void
+bond_tx_slaves_update(struct bond_dev_private *internals);
+
 void
 bond_ethdev_primary_set(struct bond_dev_private *internals,
 		uint8_t slave_port_id);
@@ -302,6 +373,12 @@ bond_tlb_enable(struct bond_dev_private *internals);
 void
 bond_tlb_activate_slave(struct bond_dev_private *internals);
 
+void
+bond_balance_disable(struct bond_dev_private *internals);
+
+void
+bond_balance_enable(struct bond_dev_private *internals);
+
 void
 bond_ethdev_stop(struct rte_eth_dev *eth_dev);
 
@@ -141,6 +141,7 @@ fs_hotplug_alarm(void *arg)
 		ret = failsafe_eth_dev_state_sync(dev);
 		if (ret)
 			ERROR("Unable to synchronize sub_device state");
+		set_burst_fn(dev, 0);
 	}
 	failsafe_dev_remove(dev);
 	ret = failsafe_hotplug_alarm_install(dev);
@@ -53,6 +53,7 @@ int mac_from_arg = 0;
 const char *pmd_failsafe_init_parameters[] = {
 	PMD_FAILSAFE_HOTPLUG_POLL_KVARG,
 	PMD_FAILSAFE_MAC_KVARG,
+	PMD_FAILSAFE_DIRECT_BURST_KVARG,
 	NULL,
 };
 
@@ -395,6 +396,19 @@ failsafe_args_parse(struct rte_eth_dev *dev, const char *params)
 				goto free_kvlist;
 			mac_from_arg = 1;
 		}
+		/* Direct bursts */
+		arg_count = rte_kvargs_count(kvlist,
+				PMD_FAILSAFE_DIRECT_BURST_KVARG);
+		if (arg_count == 1) {
+			uint64_t direct_burst;
+
+			ret = rte_kvargs_process(kvlist,
+					PMD_FAILSAFE_DIRECT_BURST_KVARG,
+					&fs_get_u64_arg, &direct_burst);
+			if (ret < 0)
+				goto free_kvlist;
+			priv->direct_burst = !!direct_burst;
+		}
 	}
 	PRIV(dev)->state = DEV_PARSED;
 free_kvlist:
@@ -314,10 +314,10 @@ fs_rxtx_clean(struct sub_device *sdev)
 	uint16_t i;
 
 	for (i = 0; i < ETH(sdev)->data->nb_rx_queues; i++)
-		if (FS_ATOMIC_RX(sdev, i))
+		if (FS_ATOMIC_RX(sdev, i) || FS_DIRECT_RX(sdev, i))
 			return 0;
 	for (i = 0; i < ETH(sdev)->data->nb_tx_queues; i++)
-		if (FS_ATOMIC_TX(sdev, i))
+		if (FS_ATOMIC_TX(sdev, i) || FS_DIRECT_TX(sdev, i))
 			return 0;
 	return 1;
 }
@@ -328,6 +328,16 @@ failsafe_dev_remove(struct rte_eth_dev *dev)
 	struct sub_device *sdev;
 	uint8_t i;
 
+	/*
+	 * A direct burst may have read its sub_device just before
+	 * direct bursts were left: wait one more alarm period.
+	 */
+	if (PRIV(dev)->direct_grace) {
+		PRIV(dev)->direct_grace = 0;
+		return;
+	}
+	/* Pairs with the barriers around the direct burst epochs. */
+	rte_smp_mb();
 	FOREACH_SUBDEV_STATE(sdev, i, dev, DEV_ACTIVE)
 		if (sdev->remove && fs_rxtx_clean(sdev))
 			fs_dev_remove(sdev);
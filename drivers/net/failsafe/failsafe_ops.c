@@ -287,6 +287,8 @@ fs_dev_start(struct rte_eth_dev *dev)
 	if (PRIV(dev)->state < DEV_STARTED)
 		PRIV(dev)->state = DEV_STARTED;
 	fs_switch_dev(dev, NULL);
+	/* Other sub_devices than the emitting one may have been started */
+	set_burst_fn(dev, 0);
 	return 0;
 }
 
@@ -301,6 +303,7 @@ fs_dev_stop(struct rte_eth_dev *dev)
 		rte_eth_dev_stop(PORT_ID(sdev));
 		sdev->state = DEV_STARTED - 1;
 	}
+	set_burst_fn(dev, 0);
 }
 
 static int
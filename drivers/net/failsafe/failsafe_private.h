@@ -45,11 +45,13 @@
 
 #define PMD_FAILSAFE_MAC_KVARG "mac"
 #define PMD_FAILSAFE_HOTPLUG_POLL_KVARG "hotplug_poll"
+#define PMD_FAILSAFE_DIRECT_BURST_KVARG "direct_burst"
 #define PMD_FAILSAFE_PARAM_STRING	\
 	"dev(<ifc>),"			\
 	"exec(<shell command>),"	\
 	"mac=mac_addr,"			\
-	"hotplug_poll=u64"		\
+	"hotplug_poll=u64,"		\
+	"direct_burst=<0|1>"		\
 	""
 
 #define FAILSAFE_HOTPLUG_DEFAULT_TIMEOUT_MS 2000
@@ -66,6 +68,8 @@ struct rxq {
 	uint8_t last_polled;
 	unsigned int socket_id;
 	struct rte_eth_rxq_info info;
+	/* odd while in a direct burst */
+	volatile uint64_t direct_epoch;
 	rte_atomic64_t refcnt[];
 };
 
@@ -74,6 +78,8 @@ struct txq {
 	uint16_t qid;
 	unsigned int socket_id;
 	struct rte_eth_txq_info info;
+	/* odd while in a direct burst */
+	volatile uint64_t direct_epoch;
 	rte_atomic64_t refcnt[];
 };
 
@@ -123,6 +129,7 @@ struct fs_priv {
 	uint8_t subs_head; /* if head == tail, no subs */
 	uint8_t subs_tail; /* first invalid */
 	uint8_t subs_tx; /* current emitting device */
+	uint8_t subs_rx; /* only receiving device, for direct RX bursts */
 	uint8_t current_probed;
 	/* flow mapping */
 	TAILQ_HEAD(sub_flows, rte_flow) flow_list;
@@ -141,6 +148,10 @@ struct fs_priv {
 	 */
 	enum dev_state state;
 	unsigned int pending_alarm:1; /* An alarm is pending */
+	/* Direct bursts allowed while the sub_devices are stable */
+	unsigned int direct_burst:1;
+	/* Direct bursts were left since the last removal check */
+	unsigned int direct_grace:1;
 	/* flow isolation state */
 	int flow_isolated:1;
 };
@@ -164,6 +175,11 @@ uint16_t failsafe_rx_burst_fast(void *rxq,
 uint16_t failsafe_tx_burst_fast(void *txq,
 		struct rte_mbuf **tx_pkts, uint16_t nb_pkts);
 
+uint16_t failsafe_rx_burst_direct(void *rxq,
+		struct rte_mbuf **rx_pkts, uint16_t nb_pkts);
+uint16_t failsafe_tx_burst_direct(void *txq,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts);
+
 /* ARGS */
 
 int failsafe_args_parse(struct rte_eth_dev *dev, const char *params);
@@ -284,6 +300,20 @@ extern int mac_from_arg;
 	 &((struct txq *)((s)->fs_dev->data->tx_queues[i]))->refcnt[(s)->sid] \
 	)
 
+/**
+ * Direct burst guard, whether a direct burst runs on a queue
+ * s: (struct sub_device *)
+ * i: uint16_t qid
+ */
+#define FS_DIRECT_RX(s, i) \
+	(((struct rxq *)((s)->fs_dev->data->rx_queues[i]))->direct_epoch & 1)
+/**
+ * s: (struct sub_device *)
+ * i: uint16_t qid
+ */
+#define FS_DIRECT_TX(s, i) \
+	(((struct txq *)((s)->fs_dev->data->tx_queues[i]))->direct_epoch & 1)
+
 #define LOG__(level, m, ...) \
 	RTE_LOG(level, PMD, "net_failsafe: " m "%c", __VA_ARGS__)
 #define LOG_(level, ...) LOG__(level, __VA_ARGS__, '\n')
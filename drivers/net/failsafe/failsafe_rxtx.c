@@ -58,32 +58,64 @@ fs_tx_unsafe(struct sub_device *sdev)
 void
 set_burst_fn(struct rte_eth_dev *dev, int force_safe)
 {
+	struct fs_priv *priv = PRIV(dev);
 	struct sub_device *sdev;
+	eth_rx_burst_t rx_burst;
+	eth_tx_burst_t tx_burst;
+	uint8_t nb_rx_ready;
+	uint8_t rx_sid;
 	uint8_t i;
 	int need_safe;
-	int safe_set;
 
+	/*
+	 * Direct bursts may still run into the previous sub_devices,
+	 * removals must wait for them.
+	 */
+	if (dev->rx_pkt_burst == &failsafe_rx_burst_direct ||
+	    dev->tx_pkt_burst == &failsafe_tx_burst_direct)
+		priv->direct_grace = 1;
 	need_safe = force_safe;
-	FOREACH_SUBDEV(sdev, i, dev)
-		need_safe |= fs_rx_unsafe(sdev);
-	safe_set = (dev->rx_pkt_burst == &failsafe_rx_burst);
-	if (need_safe && !safe_set) {
-		DEBUG("Using safe RX bursts%s",
+	nb_rx_ready = 0;
+	rx_sid = 0;
+	FOREACH_SUBDEV(sdev, i, dev) {
+		if (fs_rx_unsafe(sdev) || sdev->remove) {
+			need_safe = 1;
+			continue;
+		}
+		rx_sid = i;
+		nb_rx_ready++;
+	}
+	if (priv->direct_burst && !force_safe && nb_rx_ready == 1) {
+		priv->subs_rx = rx_sid;
+		rx_burst = &failsafe_rx_burst_direct;
+	} else if (need_safe) {
+		rx_burst = &failsafe_rx_burst;
+	} else {
+		rx_burst = &failsafe_rx_burst_fast;
+	}
+	need_safe = force_safe || fs_tx_unsafe(TX_SUBDEV(dev)) ||
+		TX_SUBDEV(dev)->remove;
+	if (priv->direct_burst && !need_safe)
+		tx_burst = &failsafe_tx_burst_direct;
+	else if (need_safe)
+		tx_burst = &failsafe_tx_burst;
+	else
+		tx_burst = &failsafe_tx_burst_fast;
+	/* Direct bursts must see their sub_device before being used. */
+	rte_smp_wmb();
+	if (dev->rx_pkt_burst != rx_burst) {
+		DEBUG("Using %s RX bursts%s",
+		      (rx_burst == &failsafe_rx_burst_direct ? "direct" :
+		       rx_burst == &failsafe_rx_burst ? "safe" : "fast"),
 		      (force_safe ? " (forced)" : ""));
-		dev->rx_pkt_burst = &failsafe_rx_burst;
-	} else if (!need_safe && safe_set) {
-		DEBUG("Using fast RX bursts");
-		dev->rx_pkt_burst = &failsafe_rx_burst_fast;
+		dev->rx_pkt_burst = rx_burst;
 	}
-	need_safe = force_safe || fs_tx_unsafe(TX_SUBDEV(dev));
-	safe_set = (dev->tx_pkt_burst == &failsafe_tx_burst);
-	if (need_safe && !safe_set) {
-		DEBUG("Using safe TX bursts%s",
+	if (dev->tx_pkt_burst != tx_burst) {
+		DEBUG("Using %s TX bursts%s",
+		      (tx_burst == &failsafe_tx_burst_direct ? "direct" :
+		       tx_burst == &failsafe_tx_burst ? "safe" : "fast"),
 		      (force_safe ? " (forced)" : ""));
-		dev->tx_pkt_burst = &failsafe_tx_burst;
-	} else if (!need_safe && safe_set) {
-		DEBUG("Using fast TX bursts");
-		dev->tx_pkt_burst = &failsafe_tx_burst_fast;
+		dev->tx_pkt_burst = tx_burst;
 	}
 	rte_wmb();
 }
@@ -201,3 +233,59 @@ failsafe_tx_burst_fast(void *queue,
 	FS_ATOMIC_V(txq->refcnt[sdev->sid]);
 	return nb_tx;
 }
+
+/*
+ * Direct bursts are installed while a single sub_device receives, and for
+ * the emitting sub_device, as long as no hot-plug event happens. They only
+ * call into the sub_device burst, the per-queue epoch being odd meanwhile.
+ */
+uint16_t
+failsafe_rx_burst_direct(void *queue,
+			 struct rte_mbuf **rx_pkts,
+			 uint16_t nb_pkts)
+{
+	struct sub_device *sdev;
+	struct rxq *rxq;
+	uint16_t nb_rx;
+
+	rxq = queue;
+	/* The epoch must be seen odd before the sub_device is read */
+	rxq->direct_epoch++;
+	rte_smp_mb();
+	sdev = &rxq->priv->subs[rxq->priv->subs_rx];
+	nb_rx = ETH(sdev)->rx_pkt_burst(ETH(sdev)->data->rx_queues[rxq->qid],
+					rx_pkts, nb_pkts);
+	rte_smp_mb();
+	rxq->direct_epoch++;
+	return nb_rx;
+}
+
+uint16_t
+failsafe_tx_burst_direct(void *queue,
+			 struct rte_mbuf **tx_pkts,
+			 uint16_t nb_pkts)
+{
+	struct sub_device *sdev;
+	struct fs_priv *priv;
+	struct txq *txq;
+	uint16_t nb_tx;
+	uint8_t sid;
+
+	txq = queue;
+	priv = txq->priv;
+	/* The epoch must be seen odd before the sub_device is read */
+	txq->direct_epoch++;
+	rte_smp_mb();
+	sid = priv->subs_tx;
+	if (unlikely(sid >= priv->subs_tail)) {
+		nb_tx = 0;
+	} else {
+		sdev = &priv->subs[sid];
+		nb_tx = ETH(sdev)->
+			tx_pkt_burst(ETH(sdev)->data->tx_queues[txq->qid],
+				     tx_pkts, nb_pkts);
+	}
+	rte_smp_mb();
+	txq->direct_epoch++;
+	return nb_tx;
+}
@@ -33,6 +33,12 @@
  */
 
 #include <time.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 
 #include <net/if.h>
 
@@ -56,15 +62,40 @@
 #define ETH_PCAP_RX_IFACE_ARG "rx_iface"
 #define ETH_PCAP_TX_IFACE_ARG "tx_iface"
 #define ETH_PCAP_IFACE_ARG    "iface"
+#define ETH_PCAP_REPLAY_ARG   "replay"
+#define ETH_PCAP_LOOP_ARG     "loop"
+#define ETH_PCAP_PACE_ARG     "pace"
+#define ETH_PCAP_DUMPER_ARG   "dumper"
+#define ETH_PCAP_SNAPLEN_ARG  "snaplen"
+#define ETH_PCAP_MBUF_TS_ARG  "mbuf_ts"
+
+#define ETH_PCAP_DUMPER_LIBPCAP  "libpcap"
+#define ETH_PCAP_DUMPER_BUFFERED "buffered"
+#define ETH_PCAP_DUMPER_THREAD   "thread"
 
 #define ETH_PCAP_ARG_MAXLEN	64
 
 #define RTE_PMD_PCAP_MAX_QUEUES 16
 
+/* Most packets a replay Rx burst returns */
+#define RTE_PMD_PCAP_REPLAY_BURST 64
+
+/* Ring of chunks the buffered dumpers write out whole */
+#define RTE_PMD_PCAP_WRITER_CHUNK_SIZE (1 << 20)
+#define RTE_PMD_PCAP_WRITER_NB_CHUNKS 4
+#define RTE_PMD_PCAP_WRITER_ALIGN 4096
+#define RTE_PMD_PCAP_WRITER_IDLE_US 100
+
+/* pcap file format with nanosecond timestamps */
+#define PCAP_NSEC_MAGIC 0xa1b23c4d
+#define PCAP_VERSION_MAJOR 2
+#define PCAP_VERSION_MINOR 4
+
 static char errbuf[PCAP_ERRBUF_SIZE];
 static unsigned char tx_pcap_data[RTE_ETH_PCAP_SNAPLEN];
 static struct timeval start_time;
 static uint64_t start_cycles;
+static uint64_t start_ns;
 static uint64_t hz;
 
 struct queue_stat {
@@ -73,28 +104,111 @@ struct queue_stat {
 	volatile unsigned long err_pkts;
 };
 
+struct pcap_replay_pkt {
+	uint64_t due;		/* cycles since the start of the loop */
+	uint32_t offset;	/* in the packet data */
+	uint32_t len;
+};
+
+/*
+ * An rx_pcap file preloaded in hugepage memory, served from there
+ * without libpcap.
+ */
+struct pcap_replay {
+	uint8_t *data;
+	struct pcap_replay_pkt *pkts;
+	uint32_t nb_pkts;
+	uint32_t next;
+	uint64_t loop;
+	uint64_t loop_start;
+	uint64_t loop_cycles;
+	int started;
+};
+
 struct pcap_rx_queue {
 	pcap_t *pcap;
 	uint8_t in_port;
 	struct rte_mempool *mb_pool;
 	struct queue_stat rx_stat;
+	struct pcap_replay replay;
 	char name[PATH_MAX];
 	char type[ETH_PCAP_ARG_MAXLEN];
 };
 
+struct pcap_nsec_file_header {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t linktype;
+};
+
+struct pcap_nsec_pkt_header {
+	uint32_t ts_sec;
+	uint32_t ts_nsec;
+	uint32_t caplen;
+	uint32_t len;
+};
+
+/*
+ * Writes a tx_pcap file without libpcap. Packets are appended to a ring
+ * of large aligned chunks, each written out whole once full, either from
+ * the Tx burst or from a thread of its own.
+ */
+struct pcap_writer {
+	uint8_t *chunks;
+	uint32_t fill;		/* bytes in the chunk being filled */
+	volatile uint32_t head;	/* chunks filled */
+	volatile uint32_t tail;	/* chunks written */
+	int fd;
+	int direct;		/* fd bypasses the page cache */
+	int threaded;
+	volatile int stop;
+	volatile int error;
+	pthread_t thread;
+};
+
 struct pcap_tx_queue {
 	pcap_dumper_t *dumper;
 	pcap_t *pcap;
+	struct pcap_writer *writer;
+	uint32_t snaplen;
+	/* mbuf->timestamp holds nanoseconds since the Epoch */
+	int mbuf_ts;
 	struct queue_stat tx_stat;
 	char name[PATH_MAX];
 	char type[ETH_PCAP_ARG_MAXLEN];
 };
 
+struct replay_args {
+	int enabled;
+	/* 0 for endless */
+	uint64_t loops;
+	/* 0 for as fast as possible, else speed relative to the capture */
+	double pace;
+};
+
+enum dumper_type {
+	DUMPER_LIBPCAP,
+	DUMPER_BUFFERED,
+	DUMPER_THREAD,
+};
+
+struct dumper_args {
+	enum dumper_type type;
+	uint32_t snaplen;
+	int mbuf_ts;
+};
+
 struct pmd_internals {
 	struct pcap_rx_queue rx_queue[RTE_PMD_PCAP_MAX_QUEUES];
 	struct pcap_tx_queue tx_queue[RTE_PMD_PCAP_MAX_QUEUES];
 	int if_index;
 	int single_iface;
+	struct replay_args replay;
+	struct dumper_args dumper;
 };
 
 struct pmd_devargs {
@@ -113,6 +227,12 @@ static const char *valid_arguments[] = {
 	ETH_PCAP_RX_IFACE_ARG,
 	ETH_PCAP_TX_IFACE_ARG,
 	ETH_PCAP_IFACE_ARG,
+	ETH_PCAP_REPLAY_ARG,
+	ETH_PCAP_LOOP_ARG,
+	ETH_PCAP_PACE_ARG,
+	ETH_PCAP_DUMPER_ARG,
+	ETH_PCAP_SNAPLEN_ARG,
+	ETH_PCAP_MBUF_TS_ARG,
 	NULL
 };
 
@@ -240,6 +360,99 @@ eth_pcap_rx(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	return num_rx;
 }
 
+/*
+ * Replay of a preloaded pcap file: the packets due, at most nb_pkts, are
+ * copied into new mbufs so that the application may modify them. With
+ * pacing, a packet is due once the time elapsed since the start of its
+ * loop reaches its scaled capture timestamp.
+ */
+static uint16_t
+eth_pcap_rx_replay(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
+{
+	struct pcap_rx_queue *pcap_q = queue;
+	struct pcap_replay *r = &pcap_q->replay;
+	struct pmd_internals *internals;
+	const struct pcap_replay_pkt *sel[RTE_PMD_PCAP_REPLAY_BURST];
+	const struct pcap_replay_pkt *pkt;
+	struct rte_mbuf *mbuf;
+	uint64_t now = 0, loop, loop_start;
+	uint32_t rx_bytes = 0, next;
+	uint16_t buf_size, num_rx = 0, nb_sel = 0, i;
+
+	if (unlikely(r->pkts == NULL || nb_pkts == 0))
+		return 0;
+
+	internals = rte_eth_devices[pcap_q->in_port].data->dev_private;
+	if (internals->replay.pace != 0) {
+		now = rte_get_timer_cycles();
+		if (unlikely(!r->started)) {
+			r->loop_start = now;
+			r->started = 1;
+		}
+	}
+
+	next = r->next;
+	loop = r->loop;
+	loop_start = r->loop_start;
+
+	nb_pkts = RTE_MIN(nb_pkts, RTE_PMD_PCAP_REPLAY_BURST);
+	while (nb_sel < nb_pkts) {
+		if (unlikely(r->next == r->nb_pkts)) {
+			if (internals->replay.loops != 0 &&
+			    r->loop + 1 >= internals->replay.loops)
+				break;
+			r->loop++;
+			r->next = 0;
+			r->loop_start += r->loop_cycles;
+		}
+
+		pkt = &r->pkts[r->next];
+		if (now != 0 && r->loop_start + pkt->due > now)
+			break;
+
+		sel[nb_sel++] = pkt;
+		r->next++;
+	}
+
+	if (nb_sel == 0 ||
+	    rte_pktmbuf_alloc_bulk(pcap_q->mb_pool, bufs, nb_sel) != 0) {
+		/* give the selected packets back for the next burst */
+		r->next = next;
+		r->loop = loop;
+		r->loop_start = loop_start;
+		return 0;
+	}
+
+	buf_size = rte_pktmbuf_data_room_size(pcap_q->mb_pool) -
+			RTE_PKTMBUF_HEADROOM;
+
+	for (i = 0; i < nb_sel; i++) {
+		pkt = sel[i];
+		mbuf = bufs[i];
+
+		if (likely(pkt->len <= buf_size)) {
+			rte_memcpy(rte_pktmbuf_mtod(mbuf, void *),
+				   r->data + pkt->offset, pkt->len);
+			mbuf->data_len = (uint16_t)pkt->len;
+		} else if (unlikely(eth_pcap_rx_jumbo(pcap_q->mb_pool, mbuf,
+				r->data + pkt->offset, pkt->len) == -1)) {
+			rte_pktmbuf_free(mbuf);
+			pcap_q->rx_stat.err_pkts++;
+			continue;
+		}
+
+		mbuf->pkt_len = pkt->len;
+		mbuf->port = pcap_q->in_port;
+		bufs[num_rx++] = mbuf;
+		rx_bytes += pkt->len;
+	}
+
+	pcap_q->rx_stat.pkts += num_rx;
+	pcap_q->rx_stat.bytes += rx_bytes;
+
+	return num_rx;
+}
+
 static inline void
 calculate_timestamp(struct timeval *ts) {
 	uint64_t cycles;
@@ -273,7 +486,7 @@ eth_pcap_tx_dumper(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 		mbuf = bufs[i];
 		calculate_timestamp(&header.ts);
 		header.len = mbuf->pkt_len;
-		header.caplen = header.len;
+		header.caplen = RTE_MIN(header.len, dumper_q->snaplen);
 
 		if (likely(mbuf->nb_segs == 1)) {
 			pcap_dump((u_char *)dumper_q->dumper, &header,
@@ -312,6 +525,193 @@ eth_pcap_tx_dumper(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	return num_tx;
 }
 
+/*
+ * Nanosecond timestamp of a packet: the one the mbuf carries, when the
+ * application said it counts nanoseconds since the Epoch, else the
+ * current time.
+ */
+static inline void
+calculate_nsec_timestamp(const struct rte_mbuf *mbuf, int mbuf_ts,
+		struct pcap_nsec_pkt_header *header)
+{
+	uint64_t cycles, ns;
+
+	if (mbuf_ts && (mbuf->ol_flags & PKT_RX_TIMESTAMP)) {
+		ns = mbuf->timestamp;
+	} else {
+		cycles = rte_get_timer_cycles() - start_cycles;
+		ns = start_ns + cycles / hz * NS_PER_S +
+			(cycles % hz) * NS_PER_S / hz;
+	}
+
+	header->ts_sec = ns / NS_PER_S;
+	header->ts_nsec = ns % NS_PER_S;
+}
+
+static int
+pcap_writer_write(struct pcap_writer *w, const uint8_t *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = write(w->fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			w->error = errno;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static void *
+pcap_writer_thread(void *arg)
+{
+	struct pcap_writer *w = arg;
+	uint32_t idx;
+
+	for (;;) {
+		if (w->tail == w->head) {
+			if (w->stop) {
+				/* the last chunk may come with the stop */
+				rte_smp_rmb();
+				if (w->tail == w->head)
+					break;
+				continue;
+			}
+			usleep(RTE_PMD_PCAP_WRITER_IDLE_US);
+			continue;
+		}
+
+		rte_smp_rmb();
+		idx = w->tail % RTE_PMD_PCAP_WRITER_NB_CHUNKS;
+		if (pcap_writer_write(w,
+				w->chunks + idx * RTE_PMD_PCAP_WRITER_CHUNK_SIZE,
+				RTE_PMD_PCAP_WRITER_CHUNK_SIZE) < 0)
+			break;
+
+		rte_smp_mb();
+		w->tail++;
+	}
+
+	return NULL;
+}
+
+/* Hands the full chunk over and waits for the next one to be free */
+static int
+pcap_writer_submit(struct pcap_writer *w)
+{
+	uint32_t idx = w->head % RTE_PMD_PCAP_WRITER_NB_CHUNKS;
+
+	w->fill = 0;
+
+	if (!w->threaded) {
+		if (pcap_writer_write(w,
+				w->chunks + idx * RTE_PMD_PCAP_WRITER_CHUNK_SIZE,
+				RTE_PMD_PCAP_WRITER_CHUNK_SIZE) < 0)
+			return -1;
+		w->head++;
+		w->tail++;
+		return 0;
+	}
+
+	rte_smp_wmb();
+	w->head++;
+
+	while (w->head - w->tail == RTE_PMD_PCAP_WRITER_NB_CHUNKS) {
+		if (w->error)
+			return -1;
+		sched_yield();
+	}
+
+	return 0;
+}
+
+static int
+pcap_writer_put(struct pcap_writer *w, const void *data, uint32_t len)
+{
+	const uint8_t *src = data;
+	uint8_t *chunk;
+	uint32_t n;
+
+	while (len > 0) {
+		chunk = w->chunks + (w->head % RTE_PMD_PCAP_WRITER_NB_CHUNKS) *
+			RTE_PMD_PCAP_WRITER_CHUNK_SIZE;
+		n = RTE_MIN(len, RTE_PMD_PCAP_WRITER_CHUNK_SIZE - w->fill);
+		rte_memcpy(chunk + w->fill, src, n);
+		w->fill += n;
+		src += n;
+		len -= n;
+
+		if (w->fill == RTE_PMD_PCAP_WRITER_CHUNK_SIZE &&
+		    pcap_writer_submit(w) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int
+pcap_writer_put_mbuf(struct pcap_writer *w, struct rte_mbuf *mbuf,
+		uint32_t snaplen, int mbuf_ts)
+{
+	struct pcap_nsec_pkt_header header;
+	uint32_t len, n;
+
+	calculate_nsec_timestamp(mbuf, mbuf_ts, &header);
+	header.len = mbuf->pkt_len;
+	header.caplen = RTE_MIN(header.len, snaplen);
+
+	if (pcap_writer_put(w, &header, sizeof(header)) < 0)
+		return -1;
+
+	for (len = header.caplen; len > 0; mbuf = mbuf->next) {
+		n = RTE_MIN(len, mbuf->data_len);
+		if (pcap_writer_put(w, rte_pktmbuf_mtod(mbuf, void *), n) < 0)
+			return -1;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * Callback to handle writing packets to a pcap file through the
+ * buffered dumpers.
+ */
+static uint16_t
+eth_pcap_tx_writer(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
+{
+	unsigned int i;
+	struct pcap_tx_queue *writer_q = queue;
+	struct pcap_writer *w = writer_q->writer;
+	uint16_t num_tx = 0;
+	uint32_t tx_bytes = 0;
+
+	if (w == NULL || w->error || nb_pkts == 0)
+		return 0;
+
+	for (i = 0; i < nb_pkts; i++) {
+		if (pcap_writer_put_mbuf(w, bufs[i], writer_q->snaplen,
+					 writer_q->mbuf_ts) < 0)
+			break;
+
+		num_tx++;
+		tx_bytes += bufs[i]->pkt_len;
+		rte_pktmbuf_free(bufs[i]);
+	}
+
+	writer_q->tx_stat.pkts += num_tx;
+	writer_q->tx_stat.bytes += tx_bytes;
+	writer_q->tx_stat.err_pkts += nb_pkts - num_tx;
+
+	return num_tx;
+}
+
 /*
  * Callback to handle sending packets through a real NIC.
  */
@@ -419,6 +819,102 @@ open_single_tx_pcap(const char *pcap_filename, pcap_dumper_t **dumper)
 	return 0;
 }
 
+static int
+open_single_tx_writer(struct pcap_tx_queue *tx, enum dumper_type type,
+		int socket_id)
+{
+	struct pcap_writer *w;
+	struct pcap_nsec_file_header header = {
+		.magic = PCAP_NSEC_MAGIC,
+		.version_major = PCAP_VERSION_MAJOR,
+		.version_minor = PCAP_VERSION_MINOR,
+		.snaplen = tx->snaplen,
+		.linktype = DLT_EN10MB,
+	};
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+	w = rte_zmalloc_socket("pcap_writer", sizeof(*w), RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (w == NULL)
+		return -1;
+
+	w->chunks = rte_malloc_socket("pcap_writer_chunks",
+			RTE_PMD_PCAP_WRITER_CHUNK_SIZE *
+			RTE_PMD_PCAP_WRITER_NB_CHUNKS,
+			RTE_PMD_PCAP_WRITER_ALIGN, socket_id);
+	if (w->chunks == NULL)
+		goto error;
+
+	/* only worth bypassing the page cache off the datapath */
+	w->threaded = type == DUMPER_THREAD;
+	w->fd = -1;
+	if (w->threaded) {
+		w->fd = open(tx->name, flags | O_DIRECT, 0644);
+		w->direct = w->fd >= 0;
+	}
+	if (w->fd < 0)
+		w->fd = open(tx->name, flags, 0644);
+	if (w->fd < 0) {
+		RTE_LOG(ERR, PMD, "Couldn't open %s for writing: %s\n",
+			tx->name, strerror(errno));
+		goto error;
+	}
+
+	pcap_writer_put(w, &header, sizeof(header));
+
+	if (w->threaded) {
+		if (pthread_create(&w->thread, NULL, pcap_writer_thread,
+				w) != 0) {
+			RTE_LOG(ERR, PMD, "Couldn't create writer thread for %s\n",
+				tx->name);
+			close(w->fd);
+			goto error;
+		}
+		rte_thread_setname(w->thread, "pcap-writer");
+	}
+
+	tx->writer = w;
+
+	return 0;
+
+error:
+	rte_free(w->chunks);
+	rte_free(w);
+	return -1;
+}
+
+/* Flushes and closes the tx_pcap file of a buffered dumper */
+static void
+close_single_tx_writer(struct pcap_tx_queue *tx)
+{
+	struct pcap_writer *w = tx->writer;
+	uint8_t *chunk;
+
+	if (w->threaded) {
+		rte_smp_wmb();
+		w->stop = 1;
+		pthread_join(w->thread, NULL);
+	}
+
+	if (w->fill > 0 && !w->error) {
+		/* the partial last chunk cannot be written directly */
+		if (w->direct)
+			fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT);
+		chunk = w->chunks + (w->head % RTE_PMD_PCAP_WRITER_NB_CHUNKS) *
+			RTE_PMD_PCAP_WRITER_CHUNK_SIZE;
+		pcap_writer_write(w, chunk, w->fill);
+	}
+
+	if (w->error)
+		RTE_LOG(ERR, PMD, "Couldn't write %s: %s\n", tx->name,
+			strerror(w->error));
+
+	close(w->fd);
+	rte_free(w->chunks);
+	rte_free(w);
+	tx->writer = NULL;
+}
+
 static int
 open_single_rx_pcap(const char *pcap_filename, pcap_t **pcap)
 {
@@ -432,6 +928,109 @@ open_single_rx_pcap(const char *pcap_filename, pcap_t **pcap)
 	return 0;
 }
 
+static void
+eth_pcap_replay_free(struct pcap_replay *r)
+{
+	rte_free(r->data);
+	rte_free(r->pkts);
+	memset(r, 0, sizeof(*r));
+}
+
+/*
+ * Reads the whole rx_pcap file of a queue into hugepage memory, once for
+ * its size and once for the data, recording for each packet when it is
+ * due relative to the first one. The pcap is closed afterwards.
+ */
+static int
+eth_pcap_replay_load(struct pcap_rx_queue *rx, double pace)
+{
+	struct pcap_replay *r = &rx->replay;
+	struct pcap_replay_pkt *pkt;
+	struct pcap_pkthdr *header;
+	const u_char *packet;
+	uint64_t nb_bytes = 0, first_us = 0, us, due;
+	uint32_t nb_pkts = 0, offset = 0;
+	int socket_id = rx->mb_pool->socket_id;
+
+	if (rx->pcap == NULL && open_single_rx_pcap(rx->name, &rx->pcap) < 0)
+		return -1;
+
+	while (pcap_next_ex(rx->pcap, &header, &packet) == 1) {
+		nb_pkts++;
+		nb_bytes += header->caplen;
+	}
+	pcap_close(rx->pcap);
+	rx->pcap = NULL;
+
+	if (nb_pkts == 0 || nb_bytes > UINT32_MAX) {
+		RTE_LOG(ERR, PMD, "Cannot replay %s: %u packets, %" PRIu64
+			" bytes\n", rx->name, nb_pkts, nb_bytes);
+		return -1;
+	}
+
+	r->data = rte_malloc_socket("pcap_replay_data", nb_bytes,
+			RTE_CACHE_LINE_SIZE, socket_id);
+	r->pkts = rte_malloc_socket("pcap_replay_pkts",
+			nb_pkts * sizeof(*r->pkts), RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (r->data == NULL || r->pkts == NULL) {
+		RTE_LOG(ERR, PMD, "Cannot allocate %" PRIu64
+			" bytes to replay %s\n", nb_bytes, rx->name);
+		goto error;
+	}
+
+	if (open_single_rx_pcap(rx->name, &rx->pcap) < 0)
+		goto error;
+
+	while (r->nb_pkts < nb_pkts &&
+	       pcap_next_ex(rx->pcap, &header, &packet) == 1) {
+		if (header->caplen > nb_bytes - offset)
+			break;
+
+		us = (uint64_t)header->ts.tv_sec * 1000000 +
+			header->ts.tv_usec;
+		if (r->nb_pkts == 0)
+			first_us = us;
+
+		due = 0;
+		if (pace != 0 && us > first_us)
+			due = (uint64_t)((double)(us - first_us) * hz /
+					1000000 / pace);
+
+		pkt = &r->pkts[r->nb_pkts];
+		/* keep the schedule monotonic whatever the capture says */
+		pkt->due = r->nb_pkts == 0 ? 0 : RTE_MAX(due, pkt[-1].due);
+		pkt->offset = offset;
+		pkt->len = header->caplen;
+		rte_memcpy(r->data + offset, packet, header->caplen);
+
+		offset += header->caplen;
+		r->nb_pkts++;
+	}
+	pcap_close(rx->pcap);
+	rx->pcap = NULL;
+
+	if (r->nb_pkts == 0) {
+		RTE_LOG(ERR, PMD, "Cannot read %s back\n", rx->name);
+		goto error;
+	}
+
+	/* a loop lasts as long as its packets plus their mean gap */
+	pkt = &r->pkts[r->nb_pkts - 1];
+	r->loop_cycles = pkt->due;
+	if (r->nb_pkts > 1)
+		r->loop_cycles += pkt->due / (r->nb_pkts - 1);
+
+	RTE_LOG(INFO, PMD, "Preloaded %u packets, %u bytes from %s\n",
+		r->nb_pkts, offset, rx->name);
+
+	return 0;
+
+error:
+	eth_pcap_replay_free(r);
+	return -1;
+}
+
 static int
 eth_dev_start(struct rte_eth_dev *dev)
 {
@@ -457,7 +1056,13 @@ eth_dev_start(struct rte_eth_dev *dev)
 	for (i = 0; i < dev->data->nb_tx_queues; i++) {
 		tx = &internals->tx_queue[i];
 
-		if (!tx->dumper &&
+		if (internals->dumper.type != DUMPER_LIBPCAP &&
+		    strcmp(tx->type, ETH_PCAP_TX_PCAP_ARG) == 0) {
+			if (!tx->writer &&
+			    open_single_tx_writer(tx, internals->dumper.type,
+					dev->data->numa_node) < 0)
+				return -1;
+		} else if (!tx->dumper &&
 				strcmp(tx->type, ETH_PCAP_TX_PCAP_ARG) == 0) {
 			if (open_single_tx_pcap(tx->name, &tx->dumper) < 0)
 				return -1;
@@ -472,6 +1077,20 @@ eth_dev_start(struct rte_eth_dev *dev)
 	for (i = 0; i < dev->data->nb_rx_queues; i++) {
 		rx = &internals->rx_queue[i];
 
+		if (internals->replay.enabled &&
+		    strcmp(rx->type, ETH_PCAP_RX_PCAP_ARG) == 0) {
+			if (rx->replay.pkts == NULL &&
+			    eth_pcap_replay_load(rx,
+					internals->replay.pace) < 0)
+				return -1;
+
+			/* every start replays from the beginning */
+			rx->replay.next = 0;
+			rx->replay.loop = 0;
+			rx->replay.started = 0;
+			continue;
+		}
+
 		if (rx->pcap != NULL)
 			continue;
 
@@ -521,6 +1140,9 @@ eth_dev_stop(struct rte_eth_dev *dev)
 			tx->dumper = NULL;
 		}
 
+		if (tx->writer != NULL)
+			close_single_tx_writer(tx);
+
 		if (tx->pcap != NULL) {
 			pcap_close(tx->pcap);
 			tx->pcap = NULL;
@@ -700,6 +1322,51 @@ open_rx_pcap(const char *key, const char *value, void *extra_args)
 	return 0;
 }
 
+static int
+set_replay(const char *key __rte_unused, const char *value, void *extra_args)
+{
+	struct replay_args *replay = extra_args;
+	char *end;
+
+	replay->enabled = strtoul(value, &end, 10) != 0;
+	if (*value == '\0' || *end != '\0')
+		return -1;
+
+	return 0;
+}
+
+static int
+set_replay_loop(const char *key __rte_unused, const char *value,
+		void *extra_args)
+{
+	struct replay_args *replay = extra_args;
+	char *end;
+
+	replay->loops = strtoull(value, &end, 10);
+	if (*value == '\0' || *end != '\0')
+		return -1;
+
+	replay->enabled = 1;
+
+	return 0;
+}
+
+static int
+set_replay_pace(const char *key __rte_unused, const char *value,
+		void *extra_args)
+{
+	struct replay_args *replay = extra_args;
+	char *end;
+
+	replay->pace = strtod(value, &end);
+	if (*value == '\0' || *end != '\0' || replay->pace < 0)
+		return -1;
+
+	replay->enabled = 1;
+
+	return 0;
+}
+
 /*
  * Opens a pcap file for writing and stores a reference to it
  * for use it later on.
@@ -724,6 +1391,73 @@ open_tx_pcap(const char *key, const char *value, void *extra_args)
 	return 0;
 }
 
+/*
+ * Stores the name of a pcap file the buffered dumpers open at start.
+ */
+static int
+select_tx_pcap(const char *key, const char *value, void *extra_args)
+{
+	unsigned int i;
+	struct pmd_devargs *dumpers = extra_args;
+
+	for (i = 0; i < dumpers->num_of_queue; i++) {
+		dumpers->queue[i].name = value;
+		dumpers->queue[i].type = key;
+	}
+
+	return 0;
+}
+
+static int
+set_dumper(const char *key __rte_unused, const char *value,
+		void *extra_args)
+{
+	struct dumper_args *dumper = extra_args;
+
+	if (strcmp(value, ETH_PCAP_DUMPER_LIBPCAP) == 0)
+		dumper->type = DUMPER_LIBPCAP;
+	else if (strcmp(value, ETH_PCAP_DUMPER_BUFFERED) == 0)
+		dumper->type = DUMPER_BUFFERED;
+	else if (strcmp(value, ETH_PCAP_DUMPER_THREAD) == 0)
+		dumper->type = DUMPER_THREAD;
+	else
+		return -1;
+
+	return 0;
+}
+
+static int
+set_snaplen(const char *key __rte_unused, const char *value,
+		void *extra_args)
+{
+	struct dumper_args *dumper = extra_args;
+	unsigned long snaplen;
+	char *end;
+
+	snaplen = strtoul(value, &end, 10);
+	if (*value == '\0' || *end != '\0' || snaplen == 0 ||
+	    snaplen > RTE_ETH_PCAP_SNAPSHOT_LEN)
+		return -1;
+
+	dumper->snaplen = snaplen;
+
+	return 0;
+}
+
+static int
+set_mbuf_ts(const char *key __rte_unused, const char *value,
+		void *extra_args)
+{
+	struct dumper_args *dumper = extra_args;
+	char *end;
+
+	dumper->mbuf_ts = strtoul(value, &end, 10) != 0;
+	if (*value == '\0' || *end != '\0')
+		return -1;
+
+	return 0;
+}
+
 /*
  * Opens an interface for reading and writing
  */
@@ -902,10 +1636,12 @@ eth_from_pcaps(struct rte_vdev_device *vdev,
 		struct pmd_devargs *rx_queues, const unsigned int nb_rx_queues,
 		struct pmd_devargs *tx_queues, const unsigned int nb_tx_queues,
 		struct rte_kvargs *kvlist, int single_iface,
-		unsigned int using_dumpers)
+		unsigned int using_dumpers, const struct replay_args *replay,
+		const struct dumper_args *dumper)
 {
 	struct pmd_internals *internals = NULL;
 	struct rte_eth_dev *eth_dev = NULL;
+	unsigned int i;
 	int ret;
 
 	ret = eth_from_pcaps_common(vdev, rx_queues, nb_rx_queues,
@@ -917,9 +1653,22 @@ eth_from_pcaps(struct rte_vdev_device *vdev,
 	/* store weather we are using a single interface for rx/tx or not */
 	internals->single_iface = single_iface;
 
-	eth_dev->rx_pkt_burst = eth_pcap_rx;
+	internals->replay = *replay;
+
+	if (replay->enabled)
+		eth_dev->rx_pkt_burst = eth_pcap_rx_replay;
+	else
+		eth_dev->rx_pkt_burst = eth_pcap_rx;
 
-	if (using_dumpers)
+	internals->dumper = *dumper;
+	for (i = 0; i < nb_tx_queues; i++) {
+		internals->tx_queue[i].snaplen = dumper->snaplen;
+		internals->tx_queue[i].mbuf_ts = dumper->mbuf_ts;
+	}
+
+	if (using_dumpers && dumper->type != DUMPER_LIBPCAP)
+		eth_dev->tx_pkt_burst = eth_pcap_tx_writer;
+	else if (using_dumpers)
 		eth_dev->tx_pkt_burst = eth_pcap_tx_dumper;
 	else
 		eth_dev->tx_pkt_burst = eth_pcap_tx;
@@ -935,6 +1684,11 @@ pmd_pcap_probe(struct rte_vdev_device *dev)
 	struct rte_kvargs *kvlist;
 	struct pmd_devargs pcaps = {0};
 	struct pmd_devargs dumpers = {0};
+	struct replay_args replay = { .loops = 1 };
+	struct dumper_args dumper = {
+		.type = DUMPER_LIBPCAP,
+		.snaplen = RTE_ETH_PCAP_SNAPSHOT_LEN,
+	};
 	int single_iface = 0;
 	int ret;
 
@@ -943,12 +1697,25 @@ pmd_pcap_probe(struct rte_vdev_device *dev)
 
 	gettimeofday(&start_time, NULL);
 	start_cycles = rte_get_timer_cycles();
+	start_ns = (uint64_t)start_time.tv_sec * NS_PER_S +
+		start_time.tv_usec * 1000;
 	hz = rte_get_timer_hz();
 
 	kvlist = rte_kvargs_parse(rte_vdev_device_args(dev), valid_arguments);
 	if (kvlist == NULL)
 		return -1;
 
+	ret = rte_kvargs_process(kvlist, ETH_PCAP_DUMPER_ARG,
+			&set_dumper, &dumper);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, ETH_PCAP_SNAPLEN_ARG,
+				&set_snaplen, &dumper);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, ETH_PCAP_MBUF_TS_ARG,
+				&set_mbuf_ts, &dumper);
+	if (ret < 0)
+		goto free_kvlist;
+
 	/*
 	 * If iface argument is passed we open the NICs and use them for
 	 * reading / writing
@@ -994,6 +1761,28 @@ pmd_pcap_probe(struct rte_vdev_device *dev)
 	if (ret < 0)
 		goto free_kvlist;
 
+	/*
+	 * A replayed rx_pcap is preloaded at start, then served from memory,
+	 * possibly looping and paced by its capture timestamps.
+	 */
+	ret = rte_kvargs_process(kvlist, ETH_PCAP_REPLAY_ARG,
+			&set_replay, &replay);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, ETH_PCAP_LOOP_ARG,
+				&set_replay_loop, &replay);
+	if (ret == 0)
+		ret = rte_kvargs_process(kvlist, ETH_PCAP_PACE_ARG,
+				&set_replay_pace, &replay);
+	if (ret < 0)
+		goto free_kvlist;
+
+	if (replay.enabled && !is_rx_pcap) {
+		RTE_LOG(ERR, PMD, "Replay needs an %s stream\n",
+			ETH_PCAP_RX_PCAP_ARG);
+		ret = -1;
+		goto free_kvlist;
+	}
+
 	/*
 	 * We check whether we want to open a TX stream to a real NIC or a
 	 * pcap file
@@ -1008,7 +1797,10 @@ pmd_pcap_probe(struct rte_vdev_device *dev)
 	if (dumpers.num_of_queue > RTE_PMD_PCAP_MAX_QUEUES)
 		dumpers.num_of_queue = RTE_PMD_PCAP_MAX_QUEUES;
 
-	if (is_tx_pcap)
+	if (is_tx_pcap && dumper.type != DUMPER_LIBPCAP)
+		ret = rte_kvargs_process(kvlist, ETH_PCAP_TX_PCAP_ARG,
+				&select_tx_pcap, &dumpers);
+	else if (is_tx_pcap)
 		ret = rte_kvargs_process(kvlist, ETH_PCAP_TX_PCAP_ARG,
 				&open_tx_pcap, &dumpers);
 	else
@@ -1020,7 +1812,8 @@ pmd_pcap_probe(struct rte_vdev_device *dev)
 
 create_eth:
 	ret = eth_from_pcaps(dev, &pcaps, pcaps.num_of_queue, &dumpers,
-		dumpers.num_of_queue, kvlist, single_iface, is_tx_pcap);
+		dumpers.num_of_queue, kvlist, single_iface, is_tx_pcap,
+		&replay, &dumper);
 
 free_kvlist:
 	rte_kvargs_free(kvlist);
@@ -1032,6 +1825,8 @@ static int
 pmd_pcap_remove(struct rte_vdev_device *dev)
 {
 	struct rte_eth_dev *eth_dev = NULL;
+	struct pmd_internals *internals;
+	unsigned int i;
 
 	RTE_LOG(INFO, PMD, "Closing pcap ethdev on numa socket %u\n",
 			rte_socket_id());
@@ -1044,6 +1839,13 @@ pmd_pcap_remove(struct rte_vdev_device *dev)
 	if (eth_dev == NULL)
 		return -1;
 
+	internals = eth_dev->data->dev_private;
+	for (i = 0; i < RTE_PMD_PCAP_MAX_QUEUES; i++) {
+		eth_pcap_replay_free(&internals->rx_queue[i].replay);
+		if (internals->tx_queue[i].writer != NULL)
+			close_single_tx_writer(&internals->tx_queue[i]);
+	}
+
 	rte_free(eth_dev->data->dev_private);
 	rte_free(eth_dev->data);
 
@@ -1064,4 +1866,10 @@ RTE_PMD_REGISTER_PARAM_STRING(net_pcap,
 	ETH_PCAP_TX_PCAP_ARG "=<string> "
 	ETH_PCAP_RX_IFACE_ARG "=<ifc> "
 	ETH_PCAP_TX_IFACE_ARG "=<ifc> "
-	ETH_PCAP_IFACE_ARG "=<ifc>");
+	ETH_PCAP_IFACE_ARG "=<ifc> "
+	ETH_PCAP_REPLAY_ARG "=<0|1> "
+	ETH_PCAP_LOOP_ARG "=<int> "
+	ETH_PCAP_PACE_ARG "=<float> "
+	ETH_PCAP_DUMPER_ARG "=<libpcap|buffered|thread> "
+	ETH_PCAP_SNAPLEN_ARG "=<int> "
+	ETH_PCAP_MBUF_TS_ARG "=<0|1>");
@@ -41,15 +41,20 @@
 #include <rte_vdev.h>
 #include <rte_kvargs.h>
 #include <rte_errno.h>
+#include <rte_prefetch.h>
 
 #define ETH_RING_NUMA_NODE_ACTION_ARG	"nodeaction"
 #define ETH_RING_ACTION_CREATE		"CREATE"
 #define ETH_RING_ACTION_ATTACH		"ATTACH"
 #define ETH_RING_INTERNAL_ARG		"internal"
+#define ETH_RING_MODE_ARG		"mode"
+#define ETH_RING_MODE_AUTO		"auto"
+#define ETH_RING_MODE_SPSC		"spsc"
 
 static const char *valid_arguments[] = {
 	ETH_RING_NUMA_NODE_ACTION_ARG,
 	ETH_RING_INTERNAL_ARG,
+	ETH_RING_MODE_ARG,
 	NULL
 };
 
@@ -67,6 +72,11 @@ enum dev_action {
 	DEV_ATTACH
 };
 
+enum dev_mode {
+	DEV_MODE_AUTO,	/* follow the producer/consumer flags of each ring */
+	DEV_MODE_SPSC	/* one thread per ring side, whatever the ring flags */
+};
+
 struct ring_queue {
 	struct rte_ring *rng;
 	rte_atomic64_t rx_pkts;
@@ -83,6 +93,7 @@ struct pmd_internals {
 
 	struct ether_addr address;
 	enum dev_action action;
+	enum dev_mode mode;
 };
 
 
@@ -124,6 +135,43 @@ eth_ring_tx(void *q, struct rte_mbuf **bufs, uint16_t nb_bufs)
 	return nb_tx;
 }
 
+/*
+ * In SP/SC mode, each ring side is only used through this port queue, so
+ * the single producer/consumer paths and plain counters are used even if
+ * the ring was created for multiple producers or consumers.
+ */
+static uint16_t
+eth_ring_rx_sc(void *q, struct rte_mbuf **bufs, uint16_t nb_bufs)
+{
+	void **ptrs = (void *)&bufs[0];
+	struct ring_queue *r = q;
+	const uint16_t nb_rx = (uint16_t)rte_ring_sc_dequeue_burst(r->rng,
+			ptrs, nb_bufs, NULL);
+	uint16_t i;
+
+	/* the mbufs were last written by another core, start fetching
+	 * their first line before the caller parses them
+	 */
+	for (i = 0; i < nb_rx; i++)
+		rte_prefetch0(bufs[i]);
+
+	r->rx_pkts.cnt += nb_rx;
+	return nb_rx;
+}
+
+static uint16_t
+eth_ring_tx_sp(void *q, struct rte_mbuf **bufs, uint16_t nb_bufs)
+{
+	void **ptrs = (void *)&bufs[0];
+	struct ring_queue *r = q;
+	const uint16_t nb_tx = (uint16_t)rte_ring_sp_enqueue_burst(r->rng,
+			ptrs, nb_bufs, NULL);
+
+	r->tx_pkts.cnt += nb_tx;
+	r->err_pkts.cnt += nb_bufs - nb_tx;
+	return nb_tx;
+}
+
 static int
 eth_dev_configure(struct rte_eth_dev *dev __rte_unused) { return 0; }
 
@@ -229,6 +277,56 @@ eth_stats_reset(struct rte_eth_dev *dev)
 	}
 }
 
+static int
+eth_xstats_get_names(struct rte_eth_dev *dev,
+		struct rte_eth_xstat_name *xstats_names,
+		unsigned int size __rte_unused)
+{
+	unsigned int i, count = 0;
+
+	if (xstats_names == NULL)
+		return dev->data->nb_rx_queues + dev->data->nb_tx_queues;
+
+	for (i = 0; i < dev->data->nb_rx_queues; i++)
+		snprintf(xstats_names[count++].name,
+			 sizeof(xstats_names[0].name),
+			 "rx_q%u_occupancy", i);
+	for (i = 0; i < dev->data->nb_tx_queues; i++)
+		snprintf(xstats_names[count++].name,
+			 sizeof(xstats_names[0].name),
+			 "tx_q%u_occupancy", i);
+
+	return count;
+}
+
+/* Number of packets waiting in the ring of each queue */
+static int
+eth_xstats_get(struct rte_eth_dev *dev, struct rte_eth_xstat *xstats,
+		unsigned int n)
+{
+	const struct pmd_internals *internal = dev->data->dev_private;
+	unsigned int i, count = 0;
+
+	if (n < (unsigned int)(dev->data->nb_rx_queues +
+			dev->data->nb_tx_queues))
+		return dev->data->nb_rx_queues + dev->data->nb_tx_queues;
+
+	for (i = 0; i < dev->data->nb_rx_queues; i++) {
+		xstats[count].id = count;
+		xstats[count].value =
+			rte_ring_count(internal->rx_ring_queues[i].rng);
+		count++;
+	}
+	for (i = 0; i < dev->data->nb_tx_queues; i++) {
+		xstats[count].id = count;
+		xstats[count].value =
+			rte_ring_count(internal->tx_ring_queues[i].rng);
+		count++;
+	}
+
+	return count;
+}
+
 static void
 eth_mac_addr_remove(struct rte_eth_dev *dev __rte_unused,
 	uint32_t index __rte_unused)
@@ -264,6 +362,8 @@ static const struct eth_dev_ops ops = {
 	.link_update = eth_link_update,
 	.stats_get = eth_stats_get,
 	.stats_reset = eth_stats_reset,
+	.xstats_get = eth_xstats_get,
+	.xstats_get_names = eth_xstats_get_names,
 	.mac_addr_remove = eth_mac_addr_remove,
 	.mac_addr_add = eth_mac_addr_add,
 };
@@ -275,7 +375,7 @@ do_eth_dev_ring_create(const char *name,
 		struct rte_ring * const rx_queues[], const unsigned nb_rx_queues,
 		struct rte_ring *const tx_queues[], const unsigned nb_tx_queues,
 		const unsigned int numa_node, enum dev_action action,
-		struct rte_eth_dev **eth_dev_p)
+		enum dev_mode mode, struct rte_eth_dev **eth_dev_p)
 {
 	struct rte_eth_dev_data *data = NULL;
 	struct pmd_internals *internals = NULL;
@@ -337,6 +437,7 @@ do_eth_dev_ring_create(const char *name,
 	data->tx_queues = tx_queues_local;
 
 	internals->action = action;
+	internals->mode = mode;
 	internals->max_rx_queues = nb_rx_queues;
 	internals->max_tx_queues = nb_tx_queues;
 	for (i = 0; i < nb_rx_queues; i++) {
@@ -361,8 +462,13 @@ do_eth_dev_ring_create(const char *name,
 	data->numa_node = numa_node;
 
 	/* finally assign rx and tx ops */
-	eth_dev->rx_pkt_burst = eth_ring_rx;
-	eth_dev->tx_pkt_burst = eth_ring_tx;
+	if (mode == DEV_MODE_SPSC) {
+		eth_dev->rx_pkt_burst = eth_ring_rx_sc;
+		eth_dev->tx_pkt_burst = eth_ring_tx_sp;
+	} else {
+		eth_dev->rx_pkt_burst = eth_ring_rx;
+		eth_dev->tx_pkt_burst = eth_ring_tx;
+	}
 
 	*eth_dev_p = eth_dev;
 
@@ -378,11 +484,13 @@ do_eth_dev_ring_create(const char *name,
 }
 
 int
-rte_eth_from_rings(const char *name, struct rte_ring *const rx_queues[],
+rte_eth_from_rings_devargs(const char *name,
+		struct rte_ring *const rx_queues[],
 		const unsigned nb_rx_queues,
 		struct rte_ring *const tx_queues[],
 		const unsigned nb_tx_queues,
-		const unsigned numa_node)
+		const unsigned numa_node,
+		const char *devargs)
 {
 	struct ring_internal_args args = {
 		.rx_queues = rx_queues,
@@ -392,7 +500,7 @@ rte_eth_from_rings(const char *name, struct rte_ring *const rx_queues[],
 		.numa_node = numa_node,
 		.addr = &args,
 	};
-	char args_str[32] = { 0 };
+	char args_str[256] = { 0 };
 	char ring_name[32] = { 0 };
 	uint8_t port_id = RTE_MAX_ETHPORTS;
 	int ret;
@@ -411,7 +519,14 @@ rte_eth_from_rings(const char *name, struct rte_ring *const rx_queues[],
 		return -1;
 	}
 
-	snprintf(args_str, 32, "%s=%p", ETH_RING_INTERNAL_ARG, &args);
+	ret = snprintf(args_str, sizeof(args_str), "%s=%p%s%s",
+			ETH_RING_INTERNAL_ARG, &args,
+			devargs != NULL && devargs[0] != '\0' ? "," : "",
+			devargs != NULL ? devargs : "");
+	if (ret < 0 || ret >= (int)sizeof(args_str)) {
+		rte_errno = EINVAL;
+		return -1;
+	}
 	snprintf(ring_name, 32, "net_ring_%s", name);
 
 	ret = rte_vdev_init(ring_name, args_str);
@@ -425,6 +540,17 @@ rte_eth_from_rings(const char *name, struct rte_ring *const rx_queues[],
 	return port_id;
 }
 
+int
+rte_eth_from_rings(const char *name, struct rte_ring *const rx_queues[],
+		const unsigned nb_rx_queues,
+		struct rte_ring *const tx_queues[],
+		const unsigned nb_tx_queues,
+		const unsigned numa_node)
+{
+	return rte_eth_from_rings_devargs(name, rx_queues, nb_rx_queues,
+			tx_queues, nb_tx_queues, numa_node, NULL);
+}
+
 int
 rte_eth_from_ring(struct rte_ring *r)
 {
@@ -434,7 +560,8 @@ rte_eth_from_ring(struct rte_ring *r)
 
 static int
 eth_dev_ring_create(const char *name, const unsigned numa_node,
-		enum dev_action action, struct rte_eth_dev **eth_dev)
+		enum dev_action action, enum dev_mode mode,
+		struct rte_eth_dev **eth_dev)
 {
 	/* rx and tx are so-called from point of view of first port.
 	 * They are inverted from the point of view of second port
@@ -456,7 +583,7 @@ eth_dev_ring_create(const char *name, const unsigned numa_node,
 	}
 
 	if (do_eth_dev_ring_create(name, rxtx, num_rings, rxtx, num_rings,
-		numa_node, action, eth_dev) < 0)
+		numa_node, action, mode, eth_dev) < 0)
 		return -1;
 
 	return 0;
@@ -558,6 +685,23 @@ parse_internal_args(const char *key __rte_unused, const char *value,
 	return 0;
 }
 
+static int
+parse_mode_arg(const char *key __rte_unused, const char *value, void *data)
+{
+	enum dev_mode *mode = data;
+
+	if (strcmp(value, ETH_RING_MODE_AUTO) == 0)
+		*mode = DEV_MODE_AUTO;
+	else if (strcmp(value, ETH_RING_MODE_SPSC) == 0)
+		*mode = DEV_MODE_SPSC;
+	else {
+		RTE_LOG(WARNING, PMD, "invalid ring pmd mode %s\n", value);
+		return -1;
+	}
+
+	return 0;
+}
+
 static int
 rte_pmd_ring_probe(struct rte_vdev_device *dev)
 {
@@ -567,6 +711,7 @@ rte_pmd_ring_probe(struct rte_vdev_device *dev)
 	struct node_action_list *info = NULL;
 	struct rte_eth_dev *eth_dev = NULL;
 	struct ring_internal_args *internal_args;
+	enum dev_mode mode = DEV_MODE_AUTO;
 
 	name = rte_vdev_device_name(dev);
 	params = rte_vdev_device_args(dev);
@@ -575,12 +720,12 @@ rte_pmd_ring_probe(struct rte_vdev_device *dev)
 
 	if (params == NULL || params[0] == '\0') {
 		ret = eth_dev_ring_create(name, rte_socket_id(), DEV_CREATE,
-				&eth_dev);
+				mode, &eth_dev);
 		if (ret == -1) {
 			RTE_LOG(INFO, PMD,
 				"Attach to pmd_ring for %s\n", name);
 			ret = eth_dev_ring_create(name, rte_socket_id(),
-						  DEV_ATTACH, &eth_dev);
+						  DEV_ATTACH, mode, &eth_dev);
 		}
 	} else {
 		kvlist = rte_kvargs_parse(params, valid_arguments);
@@ -589,13 +734,13 @@ rte_pmd_ring_probe(struct rte_vdev_device *dev)
 			RTE_LOG(INFO, PMD, "Ignoring unsupported parameters when creating"
 					" rings-backed ethernet device\n");
 			ret = eth_dev_ring_create(name, rte_socket_id(),
-						  DEV_CREATE, &eth_dev);
+						  DEV_CREATE, mode, &eth_dev);
 			if (ret == -1) {
 				RTE_LOG(INFO, PMD,
 					"Attach to pmd_ring for %s\n",
 					name);
 				ret = eth_dev_ring_create(name, rte_socket_id(),
-							  DEV_ATTACH, &eth_dev);
+							  DEV_ATTACH, mode, &eth_dev);
 			}
 
 			if (eth_dev)
@@ -604,6 +749,11 @@ rte_pmd_ring_probe(struct rte_vdev_device *dev)
 			return ret;
 		}
 
+		ret = rte_kvargs_process(kvlist, ETH_RING_MODE_ARG,
+					 parse_mode_arg, &mode);
+		if (ret < 0)
+			goto out_free;
+
 		if (rte_kvargs_count(kvlist, ETH_RING_INTERNAL_ARG) == 1) {
 			ret = rte_kvargs_process(kvlist, ETH_RING_INTERNAL_ARG,
 						 parse_internal_args,
@@ -618,9 +768,21 @@ rte_pmd_ring_probe(struct rte_vdev_device *dev)
 				internal_args->nb_tx_queues,
 				internal_args->numa_node,
 				DEV_ATTACH,
+				mode,
 				&eth_dev);
 			if (ret >= 0)
 				ret = 0;
+		} else if (rte_kvargs_count(kvlist,
+				ETH_RING_NUMA_NODE_ACTION_ARG) == 0) {
+			ret = eth_dev_ring_create(name, rte_socket_id(),
+						  DEV_CREATE, mode, &eth_dev);
+			if (ret == -1) {
+				RTE_LOG(INFO, PMD,
+					"Attach to pmd_ring for %s\n",
+					name);
+				ret = eth_dev_ring_create(name, rte_socket_id(),
+							  DEV_ATTACH, mode, &eth_dev);
+			}
 		} else {
 			ret = rte_kvargs_count(kvlist, ETH_RING_NUMA_NODE_ACTION_ARG);
 			info = rte_zmalloc("struct node_action_list",
@@ -643,7 +805,7 @@ rte_pmd_ring_probe(struct rte_vdev_device *dev)
 				ret = eth_dev_ring_create(info->list[info->count].name,
 							  info->list[info->count].node,
 							  info->list[info->count].action,
-							  &eth_dev);
+							  mode, &eth_dev);
 				if ((ret == -1) &&
 				    (info->list[info->count].action == DEV_CREATE)) {
 					RTE_LOG(INFO, PMD,
@@ -651,7 +813,7 @@ rte_pmd_ring_probe(struct rte_vdev_device *dev)
 						name);
 					ret = eth_dev_ring_create(name,
 							info->list[info->count].node,
-							DEV_ATTACH,
+							DEV_ATTACH, mode,
 							&eth_dev);
 				}
 			}
@@ -718,4 +880,5 @@ static struct rte_vdev_driver pmd_ring_drv = {
 RTE_PMD_REGISTER_VDEV(net_ring, pmd_ring_drv);
 RTE_PMD_REGISTER_ALIAS(net_ring, eth_ring);
 RTE_PMD_REGISTER_PARAM_STRING(net_ring,
-	ETH_RING_NUMA_NODE_ACTION_ARG "=name:node:action(ATTACH|CREATE)");
+	ETH_RING_NUMA_NODE_ACTION_ARG "=name:node:action(ATTACH|CREATE) "
+	ETH_RING_MODE_ARG "=<auto|spsc>");
@@ -65,6 +65,42 @@ int rte_eth_from_rings(const char *name,
 		const unsigned nb_tx_queues,
 		const unsigned numa_node);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a new ethdev port from a set of rings, with device arguments
+ *
+ * This is the same as rte_eth_from_rings, with the arguments of the ring
+ * PMD given as a string. In particular "mode=spsc" makes each queue use
+ * the single producer or consumer functions of its ring, whatever the
+ * ring flags, for rings only accessed through this port on their side.
+ *
+ * @param name
+ *    name to be given to the new ethdev port
+ * @param rx_queues
+ *    pointer to array of rte_rings to be used as RX queues
+ * @param nb_rx_queues
+ *    number of elements in the rx_queues array
+ * @param tx_queues
+ *    pointer to array of rte_rings to be used as TX queues
+ * @param nb_tx_queues
+ *    number of elements in the tx_queues array
+ * @param numa_node
+ *    the numa node on which the memory for this port is to be allocated
+ * @param devargs
+ *    comma separated key=value arguments of the ring PMD, or NULL
+ * @return
+ *    the port number of the newly created the ethdev or -1 on error.
+ */
+int rte_eth_from_rings_devargs(const char *name,
+		struct rte_ring * const rx_queues[],
+		const unsigned nb_rx_queues,
+		struct rte_ring *const tx_queues[],
+		const unsigned nb_tx_queues,
+		const unsigned numa_node,
+		const char *devargs);
+
 /**
  * Create a new ethdev port from a ring
  *
@@ -78,6 +78,9 @@
 #define ETH_TAP_MAC_ARG         "mac"
 #define ETH_TAP_MAC_FIXED       "fixed"
 
+/* Largest frame the kernel hands over with TSO offloads */
+#define TAP_GSO_MAX             (ETHER_HDR_LEN + 4 + 65535)
+
 #define FLOWER_KERNEL_VERSION KERNEL_VERSION(4, 2, 0)
 #define FLOWER_VLAN_KERNEL_VERSION KERNEL_VERSION(4, 9, 0)
 
@@ -127,9 +130,7 @@ static int
 tun_alloc(struct pmd_internals *pmd)
 {
 	struct ifreq ifr;
-#ifdef IFF_MULTI_QUEUE
 	unsigned int features;
-#endif
 	int fd;
 
 	memset(&ifr, 0, sizeof(struct ifreq));
@@ -149,7 +150,6 @@ tun_alloc(struct pmd_internals *pmd)
 		goto error;
 	}
 
-#ifdef IFF_MULTI_QUEUE
 	/* Grab the TUN features to verify we can work multi-queue */
 	if (ioctl(fd, TUNGETFEATURES, &features) < 0) {
 		RTE_LOG(ERR, PMD, "TAP unable to get TUN/TAP features\n");
@@ -157,6 +157,15 @@ tun_alloc(struct pmd_internals *pmd)
 	}
 	RTE_LOG(DEBUG, PMD, "  TAP Features %08x\n", features);
 
+	/*
+	 * A virtio net header before each frame carries checksum and
+	 * segmentation offloads to and from the kernel.
+	 */
+	pmd->vnet_hdr = !!(features & IFF_VNET_HDR);
+	if (pmd->vnet_hdr)
+		ifr.ifr_flags |= IFF_VNET_HDR;
+
+#ifdef IFF_MULTI_QUEUE
 	if (features & IFF_MULTI_QUEUE) {
 		RTE_LOG(DEBUG, PMD, "  Multi-queue support for %d queues\n",
 			RTE_PMD_TAP_MAX_QUEUES);
@@ -177,6 +186,17 @@ tun_alloc(struct pmd_internals *pmd)
 		goto error;
 	}
 
+	if (pmd->vnet_hdr) {
+		int hdr_size = sizeof(struct virtio_net_hdr);
+
+		if (ioctl(fd, TUNSETVNETHDRSZ, &hdr_size) < 0) {
+			RTE_LOG(WARNING, PMD,
+				"Unable to set vnet header size for %s\n",
+				ifr.ifr_name);
+			goto error;
+		}
+	}
+
 	/* Always set the file descriptor to non-blocking */
 	if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
 		RTE_LOG(WARNING, PMD,
@@ -270,6 +290,9 @@ tap_verify_csum(struct rte_mbuf *mbuf)
 		/* IPv6 extensions are not supported */
 		return;
 	}
+	/* The kernel may already have vouched for the L4 checksum */
+	if (mbuf->ol_flags & PKT_RX_L4_CKSUM_MASK)
+		return;
 	if (l4 == RTE_PTYPE_L4_UDP || l4 == RTE_PTYPE_L4_TCP) {
 		l4_hdr = rte_pktmbuf_mtod_offset(mbuf, void *, l2_len + l3_len);
 		/* Don't verify checksum for multi-segment packets. */
@@ -285,6 +308,56 @@ tap_verify_csum(struct rte_mbuf *mbuf)
 	}
 }
 
+/* Translate the vnet header of a received frame into mbuf offload flags.
+ * Checksums are only left undone and frames only left unsegmented by the
+ * kernel when the matching offloads are set, see tap_offload_set().
+ */
+static int
+tap_rx_offload(struct rte_mbuf *mbuf, const struct virtio_net_hdr *hdr,
+	       const struct rte_net_hdr_lens *hdr_lens)
+{
+	uint32_t l4 = mbuf->packet_type & RTE_PTYPE_L4_MASK;
+	int l4_supported = l4 == RTE_PTYPE_L4_TCP || l4 == RTE_PTYPE_L4_UDP;
+
+	if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+		if (l4_supported &&
+		    hdr->csum_start == hdr_lens->l2_len + hdr_lens->l3_len) {
+			mbuf->ol_flags |= PKT_RX_L4_CKSUM_NONE;
+		} else {
+			/* Unknown protocol or tunnel, do the checksum here */
+			uint16_t csum, off;
+
+			rte_raw_cksum_mbuf(mbuf, hdr->csum_start,
+					   rte_pktmbuf_pkt_len(mbuf) -
+					   hdr->csum_start, &csum);
+			if (likely(csum != 0xffff))
+				csum = ~csum;
+			off = hdr->csum_offset + hdr->csum_start;
+			if (rte_pktmbuf_data_len(mbuf) >= off + sizeof(csum))
+				*rte_pktmbuf_mtod_offset(mbuf, uint16_t *,
+							 off) = csum;
+		}
+	} else if (hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID && l4_supported) {
+		mbuf->ol_flags |= PKT_RX_L4_CKSUM_GOOD;
+	}
+
+	if (hdr->gso_type != VIRTIO_NET_HDR_GSO_NONE) {
+		switch (hdr->gso_type) {
+		case VIRTIO_NET_HDR_GSO_TCPV4:
+		case VIRTIO_NET_HDR_GSO_TCPV6:
+			if (hdr->gso_size == 0)
+				return -1;
+			mbuf->ol_flags |= PKT_RX_LRO;
+			mbuf->tso_segsz = hdr->gso_size;
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 /* Callback to handle the rx burst of packets to the correct interface and
  * file descriptor(s) in a multi-queue setup.
  */
@@ -296,10 +369,13 @@ pmd_rx_burst(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	unsigned long num_rx_bytes = 0;
 	uint32_t trigger = tap_trigger;
 
+	int hdr_len = (*rxq->iovecs)[0].iov_len;
+	int nb_iovs = 1 + (rxq->rxmode->enable_scatter ||
+			   rxq->rxmode->enable_lro ? rxq->nb_rx_desc : 1);
+	struct rte_net_hdr_lens hdr_lens;
+
 	if (trigger == rxq->trigger_seen)
 		return 0;
-	if (trigger)
-		rxq->trigger_seen = trigger;
 	rte_compiler_barrier();
 	for (num_rx = 0; num_rx < nb_pkts; ) {
 		struct rte_mbuf *mbuf = rxq->pool;
@@ -308,19 +384,25 @@ pmd_rx_burst(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 		uint16_t data_off = rte_pktmbuf_headroom(mbuf);
 		int len;
 
-		len = readv(rxq->fd, *rxq->iovecs,
-			    1 + (rxq->rxmode->enable_scatter ?
-				 rxq->nb_rx_desc : 1));
-		if (len < (int)sizeof(struct tun_pi))
+		len = readv(rxq->fd, *rxq->iovecs, nb_iovs);
+		if (len < hdr_len) {
+			/*
+			 * Only a drained queue waits for the next trigger,
+			 * packets left behind by a full burst are read on
+			 * the next one.
+			 */
+			if (trigger)
+				rxq->trigger_seen = trigger;
 			break;
+		}
 
 		/* Packet couldn't fit in the provided mbuf */
-		if (unlikely(rxq->pi.flags & TUN_PKT_STRIP)) {
+		if (unlikely(rxq->hdr.pi.flags & TUN_PKT_STRIP)) {
 			rxq->stats.ierrors++;
 			continue;
 		}
 
-		len -= sizeof(struct tun_pi);
+		len -= hdr_len;
 
 		mbuf->pkt_len = len;
 		mbuf->port = rxq->in_port;
@@ -363,8 +445,17 @@ pmd_rx_burst(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 			data_off = 0;
 		}
 		seg->next = NULL;
-		mbuf->packet_type = rte_net_get_ptype(mbuf, NULL,
+		mbuf->packet_type = rte_net_get_ptype(mbuf, &hdr_lens,
 						      RTE_PTYPE_ALL_MASK);
+		if (rxq->vnet_hdr &&
+		    (rxq->hdr.vnet.flags ||
+		     rxq->hdr.vnet.gso_type != VIRTIO_NET_HDR_GSO_NONE) &&
+		    unlikely(tap_rx_offload(mbuf, &rxq->hdr.vnet,
+					    &hdr_lens) < 0)) {
+			rte_pktmbuf_free(mbuf);
+			rxq->stats.ierrors++;
+			continue;
+		}
 		if (rxq->rxmode->hw_ip_checksum)
 			tap_verify_csum(mbuf);
 
@@ -429,6 +520,73 @@ tap_tx_offload(char *packet, uint64_t ol_flags, unsigned int l2_len,
 	}
 }
 
+/* Fill the vnet header of a frame from the mbuf checksum and TSO requests,
+ * leaving the L4 checksum and the segmentation to the kernel. The checksum
+ * fields are set in a copy of the packet headers, so as not to write into
+ * the mbuf. Returns the length of that copy, or -1 if the headers are not
+ * in the first segment.
+ */
+static int
+tap_tx_vnet_offload(struct virtio_net_hdr *hdr, struct rte_mbuf *mbuf,
+		    char *copy)
+{
+	uint64_t ol_flags = mbuf->ol_flags;
+	unsigned int l4_off = mbuf->l2_len + mbuf->l3_len;
+	unsigned int copy_len = l4_off;
+	int tcp = (ol_flags & PKT_TX_L4_MASK) == PKT_TX_TCP_CKSUM ||
+		(ol_flags & PKT_TX_TCP_SEG);
+	int udp = (ol_flags & PKT_TX_L4_MASK) == PKT_TX_UDP_CKSUM;
+	void *l3_hdr = copy + mbuf->l2_len;
+	uint16_t *l4_cksum;
+	int ipv4;
+
+	/* As in tap_tx_offload(), IPv4 packets get their checksum anyway */
+	if (!(ol_flags & (PKT_TX_IP_CKSUM | PKT_TX_IPV4)) && !tcp && !udp)
+		return 0;
+
+	if (ol_flags & PKT_TX_TCP_SEG)
+		copy_len += mbuf->l4_len;
+	else if (tcp)
+		copy_len += sizeof(struct tcp_hdr);
+	else if (udp)
+		copy_len += sizeof(struct udp_hdr);
+	if (unlikely(copy_len > rte_pktmbuf_data_len(mbuf)))
+		return -1;
+	rte_memcpy(copy, rte_pktmbuf_mtod(mbuf, void *), copy_len);
+
+	ipv4 = (*(uint8_t *)l3_hdr >> 4) == 4;
+	if (ipv4 && (ol_flags & (PKT_TX_IP_CKSUM | PKT_TX_IPV4))) {
+		struct ipv4_hdr *iph = l3_hdr;
+
+		iph->hdr_checksum = 0;
+		iph->hdr_checksum = rte_ipv4_cksum(iph);
+	}
+	if (!tcp && !udp)
+		return copy_len;
+
+	/* The kernel expects the pseudo-header checksum, length included */
+	if (tcp)
+		l4_cksum = &((struct tcp_hdr *)(copy + l4_off))->cksum;
+	else
+		l4_cksum = &((struct udp_hdr *)(copy + l4_off))->dgram_cksum;
+	*l4_cksum = ipv4 ? rte_ipv4_phdr_cksum(l3_hdr, 0) :
+		rte_ipv6_phdr_cksum(l3_hdr, 0);
+
+	hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+	hdr->csum_start = l4_off;
+	hdr->csum_offset = tcp ? offsetof(struct tcp_hdr, cksum) :
+		offsetof(struct udp_hdr, dgram_cksum);
+
+	if (ol_flags & PKT_TX_TCP_SEG) {
+		hdr->gso_type = ipv4 ? VIRTIO_NET_HDR_GSO_TCPV4 :
+			VIRTIO_NET_HDR_GSO_TCPV6;
+		hdr->gso_size = mbuf->tso_segsz;
+		hdr->hdr_len = copy_len;
+	}
+
+	return copy_len;
+}
+
 /* Callback to handle sending packets from the tap interface
  */
 static uint16_t
@@ -446,40 +604,57 @@ pmd_tx_burst(void *queue, struct rte_mbuf **bufs, uint16_t nb_pkts)
 	max_size = *txq->mtu + (ETHER_HDR_LEN + ETHER_CRC_LEN + 4);
 	for (i = 0; i < nb_pkts; i++) {
 		struct rte_mbuf *mbuf = bufs[num_tx];
-		struct iovec iovecs[mbuf->nb_segs + 1];
-		struct tun_pi pi = { .flags = 0 };
+		struct iovec iovecs[mbuf->nb_segs + 2];
+		struct tap_hdr hdr = { .pi = { .flags = 0 } };
 		struct rte_mbuf *seg = mbuf;
 		char m_copy[mbuf->data_len];
+		int copy_len = 0;
 		int n;
 		int j;
 
 		/* stats.errs will be incremented */
-		if (rte_pktmbuf_pkt_len(mbuf) > max_size)
+		if (rte_pktmbuf_pkt_len(mbuf) > max_size &&
+		    !(txq->vnet_hdr && (mbuf->ol_flags & PKT_TX_TCP_SEG)))
 			break;
 
-		iovecs[0].iov_base = &pi;
-		iovecs[0].iov_len = sizeof(pi);
-		for (j = 1; j <= mbuf->nb_segs; j++) {
-			iovecs[j].iov_len = rte_pktmbuf_data_len(seg);
-			iovecs[j].iov_base =
-				rte_pktmbuf_mtod(seg, void *);
-			seg = seg->next;
-		}
-		if (mbuf->ol_flags & (PKT_TX_IP_CKSUM | PKT_TX_IPV4) ||
+		iovecs[0].iov_base = &hdr;
+		iovecs[0].iov_len = sizeof(hdr.pi);
+		if (txq->vnet_hdr) {
+			iovecs[0].iov_len = sizeof(hdr);
+			copy_len = tap_tx_vnet_offload(&hdr.vnet, mbuf, m_copy);
+			if (copy_len < 0)
+				break;
+		} else if (mbuf->ol_flags & (PKT_TX_IP_CKSUM | PKT_TX_IPV4) ||
 		    (mbuf->ol_flags & PKT_TX_L4_MASK) == PKT_TX_UDP_CKSUM ||
 		    (mbuf->ol_flags & PKT_TX_L4_MASK) == PKT_TX_TCP_CKSUM) {
 			/* Support only packets with all data in the same seg */
 			if (mbuf->nb_segs > 1)
 				break;
 			/* To change checksums, work on a copy of data. */
+			copy_len = rte_pktmbuf_data_len(mbuf);
 			rte_memcpy(m_copy, rte_pktmbuf_mtod(mbuf, void *),
-				   rte_pktmbuf_data_len(mbuf));
+				   copy_len);
 			tap_tx_offload(m_copy, mbuf->ol_flags,
 				       mbuf->l2_len, mbuf->l3_len);
-			iovecs[1].iov_base = m_copy;
+		}
+
+		/* modified headers first, then the rest of the data */
+		j = 1;
+		if (copy_len) {
+			iovecs[j].iov_base = m_copy;
+			iovecs[j].iov_len = copy_len;
+			j++;
+		}
+		iovecs[j].iov_base = rte_pktmbuf_mtod_offset(seg, void *,
+							     copy_len);
+		iovecs[j].iov_len = rte_pktmbuf_data_len(seg) - copy_len;
+		for (j++, seg = seg->next; seg; j++, seg = seg->next) {
+			iovecs[j].iov_len = rte_pktmbuf_data_len(seg);
+			iovecs[j].iov_base =
+				rte_pktmbuf_mtod(seg, void *);
 		}
 		/* copy the tx frame data */
-		n = writev(txq->fd, iovecs, mbuf->nb_segs + 1);
+		n = writev(txq->fd, iovecs, j);
 		if (n <= 0)
 			break;
 
@@ -582,11 +757,38 @@ tap_link_set_up(struct rte_eth_dev *dev)
 	return tap_ioctl(pmd, SIOCSIFFLAGS, &ifr, 1, LOCAL_AND_REMOTE);
 }
 
+/* Tell the kernel which offloads the Rx path can take: checksums left
+ * undone and unsegmented TCP frames.
+ */
+static int
+tap_offload_set(struct rte_eth_dev *dev)
+{
+	struct pmd_internals *pmd = dev->data->dev_private;
+	struct rte_eth_rxmode *rxmode = &dev->data->dev_conf.rxmode;
+	unsigned int offload = 0;
+
+	if (!pmd->vnet_hdr)
+		return 0;
+	if (rxmode->hw_ip_checksum)
+		offload |= TUN_F_CSUM;
+	if (rxmode->enable_lro)
+		offload |= TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6;
+	if (ioctl(pmd->rxq[0].fd, TUNSETOFFLOAD, offload) < 0) {
+		RTE_LOG(ERR, PMD, "%s: Unable to set offloads %#x: %s\n",
+			pmd->name, offload, strerror(errno));
+		return -errno;
+	}
+	return 0;
+}
+
 static int
 tap_dev_start(struct rte_eth_dev *dev)
 {
 	int err;
 
+	err = tap_offload_set(dev);
+	if (err)
+		return err;
 	err = tap_intr_handle_set(dev, 1);
 	if (err)
 		return err;
@@ -662,6 +864,10 @@ tap_dev_info(struct rte_eth_dev *dev, struct rte_eth_dev_info *dev_info)
 		(DEV_TX_OFFLOAD_IPV4_CKSUM |
 		 DEV_TX_OFFLOAD_UDP_CKSUM |
 		 DEV_TX_OFFLOAD_TCP_CKSUM);
+	if (internals->vnet_hdr) {
+		dev_info->rx_offload_capa |= DEV_RX_OFFLOAD_TCP_LRO;
+		dev_info->tx_offload_capa |= DEV_TX_OFFLOAD_TCP_TSO;
+	}
 }
 
 static void
@@ -907,6 +1113,8 @@ tap_setup_queue(struct rte_eth_dev *dev,
 
 	rx->fd = fd;
 	tx->fd = fd;
+	rx->vnet_hdr = pmd->vnet_hdr;
+	tx->vnet_hdr = pmd->vnet_hdr;
 	tx->mtu = &dev->data->mtu;
 	rx->rxmode = &dev->data->dev_conf.rxmode;
 
@@ -960,8 +1168,9 @@ tap_rx_queue_setup(struct rte_eth_dev *dev,
 		goto error;
 	}
 
-	(*rxq->iovecs)[0].iov_len = sizeof(struct tun_pi);
-	(*rxq->iovecs)[0].iov_base = &rxq->pi;
+	(*rxq->iovecs)[0].iov_len = rxq->vnet_hdr ?
+		sizeof(rxq->hdr) : sizeof(rxq->hdr.pi);
+	(*rxq->iovecs)[0].iov_base = &rxq->hdr;
 
 	for (i = 1; i <= nb_desc; i++) {
 		*tmp = rte_pktmbuf_alloc(rxq->mp);
@@ -979,6 +1188,12 @@ tap_rx_queue_setup(struct rte_eth_dev *dev,
 		tmp = &(*tmp)->next;
 	}
 
+	if (rxq->rxmode->enable_lro &&
+	    (rxq->pool->buf_len - RTE_PKTMBUF_HEADROOM) * nb_desc < TAP_GSO_MAX)
+		RTE_LOG(WARNING, PMD,
+			"%s: %d RX descriptors too few for LRO, large packets will be dropped\n",
+			dev->device->name, nb_desc);
+
 	RTE_LOG(DEBUG, PMD, "  RX TAP device name %s, qid %d on fd %d\n",
 		internals->name, rx_queue_id, internals->rxq[rx_queue_id].fd);
 
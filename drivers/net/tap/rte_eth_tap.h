@@ -40,6 +40,7 @@
 #include <net/if.h>
 
 #include <linux/if_tun.h>
+#include <linux/virtio_net.h>
 
 #include <rte_ethdev.h>
 #include <rte_ether.h>
@@ -60,6 +61,12 @@ struct pkt_stats {
 	uint64_t rx_nombuf;             /* Nb of RX mbuf alloc failures */
 };
 
+/* Headers preceding each frame read from or written to the tap */
+struct tap_hdr {
+	struct tun_pi pi;               /* packet info */
+	struct virtio_net_hdr vnet;     /* offloads, if IFF_VNET_HDR is set */
+};
+
 struct rx_queue {
 	struct rte_mempool *mp;         /* Mempool for RX packets */
 	uint32_t trigger_seen;          /* Last seen Rx trigger value */
@@ -70,11 +77,13 @@ struct rx_queue {
 	struct rte_eth_rxmode *rxmode;  /* RX features */
 	struct rte_mbuf *pool;          /* mbufs pool for this queue */
 	struct iovec (*iovecs)[];       /* descriptors for this queue */
-	struct tun_pi pi;               /* packet info for iovecs */
+	struct tap_hdr hdr;             /* packet headers for iovecs */
+	int vnet_hdr;                   /* 1 if frames have a vnet header */
 };
 
 struct tx_queue {
 	int fd;
+	int vnet_hdr;                   /* 1 if frames have a vnet header */
 	uint16_t *mtu;                  /* Pointer to MTU from dev_data */
 	struct pkt_stats stats;         /* Stats for this TX queue */
 };
@@ -90,6 +99,7 @@ struct pmd_internals {
 	int ioctl_sock;                   /* socket for ioctl calls */
 	int nlsk_fd;                      /* Netlink socket fd */
 	int flow_isolate;                 /* 1 if flow isolation is enabled */
+	int vnet_hdr;                     /* 1 if IFF_VNET_HDR is enabled */
 	LIST_HEAD(tap_flows, rte_flow) flows;        /* rte_flow rules */
 	/* implicit rte_flow rules set when a remote device is active */
 	LIST_HEAD(tap_implicit_flows, rte_flow) implicit_flows;
@@ -155,6 +155,84 @@ static const struct rte_virtio_xstats_name_off rte_virtio_txq_stat_strings[] = {
 
 struct virtio_hw_internal virtio_hw_internal[RTE_MAX_ETHPORTS];
 
+/*
+ * Packed ring flavour of virtio_send_command(): the whole command is one
+ * chain of header, data and status descriptors sharing a single buffer
+ * id; the head flags are written last to make it available at once.
+ */
+static int
+virtio_send_command_packed(struct virtnet_ctl *cvq,
+		struct virtio_pmd_ctrl *ctrl, int *dlen, int pkt_num)
+{
+	struct virtqueue *vq = cvq->vq;
+	struct vring_packed_desc *desc = vq->vq_packed.desc_packed;
+	struct virtio_pmd_ctrl result;
+	uint16_t head, idx, id, head_flags, nb_descs = 0;
+	int k, sum = 0;
+
+	if ((vq->vq_free_cnt < ((uint32_t)pkt_num + 2)) || (pkt_num < 1))
+		return -1;
+
+	memcpy(cvq->virtio_net_hdr_mz->addr, ctrl,
+		sizeof(struct virtio_pmd_ctrl));
+
+	id = vq_packed_get_id(vq);
+	head = vq->vq_avail_idx;
+	head_flags = VRING_DESC_F_NEXT | vq->vq_avail_flags;
+
+	desc[head].addr = cvq->virtio_net_hdr_mem;
+	desc[head].len = sizeof(struct virtio_net_ctrl_hdr);
+	desc[head].id = id;
+	nb_descs++;
+	vq_packed_avail_advance(vq, 1);
+
+	for (k = 0; k < pkt_num; k++) {
+		idx = vq->vq_avail_idx;
+		desc[idx].addr = cvq->virtio_net_hdr_mem
+			+ sizeof(struct virtio_net_ctrl_hdr)
+			+ sizeof(ctrl->status) + sizeof(uint8_t) * sum;
+		desc[idx].len = dlen[k];
+		desc[idx].id = id;
+		desc[idx].flags = VRING_DESC_F_NEXT | vq->vq_avail_flags;
+		sum += dlen[k];
+		nb_descs++;
+		vq_packed_avail_advance(vq, 1);
+	}
+
+	idx = vq->vq_avail_idx;
+	desc[idx].addr = cvq->virtio_net_hdr_mem
+		+ sizeof(struct virtio_net_ctrl_hdr);
+	desc[idx].len = sizeof(ctrl->status);
+	desc[idx].id = id;
+	desc[idx].flags = VRING_DESC_F_WRITE | vq->vq_avail_flags;
+	nb_descs++;
+	vq_packed_avail_advance(vq, 1);
+
+	vq->vq_descx[id].ndescs = nb_descs;
+	vq->vq_free_cnt -= nb_descs;
+
+	virtio_wmb();
+	desc[head].flags = head_flags;
+
+	virtqueue_notify(vq);
+
+	/* wait for the used descriptor */
+	while (!desc_is_used(&desc[head], vq))
+		usleep(100);
+
+	virtio_rmb();
+	vq_packed_used_advance(vq, nb_descs);
+	vq_packed_put_id(vq, id);
+
+	PMD_INIT_LOG(DEBUG, "vq->vq_free_cnt=%d\nvq->vq_avail_idx=%d",
+			vq->vq_free_cnt, vq->vq_avail_idx);
+
+	memcpy(&result, cvq->virtio_net_hdr_mz->addr,
+			sizeof(struct virtio_pmd_ctrl));
+
+	return result.status;
+}
+
 static int
 virtio_send_command(struct virtnet_ctl *cvq, struct virtio_pmd_ctrl *ctrl,
 		int *dlen, int pkt_num)
@@ -172,6 +250,9 @@ virtio_send_command(struct virtnet_ctl *cvq, struct virtio_pmd_ctrl *ctrl,
 		return -1;
 	}
 	vq = cvq->vq;
+	if (vtpci_packed_queue(vq->hw))
+		return virtio_send_command_packed(cvq, ctrl, dlen, pkt_num);
+
 	head = vq->vq_desc_head_idx;
 
 	PMD_INIT_LOG(DEBUG, "vq->vq_desc_head_idx = %d, status = %d, "
@@ -324,6 +405,26 @@ virtio_init_vring(struct virtqueue *vq)
 	 * Reinitialise since virtio port might have been stopped and restarted
 	 */
 	memset(ring_mem, 0, vq->vq_ring_size);
+
+	if (vtpci_packed_queue(vq->hw)) {
+		vring_packed_init(&vq->vq_packed, size, ring_mem,
+				  VIRTIO_PCI_VRING_ALIGN);
+		vq->vq_used_cons_idx = 0;
+		vq->vq_desc_head_idx = 0;
+		vq->vq_avail_idx = 0;
+		vq->vq_desc_tail_idx = (uint16_t)(vq->vq_nentries - 1);
+		vq->vq_free_cnt = vq->vq_nentries;
+		/* both wrap counters start set */
+		vq->vq_avail_wrap_counter = 1;
+		vq->vq_used_wrap_counter = 1;
+		vq->vq_avail_flags = VRING_DESC_F_AVAIL(1);
+		memset(vq->vq_descx, 0,
+		       sizeof(struct vq_desc_extra) * vq->vq_nentries);
+		vring_packed_desc_init(vq);
+		virtqueue_disable_intr(vq);
+		return;
+	}
+
 	vring_init(vr, size, ring_mem, VIRTIO_PCI_VRING_ALIGN);
 	vq->vq_used_cons_idx = 0;
 	vq->vq_desc_head_idx = 0;
@@ -407,7 +508,10 @@ virtio_init_queue(struct rte_eth_dev *dev, uint16_t vtpci_queue_idx)
 	/*
 	 * Reserve a memzone for vring elements
 	 */
-	size = vring_size(vq_size, VIRTIO_PCI_VRING_ALIGN);
+	if (vtpci_packed_queue(hw))
+		size = vring_packed_size(vq_size, VIRTIO_PCI_VRING_ALIGN);
+	else
+		size = vring_size(vq_size, VIRTIO_PCI_VRING_ALIGN);
 	vq->vq_ring_size = RTE_ALIGN_CEIL(size, VIRTIO_PCI_VRING_ALIGN);
 	PMD_INIT_LOG(DEBUG, "vring_size: %d, rounded_vring_size: %d",
 		     size, vq->vq_ring_size);
@@ -1189,6 +1293,13 @@ virtio_negotiate_features(struct virtio_hw *hw, uint64_t req_features)
 	PMD_INIT_LOG(DEBUG, "features after negotiate = %" PRIx64,
 		hw->guest_features);
 
+	if (vtpci_packed_queue(hw) &&
+	    !vtpci_with_feature(hw, VIRTIO_F_VERSION_1)) {
+		PMD_INIT_LOG(ERR,
+			"VIRTIO_F_RING_PACKED requires VIRTIO_F_VERSION_1.");
+		return -1;
+	}
+
 	if (hw->modern) {
 		if (!vtpci_with_feature(hw, VIRTIO_F_VERSION_1)) {
 			PMD_INIT_LOG(ERR,
@@ -1239,6 +1350,17 @@ static void
 rx_func_get(struct rte_eth_dev *eth_dev)
 {
 	struct virtio_hw *hw = eth_dev->data->dev_private;
+
+	if (vtpci_packed_queue(hw)) {
+		if (vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF))
+			eth_dev->rx_pkt_burst =
+				&virtio_recv_mergeable_pkts_packed;
+		else
+			eth_dev->rx_pkt_burst = &virtio_recv_pkts_packed;
+		eth_dev->tx_pkt_burst = &virtio_xmit_pkts_packed;
+		return;
+	}
+
 	if (vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF))
 		eth_dev->rx_pkt_burst = &virtio_recv_mergeable_pkts;
 	else
@@ -1546,7 +1668,11 @@ eth_virtio_dev_init(struct rte_eth_dev *eth_dev)
 		virtio_set_vtpci_ops(hw);
 		if (hw->use_simple_rxtx) {
 			eth_dev->tx_pkt_burst = virtio_xmit_pkts_simple;
-			eth_dev->rx_pkt_burst = virtio_recv_pkts_vec;
+			if (vtpci_with_feature(hw, VIRTIO_NET_F_MRG_RXBUF))
+				eth_dev->rx_pkt_burst =
+					virtio_recv_mergeable_pkts_vec;
+			else
+				eth_dev->rx_pkt_burst = virtio_recv_pkts_vec;
 		} else {
 			rx_func_get(eth_dev);
 		}
@@ -412,10 +412,20 @@ modern_setup_queue(struct virtio_hw *hw, struct virtqueue *vq)
 		return -1;
 
 	desc_addr = vq->vq_ring_mem;
-	avail_addr = desc_addr + vq->vq_nentries * sizeof(struct vring_desc);
-	used_addr = RTE_ALIGN_CEIL(avail_addr + offsetof(struct vring_avail,
-							 ring[vq->vq_nentries]),
-				   VIRTIO_PCI_VRING_ALIGN);
+	if (vtpci_packed_queue(hw)) {
+		/* the driver and device event areas take the avail/used slots */
+		avail_addr = desc_addr + RTE_PTR_DIFF(vq->vq_packed.driver_event,
+						      vq->vq_ring_virt_mem);
+		used_addr = desc_addr + RTE_PTR_DIFF(vq->vq_packed.device_event,
+						     vq->vq_ring_virt_mem);
+	} else {
+		avail_addr = desc_addr +
+			vq->vq_nentries * sizeof(struct vring_desc);
+		used_addr = RTE_ALIGN_CEIL(avail_addr +
+				offsetof(struct vring_avail,
+					 ring[vq->vq_nentries]),
+				VIRTIO_PCI_VRING_ALIGN);
+	}
 
 	rte_write16(vq->vq_queue_index, &hw->common_cfg->queue_select);
 
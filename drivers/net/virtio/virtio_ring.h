@@ -45,6 +45,19 @@
 /* This means the buffer contains a list of buffer descriptors. */
 #define VRING_DESC_F_INDIRECT   4
 
+/*
+ * Mark a descriptor as available or used in the packed ring. A descriptor
+ * is available when AVAIL matches the driver wrap counter and USED does
+ * not; it is used once both match the device wrap counter.
+ */
+#define VRING_DESC_F_AVAIL(b)   ((uint16_t)(b) << 7)
+#define VRING_DESC_F_USED(b)    ((uint16_t)(b) << 15)
+
+/* Event suppression flags of the packed ring. */
+#define RING_EVENT_FLAGS_ENABLE  0x0
+#define RING_EVENT_FLAGS_DISABLE 0x1
+#define RING_EVENT_FLAGS_DESC    0x2
+
 /* The Host uses this in used->flags to advise the Guest: don't kick me
  * when you add a buffer.  It's unreliable, so it's simply an
  * optimization.  Guest will still kick if it's out of buffers. */
@@ -90,6 +103,26 @@ struct vring {
 	struct vring_used  *used;
 };
 
+/* Packed ring descriptor: 16 bytes, written back in place when used. */
+struct vring_packed_desc {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t id;
+	uint16_t flags;
+};
+
+struct vring_packed_desc_event {
+	uint16_t desc_event_off_wrap;
+	uint16_t desc_event_flags;
+};
+
+struct vring_packed {
+	unsigned int num;
+	struct vring_packed_desc *desc_packed;
+	struct vring_packed_desc_event *driver_event;
+	struct vring_packed_desc_event *device_event;
+};
+
 /* The standard layout for the ring is a continuous chunk of memory which
  * looks like this.  We assume num is a power of 2.
  *
@@ -148,6 +181,34 @@ vring_init(struct vring *vr, unsigned int num, uint8_t *p,
 		RTE_ALIGN_CEIL((uintptr_t)(&vr->avail->ring[num]), align);
 }
 
+/*
+ * The packed layout is a single descriptor ring, followed by the driver
+ * event suppression area and, on the next align boundary, the device one.
+ */
+static inline size_t
+vring_packed_size(unsigned int num, unsigned long align)
+{
+	size_t size;
+
+	size = num * sizeof(struct vring_packed_desc);
+	size += sizeof(struct vring_packed_desc_event);
+	size = RTE_ALIGN_CEIL(size, align);
+	size += sizeof(struct vring_packed_desc_event);
+	return size;
+}
+
+static inline void
+vring_packed_init(struct vring_packed *vr, unsigned int num, uint8_t *p,
+	unsigned long align)
+{
+	vr->num = num;
+	vr->desc_packed = (struct vring_packed_desc *)p;
+	vr->driver_event = (struct vring_packed_desc_event *)(p +
+		num * sizeof(struct vring_packed_desc));
+	vr->device_event = (struct vring_packed_desc_event *)
+		RTE_ALIGN_CEIL((uintptr_t)(vr->driver_event + 1), align);
+}
+
 /*
  * The following is used with VIRTIO_RING_F_EVENT_IDX.
  * Assuming a given event_idx value from the other size, if we have
@@ -59,6 +59,72 @@
 #define RTE_VIRTIO_DESC_PER_LOOP 8
 #define RTE_VIRTIO_VPMD_RX_REARM_THRESH RTE_VIRTIO_VPMD_RX_BURST
 
+/*
+ * Move eight mbufs from the sw_ring to rx_pkts, filling their descriptor
+ * fields from the used ring elements: a 16 byte load holds two of them.
+ */
+static __rte_always_inline void
+virtio_rx_desc_fields_vec(struct vring_used_elem *rused,
+	struct rte_mbuf **sw_ring, struct rte_mbuf **rx_pkts,
+	__m128i shuf_msk1, __m128i shuf_msk2, __m128i len_adjust)
+{
+	__m128i desc[RTE_VIRTIO_DESC_PER_LOOP / 2];
+	__m128i mbp[RTE_VIRTIO_DESC_PER_LOOP / 2];
+	__m128i pkt_mb[RTE_VIRTIO_DESC_PER_LOOP];
+
+	mbp[0] = _mm_loadu_si128((__m128i *)(sw_ring + 0));
+	desc[0] = _mm_loadu_si128((__m128i *)(rused + 0));
+	_mm_storeu_si128((__m128i *)&rx_pkts[0], mbp[0]);
+
+	mbp[1] = _mm_loadu_si128((__m128i *)(sw_ring + 2));
+	desc[1] = _mm_loadu_si128((__m128i *)(rused + 2));
+	_mm_storeu_si128((__m128i *)&rx_pkts[2], mbp[1]);
+
+	mbp[2] = _mm_loadu_si128((__m128i *)(sw_ring + 4));
+	desc[2] = _mm_loadu_si128((__m128i *)(rused + 4));
+	_mm_storeu_si128((__m128i *)&rx_pkts[4], mbp[2]);
+
+	mbp[3] = _mm_loadu_si128((__m128i *)(sw_ring + 6));
+	desc[3] = _mm_loadu_si128((__m128i *)(rused + 6));
+	_mm_storeu_si128((__m128i *)&rx_pkts[6], mbp[3]);
+
+	pkt_mb[1] = _mm_shuffle_epi8(desc[0], shuf_msk2);
+	pkt_mb[0] = _mm_shuffle_epi8(desc[0], shuf_msk1);
+	pkt_mb[1] = _mm_add_epi16(pkt_mb[1], len_adjust);
+	pkt_mb[0] = _mm_add_epi16(pkt_mb[0], len_adjust);
+	_mm_storeu_si128((void *)&rx_pkts[1]->rx_descriptor_fields1,
+		pkt_mb[1]);
+	_mm_storeu_si128((void *)&rx_pkts[0]->rx_descriptor_fields1,
+		pkt_mb[0]);
+
+	pkt_mb[3] = _mm_shuffle_epi8(desc[1], shuf_msk2);
+	pkt_mb[2] = _mm_shuffle_epi8(desc[1], shuf_msk1);
+	pkt_mb[3] = _mm_add_epi16(pkt_mb[3], len_adjust);
+	pkt_mb[2] = _mm_add_epi16(pkt_mb[2], len_adjust);
+	_mm_storeu_si128((void *)&rx_pkts[3]->rx_descriptor_fields1,
+		pkt_mb[3]);
+	_mm_storeu_si128((void *)&rx_pkts[2]->rx_descriptor_fields1,
+		pkt_mb[2]);
+
+	pkt_mb[5] = _mm_shuffle_epi8(desc[2], shuf_msk2);
+	pkt_mb[4] = _mm_shuffle_epi8(desc[2], shuf_msk1);
+	pkt_mb[5] = _mm_add_epi16(pkt_mb[5], len_adjust);
+	pkt_mb[4] = _mm_add_epi16(pkt_mb[4], len_adjust);
+	_mm_storeu_si128((void *)&rx_pkts[5]->rx_descriptor_fields1,
+		pkt_mb[5]);
+	_mm_storeu_si128((void *)&rx_pkts[4]->rx_descriptor_fields1,
+		pkt_mb[4]);
+
+	pkt_mb[7] = _mm_shuffle_epi8(desc[3], shuf_msk2);
+	pkt_mb[6] = _mm_shuffle_epi8(desc[3], shuf_msk1);
+	pkt_mb[7] = _mm_add_epi16(pkt_mb[7], len_adjust);
+	pkt_mb[6] = _mm_add_epi16(pkt_mb[6], len_adjust);
+	_mm_storeu_si128((void *)&rx_pkts[7]->rx_descriptor_fields1,
+		pkt_mb[7]);
+	_mm_storeu_si128((void *)&rx_pkts[6]->rx_descriptor_fields1,
+		pkt_mb[6]);
+}
+
 /* virtio vPMD receive routine, only accept(nb_pkts >= RTE_VIRTIO_DESC_PER_LOOP)
  *
  * This routine is for non-mergeable RX, one desc for each guest buffer.
@@ -141,61 +207,8 @@ virtio_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
 
 	for (nb_pkts_received = 0;
 		nb_pkts_received < nb_used;) {
-		__m128i desc[RTE_VIRTIO_DESC_PER_LOOP / 2];
-		__m128i mbp[RTE_VIRTIO_DESC_PER_LOOP / 2];
-		__m128i pkt_mb[RTE_VIRTIO_DESC_PER_LOOP];
-
-		mbp[0] = _mm_loadu_si128((__m128i *)(sw_ring + 0));
-		desc[0] = _mm_loadu_si128((__m128i *)(rused + 0));
-		_mm_storeu_si128((__m128i *)&rx_pkts[0], mbp[0]);
-
-		mbp[1] = _mm_loadu_si128((__m128i *)(sw_ring + 2));
-		desc[1] = _mm_loadu_si128((__m128i *)(rused + 2));
-		_mm_storeu_si128((__m128i *)&rx_pkts[2], mbp[1]);
-
-		mbp[2] = _mm_loadu_si128((__m128i *)(sw_ring + 4));
-		desc[2] = _mm_loadu_si128((__m128i *)(rused + 4));
-		_mm_storeu_si128((__m128i *)&rx_pkts[4], mbp[2]);
-
-		mbp[3] = _mm_loadu_si128((__m128i *)(sw_ring + 6));
-		desc[3] = _mm_loadu_si128((__m128i *)(rused + 6));
-		_mm_storeu_si128((__m128i *)&rx_pkts[6], mbp[3]);
-
-		pkt_mb[1] = _mm_shuffle_epi8(desc[0], shuf_msk2);
-		pkt_mb[0] = _mm_shuffle_epi8(desc[0], shuf_msk1);
-		pkt_mb[1] = _mm_add_epi16(pkt_mb[1], len_adjust);
-		pkt_mb[0] = _mm_add_epi16(pkt_mb[0], len_adjust);
-		_mm_storeu_si128((void *)&rx_pkts[1]->rx_descriptor_fields1,
-			pkt_mb[1]);
-		_mm_storeu_si128((void *)&rx_pkts[0]->rx_descriptor_fields1,
-			pkt_mb[0]);
-
-		pkt_mb[3] = _mm_shuffle_epi8(desc[1], shuf_msk2);
-		pkt_mb[2] = _mm_shuffle_epi8(desc[1], shuf_msk1);
-		pkt_mb[3] = _mm_add_epi16(pkt_mb[3], len_adjust);
-		pkt_mb[2] = _mm_add_epi16(pkt_mb[2], len_adjust);
-		_mm_storeu_si128((void *)&rx_pkts[3]->rx_descriptor_fields1,
-			pkt_mb[3]);
-		_mm_storeu_si128((void *)&rx_pkts[2]->rx_descriptor_fields1,
-			pkt_mb[2]);
-
-		pkt_mb[5] = _mm_shuffle_epi8(desc[2], shuf_msk2);
-		pkt_mb[4] = _mm_shuffle_epi8(desc[2], shuf_msk1);
-		pkt_mb[5] = _mm_add_epi16(pkt_mb[5], len_adjust);
-		pkt_mb[4] = _mm_add_epi16(pkt_mb[4], len_adjust);
-		_mm_storeu_si128((void *)&rx_pkts[5]->rx_descriptor_fields1,
-			pkt_mb[5]);
-		_mm_storeu_si128((void *)&rx_pkts[4]->rx_descriptor_fields1,
-			pkt_mb[4]);
-
-		pkt_mb[7] = _mm_shuffle_epi8(desc[3], shuf_msk2);
-		pkt_mb[6] = _mm_shuffle_epi8(desc[3], shuf_msk1);
-		pkt_mb[7] = _mm_add_epi16(pkt_mb[7], len_adjust);
-		pkt_mb[6] = _mm_add_epi16(pkt_mb[6], len_adjust);
-		_mm_storeu_si128((void *)&rx_pkts[7]->rx_descriptor_fields1,
-			pkt_mb[7]);
-		_mm_storeu_si128((void *)&rx_pkts[6]->rx_descriptor_fields1,
-			pkt_mb[6]);
+		virtio_rx_desc_fields_vec(rused, sw_ring, rx_pkts,
+			shuf_msk1, shuf_msk2, len_adjust);
 
 		if (unlikely(nb_used <= RTE_VIRTIO_DESC_PER_LOOP)) {
 			if (sw_ring + nb_used <= sw_ring_end)
@@ -224,3 +237,173 @@ virtio_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
 	rxvq->stats.packets += nb_pkts_received;
 	return nb_pkts_received;
 }
+
+/*
+ * Chain the buffers of the packet at the head of the used ring, the way
+ * virtio_recv_mergeable_pkts() does. Returns the number of used elements
+ * the packet takes, or 0 when the device has not returned all of them yet.
+ */
+static inline uint16_t
+virtio_rx_mergeable_chain(struct virtnet_rx *rxvq, struct rte_mbuf **rx_pkt,
+	uint16_t nb_used)
+{
+	struct virtqueue *vq = rxvq->vq;
+	struct vring_used_elem *used = vq->vq_ring.used->ring;
+	uint16_t hdr_size = vq->hw->vtnet_hdr_size;
+	uint16_t mask = vq->vq_nentries - 1;
+	uint16_t idx = vq->vq_used_cons_idx & mask;
+	struct virtio_net_hdr_mrg_rxbuf *header;
+	struct rte_mbuf *head, *prev, *rxm;
+	uint16_t seg_num, i;
+	uint32_t len;
+
+	head = vq->sw_ring[idx];
+	header = (struct virtio_net_hdr_mrg_rxbuf *)((char *)head->buf_addr +
+		RTE_PKTMBUF_HEADROOM - hdr_size);
+	seg_num = header->num_buffers;
+	if (seg_num == 0)
+		seg_num = 1;
+
+	if (unlikely(seg_num > vq->vq_nentries)) {
+		PMD_RX_LOG(ERR, "Bogus num_buffers %u", seg_num);
+		rxvq->stats.errors++;
+		seg_num = 1;
+	}
+	if (seg_num > nb_used)
+		return 0;
+
+	len = used[idx].len - hdr_size;
+	head->ol_flags = 0;
+	head->packet_type = 0;
+	head->vlan_tci = 0;
+	head->nb_segs = seg_num;
+	head->data_len = (uint16_t)len;
+	head->pkt_len = len;
+
+	prev = head;
+	for (i = 1; i < seg_num; i++) {
+		idx = (idx + 1) & mask;
+		rxm = vq->sw_ring[idx];
+		len = used[idx].len;
+
+		rxm->data_off = RTE_PKTMBUF_HEADROOM - hdr_size;
+		rxm->data_len = (uint16_t)len;
+		rxm->pkt_len = len;
+		head->pkt_len += len;
+		prev->next = rxm;
+		prev = rxm;
+	}
+	prev->next = NULL;
+
+	*rx_pkt = head;
+	return seg_num;
+}
+
+/* virtio vPMD receive routine for mergeable Rx buffers.
+ *
+ * Same ring layout as virtio_recv_pkts_vec(). Runs of eight packets that
+ * each fit a single buffer, the common case, are handled with vector
+ * instructions; a packet spread over several buffers is chained in scalar
+ * code, after which the vector loop resumes.
+ */
+uint16_t
+virtio_recv_mergeable_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
+	uint16_t nb_pkts)
+{
+	struct virtnet_rx *rxvq = rx_queue;
+	struct virtqueue *vq = rxvq->vq;
+	struct virtio_hw *hw = vq->hw;
+	uint16_t hdr_size = hw->vtnet_hdr_size;
+	uint16_t mask = vq->vq_nentries - 1;
+	struct virtio_net_hdr_mrg_rxbuf *header;
+	uint16_t nb_used, nb_segs, desc_idx, i;
+	uint16_t nb_rx = 0, nb_consumed = 0;
+	__m128i shuf_msk1, shuf_msk2, len_adjust;
+
+	shuf_msk1 = _mm_set_epi8(
+		0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF,		/* vlan tci */
+		5, 4,			/* dat len */
+		0xFF, 0xFF, 5, 4,	/* pkt len */
+		0xFF, 0xFF, 0xFF, 0xFF	/* packet type */
+	);
+
+	shuf_msk2 = _mm_set_epi8(
+		0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF,		/* vlan tci */
+		13, 12,			/* dat len */
+		0xFF, 0xFF, 13, 12,	/* pkt len */
+		0xFF, 0xFF, 0xFF, 0xFF	/* packet type */
+	);
+
+	len_adjust = _mm_set_epi16(
+		0, 0,
+		0,
+		(uint16_t)-hdr_size,
+		0, (uint16_t)-hdr_size,
+		0, 0);
+
+	if (unlikely(hw->started == 0))
+		return 0;
+
+	nb_used = VIRTQUEUE_NUSED(vq);
+
+	rte_compiler_barrier();
+
+	if (unlikely(nb_used == 0))
+		return 0;
+
+	rte_prefetch0(&vq->vq_ring.used->ring[vq->vq_used_cons_idx & mask]);
+
+	if (vq->vq_free_cnt >= RTE_VIRTIO_VPMD_RX_REARM_THRESH) {
+		virtio_rxq_rearm_vec(rxvq);
+		if (unlikely(virtqueue_kick_prepare(vq)))
+			virtqueue_notify(vq);
+	}
+
+	while (nb_rx < nb_pkts && nb_used > 0) {
+		desc_idx = vq->vq_used_cons_idx & mask;
+
+		if (likely(nb_used >= RTE_VIRTIO_DESC_PER_LOOP &&
+			   nb_pkts - nb_rx >= RTE_VIRTIO_DESC_PER_LOOP &&
+			   desc_idx + RTE_VIRTIO_DESC_PER_LOOP <=
+			   vq->vq_nentries)) {
+			virtio_rx_desc_fields_vec(
+				&vq->vq_ring.used->ring[desc_idx],
+				&vq->sw_ring[desc_idx], &rx_pkts[nb_rx],
+				shuf_msk1, shuf_msk2, len_adjust);
+
+			/* Keep the packets up to the first one that spans
+			 * several buffers.
+			 */
+			for (i = 0; i < RTE_VIRTIO_DESC_PER_LOOP; i++) {
+				header = (struct virtio_net_hdr_mrg_rxbuf *)
+					((char *)rx_pkts[nb_rx + i]->buf_addr +
+					 RTE_PKTMBUF_HEADROOM - hdr_size);
+				if (unlikely(header->num_buffers > 1))
+					break;
+			}
+
+			nb_rx += i;
+			nb_used -= i;
+			nb_consumed += i;
+			vq->vq_used_cons_idx += i;
+			if (likely(i == RTE_VIRTIO_DESC_PER_LOOP))
+				continue;
+		}
+
+		nb_segs = virtio_rx_mergeable_chain(rxvq, &rx_pkts[nb_rx],
+			nb_used);
+		if (nb_segs == 0)
+			break;
+
+		nb_rx++;
+		nb_used -= nb_segs;
+		nb_consumed += nb_segs;
+		vq->vq_used_cons_idx += nb_segs;
+	}
+
+	vq->vq_free_cnt += nb_consumed;
+	rxvq->stats.packets += nb_rx;
+	return nb_rx;
+}
@@ -352,6 +352,10 @@ vhost_kernel_set_backend(int vhostfd, int tapfd)
 	return 0;
 }
 
+/* A queue pair being disabled keeps its tap queue: with a multi-queue tap
+ * it is detached, so that the interface and its configuration survive as
+ * long as the port does, and attached again on enable.
+ */
 static int
 vhost_kernel_enable_queue_pair(struct virtio_user_dev *dev,
 			       uint16_t pair_idx,
@@ -363,14 +367,18 @@ vhost_kernel_enable_queue_pair(struct virtio_user_dev *dev,
 	int req_mq = (dev->max_queue_pairs > 1);
 
 	vhostfd = dev->vhostfds[pair_idx];
+	tapfd = dev->tapfds[pair_idx];
 
 	if (!enable) {
-		if (dev->tapfds[pair_idx] >= 0) {
-			close(dev->tapfds[pair_idx]);
-			dev->tapfds[pair_idx] = -1;
-		}
-		return vhost_kernel_set_backend(vhostfd, -1);
-	} else if (dev->tapfds[pair_idx] >= 0) {
+		if (!dev->qp_enabled[pair_idx])
+			return 0;
+		if (vhost_kernel_set_backend(vhostfd, -1) < 0)
+			return -1;
+		if (req_mq && vhost_kernel_tap_set_queue(tapfd, 0) < 0)
+			return -1;
+		dev->qp_enabled[pair_idx] = 0;
+		return 0;
+	} else if (dev->qp_enabled[pair_idx]) {
 		return 0;
 	}
 
@@ -380,20 +388,33 @@ vhost_kernel_enable_queue_pair(struct virtio_user_dev *dev,
 	else
 		hdr_size = sizeof(struct virtio_net_hdr);
 
-	tapfd = vhost_kernel_open_tap(&dev->ifname, hdr_size, req_mq);
 	if (tapfd < 0) {
-		PMD_DRV_LOG(ERR, "fail to open tap for vhost kernel");
-		return -1;
+		tapfd = vhost_kernel_open_tap(&dev->ifname, hdr_size, req_mq,
+					      dev->features);
+		if (tapfd < 0) {
+			PMD_DRV_LOG(ERR, "fail to open tap for vhost kernel");
+			return -1;
+		}
+		dev->tapfds[pair_idx] = tapfd;
+	} else {
+		/* features may have been renegotiated since last enable */
+		if (req_mq && vhost_kernel_tap_set_queue(tapfd, 1) < 0)
+			return -1;
+		if (vhost_kernel_tap_setup(tapfd, hdr_size, dev->features) < 0)
+			goto detach;
 	}
 
 	if (vhost_kernel_set_backend(vhostfd, tapfd) < 0) {
 		PMD_DRV_LOG(ERR, "fail to set backend for vhost kernel");
-		close(tapfd);
-		return -1;
+		goto detach;
 	}
 
-	dev->tapfds[pair_idx] = tapfd;
+	dev->qp_enabled[pair_idx] = 1;
 	return 0;
+detach:
+	if (req_mq)
+		vhost_kernel_tap_set_queue(tapfd, 0);
+	return -1;
 }
 
 struct virtio_user_backend_ops ops_kernel = {
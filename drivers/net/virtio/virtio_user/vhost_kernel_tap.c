@@ -40,22 +40,95 @@
 #include <string.h>
 #include <limits.h>
 
+#include <rte_byteorder.h>
+
 #include "vhost_kernel_tap.h"
 #include "../virtio_logs.h"
+#include "../virtio_pci.h"
+
+/* Translate the offloads the driver negotiated into TUN_F_* flags: they
+ * tell tap which kinds of partial packets it may hand us on the read side.
+ */
+static unsigned int
+vhost_kernel_tap_offloads(uint64_t features)
+{
+	unsigned int offload = 0;
+
+	if (!(features & (1ULL << VIRTIO_NET_F_GUEST_CSUM)))
+		return 0;
+
+	offload |= TUN_F_CSUM;
+	if (features & (1ULL << VIRTIO_NET_F_GUEST_TSO4))
+		offload |= TUN_F_TSO4;
+	if (features & (1ULL << VIRTIO_NET_F_GUEST_TSO6))
+		offload |= TUN_F_TSO6;
+	if ((offload & (TUN_F_TSO4 | TUN_F_TSO6)) &&
+	    (features & (1ULL << VIRTIO_NET_F_GUEST_ECN)))
+		offload |= TUN_F_TSO_ECN;
+	if (features & (1ULL << VIRTIO_NET_F_GUEST_UFO))
+		offload |= TUN_F_UFO;
+
+	return offload;
+}
+
+int
+vhost_kernel_tap_setup(int tapfd, int hdr_size, uint64_t features)
+{
+	unsigned int offload = vhost_kernel_tap_offloads(features);
+
+	if (ioctl(tapfd, TUNSETVNETHDRSZ, &hdr_size) < 0) {
+		PMD_DRV_LOG(ERR, "TUNSETVNETHDRSZ failed: %s", strerror(errno));
+		return -1;
+	}
+
+#if RTE_BYTE_ORDER == RTE_BIG_ENDIAN
+	/* Virtio 1.0 headers are little endian, legacy ones native */
+	if (features & (1ULL << VIRTIO_F_VERSION_1)) {
+		int le = 1;
+
+		if (ioctl(tapfd, TUNSETVNETLE, &le) < 0) {
+			PMD_DRV_LOG(ERR, "TUNSETVNETLE failed: %s",
+				    strerror(errno));
+			return -1;
+		}
+	}
+#endif
+
+	/* Kernels since 4.14 refuse UFO, retry without it */
+	if (ioctl(tapfd, TUNSETOFFLOAD, offload) != 0 &&
+	    (!(offload & TUN_F_UFO) ||
+	     ioctl(tapfd, TUNSETOFFLOAD, offload & ~TUN_F_UFO) != 0)) {
+		PMD_DRV_LOG(ERR, "TUNSETOFFLOAD ioctl() failed: %s",
+			   strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
 
 int
-vhost_kernel_open_tap(char **p_ifname, int hdr_size, int req_mq)
+vhost_kernel_tap_set_queue(int tapfd, int attach)
+{
+	struct ifreq ifr;
+
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = attach ? IFF_ATTACH_QUEUE : IFF_DETACH_QUEUE;
+	if (ioctl(tapfd, TUNSETQUEUE, (void *)&ifr) == -1) {
+		PMD_DRV_LOG(ERR, "TUNSETQUEUE failed: %s", strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+vhost_kernel_open_tap(char **p_ifname, int hdr_size, int req_mq,
+		      uint64_t features)
 {
 	unsigned int tap_features;
 	int sndbuf = INT_MAX;
 	struct ifreq ifr;
 	int tapfd;
-	unsigned int offload =
-			TUN_F_CSUM |
-			TUN_F_TSO4 |
-			TUN_F_TSO6 |
-			TUN_F_TSO_ECN |
-			TUN_F_UFO;
 
 	/* TODO:
 	 * 1. verify we can get/set vnet_hdr_len, tap_probe_vnet_hdr_len
@@ -91,8 +164,13 @@ vhost_kernel_open_tap(char **p_ifname, int hdr_size, int req_mq)
 		goto error;
 	}
 
-	if (req_mq)
+	if (req_mq) {
+		if (!(tap_features & IFF_MULTI_QUEUE)) {
+			PMD_DRV_LOG(ERR, "TAP does not support IFF_MULTI_QUEUE");
+			goto error;
+		}
 		ifr.ifr_flags |= IFF_MULTI_QUEUE;
+	}
 
 	if (*p_ifname)
 		strncpy(ifr.ifr_name, *p_ifname, IFNAMSIZ);
@@ -105,23 +183,13 @@ vhost_kernel_open_tap(char **p_ifname, int hdr_size, int req_mq)
 
 	fcntl(tapfd, F_SETFL, O_NONBLOCK);
 
-	if (ioctl(tapfd, TUNSETVNETHDRSZ, &hdr_size) < 0) {
-		PMD_DRV_LOG(ERR, "TUNSETVNETHDRSZ failed: %s", strerror(errno));
-		goto error;
-	}
-
 	if (ioctl(tapfd, TUNSETSNDBUF, &sndbuf) < 0) {
 		PMD_DRV_LOG(ERR, "TUNSETSNDBUF failed: %s", strerror(errno));
 		goto error;
 	}
 
-	/* TODO: before set the offload capabilities, we'd better (1) check
-	 * negotiated features to see if necessary to offload; (2) query tap
-	 * to see if it supports the offload capabilities.
-	 */
-	if (ioctl(tapfd, TUNSETOFFLOAD, offload) != 0)
-		PMD_DRV_LOG(ERR, "TUNSETOFFLOAD ioctl() failed: %s",
-			   strerror(errno));
+	if (vhost_kernel_tap_setup(tapfd, hdr_size, features) < 0)
+		goto error;
 
 	if (!(*p_ifname))
 		*p_ifname = strdup(ifr.ifr_name);
@@ -31,6 +31,7 @@
  *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdint.h>
 #include <sys/ioctl.h>
 
 /* TUN ioctls */
@@ -64,4 +65,7 @@
 /* Constants */
 #define PATH_NET_TUN	"/dev/net/tun"
 
-int vhost_kernel_open_tap(char **p_ifname, int hdr_size, int req_mq);
+int vhost_kernel_open_tap(char **p_ifname, int hdr_size, int req_mq,
+			  uint64_t features);
+int vhost_kernel_tap_setup(int tapfd, int hdr_size, uint64_t features);
+int vhost_kernel_tap_set_queue(int tapfd, int attach);
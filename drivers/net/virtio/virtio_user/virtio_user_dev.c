@@ -68,21 +68,31 @@ virtio_user_kick_queue(struct virtio_user_dev *dev, uint32_t queue_sel)
 	struct vhost_vring_file file;
 	struct vhost_vring_state state;
 	struct vring *vring = &dev->vrings[queue_sel];
+	struct vring_packed *pvring = &dev->packed_vrings[queue_sel];
+	int packed = !!(dev->features & (1ULL << VIRTIO_F_RING_PACKED));
 	struct vhost_vring_addr addr = {
 		.index = queue_sel,
-		.desc_user_addr = (uint64_t)(uintptr_t)vring->desc,
-		.avail_user_addr = (uint64_t)(uintptr_t)vring->avail,
-		.used_user_addr = (uint64_t)(uintptr_t)vring->used,
 		.log_guest_addr = 0,
 		.flags = 0, /* disable log */
 	};
 
+	if (packed) {
+		addr.desc_user_addr = (uint64_t)(uintptr_t)pvring->desc_packed;
+		addr.avail_user_addr = (uint64_t)(uintptr_t)pvring->driver_event;
+		addr.used_user_addr = (uint64_t)(uintptr_t)pvring->device_event;
+	} else {
+		addr.desc_user_addr = (uint64_t)(uintptr_t)vring->desc;
+		addr.avail_user_addr = (uint64_t)(uintptr_t)vring->avail;
+		addr.used_user_addr = (uint64_t)(uintptr_t)vring->used;
+	}
+
 	state.index = queue_sel;
 	state.num = vring->num;
 	dev->ops->send_request(dev, VHOST_USER_SET_VRING_NUM, &state);
 
 	state.index = queue_sel;
-	state.num = 0; /* no reservation */
+	/* no reservation; a packed ring also starts with wrap counter set */
+	state.num = packed ? (1 << 15) : 0;
 	dev->ops->send_request(dev, VHOST_USER_SET_VRING_BASE, &state);
 
 	dev->ops->send_request(dev, VHOST_USER_SET_VRING_ADDR, &addr);
@@ -300,6 +310,7 @@ virtio_user_dev_setup(struct virtio_user_dev *dev)
 		for (q = 0; q < dev->max_queue_pairs; ++q) {
 			dev->vhostfds[q] = -1;
 			dev->tapfds[q] = -1;
+			dev->qp_enabled[q] = 0;
 		}
 	}
 
@@ -332,16 +343,19 @@ virtio_user_dev_setup(struct virtio_user_dev *dev)
 	 1ULL << VIRTIO_NET_F_GUEST_CSUM	|	\
 	 1ULL << VIRTIO_NET_F_GUEST_TSO4	|	\
 	 1ULL << VIRTIO_NET_F_GUEST_TSO6	|	\
+	 1ULL << VIRTIO_F_RING_PACKED		|	\
 	 1ULL << VIRTIO_F_VERSION_1)
 
 int
 virtio_user_dev_init(struct virtio_user_dev *dev, char *path, int queues,
-		     int cq, int queue_size, const char *mac, char **ifname)
+		     int cq, int queue_size, const char *mac, char **ifname,
+		     int packed_vq)
 {
 	snprintf(dev->path, PATH_MAX, "%s", path);
 	dev->max_queue_pairs = queues;
 	dev->queue_pairs = 1; /* mq disabled by default */
 	dev->queue_size = queue_size;
+	dev->packed_vq = !!packed_vq;
 	dev->mac_specified = 0;
 	parse_mac(dev, mac);
 
@@ -386,6 +400,10 @@ virtio_user_dev_init(struct virtio_user_dev *dev, char *path, int queues,
 	if (is_vhost_user_by_type(dev->path))
 		dev->device_features |= (1ull << VIRTIO_NET_F_STATUS);
 
+	/* Packed ring is only offered on request */
+	if (!dev->packed_vq)
+		dev->device_features &= ~(1ull << VIRTIO_F_RING_PACKED);
+
 	dev->device_features &= VIRTIO_USER_SUPPORTED_FEATURES;
 
 	return 0;
@@ -406,8 +424,11 @@ virtio_user_dev_uninit(struct virtio_user_dev *dev)
 	close(dev->vhostfd);
 
 	if (dev->vhostfds) {
-		for (i = 0; i < dev->max_queue_pairs; ++i)
+		for (i = 0; i < dev->max_queue_pairs; ++i) {
 			close(dev->vhostfds[i]);
+			if (dev->tapfds[i] >= 0)
+				close(dev->tapfds[i]);
+		}
 		free(dev->vhostfds);
 		free(dev->tapfds);
 	}
@@ -498,3 +519,89 @@ virtio_user_handle_cq(struct virtio_user_dev *dev, uint16_t queue_idx)
 		vring->used->idx++;
 	}
 }
+
+static uint32_t
+virtio_user_handle_ctrl_msg_packed(struct virtio_user_dev *dev,
+				   struct vring_packed *vring,
+				   uint16_t idx_hdr)
+{
+	struct virtio_net_ctrl_hdr *hdr;
+	virtio_net_ctrl_ack status = ~0;
+	uint16_t i, idx_data, idx_status;
+	uint32_t n_descs = 0;
+
+	/* locate desc for header, data, and status */
+	idx_data = idx_hdr + 1;
+	if (idx_data >= vring->num)
+		idx_data -= vring->num;
+	n_descs++;
+
+	i = idx_data;
+	while (vring->desc_packed[i].flags & VRING_DESC_F_NEXT) {
+		if (++i >= vring->num)
+			i -= vring->num;
+		n_descs++;
+	}
+
+	/* locate desc for status */
+	idx_status = i;
+	n_descs++;
+
+	hdr = (void *)(uintptr_t)vring->desc_packed[idx_hdr].addr;
+	if (hdr->class == VIRTIO_NET_CTRL_MQ &&
+	    hdr->cmd == VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET) {
+		uint16_t queues;
+
+		queues = *(uint16_t *)(uintptr_t)
+				vring->desc_packed[idx_data].addr;
+		status = virtio_user_handle_mq(dev, queues);
+	}
+
+	/* Update status */
+	*(virtio_net_ctrl_ack *)(uintptr_t)
+		vring->desc_packed[idx_status].addr = status;
+
+	return n_descs;
+}
+
+static inline int
+desc_is_avail(struct vring_packed_desc *desc, uint8_t wrap_counter)
+{
+	uint16_t flags = *(volatile uint16_t *)&desc->flags;
+
+	return !!(flags & VRING_DESC_F_AVAIL(1)) == wrap_counter &&
+		!!(flags & VRING_DESC_F_USED(1)) != wrap_counter;
+}
+
+void
+virtio_user_handle_cq_packed(struct virtio_user_dev *dev, uint16_t queue_idx)
+{
+	struct virtio_user_queue *vq = &dev->packed_queues[queue_idx];
+	struct vring_packed *vring = &dev->packed_vrings[queue_idx];
+	struct vring_packed_desc *desc;
+	uint32_t n_descs;
+	uint16_t flags;
+
+	/* Descriptors are consumed in order, the head keeps the buffer id */
+	while (desc_is_avail(&vring->desc_packed[vq->used_idx],
+			     vq->used_wrap_counter)) {
+		desc = &vring->desc_packed[vq->used_idx];
+
+		n_descs = virtio_user_handle_ctrl_msg_packed(dev, vring,
+							     vq->used_idx);
+
+		flags = VRING_DESC_F_WRITE;
+		if (vq->used_wrap_counter)
+			flags |= VRING_DESC_F_AVAIL(1) | VRING_DESC_F_USED(1);
+
+		desc->len = n_descs;
+		rte_smp_wmb();
+		desc->flags = flags;
+
+		vq->used_idx += n_descs;
+		if (vq->used_idx >= vring->num) {
+			vq->used_idx -= vring->num;
+			vq->used_wrap_counter ^= 1;
+		}
+	}
+}
@@ -39,6 +39,12 @@
 #include "../virtio_ring.h"
 #include "vhost.h"
 
+/* device side state of a packed ring handled in the frontend (ctrl queue) */
+struct virtio_user_queue {
+	uint16_t	used_idx;
+	uint8_t		used_wrap_counter;
+};
+
 struct virtio_user_dev {
 	/* for vhost_user backend */
 	int		vhostfd;
@@ -47,6 +53,7 @@ struct virtio_user_dev {
 	char		*ifname;
 	int		*vhostfds;
 	int		*tapfds;
+	uint8_t		qp_enabled[VIRTIO_MAX_VIRTQUEUE_PAIRS];
 
 	/* for both vhost_user and vhost_kernel */
 	int		callfds[VIRTIO_MAX_VIRTQUEUES];
@@ -62,8 +69,14 @@ struct virtio_user_dev {
 	uint8_t		status;
 	uint8_t		port_id;
 	uint8_t		mac_addr[ETHER_ADDR_LEN];
+	uint8_t		packed_vq; /* offer VIRTIO_F_RING_PACKED */
 	char		path[PATH_MAX];
-	struct vring	vrings[VIRTIO_MAX_VIRTQUEUES];
+	RTE_STD_C11
+	union {
+		struct vring		vrings[VIRTIO_MAX_VIRTQUEUES];
+		struct vring_packed	packed_vrings[VIRTIO_MAX_VIRTQUEUES];
+	};
+	struct virtio_user_queue packed_queues[VIRTIO_MAX_VIRTQUEUES];
 	struct virtio_user_backend_ops *ops;
 };
 
@@ -71,7 +84,10 @@ int is_vhost_user_by_type(const char *path);
 int virtio_user_start_device(struct virtio_user_dev *dev);
 int virtio_user_stop_device(struct virtio_user_dev *dev);
 int virtio_user_dev_init(struct virtio_user_dev *dev, char *path, int queues,
-			 int cq, int queue_size, const char *mac, char **ifname);
+			 int cq, int queue_size, const char *mac, char **ifname,
+			 int packed_vq);
 void virtio_user_dev_uninit(struct virtio_user_dev *dev);
 void virtio_user_handle_cq(struct virtio_user_dev *dev, uint16_t queue_idx);
+void virtio_user_handle_cq_packed(struct virtio_user_dev *dev,
+				  uint16_t queue_idx);
 #endif
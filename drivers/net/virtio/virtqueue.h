@@ -180,11 +180,23 @@ struct virtio_pmd_ctrl {
 struct vq_desc_extra {
 	void *cookie;
 	uint16_t ndescs;
+	uint16_t next; /**< next free buffer id, packed ring only */
 };
 
 struct virtqueue {
 	struct virtio_hw  *hw; /**< virtio_hw structure pointer. */
-	struct vring vq_ring;  /**< vring keeping desc, used and avail */
+	RTE_STD_C11
+	union {
+		struct vring vq_ring;  /**< vring keeping desc, used and avail */
+		struct vring_packed vq_packed; /**< packed desc ring */
+	};
+	/**
+	 * Packed ring only: AVAIL/USED flags matching the driver wrap
+	 * counter, and the wrap counter expected on used descriptors.
+	 */
+	uint16_t vq_avail_flags;
+	uint8_t vq_avail_wrap_counter;
+	uint8_t vq_used_wrap_counter;
 	/**
 	 * Last consumed descriptor in the used table,
 	 * trails vq_ring.used->idx.
@@ -277,13 +289,28 @@ vring_desc_init(struct vring_desc *dp, uint16_t n)
 	dp[i].next = VQ_RING_DESC_CHAIN_END;
 }
 
+/* Chain all the buffer ids of a packed ring into the free list */
+static inline void
+vring_packed_desc_init(struct virtqueue *vq)
+{
+	uint16_t i;
+
+	for (i = 0; i < vq->vq_nentries - 1; i++)
+		vq->vq_descx[i].next = (uint16_t)(i + 1);
+	vq->vq_descx[i].next = VQ_RING_DESC_CHAIN_END;
+}
+
 /**
  * Tell the backend not to interrupt us.
  */
 static inline void
 virtqueue_disable_intr(struct virtqueue *vq)
 {
-	vq->vq_ring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+	if (vtpci_packed_queue(vq->hw))
+		vq->vq_packed.driver_event->desc_event_flags =
+			RING_EVENT_FLAGS_DISABLE;
+	else
+		vq->vq_ring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
 }
 
 /**
@@ -292,7 +319,11 @@ virtqueue_disable_intr(struct virtqueue *vq)
 static inline void
 virtqueue_enable_intr(struct virtqueue *vq)
 {
-	vq->vq_ring.avail->flags &= (~VRING_AVAIL_F_NO_INTERRUPT);
+	if (vtpci_packed_queue(vq->hw))
+		vq->vq_packed.driver_event->desc_event_flags =
+			RING_EVENT_FLAGS_ENABLE;
+	else
+		vq->vq_ring.avail->flags &= (~VRING_AVAIL_F_NO_INTERRUPT);
 }
 
 /**
@@ -312,6 +343,66 @@ virtqueue_full(const struct virtqueue *vq)
 
 #define VIRTQUEUE_NUSED(vq) ((uint16_t)((vq)->vq_ring.used->idx - (vq)->vq_used_cons_idx))
 
+/*
+ * Packed ring: the device hands a descriptor back by setting both its
+ * AVAIL and USED bits to the device wrap counter.
+ */
+static inline int
+desc_is_used(struct vring_packed_desc *desc, struct virtqueue *vq)
+{
+	uint16_t flags = *(volatile uint16_t *)&desc->flags;
+	uint16_t used = !!(flags & VRING_DESC_F_USED(1));
+	uint16_t avail = !!(flags & VRING_DESC_F_AVAIL(1));
+
+	return avail == used && used == vq->vq_used_wrap_counter;
+}
+
+/* Move the packed ring avail index, flipping the wrap counter if needed */
+static inline void
+vq_packed_avail_advance(struct virtqueue *vq, uint16_t n)
+{
+	vq->vq_avail_idx += n;
+	if (vq->vq_avail_idx >= vq->vq_nentries) {
+		vq->vq_avail_idx -= vq->vq_nentries;
+		vq->vq_avail_wrap_counter ^= 1;
+		vq->vq_avail_flags ^= VRING_DESC_F_AVAIL(1) |
+			VRING_DESC_F_USED(1);
+	}
+}
+
+/* Move the packed ring used index, flipping the wrap counter if needed */
+static inline void
+vq_packed_used_advance(struct virtqueue *vq, uint16_t n)
+{
+	vq->vq_used_cons_idx += n;
+	if (vq->vq_used_cons_idx >= vq->vq_nentries) {
+		vq->vq_used_cons_idx -= vq->vq_nentries;
+		vq->vq_used_wrap_counter ^= 1;
+	}
+}
+
+/* Take a buffer id from the packed ring free list */
+static inline uint16_t
+vq_packed_get_id(struct virtqueue *vq)
+{
+	uint16_t id = vq->vq_desc_head_idx;
+
+	vq->vq_desc_head_idx = vq->vq_descx[id].next;
+	return id;
+}
+
+/* Give a buffer id, and the descriptors it held, back to the free list */
+static inline void
+vq_packed_put_id(struct virtqueue *vq, uint16_t id)
+{
+	struct vq_desc_extra *dxp = &vq->vq_descx[id];
+
+	vq->vq_free_cnt = (uint16_t)(vq->vq_free_cnt + dxp->ndescs);
+	dxp->ndescs = 0;
+	dxp->next = vq->vq_desc_head_idx;
+	vq->vq_desc_head_idx = id;
+}
+
 static inline void
 vq_update_avail_idx(struct virtqueue *vq)
 {
@@ -342,6 +433,15 @@ virtqueue_kick_prepare(struct virtqueue *vq)
 	return !(vq->vq_ring.used->flags & VRING_USED_F_NO_NOTIFY);
 }
 
+static inline int
+virtqueue_kick_prepare_packed(struct virtqueue *vq)
+{
+	/* make the avail descs visible before we read the device flags */
+	virtio_mb();
+	return vq->vq_packed.device_event->desc_event_flags !=
+		RING_EVENT_FLAGS_DISABLE;
+}
+
 static inline void
 virtqueue_notify(struct virtqueue *vq)
 {
@@ -356,6 +456,15 @@ virtqueue_notify(struct virtqueue *vq)
 #ifdef RTE_LIBRTE_VIRTIO_DEBUG_DUMP
 #define VIRTQUEUE_DUMP(vq) do { \
 	uint16_t used_idx, nused; \
+	if (vtpci_packed_queue((vq)->hw)) { \
+		PMD_INIT_LOG(DEBUG, \
+		  "VQ: - size=%d; free=%d; avail_idx=%d; avail_wrap=%d;" \
+		  " used_cons_idx=%d; used_wrap=%d", \
+		  (vq)->vq_nentries, (vq)->vq_free_cnt, \
+		  (vq)->vq_avail_idx, (vq)->vq_avail_wrap_counter, \
+		  (vq)->vq_used_cons_idx, (vq)->vq_used_wrap_counter); \
+		break; \
+	} \
 	used_idx = (vq)->vq_ring.used->idx; \
 	nused = (uint16_t)(used_idx - (vq)->vq_used_cons_idx); \
 	PMD_INIT_LOG(DEBUG, \
@@ -115,6 +115,7 @@ struct kni_port_params {
 	unsigned lcore_tx; /* lcore ID for TX */
 	uint32_t nb_lcore_k; /* Number of lcores for KNI multi kernel threads */
 	uint32_t nb_kni; /* Number of KNI devices to be created */
+	uint16_t nb_kni_queues; /* Number of queues of each KNI device */
 	unsigned lcore_k[KNI_MAX_KTHREAD]; /* lcore ID list for kthreads */
 	struct rte_kni *kni[KNI_MAX_KTHREAD]; /* KNI context pointers */
 } __rte_cache_aligned;
@@ -144,6 +145,9 @@ static uint32_t ports_mask = 0;
 /* Ports set in promiscuous mode off by default. */
 static int promiscuous_on = 0;
 
+/* One multi-queue KNI device per port, instead of one device per kthread */
+static int multi_queue_on = 0;
+
 /* Structure type for recording kni interface specific stats */
 struct kni_interface_stats {
 	/* number of pkts received from NIC, and sent to KNI */
@@ -239,6 +243,7 @@ static void
 kni_ingress(struct kni_port_params *p)
 {
 	uint8_t i, port_id;
+	uint16_t q;
 	unsigned nb_rx, num;
 	uint32_t nb_kni;
 	struct rte_mbuf *pkts_burst[PKT_BURST_SZ];
@@ -249,22 +254,27 @@ kni_ingress(struct kni_port_params *p)
 	nb_kni = p->nb_kni;
 	port_id = p->port_id;
 	for (i = 0; i < nb_kni; i++) {
-		/* Burst rx from eth */
-		nb_rx = rte_eth_rx_burst(port_id, 0, pkts_burst, PKT_BURST_SZ);
-		if (unlikely(nb_rx > PKT_BURST_SZ)) {
-			RTE_LOG(ERR, APP, "Error receiving from eth\n");
-			return;
+		for (q = 0; q < p->nb_kni_queues; q++) {
+			/* Burst rx from eth */
+			nb_rx = rte_eth_rx_burst(port_id, q, pkts_burst,
+						 PKT_BURST_SZ);
+			if (unlikely(nb_rx > PKT_BURST_SZ)) {
+				RTE_LOG(ERR, APP, "Error receiving from eth\n");
+				return;
+			}
+			/* Burst tx to kni */
+			num = rte_kni_tx_burst_queue(p->kni[i], q, pkts_burst,
+						     nb_rx);
+			kni_stats[port_id].rx_packets += num;
+
+			if (unlikely(num < nb_rx)) {
+				/* Free mbufs not tx to kni interface */
+				kni_burst_free_mbufs(&pkts_burst[num],
+						     nb_rx - num);
+				kni_stats[port_id].rx_dropped += nb_rx - num;
+			}
 		}
-		/* Burst tx to kni */
-		num = rte_kni_tx_burst(p->kni[i], pkts_burst, nb_rx);
-		kni_stats[port_id].rx_packets += num;
-
 		rte_kni_handle_request(p->kni[i]);
-		if (unlikely(num < nb_rx)) {
-			/* Free mbufs not tx to kni interface */
-			kni_burst_free_mbufs(&pkts_burst[num], nb_rx - num);
-			kni_stats[port_id].rx_dropped += nb_rx - num;
-		}
 	}
 }
 
@@ -275,6 +285,7 @@ static void
 kni_egress(struct kni_port_params *p)
 {
 	uint8_t i, port_id;
+	uint16_t q;
 	unsigned nb_tx, num;
 	uint32_t nb_kni;
 	struct rte_mbuf *pkts_burst[PKT_BURST_SZ];
@@ -285,19 +296,24 @@ kni_egress(struct kni_port_params *p)
 	nb_kni = p->nb_kni;
 	port_id = p->port_id;
 	for (i = 0; i < nb_kni; i++) {
-		/* Burst rx from kni */
-		num = rte_kni_rx_burst(p->kni[i], pkts_burst, PKT_BURST_SZ);
-		if (unlikely(num > PKT_BURST_SZ)) {
-			RTE_LOG(ERR, APP, "Error receiving from KNI\n");
-			return;
-		}
-		/* Burst tx to eth */
-		nb_tx = rte_eth_tx_burst(port_id, 0, pkts_burst, (uint16_t)num);
-		kni_stats[port_id].tx_packets += nb_tx;
-		if (unlikely(nb_tx < num)) {
-			/* Free mbufs not tx to NIC */
-			kni_burst_free_mbufs(&pkts_burst[nb_tx], num - nb_tx);
-			kni_stats[port_id].tx_dropped += num - nb_tx;
+		for (q = 0; q < p->nb_kni_queues; q++) {
+			/* Burst rx from kni */
+			num = rte_kni_rx_burst_queue(p->kni[i], q, pkts_burst,
+						     PKT_BURST_SZ);
+			if (unlikely(num > PKT_BURST_SZ)) {
+				RTE_LOG(ERR, APP, "Error receiving from KNI\n");
+				return;
+			}
+			/* Burst tx to eth */
+			nb_tx = rte_eth_tx_burst(port_id, 0, pkts_burst,
+						 (uint16_t)num);
+			kni_stats[port_id].tx_packets += nb_tx;
+			if (unlikely(nb_tx < num)) {
+				/* Free mbufs not tx to NIC */
+				kni_burst_free_mbufs(&pkts_burst[nb_tx],
+						     num - nb_tx);
+				kni_stats[port_id].tx_dropped += num - nb_tx;
+			}
 		}
 	}
 }
@@ -359,11 +375,13 @@ main_loop(__rte_unused void *arg)
 static void
 print_usage(const char *prgname)
 {
-	RTE_LOG(INFO, APP, "\nUsage: %s [EAL options] -- -p PORTMASK -P "
+	RTE_LOG(INFO, APP, "\nUsage: %s [EAL options] -- -p PORTMASK -P -m "
 		   "[--config (port,lcore_rx,lcore_tx,lcore_kthread...)"
 		   "[,(port,lcore_rx,lcore_tx,lcore_kthread...)]]\n"
 		   "    -p PORTMASK: hex bitmask of ports to use\n"
 		   "    -P : enable promiscuous mode\n"
+		   "    -m : create one KNI device per port with a queue "
+		   "per lcore_kthread\n"
 		   "    --config (port,lcore_rx,lcore_tx,lcore_kthread...): "
 		   "port and lcore configurations\n",
 	           prgname);
@@ -522,6 +540,22 @@ validate_parameters(uint32_t portmask)
 					kni_port_params_array[i]->lcore_tx,
 					kni_port_params_array[i]->port_id);
 
+		if (!kni_port_params_array[i])
+			continue;
+
+		/* A queue per lcore_kthread in multi-queue mode */
+		kni_port_params_array[i]->nb_kni_queues = 1;
+		if (multi_queue_on && kni_port_params_array[i]->nb_lcore_k) {
+			if (kni_port_params_array[i]->nb_lcore_k >
+							RTE_KNI_MAX_QUEUES)
+				rte_exit(EXIT_FAILURE, "more than %u "
+					"lcore_kthread for port %d in "
+					"multi-queue mode\n",
+					RTE_KNI_MAX_QUEUES,
+					kni_port_params_array[i]->port_id);
+			kni_port_params_array[i]->nb_kni_queues =
+				kni_port_params_array[i]->nb_lcore_k;
+		}
 	}
 
 	return 0;
@@ -544,7 +578,7 @@ parse_args(int argc, char **argv)
 	opterr = 0;
 
 	/* Parse command line */
-	while ((opt = getopt_long(argc, argv, "p:P", longopts,
+	while ((opt = getopt_long(argc, argv, "p:Pm", longopts,
 						&longindex)) != EOF) {
 		switch (opt) {
 		case 'p':
@@ -553,6 +587,9 @@ parse_args(int argc, char **argv)
 		case 'P':
 			promiscuous_on = 1;
 			break;
+		case 'm':
+			multi_queue_on = 1;
+			break;
 		case 0:
 			if (!strncmp(longopts[longindex].name,
 				     CMDLINE_OPT_CONFIG,
@@ -590,8 +627,8 @@ init_kni(void)
 	/* Calculate the maximum number of KNI interfaces that will be used */
 	for (i = 0; i < RTE_MAX_ETHPORTS; i++) {
 		if (kni_port_params_array[i]) {
-			num_of_kni_ports += (params[i]->nb_lcore_k ?
-				params[i]->nb_lcore_k : 1);
+			num_of_kni_ports += (params[i]->nb_lcore_k &&
+				!multi_queue_on ? params[i]->nb_lcore_k : 1);
 		}
 	}
 
@@ -599,18 +636,37 @@ init_kni(void)
 	rte_kni_init(num_of_kni_ports);
 }
 
+/* Get the configuration of a port, with a RX queue per KNI queue */
+static uint16_t
+get_port_conf(uint8_t port, struct rte_eth_conf *conf)
+{
+	uint16_t nb_rxq = kni_port_params_array[port]->nb_kni_queues;
+
+	memcpy(conf, &port_conf, sizeof(*conf));
+	if (nb_rxq > 1) {
+		/* Keep the packets of a flow on the same KNI queue */
+		conf->rxmode.mq_mode = ETH_MQ_RX_RSS;
+		conf->rx_adv_conf.rss_conf.rss_hf = ETH_RSS_IP;
+	}
+
+	return nb_rxq;
+}
+
 /* Initialise a single port on an Ethernet device */
 static void
 init_port(uint8_t port)
 {
 	int ret;
+	uint16_t q, nb_rxq;
 	uint16_t nb_rxd = NB_RXD;
 	uint16_t nb_txd = NB_TXD;
+	struct rte_eth_conf conf;
 
 	/* Initialise device and RX/TX queues */
 	RTE_LOG(INFO, APP, "Initialising port %u ...\n", (unsigned)port);
 	fflush(stdout);
-	ret = rte_eth_dev_configure(port, 1, 1, &port_conf);
+	nb_rxq = get_port_conf(port, &conf);
+	ret = rte_eth_dev_configure(port, nb_rxq, 1, &conf);
 	if (ret < 0)
 		rte_exit(EXIT_FAILURE, "Could not configure port%u (%d)\n",
 		            (unsigned)port, ret);
@@ -620,11 +676,13 @@ init_port(uint8_t port)
 		rte_exit(EXIT_FAILURE, "Could not adjust number of descriptors "
 				"for port%u (%d)\n", (unsigned)port, ret);
 
-	ret = rte_eth_rx_queue_setup(port, 0, nb_rxd,
-		rte_eth_dev_socket_id(port), NULL, pktmbuf_pool);
-	if (ret < 0)
-		rte_exit(EXIT_FAILURE, "Could not setup up RX queue for "
-				"port%u (%d)\n", (unsigned)port, ret);
+	for (q = 0; q < nb_rxq; q++) {
+		ret = rte_eth_rx_queue_setup(port, q, nb_rxd,
+			rte_eth_dev_socket_id(port), NULL, pktmbuf_pool);
+		if (ret < 0)
+			rte_exit(EXIT_FAILURE, "Could not setup up RX queue "
+				"for port%u (%d)\n", (unsigned)port, ret);
+	}
 
 	ret = rte_eth_tx_queue_setup(port, 0, nb_txd,
 		rte_eth_dev_socket_id(port), NULL);
@@ -701,6 +759,7 @@ static int
 kni_change_mtu(uint8_t port_id, unsigned new_mtu)
 {
 	int ret;
+	uint16_t nb_rxq;
 	struct rte_eth_conf conf;
 
 	if (port_id >= rte_eth_dev_count()) {
@@ -713,7 +772,7 @@ kni_change_mtu(uint8_t port_id, unsigned new_mtu)
 	/* Stop specific port */
 	rte_eth_dev_stop(port_id);
 
-	memcpy(&conf, &port_conf, sizeof(conf));
+	nb_rxq = get_port_conf(port_id, &conf);
 	/* Set new MTU */
 	if (new_mtu > ETHER_MAX_LEN)
 		conf.rxmode.jumbo_frame = 1;
@@ -723,7 +782,7 @@ kni_change_mtu(uint8_t port_id, unsigned new_mtu)
 	/* mtu + length of header + length of FCS = max pkt length */
 	conf.rxmode.max_rx_pkt_len = new_mtu + KNI_ENET_HEADER_SIZE +
 							KNI_ENET_FCS_SIZE;
-	ret = rte_eth_dev_configure(port_id, 1, 1, &conf);
+	ret = rte_eth_dev_configure(port_id, nb_rxq, 1, &conf);
 	if (ret < 0) {
 		RTE_LOG(ERR, APP, "Fail to reconfigure port %d\n", port_id);
 		return ret;
@@ -769,6 +828,7 @@ static int
 kni_alloc(uint8_t port_id)
 {
 	uint8_t i;
+	uint16_t q;
 	struct rte_kni *kni;
 	struct rte_kni_conf conf;
 	struct kni_port_params **params = kni_port_params_array;
@@ -776,13 +836,26 @@ kni_alloc(uint8_t port_id)
 	if (port_id >= RTE_MAX_ETHPORTS || !params[port_id])
 		return -1;
 
-	params[port_id]->nb_kni = params[port_id]->nb_lcore_k ?
-				params[port_id]->nb_lcore_k : 1;
+	if (params[port_id]->nb_kni_queues > 1)
+		params[port_id]->nb_kni = 1;
+	else
+		params[port_id]->nb_kni = params[port_id]->nb_lcore_k ?
+					params[port_id]->nb_lcore_k : 1;
 
 	for (i = 0; i < params[port_id]->nb_kni; i++) {
 		/* Clear conf at first */
 		memset(&conf, 0, sizeof(conf));
-		if (params[port_id]->nb_lcore_k) {
+		if (params[port_id]->nb_kni_queues > 1) {
+			/* One queue and kernel thread per lcore_kthread */
+			snprintf(conf.name, RTE_KNI_NAMESIZE,
+					"vEth%u", port_id);
+			conf.nb_queues = params[port_id]->nb_kni_queues;
+			for (q = 0; q < conf.nb_queues; q++)
+				conf.queue_core_id[q] =
+					params[port_id]->lcore_k[q];
+			conf.core_id = params[port_id]->lcore_k[0];
+			conf.force_bind = 1;
+		} else if (params[port_id]->nb_lcore_k) {
 			snprintf(conf.name, RTE_KNI_NAMESIZE,
 					"vEth%u_%u", port_id, i);
 			conf.core_id = params[port_id]->lcore_k[i];
@@ -170,17 +170,13 @@ struct rte_acl_ctx *
 rte_acl_find_existing(const char *name)
 {
 	struct rte_acl_ctx *ctx = NULL;
-	struct rte_acl_list *acl_list;
 	struct rte_tailq_entry *te;
 
-	acl_list = RTE_TAILQ_CAST(rte_acl_tailq.head, rte_acl_list);
-
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
-	TAILQ_FOREACH(te, acl_list, next) {
+	te = rte_tailq_name_lookup(rte_acl_tailq.head, name,
+		sizeof(ctx->name));
+	if (te != NULL)
 		ctx = (struct rte_acl_ctx *) te->data;
-		if (strncmp(name, ctx->name, sizeof(ctx->name)) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	if (te == NULL) {
@@ -204,15 +200,16 @@ rte_acl_free(struct rte_acl_ctx *ctx)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* find our tailq entry */
-	TAILQ_FOREACH(te, acl_list, next) {
-		if (te->data == (void *) ctx)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_acl_tailq.head, ctx->name,
+		sizeof(ctx->name));
+	if (te != NULL && te->data != (void *) ctx)
+		te = NULL;
 	if (te == NULL) {
 		rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 		return;
 	}
 
+	rte_tailq_name_del(te);
 	TAILQ_REMOVE(acl_list, te, next);
 
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -248,11 +245,10 @@ rte_acl_create(const struct rte_acl_param *param)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* if we already have one with that name */
-	TAILQ_FOREACH(te, acl_list, next) {
+	te = rte_tailq_name_lookup(rte_acl_tailq.head, param->name,
+		sizeof(ctx->name));
+	if (te != NULL)
 		ctx = (struct rte_acl_ctx *) te->data;
-		if (strncmp(param->name, ctx->name, sizeof(ctx->name)) == 0)
-			break;
-	}
 
 	/* if ACL with such name doesn't exist, then create a new one. */
 	if (te == NULL) {
@@ -284,6 +280,7 @@ rte_acl_create(const struct rte_acl_param *param)
 		te->data = (void *) ctx;
 
 		TAILQ_INSERT_TAIL(acl_list, te, next);
+		rte_tailq_name_add(rte_acl_tailq.head, te, ctx->name);
 	}
 
 exit:
@@ -59,39 +59,73 @@ memzone_lookup_thread_unsafe(const char *name)
 {
 	const struct rte_mem_config *mcfg;
 	const struct rte_memzone *mz;
-	unsigned i = 0;
+	uint32_t idx;
 
 	/* get pointer to global configuration */
 	mcfg = rte_eal_get_configuration()->mem_config;
 
-	/*
-	 * the algorithm is not optimal (linear), but there are few
-	 * zones and this function should be called at init only
-	 */
-	for (i = 0; i < RTE_MAX_MEMZONE; i++) {
-		mz = &mcfg->memzone[i];
-		if (mz->addr != NULL && !strncmp(name, mz->name, RTE_MEMZONE_NAMESIZE))
-			return &mcfg->memzone[i];
+	idx = mcfg->memzone_name_bucket[eal_name_hash(name, RTE_MEMZONE_NAMESIZE) &
+		(RTE_NAME_INDEX_BUCKETS - 1)];
+	while (idx != 0) {
+		mz = &mcfg->memzone[idx - 1];
+		if (!strncmp(name, mz->name, RTE_MEMZONE_NAMESIZE))
+			return mz;
+		idx = mcfg->memzone_name_next[idx - 1];
 	}
 
 	return NULL;
 }
 
+/* take a free memzone and add it to the name index */
 static inline struct rte_memzone *
-get_next_free_memzone(void)
+get_next_free_memzone(const char *name)
 {
 	struct rte_mem_config *mcfg;
-	unsigned i = 0;
+	uint32_t idx, *bucket;
+	unsigned int i;
 
 	/* get pointer to global configuration */
 	mcfg = rte_eal_get_configuration()->mem_config;
 
-	for (i = 0; i < RTE_MAX_MEMZONE; i++) {
-		if (mcfg->memzone[i].addr == NULL)
-			return &mcfg->memzone[i];
+	/* lowest free descriptor */
+	for (i = 0; i < RTE_DIM(mcfg->memzone_used); i++) {
+		if (~mcfg->memzone_used[i] != 0)
+			break;
 	}
+	if (i == RTE_DIM(mcfg->memzone_used))
+		return NULL;
+	idx = i * 64 + __builtin_ctzll(~mcfg->memzone_used[i]);
+	if (idx >= RTE_MAX_MEMZONE)
+		return NULL;
+	mcfg->memzone_used[i] |= 1ULL << (idx % 64);
 
-	return NULL;
+	bucket = &mcfg->memzone_name_bucket[eal_name_hash(name, RTE_MEMZONE_NAMESIZE) &
+		(RTE_NAME_INDEX_BUCKETS - 1)];
+	mcfg->memzone_name_next[idx] = *bucket;
+	*bucket = idx + 1;
+
+	return &mcfg->memzone[idx];
+}
+
+/* remove a memzone from the name index and release its descriptor */
+static inline void
+put_free_memzone(unsigned int idx)
+{
+	struct rte_mem_config *mcfg;
+	uint32_t *prev;
+
+	/* get pointer to global configuration */
+	mcfg = rte_eal_get_configuration()->mem_config;
+
+	prev = &mcfg->memzone_name_bucket[
+		eal_name_hash(mcfg->memzone[idx].name,
+		RTE_MEMZONE_NAMESIZE) &
+		(RTE_NAME_INDEX_BUCKETS - 1)];
+	while (*prev != idx + 1)
+		prev = &mcfg->memzone_name_next[*prev - 1];
+	*prev = mcfg->memzone_name_next[idx];
+
+	mcfg->memzone_used[idx / 64] &= ~(1ULL << (idx % 64));
 }
 
 /* This function will return the greatest free block if a heap has been
@@ -240,7 +274,7 @@ memzone_reserve_aligned_thread_unsafe(const char *name, size_t len,
 	const struct malloc_elem *elem = malloc_elem_from_data(mz_addr);
 
 	/* fill the zone in config */
-	mz = get_next_free_memzone();
+	mz = get_next_free_memzone(name);
 
 	if (mz == NULL) {
 		RTE_LOG(ERR, EAL, "%s(): Cannot find free memzone but there is room "
@@ -345,6 +379,7 @@ rte_memzone_free(const struct rte_memzone *mz)
 		rte_panic("%s(): memzone address not NULL but memzone_cnt is 0!\n",
 				__func__);
 	} else {
+		put_free_memzone(idx);
 		memset(&mcfg->memzone[idx], 0, sizeof(mcfg->memzone[idx]));
 		mcfg->memzone_cnt--;
 	}
@@ -430,6 +465,9 @@ rte_eal_memzone_init(void)
 	/* delete all zones */
 	mcfg->memzone_cnt = 0;
 	memset(mcfg->memzone, 0, sizeof(mcfg->memzone));
+	memset(mcfg->memzone_name_bucket, 0,
+		sizeof(mcfg->memzone_name_bucket));
+	memset(mcfg->memzone_used, 0, sizeof(mcfg->memzone_used));
 
 	rte_rwlock_write_unlock(&mcfg->mlock);
 
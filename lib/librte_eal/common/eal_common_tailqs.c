@@ -99,6 +99,87 @@ rte_dump_tailq(FILE *f)
 	rte_rwlock_read_unlock(&mcfg->qlock);
 }
 
+/* FNV-1a hash */
+uint32_t
+eal_name_hash(const char *name, size_t size)
+{
+	uint32_t hash = 2166136261U;
+
+	while (size-- != 0 && *name != '\0') {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/* index bucket of a name, entries of different tailqs may share a name */
+static struct rte_tailq_entry **
+rte_tailq_name_bucket(struct rte_tailq_head *head, const char *name,
+	size_t size)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+	uint32_t hash;
+
+	RTE_BUILD_BUG_ON(RTE_NAME_INDEX_BUCKETS & (RTE_NAME_INDEX_BUCKETS - 1));
+
+	hash = eal_name_hash(name, size) ^
+		((uint32_t)(head - mcfg->tailq_head) * 0x9e3779b1U);
+	return &mcfg->tailq_name_bucket[hash & (RTE_NAME_INDEX_BUCKETS - 1)];
+}
+
+void
+rte_tailq_name_add(struct rte_tailq_head *head, struct rte_tailq_entry *te,
+	const char *name)
+{
+	struct rte_tailq_entry **bucket =
+		rte_tailq_name_bucket(head, name, SIZE_MAX);
+
+	te->name_head = head;
+	te->name = name;
+	te->name_next = *bucket;
+	*bucket = te;
+}
+
+void
+rte_tailq_name_del(struct rte_tailq_entry *te)
+{
+	struct rte_tailq_entry **prev;
+
+	if (te->name == NULL)
+		return;
+
+	prev = rte_tailq_name_bucket(te->name_head, te->name, SIZE_MAX);
+	while (*prev != NULL && *prev != te)
+		prev = &(*prev)->name_next;
+	if (*prev != NULL)
+		*prev = te->name_next;
+
+	te->name_next = NULL;
+	te->name_head = NULL;
+	te->name = NULL;
+}
+
+struct rte_tailq_entry *
+rte_tailq_name_lookup(struct rte_tailq_head *head, const char *name,
+	size_t size)
+{
+	struct rte_tailq_entry *te;
+
+	if (head == NULL || name == NULL)
+		return NULL;
+
+	/* indexed names are NUL-terminated within size, hash as many chars */
+	for (te = *rte_tailq_name_bucket(head, name, size); te != NULL;
+			te = te->name_next) {
+		if (te->name_head == head &&
+				strncmp(name, te->name, size) == 0)
+			return te;
+	}
+
+	return NULL;
+}
+
 static struct rte_tailq_head *
 rte_eal_tailq_create(const char *name)
 {
@@ -355,4 +355,18 @@ bool rte_eal_using_phys_addrs(void);
  */
 struct rte_bus *rte_bus_find_by_device_name(const char *str);
 
+/**
+ * Hash a name for the shared name indexes of memzones and tailq entries.
+ *
+ * This function is private to the EAL.
+ *
+ * @param name
+ *   A name.
+ * @param size
+ *   The maximum number of characters of the name to hash.
+ * @return
+ *   The hash of the name, to be reduced to RTE_NAME_INDEX_BUCKETS.
+ */
+uint32_t eal_name_hash(const char *name, size_t size);
+
 #endif /* _EAL_PRIVATE_H_ */
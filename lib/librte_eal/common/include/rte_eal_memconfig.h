@@ -76,6 +76,16 @@ struct rte_mem_config {
 
 	struct rte_tailq_head tailq_head[RTE_MAX_TAILQ]; /**< Tailqs for objects */
 
+	/*
+	 * Hashed name indexes, protected by mlock for memzones and by qlock
+	 * for tailq entries. Memzones are chained by index + 1 (0 ends a
+	 * chain) and allocated from a bitmap of used descriptors.
+	 */
+	uint32_t memzone_name_bucket[RTE_NAME_INDEX_BUCKETS];
+	uint32_t memzone_name_next[RTE_MAX_MEMZONE];
+	uint64_t memzone_used[(RTE_MAX_MEMZONE + 63) / 64];
+	struct rte_tailq_entry *tailq_name_bucket[RTE_NAME_INDEX_BUCKETS];
+
 	/* Heaps of Malloc per socket */
 	struct malloc_heap malloc_heaps[RTE_MAX_NUMA_NODES];
 
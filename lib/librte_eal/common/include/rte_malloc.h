@@ -335,6 +335,43 @@ rte_malloc_set_limit(const char *type, size_t max);
 phys_addr_t
 rte_malloc_virt2phy(const void *addr);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Enable the per-lcore small object caches.
+ *
+ * When enabled, allocations of up to 32 cache lines with default alignment
+ * made from an EAL thread on its local socket are served from a per-lcore
+ * cache of power-of-two size classes, refilled from and flushed to the
+ * socket heap in batches. Objects held in the caches are accounted as
+ * allocated in the heap statistics. Memory zones are not affected.
+ */
+void
+rte_malloc_cache_enable(void);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Disable the per-lcore small object caches.
+ *
+ * Objects already held in the caches are not released, each lcore should
+ * call rte_malloc_cache_flush() to give them back to the heap.
+ */
+void
+rte_malloc_cache_disable(void);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Give all the objects held in the cache of the calling lcore back to
+ * the heap. Does nothing when called from a non-EAL thread.
+ */
+void
+rte_malloc_cache_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
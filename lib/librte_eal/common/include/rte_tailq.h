@@ -52,6 +52,9 @@ extern "C" {
 struct rte_tailq_entry {
 	TAILQ_ENTRY(rte_tailq_entry) next; /**< Pointer entries for a tailq list */
 	void *data; /**< Pointer to the data referenced by this tailq entry */
+	struct rte_tailq_entry *name_next; /**< Next entry in name index */
+	struct rte_tailq_head *name_head; /**< Tailq of the indexed entry */
+	const char *name; /**< Name of the indexed entry, NULL if not indexed */
 };
 /** dummy */
 TAILQ_HEAD(rte_tailq_entry_head, rte_tailq_entry);
@@ -147,6 +150,64 @@ struct rte_tailq_head *rte_eal_tailq_lookup(const char *name);
  */
 int rte_eal_tailq_register(struct rte_tailq_elem *t);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add a tail queue entry to the shared name index.
+ *
+ * The index is shared by all tail queues and all processes, so that
+ * libraries can find their objects by name without walking their tail
+ * queue. The entry must have been allocated with rte_zmalloc() and the
+ * caller must hold the tailq write lock (RTE_EAL_TAILQ_RWLOCK).
+ *
+ * @param head
+ *   The tail queue head the entry is inserted in.
+ * @param te
+ *   The tail queue entry.
+ * @param name
+ *   The name of the object referenced by the entry. It must stay valid
+ *   in shared memory until the entry is removed from the index, e.g. it
+ *   can point to the name stored in the object itself.
+ */
+void rte_tailq_name_add(struct rte_tailq_head *head,
+	struct rte_tailq_entry *te, const char *name);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Remove a tail queue entry from the shared name index.
+ *
+ * Entries that are not indexed are ignored. The caller must hold the
+ * tailq write lock (RTE_EAL_TAILQ_RWLOCK).
+ *
+ * @param te
+ *   The tail queue entry.
+ */
+void rte_tailq_name_del(struct rte_tailq_entry *te);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Find a tail queue entry by name in the shared name index.
+ *
+ * The caller must hold the tailq lock (RTE_EAL_TAILQ_RWLOCK) for reading.
+ *
+ * @param head
+ *   The tail queue head to look into.
+ * @param name
+ *   The name of the object.
+ * @param size
+ *   The maximum number of characters to compare, usually the size of the
+ *   name field of the objects.
+ * @return
+ *   The tail queue entry, or NULL if not found.
+ */
+struct rte_tailq_entry *rte_tailq_name_lookup(struct rte_tailq_head *head,
+	const char *name, size_t size);
+
 #define EAL_REGISTER_TAILQ(t) \
 RTE_INIT(tailqinitfn_ ##t); \
 static void tailqinitfn_ ##t(void) \
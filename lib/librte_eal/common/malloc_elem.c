@@ -271,10 +271,26 @@ join_elem(struct malloc_elem *elem1, struct malloc_elem *elem2)
 int
 malloc_elem_free(struct malloc_elem *elem)
 {
+	struct malloc_heap *heap;
+
 	if (!malloc_elem_cookies_ok(elem) || elem->state != ELEM_BUSY)
 		return -1;
 
-	rte_spinlock_lock(&(elem->heap->lock));
+	/* the header may be merged and cleared, keep the heap pointer */
+	heap = elem->heap;
+	rte_spinlock_lock(&heap->lock);
+	malloc_elem_free_nolock(elem);
+	rte_spinlock_unlock(&heap->lock);
+
+	return 0;
+}
+
+/*
+ * free a malloc_elem block with the heap lock already held by the caller.
+ */
+void
+malloc_elem_free_nolock(struct malloc_elem *elem)
+{
 	size_t sz = elem->size - sizeof(*elem);
 	uint8_t *ptr = (uint8_t *)&elem[1];
 	struct malloc_elem *next = RTE_PTR_ADD(elem, elem->size);
@@ -301,10 +317,6 @@ malloc_elem_free(struct malloc_elem *elem)
 	elem->heap->alloc_count--;
 
 	memset(ptr, 0, sz);
-
-	rte_spinlock_unlock(&(elem->heap->lock));
-
-	return 0;
 }
 
 /*
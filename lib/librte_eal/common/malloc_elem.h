@@ -42,7 +42,8 @@ struct malloc_heap;
 enum elem_state {
 	ELEM_FREE = 0,
 	ELEM_BUSY,
-	ELEM_PAD  /* element is a padding-only header */
+	ELEM_PAD,  /* element is a padding-only header */
+	ELEM_CACHED  /* element is busy, held by a per-lcore malloc cache */
 };
 
 struct malloc_elem {
@@ -170,6 +171,13 @@ malloc_elem_alloc(struct malloc_elem *elem, size_t size,
 int
 malloc_elem_free(struct malloc_elem *elem);
 
+/*
+ * same as malloc_elem_free, but the caller must already hold the heap
+ * lock and have checked that the element is busy.
+ */
+void
+malloc_elem_free_nolock(struct malloc_elem *elem);
+
 /*
  * attempt to resize a malloc_elem by expanding into any free space
  * immediately after it in memory.
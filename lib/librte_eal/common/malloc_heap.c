@@ -174,6 +174,51 @@ malloc_heap_alloc(struct malloc_heap *heap,
 	return elem == NULL ? NULL : (void *)(&elem[1]);
 }
 
+/*
+ * Allocate up to n blocks of the same size from the heap, taking the heap
+ * lock only once. Used to refill the per-lcore caches of rte_malloc.
+ * Returns the number of blocks stored in objs.
+ */
+unsigned int
+malloc_heap_alloc_bulk(struct malloc_heap *heap, size_t size, size_t align,
+		void **objs, unsigned int n)
+{
+	struct malloc_elem *elem;
+	unsigned int i;
+
+	size = RTE_CACHE_LINE_ROUNDUP(size);
+	align = RTE_CACHE_LINE_ROUNDUP(align);
+
+	rte_spinlock_lock(&heap->lock);
+	for (i = 0; i < n; i++) {
+		elem = find_suitable_element(heap, size, 0, align, 0);
+		if (elem == NULL)
+			break;
+		elem = malloc_elem_alloc(elem, size, align, 0);
+		heap->alloc_count++;
+		objs[i] = &elem[1];
+	}
+	rte_spinlock_unlock(&heap->lock);
+
+	return i;
+}
+
+/*
+ * Give n blocks back to the heap, taking the heap lock only once. All the
+ * blocks must be busy or cached elements belonging to this heap.
+ */
+void
+malloc_heap_free_bulk(struct malloc_heap *heap, void * const *objs,
+		unsigned int n)
+{
+	unsigned int i;
+
+	rte_spinlock_lock(&heap->lock);
+	for (i = 0; i < n; i++)
+		malloc_elem_free_nolock(malloc_elem_from_data(objs[i]));
+	rte_spinlock_unlock(&heap->lock);
+}
+
 /*
  * Function to retrieve data for heap on given socket
  */
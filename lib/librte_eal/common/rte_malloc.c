@@ -53,11 +53,170 @@
 #include "malloc_elem.h"
 #include "malloc_heap.h"
 
+/* Number of size classes, from one cache line up to 32 cache lines. */
+#define MALLOC_CACHE_NUM_CLASSES 6
+#define MALLOC_CACHE_CLASS_SIZE(idx) ((size_t)RTE_CACHE_LINE_SIZE << (idx))
+#define MALLOC_CACHE_MAX_SIZE \
+	MALLOC_CACHE_CLASS_SIZE(MALLOC_CACHE_NUM_CLASSES - 1)
+/* Number of objects moved between a cache and the heap at once. */
+#define MALLOC_CACHE_BULK (RTE_MALLOC_CACHE_SIZE / 2)
+
+/*
+ * Per-lcore cache of small objects, one stack of free objects per size
+ * class. All objects come from the heap of the lcore's socket. The caches
+ * are private to each process.
+ */
+struct malloc_lcore_cache {
+	unsigned int len[MALLOC_CACHE_NUM_CLASSES];
+	void *objs[MALLOC_CACHE_NUM_CLASSES][RTE_MALLOC_CACHE_SIZE];
+} __rte_cache_aligned;
+
+static struct malloc_lcore_cache malloc_lcore_cache[RTE_MAX_LCORE];
+static volatile int malloc_cache_enabled;
+
+/* Return the size class of a cache line rounded size, or -1. */
+static inline int
+malloc_cache_class(size_t size)
+{
+	if (size > MALLOC_CACHE_MAX_SIZE)
+		return -1;
+	return rte_bsf32(rte_align32pow2(size / RTE_CACHE_LINE_SIZE));
+}
+
+static inline struct malloc_heap *
+malloc_cache_heap(void)
+{
+	struct rte_mem_config *mcfg = rte_eal_get_configuration()->mem_config;
+
+	return &mcfg->malloc_heaps[malloc_get_numa_socket()];
+}
+
+/*
+ * Get an object from the cache of the calling lcore, refilling it from
+ * the heap in one batch when empty. Returns NULL if the request cannot be
+ * served by the cache.
+ */
+static void *
+malloc_cache_get(size_t size)
+{
+	struct malloc_lcore_cache *cache;
+	unsigned int lcore_id = rte_lcore_id();
+	unsigned int i;
+	void *addr;
+	int idx;
+
+	if (lcore_id >= RTE_MAX_LCORE)
+		return NULL;
+
+	idx = malloc_cache_class(RTE_CACHE_LINE_ROUNDUP(size));
+	if (idx < 0)
+		return NULL;
+
+	cache = &malloc_lcore_cache[lcore_id];
+	if (unlikely(cache->len[idx] == 0)) {
+		cache->len[idx] = malloc_heap_alloc_bulk(malloc_cache_heap(),
+				MALLOC_CACHE_CLASS_SIZE(idx), RTE_CACHE_LINE_SIZE,
+				cache->objs[idx], MALLOC_CACHE_BULK);
+		if (cache->len[idx] == 0)
+			return NULL;
+		for (i = 0; i < cache->len[idx]; i++)
+			malloc_elem_from_data(cache->objs[idx][i])->state =
+				ELEM_CACHED;
+	}
+
+	addr = cache->objs[idx][--cache->len[idx]];
+	malloc_elem_from_data(addr)->state = ELEM_BUSY;
+
+	return addr;
+}
+
+/*
+ * Put an object in the cache of the calling lcore. Only objects with the
+ * exact size of a class, without alignment padding and from the local heap
+ * are cached. When the cache is full, its oldest half is given back to the
+ * heap in one batch. Returns 0 if the object was cached. Cached objects
+ * are marked, so that freeing one again is caught by malloc_elem_free().
+ */
+static int
+malloc_cache_put(void *addr)
+{
+	struct malloc_lcore_cache *cache;
+	struct malloc_elem *elem;
+	struct malloc_heap *heap;
+	unsigned int lcore_id = rte_lcore_id();
+	size_t size;
+	int idx;
+
+	if (lcore_id >= RTE_MAX_LCORE)
+		return -1;
+
+	elem = malloc_elem_from_data(addr);
+	if (!malloc_elem_cookies_ok(elem) || elem->state != ELEM_BUSY ||
+			elem->pad != 0)
+		return -1;
+
+	size = elem->size - MALLOC_ELEM_OVERHEAD;
+	idx = malloc_cache_class(size);
+	if (idx < 0 || MALLOC_CACHE_CLASS_SIZE(idx) != size)
+		return -1;
+
+	heap = malloc_cache_heap();
+	if (elem->heap != heap)
+		return -1;
+
+	cache = &malloc_lcore_cache[lcore_id];
+	if (unlikely(cache->len[idx] == RTE_MALLOC_CACHE_SIZE)) {
+		malloc_heap_free_bulk(heap, cache->objs[idx],
+				MALLOC_CACHE_BULK);
+		cache->len[idx] -= MALLOC_CACHE_BULK;
+		memmove(cache->objs[idx], &cache->objs[idx][MALLOC_CACHE_BULK],
+				cache->len[idx] * sizeof(void *));
+	}
+
+	/* rte_zmalloc relies on freed memory being zeroed */
+	memset(addr, 0, size);
+	elem->state = ELEM_CACHED;
+	cache->objs[idx][cache->len[idx]++] = addr;
+
+	return 0;
+}
+
+void
+rte_malloc_cache_enable(void)
+{
+	malloc_cache_enabled = 1;
+}
+
+void
+rte_malloc_cache_disable(void)
+{
+	malloc_cache_enabled = 0;
+}
+
+void
+rte_malloc_cache_flush(void)
+{
+	struct malloc_lcore_cache *cache;
+	unsigned int lcore_id = rte_lcore_id();
+	unsigned int idx;
+
+	if (lcore_id >= RTE_MAX_LCORE)
+		return;
+
+	cache = &malloc_lcore_cache[lcore_id];
+	for (idx = 0; idx < MALLOC_CACHE_NUM_CLASSES; idx++) {
+		malloc_heap_free_bulk(malloc_cache_heap(), cache->objs[idx],
+				cache->len[idx]);
+		cache->len[idx] = 0;
+	}
+}
 
 /* Free the memory space back to heap */
 void rte_free(void *addr)
 {
 	if (addr == NULL) return;
+	if (malloc_cache_enabled && malloc_cache_put(addr) == 0)
+		return;
 	if (malloc_elem_free(malloc_elem_from_data(addr)) < 0)
 		rte_panic("Fatal error: Invalid memory\n");
 }
@@ -88,6 +247,13 @@ rte_malloc_socket(const char *type, size_t size, unsigned align, int socket_arg)
 	if (socket >= RTE_MAX_NUMA_NODES)
 		return NULL;
 
+	if (malloc_cache_enabled && align <= RTE_CACHE_LINE_SIZE &&
+			socket == (int)malloc_get_numa_socket()) {
+		ret = malloc_cache_get(size);
+		if (ret != NULL)
+			return ret;
+	}
+
 	ret = malloc_heap_alloc(&mcfg->malloc_heaps[socket], type,
 				size, 0, align == 0 ? 1 : align, 0);
 	if (ret != NULL || socket_arg != SOCKET_ID_ANY)
@@ -163,7 +329,7 @@ rte_realloc(void *ptr, size_t size, unsigned align)
 		return rte_malloc(NULL, size, align);
 
 	struct malloc_elem *elem = malloc_elem_from_data(ptr);
-	if (elem == NULL)
+	if (elem == NULL || elem->state == ELEM_CACHED)
 		rte_panic("Fatal error: memory corruption detected\n");
 
 	size = RTE_CACHE_LINE_ROUNDUP(size), align = RTE_CACHE_LINE_ROUNDUP(align);
@@ -71,6 +71,11 @@
  */
 #define RTE_KNI_NAMESIZE 32
 
+/**
+ * Maximum number of FIFO queue pairs of a KNI device.
+ */
+#define RTE_KNI_MAX_QUEUES 8
+
 #define RTE_CACHE_LINE_MIN_SIZE 64
 
 /*
@@ -131,6 +136,18 @@ struct rte_kni_mbuf {
 	void *next;
 };
 
+/*
+ * FIFOs of one queue pair of a KNI device, polled by its own kernel thread
+ * in multiple kernel thread mode.
+ */
+struct rte_kni_queue_info {
+	phys_addr_t tx_phys;
+	phys_addr_t rx_phys;
+	phys_addr_t alloc_phys;
+	phys_addr_t free_phys;
+	uint32_t core_id;             /**< core ID to bind for kernel thread */
+};
+
 /*
  * Struct used to create a KNI device. Passed to the kernel in IOCTL call
  */
@@ -138,10 +155,8 @@ struct rte_kni_mbuf {
 struct rte_kni_device_info {
 	char name[RTE_KNI_NAMESIZE];  /**< Network device name for KNI */
 
-	phys_addr_t tx_phys;
-	phys_addr_t rx_phys;
-	phys_addr_t alloc_phys;
-	phys_addr_t free_phys;
+	uint16_t nb_queues;           /**< Number of queue pairs */
+	struct rte_kni_queue_info queues[RTE_KNI_MAX_QUEUES];
 
 	/* Used by Ethtool */
 	phys_addr_t req_phys;
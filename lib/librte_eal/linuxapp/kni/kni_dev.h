@@ -48,6 +48,44 @@
 
 #define MBUF_BURST_SZ 32
 
+struct kni_dev;
+
+/**
+ * A structure describing one queue pair of a kni device.
+ */
+struct kni_queue {
+	struct kni_dev *kni;
+	uint16_t queue_id;
+	uint32_t core_id;            /* Core ID to bind */
+	struct task_struct *pthread;
+
+	/* statistics of the queue, summed up by kni_net_stats() */
+	unsigned long rx_packets;
+	unsigned long rx_bytes;
+	unsigned long rx_dropped;
+	unsigned long tx_packets;
+	unsigned long tx_bytes;
+	unsigned long tx_dropped;
+
+	/* queue for packets to be sent out */
+	void *tx_q;
+
+	/* queue for the packets received */
+	void *rx_q;
+
+	/* queue for the allocated mbufs those can be used to save sk buffs */
+	void *alloc_q;
+
+	/* free queue for the mbufs to be freed */
+	void *free_q;
+
+	/* buffers */
+	void *pa[MBUF_BURST_SZ];
+	void *va[MBUF_BURST_SZ];
+	void *alloc_pa[MBUF_BURST_SZ];
+	void *alloc_va[MBUF_BURST_SZ];
+};
+
 /**
  * A structure describing the private information for a kni device.
  */
@@ -60,7 +98,6 @@ struct kni_dev {
 	uint16_t group_id;           /* Group ID of a group of KNI devices */
 	uint32_t core_id;            /* Core ID to bind */
 	char name[RTE_KNI_NAMESIZE]; /* Network device name */
-	struct task_struct *pthread;
 
 	/* wait queue for req/resp */
 	wait_queue_head_t wq;
@@ -74,17 +111,9 @@ struct kni_dev {
 	struct net_device *lad_dev;
 	struct pci_dev *pci_dev;
 
-	/* queue for packets to be sent out */
-	void *tx_q;
-
-	/* queue for the packets received */
-	void *rx_q;
-
-	/* queue for the allocated mbufs those can be used to save sk buffs */
-	void *alloc_q;
-
-	/* free queue for the mbufs to be freed */
-	void *free_q;
+	/* queue pairs, each polled by its own kernel thread in multiple mode */
+	uint16_t nb_queues;
+	struct kni_queue queues[RTE_KNI_MAX_QUEUES];
 
 	/* request queue */
 	void *req_q;
@@ -103,15 +132,9 @@ struct kni_dev {
 
 	/* synchro for request processing */
 	unsigned long synchro;
-
-	/* buffers */
-	void *pa[MBUF_BURST_SZ];
-	void *va[MBUF_BURST_SZ];
-	void *alloc_pa[MBUF_BURST_SZ];
-	void *alloc_va[MBUF_BURST_SZ];
 };
 
-void kni_net_rx(struct kni_dev *kni);
+void kni_net_rx(struct kni_queue *q);
 void kni_net_init(struct net_device *dev);
 void kni_net_config_lo_mode(char *lo_str);
 void kni_net_poll_resp(struct kni_dev *kni);
@@ -33,22 +33,27 @@
 static inline uint32_t
 kni_fifo_put(struct rte_kni_fifo *fifo, void **data, uint32_t num)
 {
-	uint32_t i = 0;
+	uint32_t i, n;
+	uint32_t mask = fifo->len - 1;
 	uint32_t fifo_write = fifo->write;
 	uint32_t fifo_read = fifo->read;
-	uint32_t new_write = fifo_write;
 
-	for (i = 0; i < num; i++) {
-		new_write = (new_write + 1) & (fifo->len - 1);
+	num = min_t(uint32_t, num, (fifo_read - fifo_write - 1) & mask);
+	if (num == 0)
+		return 0;
 
-		if (new_write == fifo_read)
-			break;
-		fifo->buffer[fifo_write] = data[i];
-		fifo_write = new_write;
-	}
-	fifo->write = fifo_write;
+	/* Copy up to the end of the buffer, then from its start */
+	n = min_t(uint32_t, num, mask + 1 - fifo_write);
+	for (i = 0; i < n; i++)
+		fifo->buffer[fifo_write + i] = data[i];
+	for (; i < num; i++)
+		fifo->buffer[i - n] = data[i];
 
-	return i;
+	/* Publish the elements before the write index */
+	smp_wmb();
+	fifo->write = (fifo_write + num) & mask;
+
+	return num;
 }
 
 /**
@@ -57,20 +62,29 @@ kni_fifo_put(struct rte_kni_fifo *fifo, void **data, uint32_t num)
 static inline uint32_t
 kni_fifo_get(struct rte_kni_fifo *fifo, void **data, uint32_t num)
 {
-	uint32_t i = 0;
-	uint32_t new_read = fifo->read;
+	uint32_t i, n;
+	uint32_t mask = fifo->len - 1;
+	uint32_t fifo_read = fifo->read;
 	uint32_t fifo_write = fifo->write;
 
-	for (i = 0; i < num; i++) {
-		if (new_read == fifo_write)
-			break;
+	/* Leave the read index untouched when empty, not to dirty its line */
+	num = min_t(uint32_t, num, (fifo_write - fifo_read) & mask);
+	if (num == 0)
+		return 0;
+
+	/* Read the elements after the write index */
+	smp_rmb();
+	n = min_t(uint32_t, num, mask + 1 - fifo_read);
+	for (i = 0; i < n; i++)
+		data[i] = fifo->buffer[fifo_read + i];
+	for (; i < num; i++)
+		data[i] = fifo->buffer[i - n];
 
-		data[i] = fifo->buffer[new_read];
-		new_read = (new_read + 1) & (fifo->len - 1);
-	}
-	fifo->read = new_read;
+	/* Read the elements before the producer may overwrite them */
+	smp_mb();
+	fifo->read = (fifo_read + num) & mask;
 
-	return i;
+	return num;
 }
 
 /**
@@ -133,14 +133,15 @@ static int
 kni_thread_single(void *data)
 {
 	struct kni_net *knet = data;
-	int j;
+	int i, j;
 	struct kni_dev *dev;
 
 	while (!kthread_should_stop()) {
 		down_read(&knet->kni_list_lock);
 		for (j = 0; j < KNI_RX_LOOP_NUM; j++) {
 			list_for_each_entry(dev, &knet->kni_list_head, list) {
-				kni_net_rx(dev);
+				for (i = 0; i < dev->nb_queues; i++)
+					kni_net_rx(&dev->queues[i]);
 				kni_net_poll_resp(dev);
 			}
 		}
@@ -159,12 +160,14 @@ static int
 kni_thread_multiple(void *param)
 {
 	int j;
-	struct kni_dev *dev = param;
+	struct kni_queue *q = param;
 
 	while (!kthread_should_stop()) {
 		for (j = 0; j < KNI_RX_LOOP_NUM; j++) {
-			kni_net_rx(dev);
-			kni_net_poll_resp(dev);
+			kni_net_rx(q);
+			/* requests are served by the thread of the first queue */
+			if (q->queue_id == 0)
+				kni_net_poll_resp(q->kni);
 		}
 #ifdef RTE_KNI_PREEMPT_DEFAULT
 		schedule_timeout_interruptible(
@@ -191,6 +194,19 @@ kni_open(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static void
+kni_stop_threads(struct kni_dev *dev)
+{
+	int i;
+
+	for (i = 0; i < dev->nb_queues; i++) {
+		if (dev->queues[i].pthread != NULL) {
+			kthread_stop(dev->queues[i].pthread);
+			dev->queues[i].pthread = NULL;
+		}
+	}
+}
+
 static int
 kni_dev_remove(struct kni_dev *dev)
 {
@@ -234,11 +250,9 @@ kni_release(struct inode *inode, struct file *file)
 
 	down_write(&knet->kni_list_lock);
 	list_for_each_entry_safe(dev, n, &knet->kni_list_head, list) {
-		/* Stop kernel thread for multiple mode */
-		if (multiple_kthread_on && dev->pthread != NULL) {
-			kthread_stop(dev->pthread);
-			dev->pthread = NULL;
-		}
+		/* Stop kernel threads for multiple mode */
+		if (multiple_kthread_on)
+			kni_stop_threads(dev);
 
 		kni_dev_remove(dev);
 		list_del(&dev->list);
@@ -272,21 +286,30 @@ kni_check_param(struct kni_dev *kni, struct rte_kni_device_info *dev)
 static int
 kni_run_thread(struct kni_net *knet, struct kni_dev *kni, uint8_t force_bind)
 {
+	struct kni_queue *q;
+	int i;
+
 	/**
-	 * Create a new kernel thread for multiple mode, set its core affinity,
-	 * and finally wake it up.
+	 * Create a new kernel thread per queue for multiple mode, set its
+	 * core affinity, and finally wake it up.
 	 */
 	if (multiple_kthread_on) {
-		kni->pthread = kthread_create(kni_thread_multiple,
-			(void *)kni, "kni_%s", kni->name);
-		if (IS_ERR(kni->pthread)) {
-			kni_dev_remove(kni);
-			return -ECANCELED;
-		}
+		for (i = 0; i < kni->nb_queues; i++) {
+			q = &kni->queues[i];
+			q->pthread = kthread_create(kni_thread_multiple,
+				(void *)q, kni->nb_queues > 1 ?
+				"kni_%s.%d" : "kni_%s", kni->name, i);
+			if (IS_ERR(q->pthread)) {
+				q->pthread = NULL;
+				kni_stop_threads(kni);
+				kni_dev_remove(kni);
+				return -ECANCELED;
+			}
 
-		if (force_bind)
-			kthread_bind(kni->pthread, kni->core_id);
-		wake_up_process(kni->pthread);
+			if (force_bind)
+				kthread_bind(q->pthread, q->core_id);
+			wake_up_process(q->pthread);
+		}
 	} else {
 		mutex_lock(&knet->kni_kthread_lock);
 
@@ -319,6 +342,8 @@ kni_ioctl_create(struct net *net, uint32_t ioctl_num,
 	struct rte_kni_device_info dev_info;
 	struct net_device *net_dev = NULL;
 	struct kni_dev *kni, *dev, *n;
+	struct kni_queue *q;
+	int i;
 #ifdef RTE_KNI_KMOD_ETHTOOL
 	struct pci_dev *found_pci = NULL;
 	struct net_device *lad_dev = NULL;
@@ -343,6 +368,11 @@ kni_ioctl_create(struct net *net, uint32_t ioctl_num,
 		return -EINVAL;
 	}
 
+	if (dev_info.nb_queues == 0 || dev_info.nb_queues > RTE_KNI_MAX_QUEUES) {
+		pr_err("invalid number of queues %u\n", dev_info.nb_queues);
+		return -EINVAL;
+	}
+
 	/**
 	 * Check if the cpu core id is valid for binding.
 	 */
@@ -350,6 +380,14 @@ kni_ioctl_create(struct net *net, uint32_t ioctl_num,
 		pr_err("cpu %u is not online\n", dev_info.core_id);
 		return -EINVAL;
 	}
+	for (i = 0; dev_info.force_bind && multiple_kthread_on &&
+			i < dev_info.nb_queues; i++) {
+		if (!cpu_online(dev_info.queues[i].core_id)) {
+			pr_err("cpu %u is not online\n",
+				dev_info.queues[i].core_id);
+			return -EINVAL;
+		}
+	}
 
 	/* Check if it has been created */
 	down_read(&knet->kni_list_lock);
@@ -361,11 +399,13 @@ kni_ioctl_create(struct net *net, uint32_t ioctl_num,
 	}
 	up_read(&knet->kni_list_lock);
 
-	net_dev = alloc_netdev(sizeof(struct kni_dev), dev_info.name,
+	net_dev = alloc_netdev_mqs(sizeof(struct kni_dev), dev_info.name,
 #ifdef NET_NAME_USER
 							NET_NAME_USER,
 #endif
-							kni_net_init);
+							kni_net_init,
+							dev_info.nb_queues,
+							dev_info.nb_queues);
 	if (net_dev == NULL) {
 		pr_err("error allocating device \"%s\"\n", dev_info.name);
 		return -EBUSY;
@@ -381,10 +421,30 @@ kni_ioctl_create(struct net *net, uint32_t ioctl_num,
 	strncpy(kni->name, dev_info.name, RTE_KNI_NAMESIZE);
 
 	/* Translate user space info into kernel space info */
-	kni->tx_q = phys_to_virt(dev_info.tx_phys);
-	kni->rx_q = phys_to_virt(dev_info.rx_phys);
-	kni->alloc_q = phys_to_virt(dev_info.alloc_phys);
-	kni->free_q = phys_to_virt(dev_info.free_phys);
+	kni->nb_queues = dev_info.nb_queues;
+	for (i = 0; i < kni->nb_queues; i++) {
+		q = &kni->queues[i];
+		q->kni = kni;
+		q->queue_id = i;
+		q->core_id = dev_info.queues[i].core_id;
+		q->tx_q = phys_to_virt(dev_info.queues[i].tx_phys);
+		q->rx_q = phys_to_virt(dev_info.queues[i].rx_phys);
+		q->alloc_q = phys_to_virt(dev_info.queues[i].alloc_phys);
+		q->free_q = phys_to_virt(dev_info.queues[i].free_phys);
+
+		pr_debug("queue %d tx_phys:    0x%016llx, tx_q addr:    0x%p\n",
+			i, (unsigned long long) dev_info.queues[i].tx_phys,
+			q->tx_q);
+		pr_debug("queue %d rx_phys:    0x%016llx, rx_q addr:    0x%p\n",
+			i, (unsigned long long) dev_info.queues[i].rx_phys,
+			q->rx_q);
+		pr_debug("queue %d alloc_phys: 0x%016llx, alloc_q addr: 0x%p\n",
+			i, (unsigned long long) dev_info.queues[i].alloc_phys,
+			q->alloc_q);
+		pr_debug("queue %d free_phys:  0x%016llx, free_q addr:  0x%p\n",
+			i, (unsigned long long) dev_info.queues[i].free_phys,
+			q->free_q);
+	}
 
 	kni->req_q = phys_to_virt(dev_info.req_phys);
 	kni->resp_q = phys_to_virt(dev_info.resp_phys);
@@ -393,14 +453,6 @@ kni_ioctl_create(struct net *net, uint32_t ioctl_num,
 
 	kni->mbuf_size = dev_info.mbuf_size;
 
-	pr_debug("tx_phys:      0x%016llx, tx_q addr:      0x%p\n",
-		(unsigned long long) dev_info.tx_phys, kni->tx_q);
-	pr_debug("rx_phys:      0x%016llx, rx_q addr:      0x%p\n",
-		(unsigned long long) dev_info.rx_phys, kni->rx_q);
-	pr_debug("alloc_phys:   0x%016llx, alloc_q addr:   0x%p\n",
-		(unsigned long long) dev_info.alloc_phys, kni->alloc_q);
-	pr_debug("free_phys:    0x%016llx, free_q addr:    0x%p\n",
-		(unsigned long long) dev_info.free_phys, kni->free_q);
 	pr_debug("req_phys:     0x%016llx, req_q addr:     0x%p\n",
 		(unsigned long long) dev_info.req_phys, kni->req_q);
 	pr_debug("resp_phys:    0x%016llx, resp_q addr:    0x%p\n",
@@ -513,10 +565,8 @@ kni_ioctl_release(struct net *net, uint32_t ioctl_num,
 		if (strncmp(dev->name, dev_info.name, RTE_KNI_NAMESIZE) != 0)
 			continue;
 
-		if (multiple_kthread_on && dev->pthread != NULL) {
-			kthread_stop(dev->pthread);
-			dev->pthread = NULL;
-		}
+		if (multiple_kthread_on)
+			kni_stop_threads(dev);
 
 		kni_dev_remove(dev);
 		list_del(&dev->list);
@@ -669,6 +719,6 @@ module_param(kthread_mode, charp, S_IRUGO);
 MODULE_PARM_DESC(kthread_mode,
 "Kernel thread mode (default=single):\n"
 "    single    Single kernel thread mode enabled.\n"
-"    multiple  Multiple kernel thread mode enabled.\n"
+"    multiple  Multiple kernel thread mode enabled, one thread per queue.\n"
 "\n"
 );
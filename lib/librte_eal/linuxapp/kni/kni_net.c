@@ -47,9 +47,9 @@
 #define KNI_WAIT_RESPONSE_TIMEOUT 300 /* 3 seconds */
 
 /* typedef for rx function */
-typedef void (*kni_net_rx_t)(struct kni_dev *kni);
+typedef void (*kni_net_rx_t)(struct kni_queue *q);
 
-static void kni_net_rx_normal(struct kni_dev *kni);
+static void kni_net_rx_normal(struct kni_queue *q);
 
 /* kni rx function pointer, with default to normal rx */
 static kni_net_rx_t kni_net_rx_func = kni_net_rx_normal;
@@ -151,7 +151,7 @@ kni_net_open(struct net_device *dev)
 	struct rte_kni_request req;
 	struct kni_dev *kni = netdev_priv(dev);
 
-	netif_start_queue(dev);
+	netif_tx_start_all_queues(dev);
 
 	memset(&req, 0, sizeof(req));
 	req.req_id = RTE_KNI_REQ_CFG_NETWORK_IF;
@@ -170,7 +170,7 @@ kni_net_release(struct net_device *dev)
 	struct rte_kni_request req;
 	struct kni_dev *kni = netdev_priv(dev);
 
-	netif_stop_queue(dev); /* can't transmit any more */
+	netif_tx_stop_all_queues(dev); /* can't transmit any more */
 
 	memset(&req, 0, sizeof(req));
 	req.req_id = RTE_KNI_REQ_CFG_NETWORK_IF;
@@ -204,6 +204,7 @@ kni_net_tx(struct sk_buff *skb, struct net_device *dev)
 	int len = 0;
 	uint32_t ret;
 	struct kni_dev *kni = netdev_priv(dev);
+	struct kni_queue *q = &kni->queues[skb_get_queue_mapping(skb)];
 	struct rte_kni_mbuf *pkt_kva = NULL;
 	void *pkt_pa = NULL;
 	void *pkt_va = NULL;
@@ -223,8 +224,8 @@ kni_net_tx(struct sk_buff *skb, struct net_device *dev)
 	 * Check if it has at least one free entry in tx_q and
 	 * one entry in alloc_q.
 	 */
-	if (kni_fifo_free_count(kni->tx_q) == 0 ||
-			kni_fifo_count(kni->alloc_q) == 0) {
+	if (kni_fifo_free_count(q->tx_q) == 0 ||
+			kni_fifo_count(q->alloc_q) == 0) {
 		/**
 		 * If no free entry in tx_q or no entry in alloc_q,
 		 * drops skb and goes out.
@@ -233,7 +234,7 @@ kni_net_tx(struct sk_buff *skb, struct net_device *dev)
 	}
 
 	/* dequeue a mbuf from alloc_q */
-	ret = kni_fifo_get(kni->alloc_q, &pkt_pa, 1);
+	ret = kni_fifo_get(q->alloc_q, &pkt_pa, 1);
 	if (likely(ret == 1)) {
 		void *data_kva;
 
@@ -251,7 +252,7 @@ kni_net_tx(struct sk_buff *skb, struct net_device *dev)
 		pkt_kva->data_len = len;
 
 		/* enqueue mbuf into tx_q */
-		ret = kni_fifo_put(kni->tx_q, &pkt_va, 1);
+		ret = kni_fifo_put(q->tx_q, &pkt_va, 1);
 		if (unlikely(ret != 1)) {
 			/* Failing should not happen */
 			pr_err("Fail to enqueue mbuf into tx_q\n");
@@ -265,15 +266,15 @@ kni_net_tx(struct sk_buff *skb, struct net_device *dev)
 
 	/* Free skb and update statistics */
 	dev_kfree_skb(skb);
-	kni->stats.tx_bytes += len;
-	kni->stats.tx_packets++;
+	q->tx_bytes += len;
+	q->tx_packets++;
 
 	return NETDEV_TX_OK;
 
 drop:
 	/* Free skb and update statistics */
 	dev_kfree_skb(skb);
-	kni->stats.tx_dropped++;
+	q->tx_dropped++;
 
 	return NETDEV_TX_OK;
 }
@@ -282,7 +283,7 @@ kni_net_tx(struct sk_buff *skb, struct net_device *dev)
  * RX: normal working mode
  */
 static void
-kni_net_rx_normal(struct kni_dev *kni)
+kni_net_rx_normal(struct kni_queue *q)
 {
 	uint32_t ret;
 	uint32_t len;
@@ -290,10 +291,10 @@ kni_net_rx_normal(struct kni_dev *kni)
 	struct rte_kni_mbuf *kva;
 	void *data_kva;
 	struct sk_buff *skb;
-	struct net_device *dev = kni->net_dev;
+	struct net_device *dev = q->kni->net_dev;
 
 	/* Get the number of free entries in free_q */
-	num_fq = kni_fifo_free_count(kni->free_q);
+	num_fq = kni_fifo_free_count(q->free_q);
 	if (num_fq == 0) {
 		/* No room on the free_q, bail out */
 		return;
@@ -303,21 +304,21 @@ kni_net_rx_normal(struct kni_dev *kni)
 	num_rx = min_t(uint32_t, num_fq, MBUF_BURST_SZ);
 
 	/* Burst dequeue from rx_q */
-	num_rx = kni_fifo_get(kni->rx_q, kni->pa, num_rx);
+	num_rx = kni_fifo_get(q->rx_q, q->pa, num_rx);
 	if (num_rx == 0)
 		return;
 
 	/* Transfer received packets to netif */
 	for (i = 0; i < num_rx; i++) {
-		kva = pa2kva(kni->pa[i]);
+		kva = pa2kva(q->pa[i]);
 		len = kva->pkt_len;
 		data_kva = kva2data_kva(kva);
-		kni->va[i] = pa2va(kni->pa[i], kva);
+		q->va[i] = pa2va(q->pa[i], kva);
 
 		skb = dev_alloc_skb(len + 2);
 		if (!skb) {
 			/* Update statistics */
-			kni->stats.rx_dropped++;
+			q->rx_dropped++;
 			continue;
 		}
 
@@ -345,17 +346,18 @@ kni_net_rx_normal(struct kni_dev *kni)
 		skb->dev = dev;
 		skb->protocol = eth_type_trans(skb, dev);
 		skb->ip_summed = CHECKSUM_UNNECESSARY;
+		skb_record_rx_queue(skb, q->queue_id);
 
 		/* Call netif interface */
 		netif_rx_ni(skb);
 
 		/* Update statistics */
-		kni->stats.rx_bytes += len;
-		kni->stats.rx_packets++;
+		q->rx_bytes += len;
+		q->rx_packets++;
 	}
 
 	/* Burst enqueue mbufs into free_q */
-	ret = kni_fifo_put(kni->free_q, kni->va, num_rx);
+	ret = kni_fifo_put(q->free_q, q->va, num_rx);
 	if (ret != num_rx)
 		/* Failing should not happen */
 		pr_err("Fail to enqueue entries into free_q\n");
@@ -365,7 +367,7 @@ kni_net_rx_normal(struct kni_dev *kni)
  * RX: loopback with enqueue/dequeue fifos.
  */
 static void
-kni_net_rx_lo_fifo(struct kni_dev *kni)
+kni_net_rx_lo_fifo(struct kni_queue *q)
 {
 	uint32_t ret;
 	uint32_t len;
@@ -376,16 +378,16 @@ kni_net_rx_lo_fifo(struct kni_dev *kni)
 	void *alloc_data_kva;
 
 	/* Get the number of entries in rx_q */
-	num_rq = kni_fifo_count(kni->rx_q);
+	num_rq = kni_fifo_count(q->rx_q);
 
 	/* Get the number of free entrie in tx_q */
-	num_tq = kni_fifo_free_count(kni->tx_q);
+	num_tq = kni_fifo_free_count(q->tx_q);
 
 	/* Get the number of entries in alloc_q */
-	num_aq = kni_fifo_count(kni->alloc_q);
+	num_aq = kni_fifo_count(q->alloc_q);
 
 	/* Get the number of free entries in free_q */
-	num_fq = kni_fifo_free_count(kni->free_q);
+	num_fq = kni_fifo_free_count(q->free_q);
 
 	/* Calculate the number of entries to be dequeued from rx_q */
 	num = min(num_rq, num_tq);
@@ -398,42 +400,42 @@ kni_net_rx_lo_fifo(struct kni_dev *kni)
 		return;
 
 	/* Burst dequeue from rx_q */
-	ret = kni_fifo_get(kni->rx_q, kni->pa, num);
+	ret = kni_fifo_get(q->rx_q, q->pa, num);
 	if (ret == 0)
 		return; /* Failing should not happen */
 
 	/* Dequeue entries from alloc_q */
-	ret = kni_fifo_get(kni->alloc_q, kni->alloc_pa, num);
+	ret = kni_fifo_get(q->alloc_q, q->alloc_pa, num);
 	if (ret) {
 		num = ret;
 		/* Copy mbufs */
 		for (i = 0; i < num; i++) {
-			kva = pa2kva(kni->pa[i]);
+			kva = pa2kva(q->pa[i]);
 			len = kva->pkt_len;
 			data_kva = kva2data_kva(kva);
-			kni->va[i] = pa2va(kni->pa[i], kva);
+			q->va[i] = pa2va(q->pa[i], kva);
 
-			alloc_kva = pa2kva(kni->alloc_pa[i]);
+			alloc_kva = pa2kva(q->alloc_pa[i]);
 			alloc_data_kva = kva2data_kva(alloc_kva);
-			kni->alloc_va[i] = pa2va(kni->alloc_pa[i], alloc_kva);
+			q->alloc_va[i] = pa2va(q->alloc_pa[i], alloc_kva);
 
 			memcpy(alloc_data_kva, data_kva, len);
 			alloc_kva->pkt_len = len;
 			alloc_kva->data_len = len;
 
-			kni->stats.tx_bytes += len;
-			kni->stats.rx_bytes += len;
+			q->tx_bytes += len;
+			q->rx_bytes += len;
 		}
 
 		/* Burst enqueue mbufs into tx_q */
-		ret = kni_fifo_put(kni->tx_q, kni->alloc_va, num);
+		ret = kni_fifo_put(q->tx_q, q->alloc_va, num);
 		if (ret != num)
 			/* Failing should not happen */
 			pr_err("Fail to enqueue mbufs into tx_q\n");
 	}
 
 	/* Burst enqueue mbufs into free_q */
-	ret = kni_fifo_put(kni->free_q, kni->va, num);
+	ret = kni_fifo_put(q->free_q, q->va, num);
 	if (ret != num)
 		/* Failing should not happen */
 		pr_err("Fail to enqueue mbufs into free_q\n");
@@ -442,15 +444,15 @@ kni_net_rx_lo_fifo(struct kni_dev *kni)
 	 * Update statistic, and enqueue/dequeue failure is impossible,
 	 * as all queues are checked at first.
 	 */
-	kni->stats.tx_packets += num;
-	kni->stats.rx_packets += num;
+	q->tx_packets += num;
+	q->rx_packets += num;
 }
 
 /*
  * RX: loopback with enqueue/dequeue fifos and sk buffer copies.
  */
 static void
-kni_net_rx_lo_fifo_skb(struct kni_dev *kni)
+kni_net_rx_lo_fifo_skb(struct kni_queue *q)
 {
 	uint32_t ret;
 	uint32_t len;
@@ -458,13 +460,13 @@ kni_net_rx_lo_fifo_skb(struct kni_dev *kni)
 	struct rte_kni_mbuf *kva;
 	void *data_kva;
 	struct sk_buff *skb;
-	struct net_device *dev = kni->net_dev;
+	struct net_device *dev = q->kni->net_dev;
 
 	/* Get the number of entries in rx_q */
-	num_rq = kni_fifo_count(kni->rx_q);
+	num_rq = kni_fifo_count(q->rx_q);
 
 	/* Get the number of free entries in free_q */
-	num_fq = kni_fifo_free_count(kni->free_q);
+	num_fq = kni_fifo_free_count(q->free_q);
 
 	/* Calculate the number of entries to dequeue from rx_q */
 	num = min(num_rq, num_fq);
@@ -475,16 +477,16 @@ kni_net_rx_lo_fifo_skb(struct kni_dev *kni)
 		return;
 
 	/* Burst dequeue mbufs from rx_q */
-	ret = kni_fifo_get(kni->rx_q, kni->pa, num);
+	ret = kni_fifo_get(q->rx_q, q->pa, num);
 	if (ret == 0)
 		return;
 
 	/* Copy mbufs to sk buffer and then call tx interface */
 	for (i = 0; i < num; i++) {
-		kva = pa2kva(kni->pa[i]);
+		kva = pa2kva(q->pa[i]);
 		len = kva->pkt_len;
 		data_kva = kva2data_kva(kva);
-		kni->va[i] = pa2va(kni->pa[i], kva);
+		q->va[i] = pa2va(q->pa[i], kva);
 
 		skb = dev_alloc_skb(len + 2);
 		if (skb) {
@@ -499,7 +501,7 @@ kni_net_rx_lo_fifo_skb(struct kni_dev *kni)
 		/* Simulate real usage, allocate/copy skb twice */
 		skb = dev_alloc_skb(len + 2);
 		if (skb == NULL) {
-			kni->stats.rx_dropped++;
+			q->rx_dropped++;
 			continue;
 		}
 
@@ -527,15 +529,16 @@ kni_net_rx_lo_fifo_skb(struct kni_dev *kni)
 		skb->dev = dev;
 		skb->ip_summed = CHECKSUM_UNNECESSARY;
 
-		kni->stats.rx_bytes += len;
-		kni->stats.rx_packets++;
+		q->rx_bytes += len;
+		q->rx_packets++;
 
-		/* call tx interface */
+		/* call tx interface of the same queue */
+		skb_set_queue_mapping(skb, q->queue_id);
 		kni_net_tx(skb, dev);
 	}
 
 	/* enqueue all the mbufs from rx_q into free_q */
-	ret = kni_fifo_put(kni->free_q, kni->va, num);
+	ret = kni_fifo_put(q->free_q, q->va, num);
 	if (ret != num)
 		/* Failing should not happen */
 		pr_err("Fail to enqueue mbufs into free_q\n");
@@ -543,13 +546,13 @@ kni_net_rx_lo_fifo_skb(struct kni_dev *kni)
 
 /* rx interface */
 void
-kni_net_rx(struct kni_dev *kni)
+kni_net_rx(struct kni_queue *q)
 {
 	/**
 	 * It doesn't need to check if it is NULL pointer,
 	 * as it has a default value
 	 */
-	(*kni_net_rx_func)(kni);
+	(*kni_net_rx_func)(q);
 }
 
 /*
@@ -564,7 +567,7 @@ kni_net_tx_timeout(struct net_device *dev)
 			jiffies - dev_trans_start(dev));
 
 	kni->stats.tx_errors++;
-	netif_wake_queue(dev);
+	netif_tx_wake_all_queues(dev);
 }
 
 /*
@@ -620,8 +623,28 @@ static struct net_device_stats *
 kni_net_stats(struct net_device *dev)
 {
 	struct kni_dev *kni = netdev_priv(dev);
+	struct net_device_stats *stats = &kni->stats;
+	struct kni_queue *q;
+	uint16_t i;
+
+	stats->rx_packets = 0;
+	stats->rx_bytes = 0;
+	stats->rx_dropped = 0;
+	stats->tx_packets = 0;
+	stats->tx_bytes = 0;
+	stats->tx_dropped = 0;
+
+	for (i = 0; i < kni->nb_queues; i++) {
+		q = &kni->queues[i];
+		stats->rx_packets += q->rx_packets;
+		stats->rx_bytes += q->rx_bytes;
+		stats->rx_dropped += q->rx_dropped;
+		stats->tx_packets += q->tx_packets;
+		stats->tx_bytes += q->tx_bytes;
+		stats->tx_dropped += q->tx_dropped;
+	}
 
-	return &kni->stats;
+	return stats;
 }
 
 /*
@@ -567,12 +567,8 @@ rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 	 * Guarantee there's no existing: this is normally already checked
 	 * by ring creation above
 	 */
-	TAILQ_FOREACH(te, efd_list, next)
-	{
-		table = (struct rte_efd_table *) te->data;
-		if (strncmp(name, table->name, RTE_EFD_NAMESIZE) == 0)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_efd_tailq.head, name,
+		RTE_EFD_NAMESIZE);
 
 	table = NULL;
 	if (te != NULL) {
@@ -714,6 +710,7 @@ rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 
 	te->data = (void *) table;
 	TAILQ_INSERT_TAIL(efd_list, te, next);
+	rte_tailq_name_add(rte_efd_tailq.head, te, table->name);
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	snprintf(ring_name, sizeof(ring_name), "HT_%s", table->name);
@@ -722,7 +719,7 @@ rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 			offline_cpu_socket, 0);
 	if (r == NULL) {
 		RTE_LOG(ERR, EFD, "memory allocation failed\n");
-		goto error_unlock_exit;
+		goto error_exit;
 	}
 
 	/* Populate free slots ring. Entry zero is reserved for key misses. */
@@ -734,6 +731,7 @@ rte_efd_create(const char *name, uint32_t max_num_rules, uint32_t key_len,
 
 error_unlock_exit:
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
+error_exit:
 	rte_efd_free(table);
 
 	return NULL;
@@ -744,18 +742,13 @@ rte_efd_find_existing(const char *name)
 {
 	struct rte_efd_table *table = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_efd_list *efd_list;
-
-	efd_list = RTE_TAILQ_CAST(rte_efd_tailq.head, rte_efd_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
 
-	TAILQ_FOREACH(te, efd_list, next)
-	{
+	te = rte_tailq_name_lookup(rte_efd_tailq.head, name,
+		RTE_EFD_NAMESIZE);
+	if (te != NULL)
 		table = (struct rte_efd_table *) te->data;
-		if (strncmp(name, table->name, RTE_EFD_NAMESIZE) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	if (te == NULL) {
@@ -768,11 +761,28 @@ rte_efd_find_existing(const char *name)
 void
 rte_efd_free(struct rte_efd_table *table)
 {
+	struct rte_efd_list *efd_list;
+	struct rte_tailq_entry *te;
 	uint8_t socket_id;
 
 	if (table == NULL)
 		return;
 
+	efd_list = RTE_TAILQ_CAST(rte_efd_tailq.head, rte_efd_list);
+
+	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
+
+	/* find out tailq entry */
+	te = rte_tailq_name_lookup(rte_efd_tailq.head, table->name,
+		RTE_EFD_NAMESIZE);
+	if (te != NULL && te->data == (void *) table) {
+		rte_tailq_name_del(te);
+		TAILQ_REMOVE(efd_list, te, next);
+		rte_free(te);
+	}
+
+	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
+
 	for (socket_id = 0; socket_id < RTE_MAX_NUMA_NODES; socket_id++)
 		rte_free(table->chunks[socket_id]);
 
@@ -120,6 +120,7 @@ rte_event_ring_create(const char *name, unsigned int count, int socket_id,
 		r->r.memzone = mz;
 
 		TAILQ_INSERT_TAIL(ring_list, te, next);
+		rte_tailq_name_add(rte_event_ring_tailq.head, te, r->r.name);
 	} else {
 		r = NULL;
 		RTE_LOG(ERR, RING, "Cannot reserve memory\n");
@@ -136,18 +137,13 @@ rte_event_ring_lookup(const char *name)
 {
 	struct rte_tailq_entry *te;
 	struct rte_event_ring *r = NULL;
-	struct rte_event_ring_list *ring_list;
-
-	ring_list = RTE_TAILQ_CAST(rte_event_ring_tailq.head,
-			rte_event_ring_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
 
-	TAILQ_FOREACH(te, ring_list, next) {
+	te = rte_tailq_name_lookup(rte_event_ring_tailq.head, name,
+		RTE_RING_NAMESIZE);
+	if (te != NULL)
 		r = (struct rte_event_ring *) te->data;
-		if (strncmp(name, r->r.name, RTE_RING_NAMESIZE) == 0)
-			break;
-	}
 
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
@@ -179,28 +175,32 @@ rte_event_ring_free(struct rte_event_ring *r)
 		return;
 	}
 
-	if (rte_memzone_free(r->r.memzone) != 0) {
-		RTE_LOG(ERR, RING, "Cannot free memory\n");
-		return;
-	}
-
 	ring_list = RTE_TAILQ_CAST(rte_event_ring_tailq.head,
 			rte_event_ring_list);
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
-	/* find out tailq entry */
-	TAILQ_FOREACH(te, ring_list, next) {
-		if (te->data == (void *) r)
-			break;
+	/* unlink the tailq entry while the name is still in the memzone */
+	te = rte_tailq_name_lookup(rte_event_ring_tailq.head, r->r.name,
+		RTE_RING_NAMESIZE);
+	if (te != NULL && te->data != (void *) r)
+		te = NULL;
+	if (te != NULL) {
+		rte_tailq_name_del(te);
+		TAILQ_REMOVE(ring_list, te, next);
 	}
 
-	if (te == NULL) {
+	if (rte_memzone_free(r->r.memzone) != 0) {
+		/* the ring is still there, keep it registered */
+		if (te != NULL) {
+			TAILQ_INSERT_TAIL(ring_list, te, next);
+			rte_tailq_name_add(rte_event_ring_tailq.head, te,
+				r->r.name);
+		}
 		rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
+		RTE_LOG(ERR, RING, "Cannot free memory\n");
 		return;
 	}
 
-	TAILQ_REMOVE(ring_list, te, next);
-
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	rte_free(te);
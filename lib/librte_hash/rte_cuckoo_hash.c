@@ -77,16 +77,12 @@ rte_hash_find_existing(const char *name)
 {
 	struct rte_hash *h = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_hash_list *hash_list;
-
-	hash_list = RTE_TAILQ_CAST(rte_hash_tailq.head, rte_hash_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
-	TAILQ_FOREACH(te, hash_list, next) {
+	te = rte_tailq_name_lookup(rte_hash_tailq.head, name,
+		RTE_HASH_NAMESIZE);
+	if (te != NULL)
 		h = (struct rte_hash *) te->data;
-		if (strncmp(name, h->name, RTE_HASH_NAMESIZE) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	if (te == NULL) {
@@ -174,11 +170,8 @@ rte_hash_create(const struct rte_hash_parameters *params)
 
 	/* guarantee there's no existing: this is normally already checked
 	 * by ring creation above */
-	TAILQ_FOREACH(te, hash_list, next) {
-		h = (struct rte_hash *) te->data;
-		if (strncmp(params->name, h->name, RTE_HASH_NAMESIZE) == 0)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_hash_tailq.head, params->name,
+		RTE_HASH_NAMESIZE);
 	h = NULL;
 	if (te != NULL) {
 		rte_errno = EEXIST;
@@ -315,6 +308,7 @@ rte_hash_create(const struct rte_hash_parameters *params)
 
 	te->data = (void *) h;
 	TAILQ_INSERT_TAIL(hash_list, te, next);
+	rte_tailq_name_add(rte_hash_tailq.head, te, h->name);
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	return h;
@@ -343,16 +337,17 @@ rte_hash_free(struct rte_hash *h)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* find out tailq entry */
-	TAILQ_FOREACH(te, hash_list, next) {
-		if (te->data == (void *) h)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_hash_tailq.head, h->name,
+		RTE_HASH_NAMESIZE);
+	if (te != NULL && te->data != (void *) h)
+		te = NULL;
 
 	if (te == NULL) {
 		rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 		return;
 	}
 
+	rte_tailq_name_del(te);
 	TAILQ_REMOVE(hash_list, te, next);
 
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -75,17 +75,12 @@ rte_fbk_hash_find_existing(const char *name)
 {
 	struct rte_fbk_hash_table *h = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_fbk_hash_list *fbk_hash_list;
-
-	fbk_hash_list = RTE_TAILQ_CAST(rte_fbk_hash_tailq.head,
-				       rte_fbk_hash_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
-	TAILQ_FOREACH(te, fbk_hash_list, next) {
+	te = rte_tailq_name_lookup(rte_fbk_hash_tailq.head, name,
+		RTE_FBK_HASH_NAMESIZE);
+	if (te != NULL)
 		h = (struct rte_fbk_hash_table *) te->data;
-		if (strncmp(name, h->name, RTE_FBK_HASH_NAMESIZE) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 	if (te == NULL) {
 		rte_errno = ENOENT;
@@ -135,11 +130,8 @@ rte_fbk_hash_create(const struct rte_fbk_hash_params *params)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* guarantee there's no existing */
-	TAILQ_FOREACH(te, fbk_hash_list, next) {
-		ht = (struct rte_fbk_hash_table *) te->data;
-		if (strncmp(params->name, ht->name, RTE_FBK_HASH_NAMESIZE) == 0)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_fbk_hash_tailq.head, params->name,
+		RTE_FBK_HASH_NAMESIZE);
 	ht = NULL;
 	if (te != NULL) {
 		rte_errno = EEXIST;
@@ -184,6 +176,7 @@ rte_fbk_hash_create(const struct rte_fbk_hash_params *params)
 	te->data = (void *) ht;
 
 	TAILQ_INSERT_TAIL(fbk_hash_list, te, next);
+	rte_tailq_name_add(rte_fbk_hash_tailq.head, te, ht->name);
 
 exit:
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -212,16 +205,17 @@ rte_fbk_hash_free(struct rte_fbk_hash_table *ht)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* find out tailq entry */
-	TAILQ_FOREACH(te, fbk_hash_list, next) {
-		if (te->data == (void *) ht)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_fbk_hash_tailq.head, ht->name,
+		RTE_FBK_HASH_NAMESIZE);
+	if (te != NULL && te->data != (void *) ht)
+		te = NULL;
 
 	if (te == NULL) {
 		rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 		return;
 	}
 
+	rte_tailq_name_del(te);
 	TAILQ_REMOVE(fbk_hash_list, te, next);
 
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -61,6 +61,16 @@
 
 #define KNI_MEM_CHECK(cond) do { if (cond) goto kni_fail; } while (0)
 
+/**
+ * KNI queue pair
+ */
+struct kni_queue {
+	struct rte_kni_fifo *tx_q;          /**< TX queue */
+	struct rte_kni_fifo *rx_q;          /**< RX queue */
+	struct rte_kni_fifo *alloc_q;       /**< Allocated mbufs queue */
+	struct rte_kni_fifo *free_q;        /**< To be freed mbufs queue */
+};
+
 /**
  * KNI context
  */
@@ -71,10 +81,8 @@ struct rte_kni {
 	struct rte_mempool *pktmbuf_pool;   /**< pkt mbuf mempool */
 	unsigned mbuf_size;                 /**< mbuf size */
 
-	struct rte_kni_fifo *tx_q;          /**< TX queue */
-	struct rte_kni_fifo *rx_q;          /**< RX queue */
-	struct rte_kni_fifo *alloc_q;       /**< Allocated mbufs queue */
-	struct rte_kni_fifo *free_q;        /**< To be freed mbufs queue */
+	uint16_t nb_queues;                 /**< Number of queue pairs */
+	struct kni_queue queues[RTE_KNI_MAX_QUEUES]; /**< Queue pairs */
 
 	/* For request & response */
 	struct rte_kni_fifo *req_q;         /**< Request queue */
@@ -99,10 +107,13 @@ struct rte_kni_memzone_slot {
 
 	/* Memzones */
 	const struct rte_memzone *m_ctx;       /**< KNI ctx */
-	const struct rte_memzone *m_tx_q;      /**< TX queue */
-	const struct rte_memzone *m_rx_q;      /**< RX queue */
-	const struct rte_memzone *m_alloc_q;   /**< Allocated mbufs queue */
-	const struct rte_memzone *m_free_q;    /**< To be freed mbufs queue */
+	/* Queue pairs, reserved on first use after the first one */
+	const struct rte_memzone *m_tx_q[RTE_KNI_MAX_QUEUES];    /**< TX queue */
+	const struct rte_memzone *m_rx_q[RTE_KNI_MAX_QUEUES];    /**< RX queue */
+	const struct rte_memzone *m_alloc_q[RTE_KNI_MAX_QUEUES];
+						/**< Allocated mbufs queue */
+	const struct rte_memzone *m_free_q[RTE_KNI_MAX_QUEUES];
+						/**< To be freed mbufs queue */
 	const struct rte_memzone *m_req_q;     /**< Request queue */
 	const struct rte_memzone *m_resp_q;    /**< Response queue */
 	const struct rte_memzone *m_sync_addr;
@@ -127,8 +138,8 @@ struct rte_kni_memzone_pool {
 };
 
 
-static void kni_free_mbufs(struct rte_kni *kni);
-static void kni_allocate_mbufs(struct rte_kni *kni);
+static void kni_free_mbufs(struct kni_queue *q);
+static void kni_allocate_mbufs(struct rte_kni *kni, struct kni_queue *q);
 
 static volatile int kni_fd = -1;
 static struct rte_kni_memzone_pool kni_memzone_pool = {
@@ -147,6 +158,43 @@ kni_memzone_reserve(const char *name, size_t len, int socket_id,
 	return mz;
 }
 
+/*
+ * Reserve the memzones of the FIFOs of a queue pair of a slot. They are
+ * only set in the slot once all of them are reserved; those reserved
+ * before a failure are found again by name on the next attempt.
+ */
+static int
+kni_memzone_reserve_queue(struct rte_kni_memzone_slot *slot, unsigned q)
+{
+	static const char * const fifo_names[] = {
+		"tx", "rx", "alloc", "free",
+	};
+	const struct rte_memzone *mz[RTE_DIM(fifo_names)];
+	char obj_name[RTE_MEMZONE_NAMESIZE];
+	char suffix[8] = "";
+	unsigned i;
+
+	/* The first queue keeps the names of single queue devices */
+	if (q > 0)
+		snprintf(suffix, sizeof(suffix), "_%u", q);
+
+	for (i = 0; i < RTE_DIM(fifo_names); i++) {
+		snprintf(obj_name, sizeof(obj_name), "kni_%s_%u%s",
+			fifo_names[i], slot->id, suffix);
+		mz[i] = kni_memzone_reserve(obj_name, KNI_FIFO_SIZE,
+			SOCKET_ID_ANY, 0);
+		if (mz[i] == NULL)
+			return -1;
+	}
+
+	slot->m_tx_q[q] = mz[0];
+	slot->m_rx_q[q] = mz[1];
+	slot->m_alloc_q[q] = mz[2];
+	slot->m_free_q[q] = mz[3];
+
+	return 0;
+}
+
 /* Pool mgmt */
 static struct rte_kni_memzone_slot*
 kni_memzone_pool_alloc(void)
@@ -226,7 +274,7 @@ rte_kni_init(unsigned int max_kni_ifaces)
 
 	/* Allocate slot objects */
 	kni_memzone_pool.slots = (struct rte_kni_memzone_slot *)
-					rte_malloc(NULL,
+					rte_zmalloc(NULL,
 					sizeof(struct rte_kni_memzone_slot) *
 					max_kni_ifaces,
 					0);
@@ -252,33 +300,8 @@ rte_kni_init(unsigned int max_kni_ifaces)
 		KNI_MEM_CHECK(mz == NULL);
 		it->m_ctx = mz;
 
-		/* TX RING */
-		snprintf(obj_name, OBJNAMSIZ, "kni_tx_%d", i);
-		mz = kni_memzone_reserve(obj_name, KNI_FIFO_SIZE,
-							SOCKET_ID_ANY, 0);
-		KNI_MEM_CHECK(mz == NULL);
-		it->m_tx_q = mz;
-
-		/* RX RING */
-		snprintf(obj_name, OBJNAMSIZ, "kni_rx_%d", i);
-		mz = kni_memzone_reserve(obj_name, KNI_FIFO_SIZE,
-							SOCKET_ID_ANY, 0);
-		KNI_MEM_CHECK(mz == NULL);
-		it->m_rx_q = mz;
-
-		/* ALLOC RING */
-		snprintf(obj_name, OBJNAMSIZ, "kni_alloc_%d", i);
-		mz = kni_memzone_reserve(obj_name, KNI_FIFO_SIZE,
-							SOCKET_ID_ANY, 0);
-		KNI_MEM_CHECK(mz == NULL);
-		it->m_alloc_q = mz;
-
-		/* FREE RING */
-		snprintf(obj_name, OBJNAMSIZ, "kni_free_%d", i);
-		mz = kni_memzone_reserve(obj_name, KNI_FIFO_SIZE,
-							SOCKET_ID_ANY, 0);
-		KNI_MEM_CHECK(mz == NULL);
-		it->m_free_q = mz;
+		/* TX, RX, ALLOC and FREE RINGs of the first queue */
+		KNI_MEM_CHECK(kni_memzone_reserve_queue(it, 0) < 0);
 
 		/* Request RING */
 		snprintf(obj_name, OBJNAMSIZ, "kni_req_%d", i);
@@ -327,10 +350,20 @@ rte_kni_alloc(struct rte_mempool *pktmbuf_pool,
 	char intf_name[RTE_KNI_NAMESIZE];
 	const struct rte_memzone *mz;
 	struct rte_kni_memzone_slot *slot = NULL;
+	struct kni_queue *q;
+	uint16_t nb_queues;
+	uint16_t i;
 
 	if (!pktmbuf_pool || !conf || !conf->name[0])
 		return NULL;
 
+	nb_queues = conf->nb_queues ? conf->nb_queues : 1;
+	if (nb_queues > RTE_KNI_MAX_QUEUES) {
+		RTE_LOG(ERR, KNI, "Invalid number of queues %u, max %u\n",
+			nb_queues, RTE_KNI_MAX_QUEUES);
+		return NULL;
+	}
+
 	/* Check if KNI subsystem has been initialized */
 	if (kni_memzone_pool.initialized != 1) {
 		RTE_LOG(ERR, KNI, "KNI subsystem has not been initialized. Invoke rte_kni_init() first\n");
@@ -374,29 +407,41 @@ rte_kni_alloc(struct rte_mempool *pktmbuf_pool,
 	RTE_LOG(INFO, KNI, "pci: %02x:%02x:%02x \t %02x:%02x\n",
 		dev_info.bus, dev_info.devid, dev_info.function,
 			dev_info.vendor_id, dev_info.device_id);
-	/* TX RING */
-	mz = slot->m_tx_q;
-	ctx->tx_q = mz->addr;
-	kni_fifo_init(ctx->tx_q, KNI_FIFO_COUNT_MAX);
-	dev_info.tx_phys = mz->phys_addr;
-
-	/* RX RING */
-	mz = slot->m_rx_q;
-	ctx->rx_q = mz->addr;
-	kni_fifo_init(ctx->rx_q, KNI_FIFO_COUNT_MAX);
-	dev_info.rx_phys = mz->phys_addr;
-
-	/* ALLOC RING */
-	mz = slot->m_alloc_q;
-	ctx->alloc_q = mz->addr;
-	kni_fifo_init(ctx->alloc_q, KNI_FIFO_COUNT_MAX);
-	dev_info.alloc_phys = mz->phys_addr;
-
-	/* FREE RING */
-	mz = slot->m_free_q;
-	ctx->free_q = mz->addr;
-	kni_fifo_init(ctx->free_q, KNI_FIFO_COUNT_MAX);
-	dev_info.free_phys = mz->phys_addr;
+	ctx->nb_queues = nb_queues;
+	dev_info.nb_queues = nb_queues;
+	for (i = 0; i < nb_queues; i++) {
+		q = &ctx->queues[i];
+		if (slot->m_tx_q[i] == NULL)
+			KNI_MEM_CHECK(kni_memzone_reserve_queue(slot, i) < 0);
+
+		/* Single queue devices keep binding on core_id */
+		dev_info.queues[i].core_id = nb_queues > 1 ?
+			conf->queue_core_id[i] : conf->core_id;
+
+		/* TX RING */
+		mz = slot->m_tx_q[i];
+		q->tx_q = mz->addr;
+		kni_fifo_init(q->tx_q, KNI_FIFO_COUNT_MAX);
+		dev_info.queues[i].tx_phys = mz->phys_addr;
+
+		/* RX RING */
+		mz = slot->m_rx_q[i];
+		q->rx_q = mz->addr;
+		kni_fifo_init(q->rx_q, KNI_FIFO_COUNT_MAX);
+		dev_info.queues[i].rx_phys = mz->phys_addr;
+
+		/* ALLOC RING */
+		mz = slot->m_alloc_q[i];
+		q->alloc_q = mz->addr;
+		kni_fifo_init(q->alloc_q, KNI_FIFO_COUNT_MAX);
+		dev_info.queues[i].alloc_phys = mz->phys_addr;
+
+		/* FREE RING */
+		mz = slot->m_free_q[i];
+		q->free_q = mz->addr;
+		kni_fifo_init(q->free_q, KNI_FIFO_COUNT_MAX);
+		dev_info.queues[i].free_phys = mz->phys_addr;
+	}
 
 	/* Request RING */
 	mz = slot->m_req_q;
@@ -427,7 +472,8 @@ rte_kni_alloc(struct rte_mempool *pktmbuf_pool,
 	ctx->in_use = 1;
 
 	/* Allocate mbufs and then put them into alloc_q */
-	kni_allocate_mbufs(ctx);
+	for (i = 0; i < nb_queues; i++)
+		kni_allocate_mbufs(ctx, &ctx->queues[i]);
 
 	return ctx;
 
@@ -487,8 +533,10 @@ int
 rte_kni_release(struct rte_kni *kni)
 {
 	struct rte_kni_device_info dev_info;
+	struct kni_queue *q;
 	uint32_t slot_id;
-	uint32_t retry = 5;
+	uint32_t retry;
+	uint16_t i;
 
 	if (!kni || !kni->in_use)
 		return -1;
@@ -501,16 +549,21 @@ rte_kni_release(struct rte_kni *kni)
 
 	/* mbufs in all fifo should be released, except request/response */
 
-	/* wait until all rxq packets processed by kernel */
-	while (kni_fifo_count(kni->rx_q) && retry--)
-		usleep(1000);
+	for (i = 0; i < kni->nb_queues; i++) {
+		q = &kni->queues[i];
 
-	if (kni_fifo_count(kni->rx_q))
-		RTE_LOG(ERR, KNI, "Fail to free all Rx-q items\n");
+		/* wait until all rxq packets processed by kernel */
+		retry = 5;
+		while (kni_fifo_count(q->rx_q) && retry--)
+			usleep(1000);
 
-	kni_free_fifo_phy(kni->pktmbuf_pool, kni->alloc_q);
-	kni_free_fifo(kni->tx_q);
-	kni_free_fifo(kni->free_q);
+		if (kni_fifo_count(q->rx_q))
+			RTE_LOG(ERR, KNI, "Fail to free all Rx-q items\n");
+
+		kni_free_fifo_phy(kni->pktmbuf_pool, q->alloc_q);
+		kni_free_fifo(q->tx_q);
+		kni_free_fifo(q->free_q);
+	}
 
 	slot_id = kni->slot_id;
 
@@ -575,8 +628,8 @@ rte_kni_handle_request(struct rte_kni *kni)
 	return 0;
 }
 
-unsigned
-rte_kni_tx_burst(struct rte_kni *kni, struct rte_mbuf **mbufs, unsigned num)
+static inline unsigned
+kni_tx_burst(struct kni_queue *q, struct rte_mbuf **mbufs, unsigned num)
 {
 	void *phy_mbufs[num];
 	unsigned int ret;
@@ -585,46 +638,96 @@ rte_kni_tx_burst(struct rte_kni *kni, struct rte_mbuf **mbufs, unsigned num)
 	for (i = 0; i < num; i++)
 		phy_mbufs[i] = va2pa(mbufs[i]);
 
-	ret = kni_fifo_put(kni->rx_q, phy_mbufs, num);
+	ret = kni_fifo_put(q->rx_q, phy_mbufs, num);
 
 	/* Get mbufs from free_q and then free them */
-	kni_free_mbufs(kni);
+	kni_free_mbufs(q);
 
 	return ret;
 }
 
 unsigned
-rte_kni_rx_burst(struct rte_kni *kni, struct rte_mbuf **mbufs, unsigned num)
+rte_kni_tx_burst(struct rte_kni *kni, struct rte_mbuf **mbufs, unsigned num)
 {
-	unsigned ret = kni_fifo_get(kni->tx_q, (void **)mbufs, num);
+	return kni_tx_burst(&kni->queues[0], mbufs, num);
+}
+
+unsigned
+rte_kni_tx_burst_queue(struct rte_kni *kni, uint16_t queue_id,
+		struct rte_mbuf **mbufs, unsigned num)
+{
+	if (unlikely(queue_id >= kni->nb_queues))
+		return 0;
+
+	return kni_tx_burst(&kni->queues[queue_id], mbufs, num);
+}
+
+static inline unsigned
+kni_rx_burst(struct rte_kni *kni, struct kni_queue *q,
+		struct rte_mbuf **mbufs, unsigned num)
+{
+	unsigned ret = kni_fifo_get(q->tx_q, (void **)mbufs, num);
 
 	/* If buffers removed, allocate mbufs and then put them into alloc_q */
 	if (ret)
-		kni_allocate_mbufs(kni);
+		kni_allocate_mbufs(kni, q);
 
 	return ret;
 }
 
+unsigned
+rte_kni_rx_burst(struct rte_kni *kni, struct rte_mbuf **mbufs, unsigned num)
+{
+	return kni_rx_burst(kni, &kni->queues[0], mbufs, num);
+}
+
+unsigned
+rte_kni_rx_burst_queue(struct rte_kni *kni, uint16_t queue_id,
+		struct rte_mbuf **mbufs, unsigned num)
+{
+	if (unlikely(queue_id >= kni->nb_queues))
+		return 0;
+
+	return kni_rx_burst(kni, &kni->queues[queue_id], mbufs, num);
+}
+
 static void
-kni_free_mbufs(struct rte_kni *kni)
+kni_free_mbufs(struct kni_queue *q)
 {
-	int i, ret;
+	int i, n, ret;
 	struct rte_mbuf *pkts[MAX_MBUF_BURST_NUM];
+	void *objs[MAX_MBUF_BURST_NUM];
+	struct rte_mempool *mp = NULL;
+	struct rte_mbuf *m;
+
+	ret = kni_fifo_get(q->free_q, (void **)pkts, MAX_MBUF_BURST_NUM);
 
-	ret = kni_fifo_get(kni->free_q, (void **)pkts, MAX_MBUF_BURST_NUM);
-	if (likely(ret > 0)) {
-		for (i = 0; i < ret; i++)
+	/* Return single segment mbufs to their pool in bulk */
+	for (i = 0, n = 0; i < ret; i++) {
+		if (unlikely(pkts[i]->next != NULL)) {
 			rte_pktmbuf_free(pkts[i]);
+			continue;
+		}
+		m = rte_pktmbuf_prefree_seg(pkts[i]);
+		if (m == NULL)
+			continue;
+		if (n > 0 && m->pool != mp) {
+			rte_mempool_put_bulk(mp, objs, n);
+			n = 0;
+		}
+		mp = m->pool;
+		objs[n++] = m;
 	}
+	if (n > 0)
+		rte_mempool_put_bulk(mp, objs, n);
 }
 
 static void
-kni_allocate_mbufs(struct rte_kni *kni)
+kni_allocate_mbufs(struct rte_kni *kni, struct kni_queue *q)
 {
 	int i, ret;
 	struct rte_mbuf *pkts[MAX_MBUF_BURST_NUM];
 	void *phys[MAX_MBUF_BURST_NUM];
-	int allocq_free;
 
 	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, pool) !=
 			 offsetof(struct rte_kni_mbuf, pool));
@@ -647,31 +750,28 @@ kni_allocate_mbufs(struct rte_kni *kni)
 		return;
 	}
 
-	allocq_free = (kni->alloc_q->read - kni->alloc_q->write - 1) \
-			& (MAX_MBUF_BURST_NUM - 1);
-	for (i = 0; i < allocq_free; i++) {
-		pkts[i] = rte_pktmbuf_alloc(kni->pktmbuf_pool);
-		if (unlikely(pkts[i] == NULL)) {
-			/* Out of memory */
-			RTE_LOG(ERR, KNI, "Out of memory\n");
-			break;
-		}
-		phys[i] = va2pa(pkts[i]);
-	}
+	/*
+	 * Refill by full bursts only, so that the pool and the alloc_q
+	 * indexes are touched once per MAX_MBUF_BURST_NUM mbufs.
+	 */
+	if (kni_fifo_free_count(q->alloc_q) < MAX_MBUF_BURST_NUM)
+		return;
 
-	/* No pkt mbuf alocated */
-	if (i <= 0)
+	if (unlikely(rte_pktmbuf_alloc_bulk(kni->pktmbuf_pool, pkts,
+				MAX_MBUF_BURST_NUM) != 0)) {
+		/* Out of memory */
+		RTE_LOG(ERR, KNI, "Out of memory\n");
 		return;
+	}
 
-	ret = kni_fifo_put(kni->alloc_q, phys, i);
+	for (i = 0; i < MAX_MBUF_BURST_NUM; i++)
+		phys[i] = va2pa(pkts[i]);
 
-	/* Check if any mbufs not put into alloc_q, and then free them */
-	if (ret >= 0 && ret < i && ret < MAX_MBUF_BURST_NUM) {
-		int j;
+	ret = kni_fifo_put(q->alloc_q, phys, MAX_MBUF_BURST_NUM);
 
-		for (j = ret; j < i; j++)
-			rte_pktmbuf_free(pkts[j]);
-	}
+	/* Check if any mbufs not put into alloc_q, and then free them */
+	for (i = ret; i < MAX_MBUF_BURST_NUM; i++)
+		rte_pktmbuf_free(pkts[i]);
 }
 
 struct rte_kni *
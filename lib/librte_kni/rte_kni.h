@@ -90,6 +90,14 @@ struct rte_kni_conf {
 
 	__extension__
 	uint8_t force_bind : 1; /* Flag to bind kernel thread */
+
+	/*
+	 * Number of FIFO queue pairs, 0 meaning 1. With several queues, the
+	 * kernel thread of each queue is bound on queue_core_id[queue] in
+	 * multiple kernel thread mode.
+	 */
+	uint16_t nb_queues;
+	uint32_t queue_core_id[RTE_KNI_MAX_QUEUES];
 };
 
 /**
@@ -115,7 +123,7 @@ void rte_kni_init(unsigned int max_kni_ifaces);
  * called. rte_kni_alloc is thread safe.
  *
  * The mempool should have capacity of more than "2 x KNI_FIFO_COUNT_MAX"
- * elements for each KNI interface allocated.
+ * elements for each queue of each KNI interface allocated.
  *
  * @param pktmbuf_pool
  *  The mempool for allocting mbufs for packets.
@@ -199,6 +207,52 @@ unsigned rte_kni_rx_burst(struct rte_kni *kni, struct rte_mbuf **mbufs,
 unsigned rte_kni_tx_burst(struct rte_kni *kni, struct rte_mbuf **mbufs,
 		unsigned num);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Retrieve a burst of packets from a queue of a KNI interface, as
+ * rte_kni_rx_burst() does for the first queue. Each queue must be polled
+ * by a single thread.
+ *
+ * @param kni
+ *  The KNI interface context.
+ * @param queue_id
+ *  The index of the queue, lower than the number of queues configured.
+ * @param mbufs
+ *  The array to store the pointers of mbufs.
+ * @param num
+ *  The maximum number per burst.
+ *
+ * @return
+ *  The actual number of packets retrieved.
+ */
+unsigned rte_kni_rx_burst_queue(struct rte_kni *kni, uint16_t queue_id,
+		struct rte_mbuf **mbufs, unsigned num);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Send a burst of packets to a queue of a KNI interface, as
+ * rte_kni_tx_burst() does for the first queue. Each queue must be polled
+ * by a single thread.
+ *
+ * @param kni
+ *  The KNI interface context.
+ * @param queue_id
+ *  The index of the queue, lower than the number of queues configured.
+ * @param mbufs
+ *  The array to store the pointers of mbufs.
+ * @param num
+ *  The maximum number per burst.
+ *
+ * @return
+ *  The actual number of packets sent.
+ */
+unsigned rte_kni_tx_burst_queue(struct rte_kni *kni, uint16_t queue_id,
+		struct rte_mbuf **mbufs, unsigned num);
+
 /**
  * Get the KNI context of its name.
  *
@@ -55,21 +55,26 @@ kni_fifo_init(struct rte_kni_fifo *fifo, unsigned size)
 static inline unsigned
 kni_fifo_put(struct rte_kni_fifo *fifo, void **data, unsigned num)
 {
-	unsigned i = 0;
+	unsigned i, n;
+	unsigned mask = fifo->len - 1;
 	unsigned fifo_write = fifo->write;
 	unsigned fifo_read = fifo->read;
-	unsigned new_write = fifo_write;
 
-	for (i = 0; i < num; i++) {
-		new_write = (new_write + 1) & (fifo->len - 1);
+	num = RTE_MIN(num, (fifo_read - fifo_write - 1) & mask);
+	if (num == 0)
+		return 0;
 
-		if (new_write == fifo_read)
-			break;
-		fifo->buffer[fifo_write] = data[i];
-		fifo_write = new_write;
-	}
-	fifo->write = fifo_write;
-	return i;
+	/* Copy up to the end of the buffer, then from its start */
+	n = RTE_MIN(num, mask + 1 - fifo_write);
+	for (i = 0; i < n; i++)
+		fifo->buffer[fifo_write + i] = data[i];
+	for (; i < num; i++)
+		fifo->buffer[i - n] = data[i];
+
+	/* Publish the elements before the write index */
+	rte_smp_wmb();
+	fifo->write = (fifo_write + num) & mask;
+	return num;
 }
 
 /**
@@ -78,18 +83,28 @@ kni_fifo_put(struct rte_kni_fifo *fifo, void **data, unsigned num)
 static inline unsigned
 kni_fifo_get(struct rte_kni_fifo *fifo, void **data, unsigned num)
 {
-	unsigned i = 0;
-	unsigned new_read = fifo->read;
+	unsigned i, n;
+	unsigned mask = fifo->len - 1;
+	unsigned fifo_read = fifo->read;
 	unsigned fifo_write = fifo->write;
-	for (i = 0; i < num; i++) {
-		if (new_read == fifo_write)
-			break;
 
-		data[i] = fifo->buffer[new_read];
-		new_read = (new_read + 1) & (fifo->len - 1);
-	}
-	fifo->read = new_read;
-	return i;
+	/* Leave the read index untouched when empty, not to dirty its line */
+	num = RTE_MIN(num, (fifo_write - fifo_read) & mask);
+	if (num == 0)
+		return 0;
+
+	/* Read the elements after the write index */
+	rte_smp_rmb();
+	n = RTE_MIN(num, mask + 1 - fifo_read);
+	for (i = 0; i < n; i++)
+		data[i] = fifo->buffer[fifo_read + i];
+	for (; i < num; i++)
+		data[i] = fifo->buffer[i - n];
+
+	/* Read the elements before the producer may overwrite them */
+	rte_smp_mb();
+	fifo->read = (fifo_read + num) & mask;
+	return num;
 }
 
 /**
@@ -100,3 +115,12 @@ kni_fifo_count(struct rte_kni_fifo *fifo)
 {
 	return (fifo->len + fifo->write - fifo->read) & (fifo->len - 1);
 }
+
+/**
+ * Get the num of available elements in the fifo
+ */
+static inline uint32_t
+kni_fifo_free_count(struct rte_kni_fifo *fifo)
+{
+	return (fifo->read - fifo->write - 1) & (fifo->len - 1);
+}
@@ -123,16 +123,12 @@ rte_lpm_find_existing_v20(const char *name)
 {
 	struct rte_lpm_v20 *l = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_lpm_list *lpm_list;
-
-	lpm_list = RTE_TAILQ_CAST(rte_lpm_tailq.head, rte_lpm_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
-	TAILQ_FOREACH(te, lpm_list, next) {
+	te = rte_tailq_name_lookup(rte_lpm_tailq.head, name,
+		RTE_LPM_NAMESIZE);
+	if (te != NULL)
 		l = (struct rte_lpm_v20 *) te->data;
-		if (strncmp(name, l->name, RTE_LPM_NAMESIZE) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	if (te == NULL) {
@@ -149,16 +145,12 @@ rte_lpm_find_existing_v1604(const char *name)
 {
 	struct rte_lpm *l = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_lpm_list *lpm_list;
-
-	lpm_list = RTE_TAILQ_CAST(rte_lpm_tailq.head, rte_lpm_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
-	TAILQ_FOREACH(te, lpm_list, next) {
+	te = rte_tailq_name_lookup(rte_lpm_tailq.head, name,
+		RTE_LPM_NAMESIZE);
+	if (te != NULL)
 		l = (struct rte_lpm *) te->data;
-		if (strncmp(name, l->name, RTE_LPM_NAMESIZE) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	if (te == NULL) {
@@ -203,11 +195,8 @@ rte_lpm_create_v20(const char *name, int socket_id, int max_rules,
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* guarantee there's no existing */
-	TAILQ_FOREACH(te, lpm_list, next) {
-		lpm = (struct rte_lpm_v20 *) te->data;
-		if (strncmp(name, lpm->name, RTE_LPM_NAMESIZE) == 0)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_lpm_tailq.head, name,
+		RTE_LPM_NAMESIZE);
 	lpm = NULL;
 	if (te != NULL) {
 		rte_errno = EEXIST;
@@ -237,6 +226,7 @@ rte_lpm_create_v20(const char *name, int socket_id, int max_rules,
 	te->data = (void *) lpm;
 
 	TAILQ_INSERT_TAIL(lpm_list, te, next);
+	rte_tailq_name_add(rte_lpm_tailq.head, te, lpm->name);
 
 exit:
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -277,11 +267,8 @@ rte_lpm_create_v1604(const char *name, int socket_id,
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* guarantee there's no existing */
-	TAILQ_FOREACH(te, lpm_list, next) {
-		lpm = (struct rte_lpm *) te->data;
-		if (strncmp(name, lpm->name, RTE_LPM_NAMESIZE) == 0)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_lpm_tailq.head, name,
+		RTE_LPM_NAMESIZE);
 	lpm = NULL;
 	if (te != NULL) {
 		rte_errno = EEXIST;
@@ -335,6 +322,7 @@ rte_lpm_create_v1604(const char *name, int socket_id,
 	te->data = (void *) lpm;
 
 	TAILQ_INSERT_TAIL(lpm_list, te, next);
+	rte_tailq_name_add(rte_lpm_tailq.head, te, lpm->name);
 
 exit:
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -364,12 +352,14 @@ rte_lpm_free_v20(struct rte_lpm_v20 *lpm)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* find our tailq entry */
-	TAILQ_FOREACH(te, lpm_list, next) {
-		if (te->data == (void *) lpm)
-			break;
-	}
-	if (te != NULL)
+	te = rte_tailq_name_lookup(rte_lpm_tailq.head, lpm->name,
+		RTE_LPM_NAMESIZE);
+	if (te != NULL && te->data != (void *) lpm)
+		te = NULL;
+	if (te != NULL) {
+		rte_tailq_name_del(te);
 		TAILQ_REMOVE(lpm_list, te, next);
+	}
 
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 
@@ -393,12 +383,14 @@ rte_lpm_free_v1604(struct rte_lpm *lpm)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* find our tailq entry */
-	TAILQ_FOREACH(te, lpm_list, next) {
-		if (te->data == (void *) lpm)
-			break;
-	}
-	if (te != NULL)
+	te = rte_tailq_name_lookup(rte_lpm_tailq.head, lpm->name,
+		RTE_LPM_NAMESIZE);
+	if (te != NULL && te->data != (void *) lpm)
+		te = NULL;
+	if (te != NULL) {
+		rte_tailq_name_del(te);
 		TAILQ_REMOVE(lpm_list, te, next);
+	}
 
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 
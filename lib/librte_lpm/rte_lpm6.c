@@ -176,11 +176,8 @@ rte_lpm6_create(const char *name, int socket_id,
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* Guarantee there's no existing */
-	TAILQ_FOREACH(te, lpm_list, next) {
-		lpm = (struct rte_lpm6 *) te->data;
-		if (strncmp(name, lpm->name, RTE_LPM6_NAMESIZE) == 0)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_lpm6_tailq.head, name,
+		RTE_LPM6_NAMESIZE);
 	lpm = NULL;
 	if (te != NULL) {
 		rte_errno = EEXIST;
@@ -223,6 +220,7 @@ rte_lpm6_create(const char *name, int socket_id,
 	te->data = (void *) lpm;
 
 	TAILQ_INSERT_TAIL(lpm_list, te, next);
+	rte_tailq_name_add(rte_lpm6_tailq.head, te, lpm->name);
 
 exit:
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -238,16 +236,12 @@ rte_lpm6_find_existing(const char *name)
 {
 	struct rte_lpm6 *l = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_lpm6_list *lpm_list;
-
-	lpm_list = RTE_TAILQ_CAST(rte_lpm6_tailq.head, rte_lpm6_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
-	TAILQ_FOREACH(te, lpm_list, next) {
+	te = rte_tailq_name_lookup(rte_lpm6_tailq.head, name,
+		RTE_LPM6_NAMESIZE);
+	if (te != NULL)
 		l = (struct rte_lpm6 *) te->data;
-		if (strncmp(name, l->name, RTE_LPM6_NAMESIZE) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	if (te == NULL) {
@@ -276,13 +270,15 @@ rte_lpm6_free(struct rte_lpm6 *lpm)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* find our tailq entry */
-	TAILQ_FOREACH(te, lpm_list, next) {
-		if (te->data == (void *) lpm)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_lpm6_tailq.head, lpm->name,
+		RTE_LPM6_NAMESIZE);
+	if (te != NULL && te->data != (void *) lpm)
+		te = NULL;
 
-	if (te != NULL)
+	if (te != NULL) {
+		rte_tailq_name_del(te);
 		TAILQ_REMOVE(lpm_list, te, next);
+	}
 
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 
@@ -72,6 +72,16 @@ EAL_REGISTER_TAILQ(rte_mempool_tailq)
 #define CALC_CACHE_FLUSHTHRESH(c)	\
 	((typeof(c))((c) * CACHE_FLUSHTHRESH_MULTIPLIER))
 
+/*
+ * Adaptive caches: a flush counts as +1 and a refill as -1 in a saturated
+ * balance. Past the threshold, the lcore is considered as a producer or
+ * a consumer of objects.
+ */
+#define CACHE_BALANCE_MAX	4
+#define CACHE_BALANCE_THRESH	2
+/* Size of the ring between producer and consumer caches. */
+#define CACHE_HANDOFF_SIZE	(4 * RTE_MEMPOOL_CACHE_MAX_SIZE)
+
 /*
  * return the greatest common divisor between a and b (fast algorithm)
  *
@@ -105,6 +115,14 @@ static unsigned get_gcd(unsigned a, unsigned b)
  * between channels and ranks in RAM: the pool allocator will add
  * padding between objects. This function return the new size of the
  * object.
+ *
+ * The first cache line of an object (e.g. the mbuf header) is the most
+ * accessed one, and the object size, in cache lines, is the stride
+ * between these lines. The number of sets of the CPU caches and the
+ * interleave granularity of channels and ranks are powers of two, so a
+ * stride that is odd and coprime with the number of channels and ranks
+ * makes consecutive objects hit all cache sets and all channels evenly.
+ * The smallest such stride is used to keep the padding minimal.
  */
 static unsigned optimize_object_size(unsigned obj_size)
 {
@@ -122,7 +140,7 @@ static unsigned optimize_object_size(unsigned obj_size)
 
 	/* process new object size */
 	new_obj_size = (obj_size + RTE_MEMPOOL_ALIGN_MASK) / RTE_MEMPOOL_ALIGN;
-	while (get_gcd(new_obj_size, nrank * nchan) != 1)
+	while (get_gcd(new_obj_size, 2 * nrank * nchan) != 1)
 		new_obj_size++;
 	return new_obj_size * RTE_MEMPOOL_ALIGN;
 }
@@ -535,6 +553,11 @@ rte_mempool_populate_default(struct rte_mempool *mp)
 		pg_shift = 0; /* not needed, zone is physically contiguous */
 		pg_sz = 0;
 		align = RTE_CACHE_LINE_SIZE;
+	} else if (mp->flags & MEMPOOL_F_NO_PHYS_CONTIG) {
+		/* no IO address needed, objects can cross page boundaries */
+		pg_shift = 0;
+		pg_sz = 0;
+		align = RTE_CACHE_LINE_SIZE;
 	} else {
 		pg_sz = getpagesize();
 		pg_shift = rte_bsf32(pg_sz);
@@ -568,7 +591,7 @@ rte_mempool_populate_default(struct rte_mempool *mp)
 		else
 			paddr = mz->phys_addr;
 
-		if (rte_eal_has_hugepages() && !rte_xen_dom0_supported())
+		if (pg_sz == 0)
 			ret = rte_mempool_populate_phys(mp, mz->addr,
 				paddr, mz->len,
 				rte_mempool_memchunk_mz_free,
@@ -654,6 +677,79 @@ rte_mempool_populate_anon(struct rte_mempool *mp)
 	return 0;
 }
 
+/* unmap an area mapped by rte_mempool_populate_anon_compact() */
+static void
+rte_mempool_memchunk_anon_compact_free(struct rte_mempool_memhdr *memhdr,
+	__rte_unused void *opaque)
+{
+	munmap(memhdr->addr, memhdr->len);
+}
+
+/* populate the mempool with objects packed in an anonymous mapping */
+int
+rte_mempool_populate_anon_compact(struct rte_mempool *mp, unsigned int flags)
+{
+	size_t size, map_size, head, tail, pg_sz, align;
+	char *map_addr, *addr;
+	int mp_flags;
+	int ret;
+
+	/* mempool must not be populated */
+	if (mp->nb_mem_chunks != 0)
+		return -EEXIST;
+
+	pg_sz = getpagesize();
+	align = pg_sz;
+	if (flags & MEMPOOL_ANON_F_THP)
+		align = RTE_PGSIZE_2M;
+
+	/* objects are packed, only the first one needs to be aligned */
+	size = (size_t)mp->size *
+		(mp->header_size + mp->elt_size + mp->trailer_size);
+	size = RTE_ALIGN_CEIL(size, pg_sz);
+
+	/* over-allocate so that the area can be aligned, a private mapping
+	 * is required for transparent huge pages
+	 */
+	map_size = size + align - pg_sz;
+	map_addr = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map_addr == MAP_FAILED)
+		return -errno;
+
+	/* give back the unused head and tail of the mapping */
+	addr = RTE_PTR_ALIGN_CEIL(map_addr, align);
+	head = RTE_PTR_DIFF(addr, map_addr);
+	tail = map_size - head - size;
+	if (head != 0)
+		munmap(map_addr, head);
+	if (tail != 0)
+		munmap(addr + size, tail);
+
+#ifdef MADV_HUGEPAGE
+	if (flags & MEMPOOL_ANON_F_THP)
+		madvise(addr, size, MADV_HUGEPAGE);
+#endif
+
+	if ((flags & MEMPOOL_ANON_F_LOCK) && mlock(addr, size) < 0) {
+		ret = -errno;
+		munmap(addr, size);
+		return ret;
+	}
+
+	mp_flags = mp->flags;
+	mp->flags |= MEMPOOL_F_NO_PHYS_CONTIG;
+	ret = rte_mempool_populate_phys(mp, addr, RTE_BAD_PHYS_ADDR, size,
+		rte_mempool_memchunk_anon_compact_free, NULL);
+	if (ret < 0) {
+		mp->flags = mp_flags;
+		munmap(addr, size);
+		return ret;
+	}
+
+	return mp->populated_size;
+}
+
 /* free a mempool */
 void
 rte_mempool_free(struct rte_mempool *mp)
@@ -667,12 +763,10 @@ rte_mempool_free(struct rte_mempool *mp)
 	mempool_list = RTE_TAILQ_CAST(rte_mempool_tailq.head, rte_mempool_list);
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 	/* find out tailq entry */
-	TAILQ_FOREACH(te, mempool_list, next) {
-		if (te->data == (void *)mp)
-			break;
-	}
-
-	if (te != NULL) {
+	te = rte_tailq_name_lookup(rte_mempool_tailq.head, mp->name,
+		RTE_MEMPOOL_NAMESIZE);
+	if (te != NULL && te->data == (void *)mp) {
+		rte_tailq_name_del(te);
 		TAILQ_REMOVE(mempool_list, te, next);
 		rte_free(te);
 	}
@@ -680,6 +774,7 @@ rte_mempool_free(struct rte_mempool *mp)
 
 	rte_mempool_free_memchunks(mp);
 	rte_mempool_ops_free(mp);
+	rte_ring_free(mp->handoff);
 	rte_memzone_free(mp->mz);
 }
 
@@ -689,6 +784,106 @@ mempool_cache_init(struct rte_mempool_cache *cache, uint32_t size)
 	cache->size = size;
 	cache->flushthresh = CALC_CACHE_FLUSHTHRESH(size);
 	cache->len = 0;
+	cache->keep = size;
+	cache->fill = size;
+	cache->balance = 0;
+}
+
+/*
+ * Update the balance of an adaptive cache after a flush (dir = 1) or a
+ * refill (dir = -1), and its thresholds accordingly:
+ * - producer: flush down to a quarter of the size, up to twice the size;
+ * - consumer: refill up to 1.5 times the size, flush above twice the size;
+ * - otherwise, the usual thresholds.
+ * The flush threshold never exceeds twice the size, so that a put of
+ * RTE_MEMPOOL_CACHE_MAX_SIZE objects always fits in the cache.
+ */
+static void
+mempool_cache_adapt(struct rte_mempool_cache *cache, int dir)
+{
+	cache->balance = RTE_MAX(-CACHE_BALANCE_MAX,
+		RTE_MIN(CACHE_BALANCE_MAX, cache->balance + dir));
+
+	if (cache->balance >= CACHE_BALANCE_THRESH) {
+		cache->keep = cache->size / 4;
+		cache->fill = cache->size;
+		cache->flushthresh = cache->size * 2;
+	} else if (cache->balance <= -CACHE_BALANCE_THRESH) {
+		cache->keep = CALC_CACHE_FLUSHTHRESH(cache->size);
+		cache->fill = CALC_CACHE_FLUSHTHRESH(cache->size);
+		cache->flushthresh = cache->size * 2;
+	} else {
+		cache->keep = cache->size;
+		cache->fill = cache->size;
+		cache->flushthresh = CALC_CACHE_FLUSHTHRESH(cache->size);
+	}
+}
+
+/* flush the excess objects of an adaptive cache */
+void
+rte_mempool_cache_adaptive_flush(struct rte_mempool *mp,
+	struct rte_mempool_cache *cache)
+{
+	void **objs = &cache->objs[cache->keep];
+	unsigned int n = cache->len - cache->keep;
+	unsigned int done = 0;
+
+	/* producers give their objects to consumers first */
+	if (mp->handoff != NULL && cache->balance >= CACHE_BALANCE_THRESH)
+		done = rte_ring_mp_enqueue_burst(mp->handoff, objs, n, NULL);
+	if (done < n)
+		rte_mempool_ops_enqueue_bulk(mp, &objs[done], n - done);
+
+	cache->len = cache->keep;
+	mempool_cache_adapt(cache, 1);
+}
+
+/* refill an adaptive cache so that it holds at least n objects */
+int
+rte_mempool_cache_adaptive_refill(struct rte_mempool *mp,
+	struct rte_mempool_cache *cache, unsigned int n)
+{
+	void **objs = &cache->objs[cache->len];
+	unsigned int req = n + (cache->fill - cache->len);
+	unsigned int done = 0;
+
+	/* consumers take objects from producers first */
+	if (mp->handoff != NULL && cache->balance <= -CACHE_BALANCE_THRESH)
+		done = rte_ring_mc_dequeue_burst(mp->handoff, objs, req, NULL);
+	if (done < req &&
+			rte_mempool_ops_dequeue_bulk(mp, &objs[done],
+				req - done) < 0) {
+		/* the pool is short, use what the producers gave if enough */
+		if (cache->len + done < n) {
+			if (done != 0)
+				rte_mempool_ops_enqueue_bulk(mp, objs, done);
+			return -ENOENT;
+		}
+		req = done;
+	}
+
+	cache->len += req;
+	mempool_cache_adapt(cache, -1);
+	return 0;
+}
+
+/* get objects from the handoff ring, completed from the handler */
+int
+rte_mempool_handoff_dequeue(struct rte_mempool *mp, void **obj_table,
+	unsigned int n)
+{
+	unsigned int done;
+
+	done = rte_ring_mc_dequeue_burst(mp->handoff, obj_table, n, NULL);
+	if (done == n)
+		return 0;
+	if (rte_mempool_ops_dequeue_bulk(mp, &obj_table[done], n - done) == 0)
+		return 0;
+
+	/* the handler always has room for all the objects of the pool */
+	if (done != 0)
+		rte_mempool_ops_enqueue_bulk(mp, obj_table, done);
+	return -ENOENT;
 }
 
 /*
@@ -772,6 +967,10 @@ rte_mempool_create_empty(const char *name, unsigned n, unsigned elt_size,
 	if (flags & MEMPOOL_F_NO_CACHE_ALIGN)
 		flags |= MEMPOOL_F_NO_SPREAD;
 
+	/* "cache handoff" imply "adaptive cache" */
+	if (flags & MEMPOOL_F_CACHE_HANDOFF)
+		flags |= MEMPOOL_F_CACHE_ADAPTIVE;
+
 	/* calculate mempool object sizes. */
 	if (!rte_mempool_calc_obj_size(elt_size, flags, &objsz)) {
 		rte_errno = EINVAL;
@@ -844,10 +1043,26 @@ rte_mempool_create_empty(const char *name, unsigned n, unsigned elt_size,
 					   cache_size);
 	}
 
+	if (flags & MEMPOOL_F_CACHE_HANDOFF) {
+		char rg_name[RTE_RING_NAMESIZE];
+
+		/* same length as the ring of the default handler */
+		ret = snprintf(rg_name, sizeof(rg_name), "MH_%s", name);
+		if (ret < 0 || ret >= (int)sizeof(rg_name)) {
+			rte_errno = ENAMETOOLONG;
+			goto exit_unlock;
+		}
+		mp->handoff = rte_ring_create(rg_name, CACHE_HANDOFF_SIZE,
+			socket_id, 0);
+		if (mp->handoff == NULL)
+			goto exit_unlock;
+	}
+
 	te->data = mp;
 
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 	TAILQ_INSERT_TAIL(mempool_list, te, next);
+	rte_tailq_name_add(rte_mempool_tailq.head, te, mp->name);
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 	rte_rwlock_write_unlock(RTE_EAL_MEMPOOL_RWLOCK);
 
@@ -979,6 +1194,9 @@ rte_mempool_avail_count(const struct rte_mempool *mp)
 
 	count = rte_mempool_ops_get_count(mp);
 
+	if (mp->handoff != NULL)
+		count += rte_ring_count(mp->handoff);
+
 	if (mp->cache_size == 0)
 		return count;
 
@@ -1019,9 +1237,17 @@ rte_mempool_dump_cache(FILE *f, const struct rte_mempool *mp)
 		cache_count = mp->local_cache[lcore_id].len;
 		fprintf(f, "    cache_count[%u]=%"PRIu32"\n",
 			lcore_id, cache_count);
+		if (mp->flags & MEMPOOL_F_CACHE_ADAPTIVE)
+			fprintf(f, "    cache_balance[%u]=%"PRId32"\n",
+				lcore_id, mp->local_cache[lcore_id].balance);
 		count += cache_count;
 	}
 	fprintf(f, "    total_cache_count=%u\n", count);
+	if (mp->handoff != NULL) {
+		cache_count = rte_ring_count(mp->handoff);
+		fprintf(f, "    handoff_count=%u\n", cache_count);
+		count += cache_count;
+	}
 	return count;
 }
 
@@ -1253,18 +1479,16 @@ rte_mempool_lookup(const char *name)
 {
 	struct rte_mempool *mp = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_mempool_list *mempool_list;
-
-	mempool_list = RTE_TAILQ_CAST(rte_mempool_tailq.head, rte_mempool_list);
 
 	rte_rwlock_read_lock(RTE_EAL_MEMPOOL_RWLOCK);
+	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
 
-	TAILQ_FOREACH(te, mempool_list, next) {
+	te = rte_tailq_name_lookup(rte_mempool_tailq.head, name,
+		RTE_MEMPOOL_NAMESIZE);
+	if (te != NULL)
 		mp = (struct rte_mempool *) te->data;
-		if (strncmp(name, mp->name, RTE_MEMPOOL_NAMESIZE) == 0)
-			break;
-	}
 
+	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 	rte_rwlock_read_unlock(RTE_EAL_MEMPOOL_RWLOCK);
 
 	if (te == NULL) {
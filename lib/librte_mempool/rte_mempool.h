@@ -108,6 +108,9 @@ struct rte_mempool_cache {
 	uint32_t size;	      /**< Size of the cache */
 	uint32_t flushthresh; /**< Threshold before we flush excess elements */
 	uint32_t len;	      /**< Current cache count */
+	uint32_t keep;	      /**< Cache count left after a flush */
+	uint32_t fill;	      /**< Cache count left after a refill */
+	int32_t balance;      /**< Adaptive mode: recent flushes - refills */
 	/*
 	 * Cache is allocated to this size to allow it to overflow in certain
 	 * cases to avoid needless emptying of cache.
@@ -252,6 +255,8 @@ struct rte_mempool {
 	struct rte_mempool_objhdr_list elt_list; /**< List of objects in pool */
 	uint32_t nb_mem_chunks;          /**< Number of memory chunks */
 	struct rte_mempool_memhdr_list mem_list; /**< List of memory chunks */
+	struct rte_ring *handoff;
+	/**< Ring passing objects from producer to consumer lcore caches. */
 
 #ifdef RTE_LIBRTE_MEMPOOL_DEBUG
 	/** Per-lcore statistics. */
@@ -265,6 +270,14 @@ struct rte_mempool {
 #define MEMPOOL_F_SC_GET         0x0008 /**< Default get is "single-consumer".*/
 #define MEMPOOL_F_POOL_CREATED   0x0010 /**< Internal: pool is created. */
 #define MEMPOOL_F_NO_PHYS_CONTIG 0x0020 /**< Don't need physically contiguous objs. */
+#define MEMPOOL_F_CACHE_ADAPTIVE 0x0040 /**< Adapt caches to get/put imbalance. */
+#define MEMPOOL_F_CACHE_HANDOFF  0x0080 /**< Hand objects off between caches. */
+
+/**
+ * Flags for rte_mempool_populate_anon_compact().
+ */
+#define MEMPOOL_ANON_F_THP       0x0001 /**< Advise transparent huge pages. */
+#define MEMPOOL_ANON_F_LOCK      0x0002 /**< Lock the memory in RAM. */
 
 /**
  * @internal When debug is enabled, store some statistics.
@@ -657,6 +670,15 @@ typedef void (rte_mempool_ctor_t)(struct rte_mempool *, void *);
  *     "single-consumer". Otherwise, it is "multi-consumers".
  *   - MEMPOOL_F_NO_PHYS_CONTIG: If set, allocated objects won't
  *     necessarily be contiguous in physical memory.
+ *   - MEMPOOL_F_CACHE_ADAPTIVE: If set, each cache used with the pool
+ *     tracks whether its lcore mostly puts or mostly gets objects. Caches
+ *     of lcores that mostly put flush more objects at once, caches of
+ *     lcores that mostly get are refilled with more objects at once.
+ *   - MEMPOOL_F_CACHE_HANDOFF: Implies MEMPOOL_F_CACHE_ADAPTIVE. Objects
+ *     flushed by lcores that mostly put are stored in a ring from which
+ *     lcores that mostly get refill first, without going through the
+ *     mempool handler. This is useful when the handler is more expensive
+ *     than a ring, e.g. stack or hardware handlers.
  * @return
  *   The pointer to the new allocated mempool, on success. NULL on error
  *   with rte_errno set appropriately. Possible rte_errno values include:
@@ -913,6 +935,34 @@ int rte_mempool_populate_default(struct rte_mempool *mp);
  */
 int rte_mempool_populate_anon(struct rte_mempool *mp);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add memory from a compact anonymous mapping for objects in the pool
+ *
+ * This function is meant for deployments without hugepages, where the
+ * objects have no IO address. A single anonymous memory area is mapped and
+ * the objects are placed back to back in it, regardless of page
+ * boundaries, so no memory is lost to padding. The physical address of all
+ * objects is RTE_BAD_PHYS_ADDR and the pool is flagged with
+ * MEMPOOL_F_NO_PHYS_CONTIG.
+ *
+ * @param mp
+ *   A pointer to the mempool structure. It must not be populated.
+ * @param flags
+ *   An OR of the following flags:
+ *   - MEMPOOL_ANON_F_THP: align the area on 2MB and advise the kernel to
+ *     back it with transparent huge pages, to reduce TLB misses.
+ *   - MEMPOOL_ANON_F_LOCK: lock the area in memory.
+ * @return
+ *   The number of objects added on success.
+ *   On error, the chunk is not added in the memory list of the
+ *   mempool and a negative errno is returned.
+ */
+int rte_mempool_populate_anon_compact(struct rte_mempool *mp,
+	unsigned int flags);
+
 /**
  * Call a function for each mempool element
  *
@@ -1023,6 +1073,57 @@ rte_mempool_default_cache(struct rte_mempool *mp, unsigned lcore_id)
 	return &mp->local_cache[lcore_id];
 }
 
+/**
+ * @internal Flush the excess objects of a cache of a pool created with
+ * MEMPOOL_F_CACHE_ADAPTIVE, and adapt the cache to its lcore usage.
+ *
+ * @param mp
+ *   A pointer to the mempool structure.
+ * @param cache
+ *   A pointer to a mempool cache structure, above its flush threshold.
+ */
+void
+rte_mempool_cache_adaptive_flush(struct rte_mempool *mp,
+	struct rte_mempool_cache *cache);
+
+/**
+ * @internal Refill a cache of a pool created with MEMPOOL_F_CACHE_ADAPTIVE
+ * so that it holds at least n objects, and adapt the cache to its lcore
+ * usage.
+ *
+ * @param mp
+ *   A pointer to the mempool structure.
+ * @param cache
+ *   A pointer to a mempool cache structure.
+ * @param n
+ *   The number of objects that must be available in the cache.
+ * @return
+ *   - 0: Success.
+ *   - <0: Not enough objects, the cache is unchanged.
+ */
+int
+rte_mempool_cache_adaptive_refill(struct rte_mempool *mp,
+	struct rte_mempool_cache *cache, unsigned int n);
+
+/**
+ * @internal Get objects from the handoff ring of a pool created with
+ * MEMPOOL_F_CACHE_HANDOFF, completed from the mempool handler, when the
+ * handler alone does not have enough objects.
+ *
+ * @param mp
+ *   A pointer to the mempool structure.
+ * @param obj_table
+ *   A pointer to a table of void * pointers (objects).
+ * @param n
+ *   The number of objects to get.
+ * @return
+ *   - 0: Success.
+ *   - <0: Not enough objects, none is taken.
+ */
+int
+rte_mempool_handoff_dequeue(struct rte_mempool *mp, void **obj_table,
+	unsigned int n);
+
 /**
  * @internal Put several objects back in the mempool; used internally.
  * @param mp
@@ -1066,9 +1167,13 @@ __mempool_generic_put(struct rte_mempool *mp, void * const *obj_table,
 	cache->len += n;
 
 	if (cache->len >= cache->flushthresh) {
-		rte_mempool_ops_enqueue_bulk(mp, &cache->objs[cache->size],
-				cache->len - cache->size);
-		cache->len = cache->size;
+		if (mp->flags & MEMPOOL_F_CACHE_ADAPTIVE) {
+			rte_mempool_cache_adaptive_flush(mp, cache);
+			return;
+		}
+		rte_mempool_ops_enqueue_bulk(mp, &cache->objs[cache->keep],
+				cache->len - cache->keep);
+		cache->len = cache->keep;
 	}
 
 	return;
@@ -1182,9 +1287,12 @@ __mempool_generic_get(struct rte_mempool *mp, void **obj_table,
 	cache_objs = cache->objs;
 
 	/* Can this be satisfied from the cache? */
-	if (cache->len < n) {
+	if (cache->len < n && (mp->flags & MEMPOOL_F_CACHE_ADAPTIVE)) {
+		if (rte_mempool_cache_adaptive_refill(mp, cache, n) < 0)
+			goto ring_dequeue;
+	} else if (cache->len < n) {
 		/* No. Backfill the cache first, and then fill from it */
-		uint32_t req = n + (cache->size - cache->len);
+		uint32_t req = n + (cache->fill - cache->len);
 
 		/* How many do we require i.e. number to fill the cache + the request */
 		ret = rte_mempool_ops_dequeue_bulk(mp,
@@ -1217,6 +1325,10 @@ __mempool_generic_get(struct rte_mempool *mp, void **obj_table,
 	/* get remaining objects from ring */
 	ret = rte_mempool_ops_dequeue_bulk(mp, obj_table, n);
 
+	/* objects flushed by producers may still wait in the handoff ring */
+	if (unlikely(ret < 0 && mp->handoff != NULL))
+		ret = rte_mempool_handoff_dequeue(mp, obj_table, n);
+
 	if (ret < 0)
 		__MEMPOOL_STAT_ADD(mp, get_fail, n);
 	else
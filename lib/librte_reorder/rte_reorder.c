@@ -151,11 +151,10 @@ rte_reorder_create(const char *name, unsigned socket_id, unsigned int size)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* guarantee there's no existing */
-	TAILQ_FOREACH(te, reorder_list, next) {
+	te = rte_tailq_name_lookup(rte_reorder_tailq.head, name,
+		RTE_REORDER_NAMESIZE);
+	if (te != NULL)
 		b = (struct rte_reorder_buffer *) te->data;
-		if (strncmp(name, b->name, RTE_REORDER_NAMESIZE) == 0)
-			break;
-	}
 	if (te != NULL)
 		goto exit;
 
@@ -178,6 +177,7 @@ rte_reorder_create(const char *name, unsigned socket_id, unsigned int size)
 		rte_reorder_init(b, bufsize, name, size);
 		te->data = (void *)b;
 		TAILQ_INSERT_TAIL(reorder_list, te, next);
+		rte_tailq_name_add(rte_reorder_tailq.head, te, b->name);
 	}
 
 exit:
@@ -225,15 +225,16 @@ rte_reorder_free(struct rte_reorder_buffer *b)
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
 	/* find our tailq entry */
-	TAILQ_FOREACH(te, reorder_list, next) {
-		if (te->data == (void *) b)
-			break;
-	}
+	te = rte_tailq_name_lookup(rte_reorder_tailq.head, b->name,
+		RTE_REORDER_NAMESIZE);
+	if (te != NULL && te->data != (void *) b)
+		te = NULL;
 	if (te == NULL) {
 		rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 		return;
 	}
 
+	rte_tailq_name_del(te);
 	TAILQ_REMOVE(reorder_list, te, next);
 
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
@@ -249,16 +250,12 @@ rte_reorder_find_existing(const char *name)
 {
 	struct rte_reorder_buffer *b = NULL;
 	struct rte_tailq_entry *te;
-	struct rte_reorder_list *reorder_list;
-
-	reorder_list = RTE_TAILQ_CAST(rte_reorder_tailq.head, rte_reorder_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
-	TAILQ_FOREACH(te, reorder_list, next) {
+	te = rte_tailq_name_lookup(rte_reorder_tailq.head, name,
+		RTE_REORDER_NAMESIZE);
+	if (te != NULL)
 		b = (struct rte_reorder_buffer *) te->data;
-		if (strncmp(name, b->name, RTE_REORDER_NAMESIZE) == 0)
-			break;
-	}
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	if (te == NULL) {
@@ -220,6 +220,7 @@ rte_ring_create(const char *name, unsigned count, int socket_id,
 		r->memzone = mz;
 
 		TAILQ_INSERT_TAIL(ring_list, te, next);
+		rte_tailq_name_add(rte_ring_tailq.head, te, r->name);
 	} else {
 		r = NULL;
 		RTE_LOG(ERR, RING, "Cannot reserve memory\n");
@@ -249,27 +250,30 @@ rte_ring_free(struct rte_ring *r)
 		return;
 	}
 
-	if (rte_memzone_free(r->memzone) != 0) {
-		RTE_LOG(ERR, RING, "Cannot free memory\n");
-		return;
-	}
-
 	ring_list = RTE_TAILQ_CAST(rte_ring_tailq.head, rte_ring_list);
 	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
 
-	/* find out tailq entry */
-	TAILQ_FOREACH(te, ring_list, next) {
-		if (te->data == (void *) r)
-			break;
+	/* unlink the tailq entry while the name is still in the memzone */
+	te = rte_tailq_name_lookup(rte_ring_tailq.head, r->name,
+		RTE_RING_NAMESIZE);
+	if (te != NULL && te->data != (void *) r)
+		te = NULL;
+	if (te != NULL) {
+		rte_tailq_name_del(te);
+		TAILQ_REMOVE(ring_list, te, next);
 	}
 
-	if (te == NULL) {
+	if (rte_memzone_free(r->memzone) != 0) {
+		/* the ring is still there, keep it registered */
+		if (te != NULL) {
+			TAILQ_INSERT_TAIL(ring_list, te, next);
+			rte_tailq_name_add(rte_ring_tailq.head, te, r->name);
+		}
 		rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
+		RTE_LOG(ERR, RING, "Cannot free memory\n");
 		return;
 	}
 
-	TAILQ_REMOVE(ring_list, te, next);
-
 	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
 
 	rte_free(te);
@@ -315,17 +319,13 @@ rte_ring_lookup(const char *name)
 {
 	struct rte_tailq_entry *te;
 	struct rte_ring *r = NULL;
-	struct rte_ring_list *ring_list;
-
-	ring_list = RTE_TAILQ_CAST(rte_ring_tailq.head, rte_ring_list);
 
 	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
 
-	TAILQ_FOREACH(te, ring_list, next) {
+	te = rte_tailq_name_lookup(rte_ring_tailq.head, name,
+		RTE_RING_NAMESIZE);
+	if (te != NULL)
 		r = (struct rte_ring *) te->data;
-		if (strncmp(name, r->name, RTE_RING_NAMESIZE) == 0)
-			break;
-	}
 
 	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
 
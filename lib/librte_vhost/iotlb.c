@@ -0,0 +1,303 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <rte_malloc.h>
+#include <rte_random.h>
+
+#include "iotlb.h"
+#include "vhost.h"
+
+int
+vhost_user_iotlb_init(struct vhost_virtqueue *vq)
+{
+	if (vq->iotlb != NULL) {
+		vhost_user_iotlb_flush_all(vq);
+		return 0;
+	}
+
+	vq->iotlb = rte_zmalloc(NULL, sizeof(struct vhost_iotlb),
+				RTE_CACHE_LINE_SIZE);
+	if (vq->iotlb == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"failed to allocate memory for IOTLB cache.\n");
+		return -1;
+	}
+	rte_spinlock_init(&vq->iotlb->pending_lock);
+
+	return 0;
+}
+
+void
+vhost_user_iotlb_free(struct vhost_virtqueue *vq)
+{
+	rte_free(vq->iotlb);
+	vq->iotlb = NULL;
+}
+
+/*
+ * Returns the index of the first entry starting above iova, the entry
+ * that may hold iova being the one right before.
+ */
+static __rte_always_inline uint32_t
+iotlb_upper_bound(struct vhost_iotlb *iotlb, uint64_t iova)
+{
+	uint32_t lo = 0, hi = iotlb->nr_entries, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (iotlb->entries[mid].iova <= iova)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static __rte_always_inline int
+iotlb_entry_covers(struct vhost_iotlb_entry *e, uint64_t iova)
+{
+	return iova >= e->iova && iova - e->iova < e->size;
+}
+
+void
+vhost_user_iotlb_cache_insert(struct vhost_virtqueue *vq, uint64_t iova,
+		uint64_t uaddr, uint64_t size, uint8_t perm)
+{
+	struct vhost_iotlb *iotlb = vq->iotlb;
+	struct vhost_iotlb_entry *e;
+	uint32_t pos, victim;
+
+	if (iotlb == NULL || size == 0)
+		return;
+
+	vhost_user_iotlb_wr_lock(vq);
+
+	pos = iotlb_upper_bound(iotlb, iova);
+	if (pos > 0 && iotlb->entries[pos - 1].iova == iova) {
+		/* the master updated a mapping we already have */
+		pos--;
+		goto set;
+	}
+
+	/* no room left: drop a random entry, the master can resend it */
+	if (iotlb->nr_entries == IOTLB_CACHE_SIZE) {
+		victim = rte_rand() % IOTLB_CACHE_SIZE;
+		memmove(&iotlb->entries[victim], &iotlb->entries[victim + 1],
+			(IOTLB_CACHE_SIZE - victim - 1) * sizeof(*e));
+		iotlb->nr_entries--;
+		if (victim < pos)
+			pos--;
+	}
+
+	memmove(&iotlb->entries[pos + 1], &iotlb->entries[pos],
+		(iotlb->nr_entries - pos) * sizeof(*e));
+	iotlb->nr_entries++;
+
+set:
+	e = &iotlb->entries[pos];
+	e->iova = iova;
+	e->uaddr = uaddr;
+	e->size = size;
+	e->perm = perm;
+
+	vhost_user_iotlb_wr_unlock(vq);
+
+	vhost_user_iotlb_pending_remove(vq, iova, size, perm);
+}
+
+void
+vhost_user_iotlb_cache_remove(struct vhost_virtqueue *vq,
+		uint64_t iova, uint64_t size)
+{
+	struct vhost_iotlb *iotlb = vq->iotlb;
+	struct vhost_iotlb_entry *e;
+	uint32_t i, n;
+
+	if (iotlb == NULL || size == 0)
+		return;
+
+	vhost_user_iotlb_wr_lock(vq);
+
+	for (i = 0, n = 0; i < iotlb->nr_entries; i++) {
+		e = &iotlb->entries[i];
+		if (e->iova < iova + size && iova < e->iova + e->size)
+			continue;
+		if (n != i)
+			iotlb->entries[n] = *e;
+		n++;
+	}
+	iotlb->nr_entries = n;
+
+	vhost_user_iotlb_wr_unlock(vq);
+}
+
+/*
+ * Translates iova to a vhost virtual address, for an access of *size
+ * bytes. Mappings following each other on both sides are walked, and
+ * *size is cut down to what they cover. Returns 0 on a miss.
+ *
+ * The caller must hold the IOTLB lock.
+ */
+uint64_t
+vhost_user_iotlb_cache_find(struct vhost_virtqueue *vq, uint64_t iova,
+		uint64_t *size, uint8_t perm)
+{
+	struct vhost_iotlb *iotlb = vq->iotlb;
+	struct vhost_iotlb_entry *e;
+	uint64_t vva, mapped;
+	uint32_t i, nr;
+
+	if (unlikely(iotlb == NULL))
+		return 0;
+
+	nr = iotlb->nr_entries;
+	i = iotlb_upper_bound(iotlb, iova);
+	if (i == 0 || !iotlb_entry_covers(&iotlb->entries[i - 1], iova))
+		return 0;
+
+	e = &iotlb->entries[--i];
+	if (unlikely((e->perm & perm) != perm))
+		return 0;
+
+	vva = e->uaddr + iova - e->iova;
+	mapped = e->iova + e->size - iova;
+	while (mapped < *size && ++i < nr) {
+		struct vhost_iotlb_entry *next = &iotlb->entries[i];
+
+		if (next->iova != e->iova + e->size ||
+		    next->uaddr != e->uaddr + e->size ||
+		    (next->perm & perm) != perm)
+			break;
+		mapped += next->size;
+		e = next;
+	}
+
+	if (mapped < *size)
+		*size = mapped;
+
+	return vva;
+}
+
+void
+vhost_user_iotlb_flush_all(struct vhost_virtqueue *vq)
+{
+	struct vhost_iotlb *iotlb = vq->iotlb;
+
+	if (iotlb == NULL)
+		return;
+
+	vhost_user_iotlb_wr_lock(vq);
+	iotlb->nr_entries = 0;
+	vhost_user_iotlb_wr_unlock(vq);
+
+	rte_spinlock_lock(&iotlb->pending_lock);
+	iotlb->nr_pending = 0;
+	rte_spinlock_unlock(&iotlb->pending_lock);
+}
+
+/*
+ * Tells whether a miss was already sent for this address, so that a
+ * queue polling on an unmapped buffer does not flood the master.
+ */
+int
+vhost_user_iotlb_pending_miss(struct vhost_virtqueue *vq, uint64_t iova,
+		uint8_t perm)
+{
+	struct vhost_iotlb *iotlb = vq->iotlb;
+	uint32_t i;
+	int found = 0;
+
+	if (iotlb == NULL)
+		return 0;
+
+	rte_spinlock_lock(&iotlb->pending_lock);
+	for (i = 0; i < iotlb->nr_pending; i++) {
+		if (iotlb->pending[i].iova == iova &&
+		    iotlb->pending[i].perm == perm) {
+			found = 1;
+			break;
+		}
+	}
+	rte_spinlock_unlock(&iotlb->pending_lock);
+
+	return found;
+}
+
+void
+vhost_user_iotlb_pending_insert(struct vhost_virtqueue *vq,
+		uint64_t iova, uint8_t perm)
+{
+	struct vhost_iotlb *iotlb = vq->iotlb;
+	uint32_t i;
+
+	if (iotlb == NULL)
+		return;
+
+	rte_spinlock_lock(&iotlb->pending_lock);
+	if (iotlb->nr_pending < IOTLB_PENDING_SIZE)
+		i = iotlb->nr_pending++;
+	else
+		i = rte_rand() % IOTLB_PENDING_SIZE;
+	iotlb->pending[i].iova = iova;
+	iotlb->pending[i].perm = perm;
+	rte_spinlock_unlock(&iotlb->pending_lock);
+}
+
+/* Forgets the misses answered by a new mapping */
+void
+vhost_user_iotlb_pending_remove(struct vhost_virtqueue *vq,
+		uint64_t iova, uint64_t size, uint8_t perm)
+{
+	struct vhost_iotlb *iotlb = vq->iotlb;
+	struct vhost_iotlb_pending *p;
+	uint32_t i, n;
+
+	if (iotlb == NULL)
+		return;
+
+	rte_spinlock_lock(&iotlb->pending_lock);
+	for (i = 0, n = 0; i < iotlb->nr_pending; i++) {
+		p = &iotlb->pending[i];
+		if (p->iova >= iova && p->iova - iova < size &&
+		    (p->perm & perm) == p->perm)
+			continue;
+		if (n != i)
+			iotlb->pending[n] = *p;
+		n++;
+	}
+	iotlb->nr_pending = n;
+	rte_spinlock_unlock(&iotlb->pending_lock);
+}
@@ -56,6 +56,7 @@ extern "C" {
 #define RTE_VHOST_USER_CLIENT		(1ULL << 0)
 #define RTE_VHOST_USER_NO_RECONNECT	(1ULL << 1)
 #define RTE_VHOST_USER_DEQUEUE_ZERO_COPY	(1ULL << 2)
+#define RTE_VHOST_USER_IOMMU_SUPPORT	(1ULL << 3)
 
 /**
  * Information relating to memory regions including offsets to
@@ -183,6 +184,32 @@ void rte_vhost_log_used_vring(int vid, uint16_t vring_idx,
 
 int rte_vhost_enable_guest_notification(int vid, uint16_t queue_id, int enable);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Coalesce the notifications sent to the guest for a split vring: the
+ * call is delayed until max_pkts used entries are pending, or the first
+ * of them has waited for max_usecs. Pending calls are made by the next
+ * enqueue or dequeue burst on the vring, so the application has to keep
+ * polling it. The guest may still suppress the call, with
+ * VRING_AVAIL_F_NO_INTERRUPT or the used event index.
+ *
+ * @param vid
+ *  vhost device ID
+ * @param vring_idx
+ *  vring index
+ * @param max_pkts
+ *  used entries after which the guest is called, 0 for no limit
+ * @param max_usecs
+ *  time after which pending entries are notified, 0 to call the guest
+ *  after each burst (the default)
+ * @return
+ *  0 on success, -1 on failure
+ */
+int rte_vhost_vring_set_coalescing(int vid, uint16_t vring_idx,
+		uint16_t max_pkts, uint32_t max_usecs);
+
 /**
  * Register vhost driver. path could be different for multiple
  * instance support.
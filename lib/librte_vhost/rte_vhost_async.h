@@ -0,0 +1,250 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_VHOST_ASYNC_H_
+#define _RTE_VHOST_ASYNC_H_
+
+/**
+ * @file
+ * Asynchronous vhost enqueue
+ *
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Large data copies of the enqueue path are handed to a copy engine
+ * instead of being done by the calling core. The used ring is updated
+ * later, in order, when the copies of a packet are reported complete.
+ * Any engine providing rte_vhost_async_channel_ops can be plugged in; a
+ * software engine running on spare lcores is provided.
+ */
+
+#include <stdint.h>
+
+#include <rte_mbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A copy job handed to a copy engine.
+ */
+struct rte_vhost_async_copy {
+	void *src;    /**< Source address. */
+	void *dst;    /**< Destination address. */
+	uint32_t len; /**< Number of bytes to copy. */
+};
+
+/**
+ * Operations of a copy engine bound to a virtqueue.
+ */
+struct rte_vhost_async_channel_ops {
+	/**
+	 * Submit copy jobs.
+	 *
+	 * @param ctx
+	 *  Engine context given at registration
+	 * @param copies
+	 *  Array of jobs
+	 * @param count
+	 *  Number of jobs in the array
+	 * @return
+	 *  Number of jobs accepted, from the start of the array
+	 */
+	uint16_t (*submit)(void *ctx, const struct rte_vhost_async_copy *copies,
+			   uint16_t count);
+
+	/**
+	 * Report completed jobs. Jobs must be reported in submission order.
+	 *
+	 * @param ctx
+	 *  Engine context given at registration
+	 * @param max
+	 *  Maximum number of jobs to report
+	 * @return
+	 *  Number of jobs completed since the previous call
+	 */
+	uint16_t (*completed)(void *ctx, uint16_t max);
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Bind a copy engine to an Rx virtqueue of a vhost device. Only the
+ * asynchronous enqueue functions may be used on the queue afterwards.
+ * The virtqueue must use the split ring layout with mergeable Rx buffers.
+ *
+ * @param vid
+ *  vhost device ID
+ * @param queue_id
+ *  virtio queue index in mq case
+ * @param threshold
+ *  Copies of this many bytes or more go to the engine, smaller ones are
+ *  done by the calling core
+ * @param ops
+ *  Copy engine operations
+ * @param ctx
+ *  Engine context, passed back to the operations
+ * @return
+ *  0 on success, -1 on failure
+ */
+int rte_vhost_async_channel_register(int vid, uint16_t queue_id,
+		uint32_t threshold, const struct rte_vhost_async_channel_ops *ops,
+		void *ctx);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Unbind the copy engine of a virtqueue. Fails while packets are in flight.
+ *
+ * @param vid
+ *  vhost device ID
+ * @param queue_id
+ *  virtio queue index in mq case
+ * @return
+ *  0 on success, -EBUSY while packets are in flight, -1 on other failures
+ */
+int rte_vhost_async_channel_unregister(int vid, uint16_t queue_id);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Start enqueuing packets to a virtqueue bound to a copy engine. Accepted
+ * packets belong to vhost until rte_vhost_poll_enqueue_completed() returns
+ * them.
+ *
+ * @param vid
+ *  vhost device ID
+ * @param queue_id
+ *  virtio queue index in mq case
+ * @param pkts
+ *  array of packets to enqueue
+ * @param count
+ *  number of packets in the array
+ * @return
+ *  number of packets accepted, from the start of the array
+ */
+uint16_t rte_vhost_submit_enqueue_burst(int vid, uint16_t queue_id,
+		struct rte_mbuf **pkts, uint16_t count);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Complete enqueued packets whose copies are done: publish them in the
+ * used ring, notify the guest, and hand the mbufs back to the caller,
+ * in submission order.
+ *
+ * @param vid
+ *  vhost device ID
+ * @param queue_id
+ *  virtio queue index in mq case
+ * @param pkts
+ *  array to receive the completed packets, to be freed by the caller
+ * @param count
+ *  size of the array
+ * @return
+ *  number of packets completed
+ */
+uint16_t rte_vhost_poll_enqueue_completed(int vid, uint16_t queue_id,
+		struct rte_mbuf **pkts, uint16_t count);
+
+/** Software copy engine, served by lcores running its worker loop. */
+struct rte_vhost_async_sw;
+
+/** Operations of the software copy engine. */
+extern const struct rte_vhost_async_channel_ops rte_vhost_async_sw_ops;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a software copy engine. Its submit side must be used by a single
+ * thread, but any number of lcores may run its worker loop.
+ *
+ * @param nb_jobs
+ *  Number of jobs in flight the engine can hold, a power of 2
+ * @param socket_id
+ *  Socket to allocate the engine on
+ * @return
+ *  The engine, to use as context with rte_vhost_async_sw_ops,
+ *  or NULL on error
+ */
+struct rte_vhost_async_sw *rte_vhost_async_sw_create(uint32_t nb_jobs,
+		int socket_id);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Worker loop of a software copy engine, to launch on spare lcores with
+ * rte_eal_remote_launch(). It returns once rte_vhost_async_sw_stop() is
+ * called.
+ *
+ * @param arg
+ *  The engine
+ * @return
+ *  0
+ */
+int rte_vhost_async_sw_worker(void *arg);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Make the worker loops of a software copy engine return.
+ *
+ * @param sw
+ *  The engine
+ */
+void rte_vhost_async_sw_stop(struct rte_vhost_async_sw *sw);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Free a software copy engine whose workers have returned.
+ *
+ * @param sw
+ *  The engine
+ */
+void rte_vhost_async_sw_free(struct rte_vhost_async_sw *sw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_VHOST_ASYNC_H_ */
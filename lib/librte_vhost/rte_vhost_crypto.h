@@ -0,0 +1,200 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RTE_VHOST_CRYPTO_H_
+#define _RTE_VHOST_CRYPTO_H_
+
+/**
+ * @file
+ * vhost-user crypto backend
+ *
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Serves the data queues of a virtio-crypto device with a cryptodev.
+ * Sessions are created by the frontend through vhost-user messages; the
+ * symmetric requests of the guest are turned into rte_crypto_ops, which
+ * the application enqueues to the cryptodev, then hands back once
+ * processed so that their results are written to the guest.
+ */
+
+#include <stdint.h>
+
+#include <rte_cryptodev.h>
+#include <rte_mempool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Features to offer on a vhost-user socket serving a crypto device. */
+#define VIRTIO_CRYPTO_FEATURES ((1ULL << 32) /* VIRTIO_F_VERSION_1 */ | \
+				(1ULL << 30) /* VHOST_USER_F_PROTOCOL_FEATURES */)
+
+/** Maximum IV length of a request. */
+#define VHOST_CRYPTO_MAX_IV_LEN		32
+/** Maximum digest length of a request. */
+#define VHOST_CRYPTO_MAX_DIGEST_LEN	64
+
+/**
+ * Offset of the IV in the crypto ops handed to
+ * rte_vhost_crypto_fetch_requests().
+ */
+#define VHOST_CRYPTO_IV_OFFSET	(sizeof(struct rte_crypto_op) + \
+				 sizeof(struct rte_crypto_sym_op))
+
+/**
+ * Private size, at least, of the crypto op pool used with
+ * rte_vhost_crypto_fetch_requests(): it holds the IV and the digest.
+ */
+#define VHOST_CRYPTO_OP_PRIV_SIZE	(VHOST_CRYPTO_MAX_IV_LEN + \
+					 VHOST_CRYPTO_MAX_DIGEST_LEN)
+
+/** Options of rte_vhost_crypto_set_zero_copy(). */
+enum rte_vhost_crypto_zero_copy {
+	RTE_VHOST_CRYPTO_ZERO_COPY_DISABLE = 0,
+	RTE_VHOST_CRYPTO_ZERO_COPY_ENABLE = 1,
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Serve a vhost device as a crypto device, normally called from the
+ * new_device callback. The socket must have been given the features of
+ * VIRTIO_CRYPTO_FEATURES with rte_vhost_driver_set_features().
+ *
+ * @param vid
+ *  vhost device ID
+ * @param cryptodev_id
+ *  Configured and started cryptodev processing the requests
+ * @param sess_pool
+ *  Mempool the cryptodev sessions are allocated from
+ * @param socket_id
+ *  NUMA socket of the allocations
+ * @return
+ *  0 on success, -1 on failure
+ */
+int
+rte_vhost_crypto_create(int vid, uint8_t cryptodev_id,
+		struct rte_mempool *sess_pool, int socket_id);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Stop serving a vhost device as a crypto device and free its sessions,
+ * normally called from the destroy_device callback. No request of the
+ * device may be in flight.
+ *
+ * @param vid
+ *  vhost device ID
+ * @return
+ *  0 on success, -1 on failure
+ */
+int
+rte_vhost_crypto_free(int vid);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Let the cryptodev work on guest memory directly when a request allows
+ * it: its destination must fit a single descriptor whose host physical
+ * address is known, which requires the socket to be registered with
+ * RTE_VHOST_USER_DEQUEUE_ZERO_COPY. Other requests are copied through
+ * mbufs. Disabled by default.
+ *
+ * @param vid
+ *  vhost device ID
+ * @param option
+ *  RTE_VHOST_CRYPTO_ZERO_COPY_ENABLE or RTE_VHOST_CRYPTO_ZERO_COPY_DISABLE
+ * @return
+ *  0 on success, -1 on failure
+ */
+int
+rte_vhost_crypto_set_zero_copy(int vid, enum rte_vhost_crypto_zero_copy option);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Turn the requests available on a data queue into crypto ops. The ops
+ * are allocated by the caller from a pool with a private size of at
+ * least VHOST_CRYPTO_OP_PRIV_SIZE, and the used ones are returned with a
+ * session and source mbuf set, ready to be enqueued to the cryptodev.
+ * Malformed requests are completed with an error status right away.
+ *
+ * A queue must be served by one thread at a time, calling this function
+ * and rte_vhost_crypto_finalize_requests() for its ops.
+ *
+ * @param vid
+ *  vhost device ID
+ * @param qid
+ *  Data queue index
+ * @param ops
+ *  Crypto ops to fill
+ * @param nb_ops
+ *  Number of ops in the array
+ * @return
+ *  Number of ops filled, from the start of the array
+ */
+uint16_t
+rte_vhost_crypto_fetch_requests(int vid, uint32_t qid,
+		struct rte_crypto_op **ops, uint16_t nb_ops);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Write the results of processed crypto ops back to the guest, complete
+ * their requests and notify the guests that asked for it. The ops may
+ * come from several devices and queues; they are not freed. Requests
+ * whose queue was reset or disabled meanwhile are dropped.
+ *
+ * @param ops
+ *  Crypto ops dequeued from the cryptodev
+ * @param nb_ops
+ *  Number of ops in the array
+ * @return
+ *  Number of ops finalized
+ */
+uint16_t
+rte_vhost_crypto_finalize_requests(struct rte_crypto_op **ops,
+		uint16_t nb_ops);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_VHOST_CRYPTO_H_ */
@@ -33,6 +33,7 @@
 
 #include <linux/vhost.h>
 #include <linux/virtio_net.h>
+#include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -48,7 +49,9 @@
 #include <rte_malloc.h>
 #include <rte_vhost.h>
 
+#include "iotlb.h"
 #include "vhost.h"
+#include "vhost_user.h"
 
 struct virtio_net *vhost_devices[MAX_VHOST_DEVICE];
 
@@ -65,6 +68,225 @@ get_device(int vid)
 	return dev;
 }
 
+/*
+ * Translate an IOVA through the IOTLB cache. On a miss the master is
+ * asked for the mapping, but we do not wait for the answer: the caller
+ * gives up on the buffer and retries on a later burst, so that the other
+ * queues keep running meanwhile. The caller holds the IOTLB lock.
+ */
+uint64_t
+__vhost_iova_to_vva(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		    uint64_t iova, uint64_t *size, uint8_t perm)
+{
+	uint64_t vva;
+
+	if (unlikely(*size == 0))
+		return 0;
+
+	vva = vhost_user_iotlb_cache_find(vq, iova, size, perm);
+	if (likely(vva != 0))
+		return vva;
+
+	if (!vhost_user_iotlb_pending_miss(vq, iova, perm)) {
+		vhost_user_iotlb_pending_insert(vq, iova, perm);
+		if (vhost_user_iotlb_miss(dev, iova, perm) < 0) {
+			RTE_LOG(ERR, VHOST_CONFIG,
+				"(%d) IOTLB miss request failed for IOVA 0x%"
+				PRIx64 "\n", dev->vid, iova);
+			vhost_user_iotlb_pending_remove(vq, iova, 1, perm);
+		}
+	}
+
+	return 0;
+}
+
+/* Converts a vhost virtual address back to a guest physical address. */
+uint64_t
+hva_to_gpa(struct virtio_net *dev, uint64_t vva, uint64_t len)
+{
+	struct rte_vhost_mem_region *reg;
+	uint32_t i;
+
+	if (dev->mem == NULL)
+		return 0;
+
+	for (i = 0; i < dev->mem->nregions; i++) {
+		reg = &dev->mem->regions[i];
+
+		if (vva >= reg->host_user_addr &&
+		    vva + len <= reg->host_user_addr + reg->size) {
+			return vva - reg->host_user_addr +
+			       reg->guest_phys_addr;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * The dirty log is indexed by guest physical address, while the guest
+ * gives us IOVAs: go through our own address space to find the pages.
+ */
+void
+__vhost_log_cache_write_iova(struct virtio_net *dev, struct vhost_virtqueue *vq,
+			     uint64_t iova, uint64_t len)
+{
+	uint64_t hva, gpa, map_len;
+
+	while (len != 0) {
+		map_len = len;
+		hva = vhost_user_iotlb_cache_find(vq, iova, &map_len,
+						  VHOST_ACCESS_WO);
+		if (hva == 0)
+			return;
+
+		gpa = hva_to_gpa(dev, hva, map_len);
+		if (gpa != 0)
+			vhost_log_cache_write(dev, vq, gpa, map_len);
+
+		iova += map_len;
+		len -= map_len;
+	}
+}
+
+/*
+ * The rings must be contiguous in our address space. When only their
+ * start is mapped, ask for the rest: it may just not be cached yet.
+ */
+static uint64_t
+ring_addr_to_vva(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		 uint64_t ra, uint64_t size, uint8_t perm)
+{
+	uint64_t vva, len = size;
+
+	vva = vhost_iova_to_vva(dev, vq, ra, &len, perm);
+	if (vva == 0 || len == size)
+		return vva;
+
+	size -= len;
+	vhost_iova_to_vva(dev, vq, ra + len, &size, perm);
+
+	return 0;
+}
+
+static int
+vring_translate_split(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	struct vhost_vring_addr *addr = &vq->ring_addrs;
+	uint64_t size;
+
+	size = sizeof(struct vring_desc) * vq->size;
+	vq->desc = (struct vring_desc *)(uintptr_t)ring_addr_to_vva(dev, vq,
+			addr->desc_user_addr, size, VHOST_ACCESS_RO);
+	if (vq->desc == NULL)
+		return -1;
+
+	size = sizeof(struct vring_avail) + sizeof(uint16_t) * (vq->size + 1);
+	vq->avail = (struct vring_avail *)(uintptr_t)ring_addr_to_vva(dev, vq,
+			addr->avail_user_addr, size, VHOST_ACCESS_RO);
+	if (vq->avail == NULL)
+		return -1;
+
+	size = sizeof(struct vring_used) +
+		sizeof(struct vring_used_elem) * vq->size + sizeof(uint16_t);
+	vq->used = (struct vring_used *)(uintptr_t)ring_addr_to_vva(dev, vq,
+			addr->used_user_addr, size, VHOST_ACCESS_RW);
+	if (vq->used == NULL)
+		return -1;
+
+	if (vq->last_used_idx != vq->used->idx) {
+		RTE_LOG(WARNING, VHOST_CONFIG,
+			"last_used_idx (%u) and vq->used->idx (%u) mismatches; "
+			"some packets maybe resent for Tx and dropped for Rx\n",
+			vq->last_used_idx, vq->used->idx);
+		vq->last_used_idx  = vq->used->idx;
+		vq->last_avail_idx = vq->used->idx;
+	}
+
+	return 0;
+}
+
+static int
+vring_translate_packed(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	struct vhost_vring_addr *addr = &vq->ring_addrs;
+	uint64_t size;
+
+	size = sizeof(struct vring_packed_desc) * vq->size;
+	vq->desc_packed = (struct vring_packed_desc *)(uintptr_t)
+		ring_addr_to_vva(dev, vq, addr->desc_user_addr, size,
+				 VHOST_ACCESS_RW);
+	if (vq->desc_packed == NULL)
+		return -1;
+
+	size = sizeof(struct vring_packed_desc_event);
+	vq->driver_event = (struct vring_packed_desc_event *)(uintptr_t)
+		ring_addr_to_vva(dev, vq, addr->avail_user_addr, size,
+				 VHOST_ACCESS_RO);
+	if (vq->driver_event == NULL)
+		return -1;
+
+	vq->device_event = (struct vring_packed_desc_event *)(uintptr_t)
+		ring_addr_to_vva(dev, vq, addr->used_user_addr, size,
+				 VHOST_ACCESS_RW);
+	if (vq->device_event == NULL)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * With an IOMMU, the ring addresses are IOVAs which can only be
+ * translated once the IOTLB holds them. This is tried when they are
+ * set, on each IOTLB update, and by the data path as long as it fails.
+ * The caller holds the IOTLB lock.
+ */
+int
+vring_translate(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	uint64_t hva;
+	int ret;
+
+	if (!(dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM)))
+		return -1;
+
+	if (vq_is_packed(dev))
+		ret = vring_translate_packed(dev, vq);
+	else
+		ret = vring_translate_split(dev, vq);
+	if (ret < 0)
+		return -1;
+
+	/* the used ring log address is an IOVA too */
+	vq->log_guest_addr = 0;
+	if (vq->ring_addrs.flags & (1 << VHOST_VRING_F_LOG)) {
+		hva = ring_addr_to_vva(dev, vq, vq->ring_addrs.log_guest_addr,
+				       sizeof(uint64_t), VHOST_ACCESS_RW);
+		if (hva == 0)
+			return -1;
+		vq->log_guest_addr = hva_to_gpa(dev, hva, sizeof(uint64_t));
+	}
+
+	vq->access_ok = 1;
+
+	return 0;
+}
+
+/*
+ * Forget the ring translations, after the master invalidated them. The
+ * caller holds the IOTLB lock for writing.
+ */
+void
+vring_invalidate(struct virtio_net *dev __rte_unused,
+		 struct vhost_virtqueue *vq)
+{
+	vq->access_ok = 0;
+	vq->desc = NULL;
+	vq->avail = NULL;
+	vq->used = NULL;
+	vq->log_guest_addr = 0;
+}
+
 static void
 cleanup_vq(struct vhost_virtqueue *vq, int destroy)
 {
@@ -83,10 +305,19 @@ cleanup_device(struct virtio_net *dev, int destroy)
 {
 	uint32_t i;
 
+	/* the copy engines must be done with the guest memory */
+	for (i = 0; i < dev->nr_vring; i++)
+		vhost_async_drain(dev, dev->virtqueue[i]);
+
 	vhost_backend_cleanup(dev);
 
 	for (i = 0; i < dev->nr_vring; i++)
 		cleanup_vq(dev->virtqueue[i], destroy);
+
+	if (dev->slave_req_fd >= 0) {
+		close(dev->slave_req_fd);
+		dev->slave_req_fd = -1;
+	}
 }
 
 /*
@@ -102,6 +333,9 @@ free_device(struct virtio_net *dev)
 		vq = dev->virtqueue[i];
 
 		rte_free(vq->shadow_used_ring);
+		rte_free(vq->batch_copy_elems);
+		vhost_free_async(vq);
+		vhost_user_iotlb_free(vq);
 
 		rte_free(vq);
 	}
@@ -126,17 +360,29 @@ init_vring_queue(struct vhost_virtqueue *vq)
 	 */
 	vq->enabled = 1;
 
+	/* A packed ring starts its life with both wrap counters set. */
+	vq->avail_wrap_counter = 1;
+	vq->used_wrap_counter = 1;
+
 	TAILQ_INIT(&vq->zmbuf_list);
+	rte_rwlock_init(&vq->iotlb_lock);
+	rte_spinlock_init(&vq->access_lock);
 }
 
+/* The caller may hold the access lock, which is kept as is */
 static void
 reset_vring_queue(struct vhost_virtqueue *vq)
 {
+	rte_spinlock_t access_lock;
 	int callfd;
 
+	vhost_user_iotlb_free(vq);
+	vhost_free_async(vq);
 	callfd = vq->callfd;
+	access_lock = vq->access_lock;
 	init_vring_queue(vq);
 	vq->callfd = callfd;
+	vq->access_lock = access_lock;
 }
 
 int
@@ -207,6 +453,8 @@ vhost_new_device(void)
 
 	vhost_devices[i] = dev;
 	dev->vid = i;
+	dev->slave_req_fd = -1;
+	rte_spinlock_init(&dev->slave_req_lock);
 
 	return i;
 }
@@ -412,11 +660,37 @@ rte_vhost_get_vhost_vring(int vid, uint16_t vring_idx,
 	return 0;
 }
 
+/*
+ * The packed ring has no avail index: walk the descriptors the driver
+ * has made available since our last position instead.
+ */
+static uint16_t
+vhost_packed_avail_count(struct vhost_virtqueue *vq)
+{
+	uint16_t idx = vq->last_avail_idx;
+	uint8_t wrap = vq->avail_wrap_counter;
+	uint16_t count = 0;
+
+	if (vq->desc_packed == NULL)
+		return 0;
+
+	while (count < vq->size && desc_is_avail(&vq->desc_packed[idx], wrap)) {
+		count++;
+		if (++idx >= vq->size) {
+			idx -= vq->size;
+			wrap ^= 1;
+		}
+	}
+
+	return count;
+}
+
 uint16_t
 rte_vhost_avail_entries(int vid, uint16_t queue_id)
 {
 	struct virtio_net *dev;
 	struct vhost_virtqueue *vq;
+	uint16_t ret;
 
 	dev = get_device(vid);
 	if (!dev)
@@ -426,13 +700,24 @@ rte_vhost_avail_entries(int vid, uint16_t queue_id)
 	if (!vq->enabled)
 		return 0;
 
-	return *(volatile uint16_t *)&vq->avail->idx - vq->last_used_idx;
+	vhost_user_iotlb_rd_lock(vq);
+	if (unlikely(!vq->access_ok))
+		ret = 0;
+	else if (vq_is_packed(dev))
+		ret = vhost_packed_avail_count(vq);
+	else
+		ret = *(volatile uint16_t *)&vq->avail->idx - vq->last_used_idx;
+	vhost_user_iotlb_rd_unlock(vq);
+
+	return ret;
 }
 
 int
 rte_vhost_enable_guest_notification(int vid, uint16_t queue_id, int enable)
 {
 	struct virtio_net *dev = get_device(vid);
+	struct vhost_virtqueue *vq;
+	int ret = 0;
 
 	if (dev == NULL)
 		return -1;
@@ -443,7 +728,41 @@ rte_vhost_enable_guest_notification(int vid, uint16_t queue_id, int enable)
 		return -1;
 	}
 
-	dev->virtqueue[queue_id]->used->flags = VRING_USED_F_NO_NOTIFY;
+	vq = dev->virtqueue[queue_id];
+	vhost_user_iotlb_rd_lock(vq);
+	if (unlikely(!vq->access_ok))
+		ret = -1;
+	else if (vq_is_packed(dev))
+		vq->device_event->flags = RING_EVENT_FLAGS_DISABLE;
+	else
+		vq->used->flags = VRING_USED_F_NO_NOTIFY;
+	vhost_user_iotlb_rd_unlock(vq);
+
+	return ret;
+}
+
+int
+rte_vhost_vring_set_coalescing(int vid, uint16_t vring_idx,
+		uint16_t max_pkts, uint32_t max_usecs)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_virtqueue *vq;
+
+	if (dev == NULL || vring_idx >= dev->nr_vring)
+		return -1;
+
+	vq = dev->virtqueue[vring_idx];
+	if (vq == NULL || vq_is_packed(dev))
+		return -1;
+
+	rte_spinlock_lock(&vq->access_lock);
+	vq->coalesce_pkts = max_pkts ? max_pkts : UINT16_MAX;
+	vq->coalesce_cycles = (uint64_t)max_usecs * rte_get_timer_hz() /
+		1000000;
+	if (vq->coalesce_cycles == 0 && vq->notify_deferred && vq->access_ok)
+		__vhost_vring_call(dev, vq);
+	rte_spinlock_unlock(&vq->access_lock);
+
 	return 0;
 }
 
@@ -501,5 +820,136 @@ rte_vhost_rx_queue_count(int vid, uint16_t qid)
 	if (unlikely(vq->enabled == 0 || vq->avail == NULL))
 		return 0;
 
+	if (vq_is_packed(dev))
+		return vhost_packed_avail_count(vq);
+
 	return *((volatile uint16_t *)&vq->avail->idx) - vq->last_avail_idx;
 }
+
+/*
+ * Free the async state of a virtqueue. Its packets in flight must have
+ * been completed or drained.
+ */
+void
+vhost_free_async(struct vhost_virtqueue *vq)
+{
+	struct vhost_async *async = vq->async;
+
+	if (async == NULL)
+		return;
+
+	rte_free(async->copies);
+	rte_free(async->copies_log);
+	rte_free(async->pkts_info);
+	rte_free(async->used_ring);
+	rte_free(async);
+	vq->async = NULL;
+}
+
+int
+rte_vhost_async_channel_register(int vid, uint16_t queue_id,
+		uint32_t threshold, const struct rte_vhost_async_channel_ops *ops,
+		void *ctx)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_virtqueue *vq;
+	struct vhost_async *async;
+
+	if (dev == NULL || ops == NULL || ops->submit == NULL ||
+	    ops->completed == NULL)
+		return -1;
+
+	/* Rx virtqueues have even indexes */
+	if (queue_id >= dev->nr_vring || (queue_id & 1)) {
+		RTE_LOG(ERR, VHOST_CONFIG, "(%d) %s: invalid virtqueue idx %d.\n",
+			vid, __func__, queue_id);
+		return -1;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (vq == NULL || vq->size == 0)
+		return -1;
+
+	if (vq_is_packed(dev) ||
+	    !(dev->features & (1ULL << VIRTIO_NET_F_MRG_RXBUF))) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) async enqueue needs a split ring with mergeable buffers\n",
+			vid);
+		return -1;
+	}
+
+	rte_spinlock_lock(&vq->access_lock);
+
+	if (vq->async != NULL)
+		goto err;
+
+	async = rte_zmalloc(NULL, sizeof(*async), RTE_CACHE_LINE_SIZE);
+	if (async == NULL)
+		goto err;
+	vq->async = async;
+
+	async->copies = rte_malloc(NULL,
+			vq->size * sizeof(struct rte_vhost_async_copy),
+			RTE_CACHE_LINE_SIZE);
+	async->copies_log = rte_malloc(NULL,
+			vq->size * sizeof(struct async_copy_log),
+			RTE_CACHE_LINE_SIZE);
+	async->pkts_info = rte_malloc(NULL,
+			vq->size * sizeof(struct async_inflight_info),
+			RTE_CACHE_LINE_SIZE);
+	async->used_ring = rte_malloc(NULL,
+			vq->size * sizeof(struct vring_used_elem),
+			RTE_CACHE_LINE_SIZE);
+	if (async->copies == NULL || async->copies_log == NULL ||
+	    async->pkts_info == NULL || async->used_ring == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) failed to allocate memory for async channel\n",
+			vid);
+		vhost_free_async(vq);
+		goto err;
+	}
+
+	async->ops = ops;
+	async->ctx = ctx;
+	async->threshold = threshold;
+
+	rte_spinlock_unlock(&vq->access_lock);
+
+	return 0;
+
+err:
+	rte_spinlock_unlock(&vq->access_lock);
+	return -1;
+}
+
+int
+rte_vhost_async_channel_unregister(int vid, uint16_t queue_id)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_virtqueue *vq;
+	int ret = 0;
+
+	if (dev == NULL || queue_id >= dev->nr_vring)
+		return -1;
+
+	vq = dev->virtqueue[queue_id];
+	if (vq == NULL)
+		return -1;
+
+	rte_spinlock_lock(&vq->access_lock);
+
+	if (vq->async == NULL) {
+		ret = -1;
+	} else if (vq->async->pkts_inflight_n) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) %u packets still in flight on queue %d\n",
+			vid, vq->async->pkts_inflight_n, queue_id);
+		ret = -EBUSY;
+	} else {
+		vhost_free_async(vq);
+	}
+
+	rte_spinlock_unlock(&vq->access_lock);
+
+	return ret;
+}
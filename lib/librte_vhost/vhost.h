@@ -37,6 +37,7 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/queue.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <linux/vhost.h>
 #include <linux/virtio_net.h>
@@ -45,8 +46,12 @@
 
 #include <rte_log.h>
 #include <rte_ether.h>
+#include <rte_cycles.h>
+#include <rte_rwlock.h>
+#include <rte_spinlock.h>
 
 #include "rte_vhost.h"
+#include "rte_vhost_async.h"
 
 /* Used to indicate that the device is running on a data core */
 #define VIRTIO_DEV_RUNNING 1
@@ -68,6 +73,68 @@ struct buf_vector {
 	uint32_t desc_idx;
 };
 
+/* Copies up to this many bytes are deferred and run as a batch */
+#define MAX_BATCH_LEN 256
+
+/**
+ * A data copy deferred to the end of the burst, along with the guest
+ * physical address to mark dirty once it is done (enqueue only).
+ */
+struct batch_copy_elem {
+	void *dst;
+	void *src;
+	uint32_t len;
+	uint64_t log_addr;
+};
+
+/* A packet enqueued asynchronously, waiting for its copies */
+struct async_inflight_info {
+	struct rte_mbuf *mbuf;
+	uint16_t nr_copies;	/* copies handed to the engine */
+	uint16_t nr_buffers;	/* used ring entries of the packet */
+};
+
+/* Guest range written by a copy handed to the engine */
+struct async_copy_log {
+	uint64_t log_addr;
+	uint32_t len;
+};
+
+/* How long a teardown waits for the copy engine to finish */
+#define VHOST_ASYNC_DRAIN_TIMEOUT_MS	1000
+
+/*
+ * State of a virtqueue bound to a copy engine. In-flight packets and
+ * their used ring entries are kept in rings of the virtqueue size, in
+ * submission order.
+ */
+struct vhost_async {
+	const struct rte_vhost_async_channel_ops *ops;
+	void *ctx;
+	uint32_t threshold;
+	uint32_t burst_threshold;
+
+	/* copies gathered during a burst */
+	struct rte_vhost_async_copy *copies;
+	uint16_t nr_copies;
+
+	/* guest ranges of the copies in the engine, logged on completion */
+	struct async_copy_log *copies_log;
+	uint16_t log_idx;
+	uint16_t copies_inflight_n;
+
+	struct async_inflight_info *pkts_info;
+	uint16_t pkts_idx;
+	uint16_t pkts_inflight_n;
+
+	struct vring_used_elem *used_ring;
+	uint16_t used_idx;
+	uint16_t used_inflight_n;
+
+	/* completions not yet matched to a packet */
+	uint32_t copies_done;
+};
+
 /*
  * A structure to hold some fields needed in zero copy code path,
  * mainly for associating an mbuf with the right desc_idx.
@@ -81,17 +148,83 @@ struct zcopy_mbuf {
 };
 TAILQ_HEAD(zcopy_mbuf_list, zcopy_mbuf);
 
+/*
+ * Virtio 1.1 packed ring layout. Old kernels have no such definitions,
+ * so we carry our own copy.
+ */
+#ifndef VIRTIO_F_RING_PACKED
+ #define VIRTIO_F_RING_PACKED		34
+#endif
+
+#ifndef VRING_PACKED_DESC_F_AVAIL
+struct vring_packed_desc {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t id;
+	uint16_t flags;
+};
+
+struct vring_packed_desc_event {
+	uint16_t off_wrap;
+	uint16_t flags;
+};
+#endif
+
+#define VRING_DESC_F_AVAIL		(1 << 7)
+#define VRING_DESC_F_USED		(1 << 15)
+
+#define RING_EVENT_FLAGS_ENABLE		0x0
+#define RING_EVENT_FLAGS_DISABLE	0x1
+#define RING_EVENT_FLAGS_DESC		0x2
+
+/*
+ * A used element of the packed ring: besides the buffer id and length,
+ * we need to know how many descriptors the chain took, to move the used
+ * index forward by the same amount.
+ */
+struct vring_used_elem_packed {
+	uint16_t id;
+	uint16_t count;
+	uint32_t len;
+};
+
+/*
+ * Dirty pages of a burst, gathered per 64-bit word of the log bitmap and
+ * written to it at the end of the burst.
+ */
+#define VHOST_LOG_CACHE_NR 32
+
+struct log_cache_entry {
+	uint32_t offset;
+	uint64_t val;
+};
+
 /**
  * Structure contains variables relevant to RX/TX virtqueues.
  */
 struct vhost_virtqueue {
-	struct vring_desc	*desc;
-	struct vring_avail	*avail;
-	struct vring_used	*used;
+	RTE_STD_C11
+	union {
+		struct vring_desc	*desc;
+		struct vring_packed_desc *desc_packed;
+	};
+	RTE_STD_C11
+	union {
+		struct vring_avail	*avail;
+		struct vring_packed_desc_event *driver_event;
+	};
+	RTE_STD_C11
+	union {
+		struct vring_used	*used;
+		struct vring_packed_desc_event *device_event;
+	};
 	uint32_t		size;
 
 	uint16_t		last_avail_idx;
 	uint16_t		last_used_idx;
+	/* Wrap counters, only meaningful for the packed ring */
+	uint8_t			avail_wrap_counter;
+	uint8_t			used_wrap_counter;
 #define VIRTIO_INVALID_EVENTFD		(-1)
 #define VIRTIO_UNINITIALIZED_EVENTFD	(-2)
 
@@ -105,6 +238,19 @@ struct vhost_virtqueue {
 
 	/* Physical address of used ring, for logging */
 	uint64_t		log_guest_addr;
+	uint16_t		log_cache_nb_elem;
+	struct log_cache_entry	log_cache[VHOST_LOG_CACHE_NR];
+
+	/*
+	 * Guest notification: used index at the last decision to kick or
+	 * not, and coalescing policy, see vhost_vring_call().
+	 */
+	uint16_t		signalled_used;
+	uint8_t			signalled_used_valid;
+	uint8_t			notify_deferred;
+	uint16_t		coalesce_pkts;
+	uint64_t		coalesce_cycles;
+	uint64_t		notify_deadline;
 
 	uint16_t		nr_zmbuf;
 	uint16_t		zmbuf_size;
@@ -112,8 +258,35 @@ struct vhost_virtqueue {
 	struct zcopy_mbuf	*zmbufs;
 	struct zcopy_mbuf_list	zmbuf_list;
 
-	struct vring_used_elem  *shadow_used_ring;
+	RTE_STD_C11
+	union {
+		struct vring_used_elem  *shadow_used_ring;
+		struct vring_used_elem_packed *shadow_used_packed;
+	};
 	uint16_t                shadow_used_idx;
+
+	struct batch_copy_elem	*batch_copy_elems;
+	uint16_t		batch_copy_nb_elems;
+
+	/* set when bound to a copy engine */
+	struct vhost_async	*async;
+
+	/*
+	 * IOTLB cache, only used with VIRTIO_F_IOMMU_PLATFORM. The ring
+	 * addresses are then IOVAs, kept until they can be translated.
+	 * Otherwise they are kept to translate the rings again when the
+	 * memory table changes.
+	 */
+	rte_rwlock_t		iotlb_lock;
+	struct vhost_iotlb	*iotlb;
+	struct vhost_vring_addr	ring_addrs;
+	int			access_ok;
+
+	/*
+	 * Held by the data path along a burst, and by the vhost-user
+	 * messages changing what it reads.
+	 */
+	rte_spinlock_t		access_lock;
 } __rte_cache_aligned;
 
 /* Old kernels have no such macros defined */
@@ -132,6 +305,30 @@ struct vhost_virtqueue {
  #define VIRTIO_NET_F_MTU 3
 #endif
 
+#ifndef VIRTIO_F_IOMMU_PLATFORM
+ #define VIRTIO_F_IOMMU_PLATFORM 33
+#endif
+
+/* Old kernels have no IOTLB message definitions */
+#ifndef VHOST_IOTLB_MSG
+#define VHOST_IOTLB_MSG 0x1
+
+struct vhost_iotlb_msg {
+	__u64 iova;
+	__u64 size;
+	__u64 uaddr;
+#define VHOST_ACCESS_RO      0x1
+#define VHOST_ACCESS_WO      0x2
+#define VHOST_ACCESS_RW      0x3
+	__u8 perm;
+#define VHOST_IOTLB_MISS           1
+#define VHOST_IOTLB_UPDATE         2
+#define VHOST_IOTLB_INVALIDATE     3
+#define VHOST_IOTLB_ACCESS_FAIL    4
+	__u8 type;
+};
+#endif
+
 /*
  * Define virtio 1.0 for older kernels
  */
@@ -157,6 +354,9 @@ struct vhost_virtqueue {
 				(1ULL << VIRTIO_NET_F_GUEST_TSO4) | \
 				(1ULL << VIRTIO_NET_F_GUEST_TSO6) | \
 				(1ULL << VIRTIO_RING_F_INDIRECT_DESC) | \
+				(1ULL << VIRTIO_RING_F_EVENT_IDX) | \
+				(1ULL << VIRTIO_F_RING_PACKED) | \
+				(1ULL << VIRTIO_F_IOMMU_PLATFORM) | \
 				(1ULL << VIRTIO_NET_F_MTU))
 
 
@@ -170,6 +370,13 @@ struct guest_page {
  * Device structure contains all configuration information relating
  * to the device.
  */
+/*
+ * Handler for the messages of a device type implemented outside of
+ * vhost_user.c, such as crypto sessions. Returns 0 when the message was
+ * handled, and sets *require_reply when msg now holds a reply.
+ */
+typedef int (*vhost_msg_handler)(int vid, void *msg, uint32_t *require_reply);
+
 struct virtio_net {
 	/* Frontend (QEMU) memory and memory region information */
 	struct rte_vhost_memory	*mem;
@@ -196,9 +403,36 @@ struct virtio_net {
 	uint32_t		nr_guest_pages;
 	uint32_t		max_guest_pages;
 	struct guest_page       *guest_pages;
+
+	/* Slave channel, used to send IOTLB miss requests */
+	int			slave_req_fd;
+	rte_spinlock_t		slave_req_lock;
+
+	/* Backend of a non-net device, e.g. vhost-crypto */
+	void			*extern_data;
+	vhost_msg_handler	extern_msg_handler;
 } __rte_cache_aligned;
 
 
+static __rte_always_inline int
+vq_is_packed(struct virtio_net *dev)
+{
+	return !!(dev->features & (1ULL << VIRTIO_F_RING_PACKED));
+}
+
+/*
+ * A packed descriptor is available to us when its AVAIL bit matches the
+ * driver's wrap counter and its USED bit does not.
+ */
+static __rte_always_inline int
+desc_is_avail(struct vring_packed_desc *desc, uint8_t wrap_counter)
+{
+	uint16_t flags = *(volatile uint16_t *)&desc->flags;
+
+	return wrap_counter == !!(flags & VRING_DESC_F_AVAIL) &&
+		wrap_counter != !!(flags & VRING_DESC_F_USED);
+}
+
 #define VHOST_LOG_PAGE	4096
 
 /*
@@ -207,7 +441,7 @@ struct virtio_net {
 static __rte_always_inline void
 vhost_set_bit(unsigned int nr, volatile uint8_t *addr)
 {
-	__sync_fetch_and_or_8(addr, (1U << nr));
+	__sync_fetch_and_or_1(addr, (1U << nr));
 }
 
 static __rte_always_inline void
@@ -245,6 +479,169 @@ vhost_log_used_vring(struct virtio_net *dev, struct vhost_virtqueue *vq,
 	vhost_log_write(dev, vq->log_guest_addr + offset, len);
 }
 
+/*
+ * Write the dirty pages cached along a burst to the log, one atomic OR
+ * per word. The bitmap is read by QEMU as native 64-bit words.
+ */
+static __rte_always_inline void
+vhost_log_cache_sync(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	volatile uint64_t *log_base;
+	uint16_t i;
+
+	if (likely(vq->log_cache_nb_elem == 0))
+		return;
+
+	if (unlikely(((dev->features & (1ULL << VHOST_F_LOG_ALL)) == 0) ||
+		     !dev->log_base)) {
+		vq->log_cache_nb_elem = 0;
+		return;
+	}
+
+	log_base = (volatile uint64_t *)(uintptr_t)dev->log_base;
+
+	/* To make sure guest memory updates are committed before logging */
+	rte_smp_wmb();
+
+	for (i = 0; i < vq->log_cache_nb_elem; i++) {
+		struct log_cache_entry *elem = vq->log_cache + i;
+
+		__sync_fetch_and_or(log_base + elem->offset, elem->val);
+	}
+
+	vq->log_cache_nb_elem = 0;
+}
+
+static __rte_always_inline void
+vhost_log_cache_page(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		     uint64_t page)
+{
+	uint32_t offset = page / 64;
+	uint64_t mask = 1ULL << (page % 64);
+	uint16_t i;
+
+	for (i = 0; i < vq->log_cache_nb_elem; i++) {
+		struct log_cache_entry *elem = vq->log_cache + i;
+
+		if (elem->offset == offset) {
+			elem->val |= mask;
+			return;
+		}
+	}
+
+	/*
+	 * The cache is full, or the word would run past a log whose size
+	 * is not a multiple of 8 bytes: log the page right away.
+	 */
+	if (unlikely(i >= VHOST_LOG_CACHE_NR ||
+		     (offset + 1) * sizeof(uint64_t) > dev->log_size)) {
+		rte_smp_wmb();
+		vhost_log_page((uint8_t *)(uintptr_t)dev->log_base, page);
+		return;
+	}
+
+	vq->log_cache[i].offset = offset;
+	vq->log_cache[i].val = mask;
+	vq->log_cache_nb_elem++;
+}
+
+/* Same as vhost_log_write(), the log being updated by vhost_log_cache_sync() */
+static __rte_always_inline void
+vhost_log_cache_write(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		      uint64_t addr, uint64_t len)
+{
+	uint64_t page;
+
+	if (likely(((dev->features & (1ULL << VHOST_F_LOG_ALL)) == 0) ||
+		   !dev->log_base || !len))
+		return;
+
+	if (unlikely(dev->log_size <= ((addr + len - 1) / VHOST_LOG_PAGE / 8)))
+		return;
+
+	page = addr / VHOST_LOG_PAGE;
+	while (page * VHOST_LOG_PAGE < addr + len) {
+		vhost_log_cache_page(dev, vq, page);
+		page += 1;
+	}
+}
+
+static __rte_always_inline void
+vhost_log_cache_used_vring(struct virtio_net *dev, struct vhost_virtqueue *vq,
+			   uint64_t offset, uint64_t len)
+{
+	vhost_log_cache_write(dev, vq, vq->log_guest_addr + offset, len);
+}
+
+/* Whether the guest asked for a call once the used index crosses event_idx */
+static __rte_always_inline int
+vhost_need_event(uint16_t event_idx, uint16_t new_idx, uint16_t old)
+{
+	return (uint16_t)(new_idx - event_idx - 1) < (uint16_t)(new_idx - old);
+}
+
+static __rte_always_inline void
+__vhost_vring_call(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	uint16_t old = vq->signalled_used;
+	uint16_t new_idx = vq->last_used_idx;
+	int kick;
+
+	/* flush used->idx update before we read the guest flags. */
+	rte_mb();
+
+	if (dev->features & (1ULL << VIRTIO_RING_F_EVENT_IDX))
+		kick = vhost_need_event(vq->avail->ring[vq->size], new_idx,
+					old) ||
+			unlikely(!vq->signalled_used_valid);
+	else
+		kick = !(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT);
+
+	vq->signalled_used = new_idx;
+	vq->signalled_used_valid = 1;
+	vq->notify_deferred = 0;
+
+	if (kick && vq->callfd >= 0)
+		eventfd_write(vq->callfd, (eventfd_t)1);
+}
+
+/*
+ * Notify the guest of the used entries of a split ring, when it asked for
+ * it: through the used event index with VIRTIO_RING_F_EVENT_IDX, else
+ * unless VRING_AVAIL_F_NO_INTERRUPT is set. With coalescing, the call is
+ * deferred until coalesce_pkts entries are pending or the first of them
+ * has waited for coalesce_cycles; vhost_vring_call_deferred() then does
+ * it from a later burst.
+ */
+static __rte_always_inline void
+vhost_vring_call(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	uint64_t now;
+
+	if (likely(vq->coalesce_cycles == 0)) {
+		__vhost_vring_call(dev, vq);
+		return;
+	}
+
+	now = rte_get_timer_cycles();
+	if (!vq->notify_deferred) {
+		vq->notify_deferred = 1;
+		vq->notify_deadline = now + vq->coalesce_cycles;
+	}
+
+	if ((uint16_t)(vq->last_used_idx - vq->signalled_used) >=
+	    vq->coalesce_pkts || now >= vq->notify_deadline)
+		__vhost_vring_call(dev, vq);
+}
+
+static __rte_always_inline void
+vhost_vring_call_deferred(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	if (unlikely(vq->notify_deferred) &&
+	    rte_get_timer_cycles() >= vq->notify_deadline)
+		__vhost_vring_call(dev, vq);
+}
+
 /* Macros for printing using RTE_LOG */
 #define RTE_LOGTYPE_VHOST_CONFIG RTE_LOGTYPE_USER1
 #define RTE_LOGTYPE_VHOST_DATA   RTE_LOGTYPE_USER1
@@ -300,7 +697,48 @@ gpa_to_hpa(struct virtio_net *dev, uint64_t gpa, uint64_t size)
 	return 0;
 }
 
+uint64_t __vhost_iova_to_vva(struct virtio_net *dev, struct vhost_virtqueue *vq,
+			uint64_t iova, uint64_t *size, uint8_t perm);
+uint64_t hva_to_gpa(struct virtio_net *dev, uint64_t vva, uint64_t len);
+void __vhost_log_cache_write_iova(struct virtio_net *dev,
+			struct vhost_virtqueue *vq,
+			uint64_t iova, uint64_t len);
+int vring_translate(struct virtio_net *dev, struct vhost_virtqueue *vq);
+void vring_invalidate(struct virtio_net *dev, struct vhost_virtqueue *vq);
+
+/*
+ * Translate a buffer address given by the guest. Without an IOMMU, it is
+ * a guest physical address. With one, it is an IOVA looked up in the
+ * IOTLB cache: *len is cut down to the part contiguous in our address
+ * space, and 0 is returned until the start of the buffer is mapped.
+ */
+static __rte_always_inline uint64_t
+vhost_iova_to_vva(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		  uint64_t iova, uint64_t *len, uint8_t perm)
+{
+	if (!(dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM)))
+		return rte_vhost_gpa_to_vva(dev->mem, iova);
+
+	return __vhost_iova_to_vva(dev, vq, iova, len, perm);
+}
+
+/* Same as vhost_log_cache_write(), for a buffer address given by the guest */
+static __rte_always_inline void
+vhost_log_cache_write_iova(struct virtio_net *dev, struct vhost_virtqueue *vq,
+			   uint64_t iova, uint64_t len)
+{
+	if (likely(!(dev->features & (1ULL << VHOST_F_LOG_ALL))))
+		return;
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		__vhost_log_cache_write_iova(dev, vq, iova, len);
+	else
+		vhost_log_cache_write(dev, vq, iova, len);
+}
+
 struct virtio_net *get_device(int vid);
+void vhost_free_async(struct vhost_virtqueue *vq);
+int vhost_async_drain(struct virtio_net *dev, struct vhost_virtqueue *vq);
 
 int vhost_new_device(void);
 void cleanup_device(struct virtio_net *dev, int destroy);
@@ -0,0 +1,175 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include <rte_atomic.h>
+#include <rte_common.h>
+#include <rte_malloc.h>
+#include <rte_memcpy.h>
+#include <rte_pause.h>
+
+#include "rte_vhost_async.h"
+
+/*
+ * Software copy engine. Jobs sit in a ring written by a single submitter;
+ * workers claim them one at a time and flag them done when copied, and
+ * the submitter reaps done jobs from the tail so completions are
+ * reported in submission order.
+ */
+
+struct async_sw_job {
+	struct rte_vhost_async_copy copy;
+	volatile uint32_t done;
+} __rte_cache_aligned;
+
+struct rte_vhost_async_sw {
+	/* owned by the submitter */
+	volatile uint32_t head;	/* jobs submitted */
+	uint32_t tail;		/* jobs reported completed */
+
+	/* shared by the workers */
+	volatile uint32_t next __rte_cache_aligned; /* next job to claim */
+	volatile int running;
+
+	uint32_t mask;
+	struct async_sw_job jobs[] __rte_cache_aligned;
+};
+
+static uint16_t
+async_sw_submit(void *ctx, const struct rte_vhost_async_copy *copies,
+		uint16_t count)
+{
+	struct rte_vhost_async_sw *sw = ctx;
+	uint32_t head = sw->head;
+	uint32_t free_jobs = sw->mask + 1 - (head - sw->tail);
+	uint16_t i;
+
+	count = RTE_MIN((uint32_t)count, free_jobs);
+	for (i = 0; i < count; i++)
+		sw->jobs[(head + i) & sw->mask].copy = copies[i];
+
+	/* jobs must be visible before the workers can claim them */
+	rte_smp_wmb();
+	sw->head = head + count;
+
+	return count;
+}
+
+static uint16_t
+async_sw_completed(void *ctx, uint16_t max)
+{
+	struct rte_vhost_async_sw *sw = ctx;
+	struct async_sw_job *job;
+	uint16_t n = 0;
+
+	while (n < max && sw->tail != sw->head) {
+		job = &sw->jobs[sw->tail & sw->mask];
+		if (job->done == 0)
+			break;
+
+		job->done = 0;
+		sw->tail++;
+		n++;
+	}
+
+	return n;
+}
+
+const struct rte_vhost_async_channel_ops rte_vhost_async_sw_ops = {
+	.submit = async_sw_submit,
+	.completed = async_sw_completed,
+};
+
+struct rte_vhost_async_sw *
+rte_vhost_async_sw_create(uint32_t nb_jobs, int socket_id)
+{
+	struct rte_vhost_async_sw *sw;
+
+	if (nb_jobs == 0 || !rte_is_power_of_2(nb_jobs))
+		return NULL;
+
+	sw = rte_zmalloc_socket("vhost_async_sw", sizeof(*sw) +
+				nb_jobs * sizeof(struct async_sw_job),
+				RTE_CACHE_LINE_SIZE, socket_id);
+	if (sw == NULL)
+		return NULL;
+
+	sw->mask = nb_jobs - 1;
+	sw->running = 1;
+
+	return sw;
+}
+
+int
+rte_vhost_async_sw_worker(void *arg)
+{
+	struct rte_vhost_async_sw *sw = arg;
+	struct async_sw_job *job;
+	uint32_t next;
+
+	while (sw->running) {
+		next = sw->next;
+		if (next == sw->head) {
+			rte_pause();
+			continue;
+		}
+
+		if (rte_atomic32_cmpset(&sw->next, next, next + 1) == 0)
+			continue;
+
+		/* read the job only after it was published */
+		rte_smp_rmb();
+
+		job = &sw->jobs[next & sw->mask];
+		rte_memcpy(job->copy.dst, job->copy.src, job->copy.len);
+
+		/* the data must be visible before the job is seen done */
+		rte_smp_wmb();
+		job->done = 1;
+	}
+
+	return 0;
+}
+
+void
+rte_vhost_async_sw_stop(struct rte_vhost_async_sw *sw)
+{
+	sw->running = 0;
+}
+
+void
+rte_vhost_async_sw_free(struct rte_vhost_async_sw *sw)
+{
+	rte_free(sw);
+}
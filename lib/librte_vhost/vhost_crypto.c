@@ -0,0 +1,1007 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <linux/virtio_crypto.h>
+
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_memcpy.h>
+#include <rte_cryptodev.h>
+
+#include "rte_vhost_crypto.h"
+#include "iotlb.h"
+#include "vhost.h"
+#include "vhost_user.h"
+
+#define VHOST_CRYPTO_MAX_SESSIONS	1024
+#define VHOST_CRYPTO_MAX_N_DESC		32
+#define VHOST_CRYPTO_MBUF_POOL_SIZE	8191
+#define VHOST_CRYPTO_MBUF_CACHE_SIZE	128
+
+#define VHOST_CRYPTO_DIGEST_OFFSET	(VHOST_CRYPTO_IV_OFFSET + \
+					 VHOST_CRYPTO_MAX_IV_LEN)
+
+/* A guest buffer of a request, in the order of the descriptor chain */
+struct vhost_crypto_seg {
+	uint64_t vva;
+	uint64_t gpa;
+	uint32_t len;
+};
+
+/* Position in the device-readable or device-writable part of a request */
+struct vhost_crypto_cursor {
+	struct vhost_crypto_seg *seg;
+	struct vhost_crypto_seg *end;
+	uint32_t off;
+};
+
+struct vhost_crypto {
+	struct virtio_net *dev;
+	uint8_t cid;
+	uint8_t zero_copy;
+	struct rte_mempool *sess_pool;
+	struct rte_mempool *mbuf_pool;
+	/* indexed by the session id given to the frontend */
+	struct rte_cryptodev_sym_session *sessions[VHOST_CRYPTO_MAX_SESSIONS];
+};
+
+/*
+ * State of a request between fetch and finalize, in the private area of
+ * its source mbuf.
+ */
+struct vhost_crypto_data_req {
+	struct vhost_crypto *vcrypto;
+	struct vhost_virtqueue *vq;
+	uint16_t desc_idx;
+	/* the cryptodev wrote the destination in guest memory */
+	uint8_t zero_copy;
+	uint8_t nb_wb;
+	uint32_t dst_len;
+	uint32_t digest_len;
+	struct vhost_crypto_seg inhdr;
+	/* device-writable buffers, without the status byte */
+	struct vhost_crypto_seg wb[VHOST_CRYPTO_MAX_N_DESC];
+};
+
+static const int cipher_algos[] = {
+	[VIRTIO_CRYPTO_NO_CIPHER] = RTE_CRYPTO_CIPHER_NULL,
+	[VIRTIO_CRYPTO_CIPHER_ARC4] = RTE_CRYPTO_CIPHER_ARC4,
+	[VIRTIO_CRYPTO_CIPHER_AES_ECB] = RTE_CRYPTO_CIPHER_AES_ECB,
+	[VIRTIO_CRYPTO_CIPHER_AES_CBC] = RTE_CRYPTO_CIPHER_AES_CBC,
+	[VIRTIO_CRYPTO_CIPHER_AES_CTR] = RTE_CRYPTO_CIPHER_AES_CTR,
+	[VIRTIO_CRYPTO_CIPHER_DES_ECB] = -VIRTIO_CRYPTO_NOTSUPP,
+	[VIRTIO_CRYPTO_CIPHER_DES_CBC] = RTE_CRYPTO_CIPHER_DES_CBC,
+	[VIRTIO_CRYPTO_CIPHER_3DES_ECB] = RTE_CRYPTO_CIPHER_3DES_ECB,
+	[VIRTIO_CRYPTO_CIPHER_3DES_CBC] = RTE_CRYPTO_CIPHER_3DES_CBC,
+	[VIRTIO_CRYPTO_CIPHER_3DES_CTR] = RTE_CRYPTO_CIPHER_3DES_CTR,
+	[VIRTIO_CRYPTO_CIPHER_KASUMI_F8] = RTE_CRYPTO_CIPHER_KASUMI_F8,
+	[VIRTIO_CRYPTO_CIPHER_SNOW3G_UEA2] = RTE_CRYPTO_CIPHER_SNOW3G_UEA2,
+	[VIRTIO_CRYPTO_CIPHER_AES_F8] = RTE_CRYPTO_CIPHER_AES_F8,
+	[VIRTIO_CRYPTO_CIPHER_AES_XTS] = RTE_CRYPTO_CIPHER_AES_XTS,
+	[VIRTIO_CRYPTO_CIPHER_ZUC_EEA3] = RTE_CRYPTO_CIPHER_ZUC_EEA3,
+};
+
+/* IV length of the cipher algorithms, which sessions have to fix */
+static const uint8_t cipher_iv_lens[] = {
+	[VIRTIO_CRYPTO_CIPHER_AES_CBC] = 16,
+	[VIRTIO_CRYPTO_CIPHER_AES_CTR] = 16,
+	[VIRTIO_CRYPTO_CIPHER_DES_CBC] = 8,
+	[VIRTIO_CRYPTO_CIPHER_3DES_CBC] = 8,
+	[VIRTIO_CRYPTO_CIPHER_3DES_CTR] = 8,
+	[VIRTIO_CRYPTO_CIPHER_KASUMI_F8] = 8,
+	[VIRTIO_CRYPTO_CIPHER_SNOW3G_UEA2] = 16,
+	[VIRTIO_CRYPTO_CIPHER_AES_F8] = 16,
+	[VIRTIO_CRYPTO_CIPHER_AES_XTS] = 16,
+	[VIRTIO_CRYPTO_CIPHER_ZUC_EEA3] = 16,
+};
+
+static const int mac_algos[] = {
+	[VIRTIO_CRYPTO_NO_MAC] = RTE_CRYPTO_AUTH_NULL,
+	[VIRTIO_CRYPTO_MAC_HMAC_MD5] = RTE_CRYPTO_AUTH_MD5_HMAC,
+	[VIRTIO_CRYPTO_MAC_HMAC_SHA1] = RTE_CRYPTO_AUTH_SHA1_HMAC,
+	[VIRTIO_CRYPTO_MAC_HMAC_SHA_224] = RTE_CRYPTO_AUTH_SHA224_HMAC,
+	[VIRTIO_CRYPTO_MAC_HMAC_SHA_256] = RTE_CRYPTO_AUTH_SHA256_HMAC,
+	[VIRTIO_CRYPTO_MAC_HMAC_SHA_384] = RTE_CRYPTO_AUTH_SHA384_HMAC,
+	[VIRTIO_CRYPTO_MAC_HMAC_SHA_512] = RTE_CRYPTO_AUTH_SHA512_HMAC,
+};
+
+static const int hash_algos[] = {
+	[VIRTIO_CRYPTO_NO_HASH] = RTE_CRYPTO_AUTH_NULL,
+	[VIRTIO_CRYPTO_HASH_MD5] = RTE_CRYPTO_AUTH_MD5,
+	[VIRTIO_CRYPTO_HASH_SHA1] = RTE_CRYPTO_AUTH_SHA1,
+	[VIRTIO_CRYPTO_HASH_SHA_224] = RTE_CRYPTO_AUTH_SHA224,
+	[VIRTIO_CRYPTO_HASH_SHA_256] = RTE_CRYPTO_AUTH_SHA256,
+	[VIRTIO_CRYPTO_HASH_SHA_384] = RTE_CRYPTO_AUTH_SHA384,
+	[VIRTIO_CRYPTO_HASH_SHA_512] = RTE_CRYPTO_AUTH_SHA512,
+};
+
+static int
+transform_cipher_param(struct rte_crypto_sym_xform *xform,
+		       VhostUserCryptoSessionParam *param)
+{
+	if (param->cipher_algo >= RTE_DIM(cipher_algos) ||
+	    cipher_algos[param->cipher_algo] < 0 ||
+	    (param->cipher_algo != VIRTIO_CRYPTO_NO_CIPHER &&
+	     cipher_algos[param->cipher_algo] == RTE_CRYPTO_CIPHER_NULL))
+		return -VIRTIO_CRYPTO_NOTSUPP;
+	if (param->cipher_key_len > VHOST_USER_CRYPTO_MAX_CIPHER_KEY_LENGTH)
+		return -VIRTIO_CRYPTO_BADMSG;
+
+	xform->type = RTE_CRYPTO_SYM_XFORM_CIPHER;
+	xform->cipher.algo = cipher_algos[param->cipher_algo];
+	xform->cipher.op = param->dir == VIRTIO_CRYPTO_OP_ENCRYPT ?
+		RTE_CRYPTO_CIPHER_OP_ENCRYPT : RTE_CRYPTO_CIPHER_OP_DECRYPT;
+	xform->cipher.key.data = param->cipher_key;
+	xform->cipher.key.length = param->cipher_key_len;
+	xform->cipher.iv.offset = VHOST_CRYPTO_IV_OFFSET;
+	if (param->cipher_algo < RTE_DIM(cipher_iv_lens))
+		xform->cipher.iv.length = cipher_iv_lens[param->cipher_algo];
+
+	return 0;
+}
+
+static int
+transform_auth_param(struct rte_crypto_sym_xform *xform,
+		     VhostUserCryptoSessionParam *param)
+{
+	const int *algos;
+	uint32_t nb_algos;
+
+	if (param->hash_mode == VIRTIO_CRYPTO_SYM_HASH_MODE_AUTH) {
+		algos = mac_algos;
+		nb_algos = RTE_DIM(mac_algos);
+	} else if (param->hash_mode == VIRTIO_CRYPTO_SYM_HASH_MODE_PLAIN) {
+		algos = hash_algos;
+		nb_algos = RTE_DIM(hash_algos);
+	} else {
+		return -VIRTIO_CRYPTO_NOTSUPP;
+	}
+
+	if (param->hash_algo >= nb_algos ||
+	    (param->hash_algo != 0 &&
+	     algos[param->hash_algo] == RTE_CRYPTO_AUTH_NULL))
+		return -VIRTIO_CRYPTO_NOTSUPP;
+	if (param->auth_key_len > VHOST_USER_CRYPTO_MAX_HMAC_KEY_LENGTH ||
+	    param->digest_len > VHOST_CRYPTO_MAX_DIGEST_LEN)
+		return -VIRTIO_CRYPTO_BADMSG;
+
+	/* The hash result is device-writable: always generate it */
+	xform->type = RTE_CRYPTO_SYM_XFORM_AUTH;
+	xform->auth.algo = algos[param->hash_algo];
+	xform->auth.op = RTE_CRYPTO_AUTH_OP_GENERATE;
+	xform->auth.key.data = param->auth_key;
+	xform->auth.key.length = param->auth_key_len;
+	xform->auth.digest_length = param->digest_len;
+
+	return 0;
+}
+
+static void
+vhost_crypto_create_sess(struct vhost_crypto *vcrypto,
+			 VhostUserCryptoSessionParam *param)
+{
+	struct rte_crypto_sym_xform cipher, auth, *first;
+	struct rte_cryptodev_sym_session *session;
+	uint32_t id;
+	int ret;
+
+	memset(&cipher, 0, sizeof(cipher));
+	memset(&auth, 0, sizeof(auth));
+
+	ret = transform_cipher_param(&cipher, param);
+	if (ret < 0)
+		goto error;
+	first = &cipher;
+
+	if (param->op_type == VIRTIO_CRYPTO_SYM_OP_ALGORITHM_CHAINING) {
+		ret = transform_auth_param(&auth, param);
+		if (ret < 0)
+			goto error;
+		if (param->chaining_dir ==
+		    VIRTIO_CRYPTO_SYM_ALG_CHAIN_ORDER_CIPHER_THEN_HASH) {
+			cipher.next = &auth;
+		} else {
+			auth.next = &cipher;
+			first = &auth;
+		}
+	} else if (param->op_type != VIRTIO_CRYPTO_SYM_OP_CIPHER) {
+		ret = -VIRTIO_CRYPTO_NOTSUPP;
+		goto error;
+	}
+
+	for (id = 0; id < VHOST_CRYPTO_MAX_SESSIONS; id++)
+		if (vcrypto->sessions[id] == NULL)
+			break;
+	if (id == VHOST_CRYPTO_MAX_SESSIONS) {
+		ret = -VIRTIO_CRYPTO_NOSPC;
+		goto error;
+	}
+
+	session = rte_cryptodev_sym_session_create(vcrypto->sess_pool);
+	if (session == NULL) {
+		ret = -VIRTIO_CRYPTO_ERR;
+		goto error;
+	}
+
+	if (rte_cryptodev_sym_session_init(vcrypto->cid, session, first,
+					   vcrypto->sess_pool) < 0) {
+		rte_cryptodev_sym_session_free(session);
+		ret = -VIRTIO_CRYPTO_ERR;
+		goto error;
+	}
+
+	vcrypto->sessions[id] = session;
+	param->session_id = id;
+
+	RTE_LOG(INFO, VHOST_CONFIG, "(%d) crypto session %u created\n",
+		vcrypto->dev->vid, id);
+	return;
+
+error:
+	RTE_LOG(ERR, VHOST_CONFIG, "(%d) failed to create crypto session: %d\n",
+		vcrypto->dev->vid, ret);
+	param->session_id = ret;
+}
+
+static int
+vhost_crypto_close_sess(struct vhost_crypto *vcrypto, uint64_t id)
+{
+	struct rte_cryptodev_sym_session *session;
+
+	if (id >= VHOST_CRYPTO_MAX_SESSIONS ||
+	    vcrypto->sessions[id] == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG, "(%d) invalid crypto session %"
+			PRIu64 "\n", vcrypto->dev->vid, id);
+		return -1;
+	}
+
+	session = vcrypto->sessions[id];
+	rte_cryptodev_sym_session_clear(vcrypto->cid, session);
+	rte_cryptodev_sym_session_free(session);
+	vcrypto->sessions[id] = NULL;
+
+	return 0;
+}
+
+static int
+vhost_crypto_msg_handler(int vid, void *msg, uint32_t *require_reply)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_crypto *vcrypto;
+	VhostUserMsg *vmsg = msg;
+	VhostUserCryptoSessionParam param;
+
+	if (dev == NULL || dev->extern_data == NULL)
+		return -1;
+	vcrypto = dev->extern_data;
+
+	switch (vmsg->request.master) {
+	case VHOST_USER_CRYPTO_CREATE_SESS:
+		memcpy(&param, &vmsg->payload.crypto_session, sizeof(param));
+		vhost_crypto_create_sess(vcrypto, &param);
+		memcpy(&vmsg->payload.crypto_session, &param, sizeof(param));
+		vmsg->size = sizeof(vmsg->payload.crypto_session);
+		*require_reply = 1;
+		return 0;
+	case VHOST_USER_CRYPTO_CLOSE_SESS:
+		return vhost_crypto_close_sess(vcrypto, vmsg->payload.u64);
+	default:
+		return -1;
+	}
+}
+
+/*
+ * Copy len bytes between buf and the guest buffers at the cursor, and
+ * move it forward. A NULL buf just skips guest bytes, which are still
+ * logged as written with to_guest. The caller checked the buffers are
+ * long enough.
+ */
+static void
+cursor_copy(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	    struct vhost_crypto_cursor *cur, uint8_t *buf, uint32_t len,
+	    int to_guest)
+{
+	uint32_t n;
+	uint8_t *ptr;
+
+	while (len > 0 && cur->seg < cur->end) {
+		n = RTE_MIN(len, cur->seg->len - cur->off);
+		if (n == 0) {
+			cur->seg++;
+			cur->off = 0;
+			continue;
+		}
+
+		ptr = (uint8_t *)(uintptr_t)(cur->seg->vva + cur->off);
+		if (buf != NULL) {
+			if (to_guest)
+				rte_memcpy(ptr, buf, n);
+			else
+				rte_memcpy(buf, ptr, n);
+			buf += n;
+		}
+		if (to_guest)
+			vhost_log_cache_write_iova(dev, vq,
+						   cur->seg->gpa + cur->off, n);
+
+		len -= n;
+		cur->off += n;
+	}
+}
+
+/* The guest buffer at the cursor, if the next len bytes are contiguous */
+static struct vhost_crypto_seg *
+cursor_contig(struct vhost_crypto_cursor *cur, uint32_t len)
+{
+	while (cur->seg < cur->end && cur->off == cur->seg->len) {
+		cur->seg++;
+		cur->off = 0;
+	}
+
+	if (cur->seg == cur->end || cur->seg->len - cur->off < len)
+		return NULL;
+
+	return cur->seg;
+}
+
+/* Source data of a request, copied into an mbuf chain */
+static struct rte_mbuf *
+vhost_crypto_copy_src(struct vhost_crypto *vcrypto, struct vhost_virtqueue *vq,
+		      struct vhost_crypto_cursor *cur, uint32_t len)
+{
+	struct rte_mbuf *head = NULL, *prev = NULL, *m;
+	uint32_t n;
+
+	do {
+		m = rte_pktmbuf_alloc(vcrypto->mbuf_pool);
+		if (m == NULL) {
+			rte_pktmbuf_free(head);
+			return NULL;
+		}
+
+		n = RTE_MIN(len, (uint32_t)rte_pktmbuf_tailroom(m));
+		cursor_copy(vcrypto->dev, vq, cur,
+			    rte_pktmbuf_mtod(m, uint8_t *), n, 0);
+		m->data_len = n;
+		len -= n;
+
+		if (head == NULL) {
+			head = m;
+			head->pkt_len = n;
+		} else {
+			prev->next = m;
+			head->nb_segs++;
+			head->pkt_len += n;
+		}
+		prev = m;
+	} while (len > 0);
+
+	return head;
+}
+
+/* Point an mbuf of our pool back to its own data buffer */
+static void
+vhost_crypto_restore_mbuf(struct rte_mbuf *m)
+{
+	uint32_t mbuf_size = sizeof(struct rte_mbuf) +
+		rte_pktmbuf_priv_size(m->pool);
+
+	m->buf_addr = (char *)m + mbuf_size;
+	m->buf_physaddr = rte_mempool_virt2phy(m->pool, m) + mbuf_size;
+	m->buf_len = rte_pktmbuf_data_room_size(m->pool);
+	m->data_off = RTE_MIN(RTE_PKTMBUF_HEADROOM, (uint16_t)m->buf_len);
+}
+
+/*
+ * Turn the request at desc_idx into a crypto op. Returns 0 when op is
+ * ready, -ENOMEM to retry later, or a positive virtio-crypto status
+ * to report to the guest, with *inhdr set when there is somewhere to.
+ */
+static int
+vhost_crypto_process_one(struct vhost_crypto *vcrypto,
+			 struct vhost_virtqueue *vq, struct rte_crypto_op *op,
+			 uint16_t desc_idx, struct vhost_crypto_seg *inhdr)
+{
+	struct virtio_net *dev = vcrypto->dev;
+	struct vhost_crypto_seg out[VHOST_CRYPTO_MAX_N_DESC];
+	struct vhost_crypto_seg in[VHOST_CRYPTO_MAX_N_DESC + 1];
+	struct vhost_crypto_data_req *vc_req;
+	struct virtio_crypto_op_data_req req;
+	struct rte_cryptodev_sym_session *session;
+	struct vhost_crypto_cursor cur;
+	struct vhost_crypto_seg *dst;
+	struct vring_desc *desc;
+	struct rte_mbuf *m;
+	uint32_t nb_out = 0, nb_in = 0, out_len = 0, in_len = 0;
+	uint32_t iv_len, src_len, dst_len, digest_len = 0, aad_len = 0;
+	uint32_t cipher_off = 0, cipher_len, hash_off = 0, hash_len = 0;
+	uint32_t i, nb_desc = 0;
+	uint16_t head = desc_idx;
+	uint64_t vva, iova, len, chunk, dst_gpa = 0, dst_hpa = 0;
+	uint8_t perm;
+
+	inhdr->vva = 0;
+
+	/*
+	 * Gather the chain: device-readable buffers, then writable ones.
+	 * A buffer mapped in pieces by the IOMMU takes a segment for each.
+	 */
+	for (;;) {
+		if (unlikely(desc_idx >= vq->size || nb_desc++ >= vq->size))
+			return VIRTIO_CRYPTO_BADMSG;
+		desc = &vq->desc[desc_idx];
+		if (unlikely(desc->flags & VRING_DESC_F_INDIRECT))
+			return VIRTIO_CRYPTO_NOTSUPP;
+
+		perm = (desc->flags & VRING_DESC_F_WRITE) ?
+			VHOST_ACCESS_WO : VHOST_ACCESS_RO;
+		iova = desc->addr;
+		len = desc->len;
+		do {
+			chunk = len;
+			vva = 0;
+			if (len != 0) {
+				vva = vhost_iova_to_vva(dev, vq, iova, &chunk,
+							perm);
+				if (unlikely(vva == 0))
+					return VIRTIO_CRYPTO_ERR;
+			}
+
+			if (desc->flags & VRING_DESC_F_WRITE) {
+				if (unlikely(nb_in == RTE_DIM(in)))
+					return VIRTIO_CRYPTO_NOTSUPP;
+				in[nb_in].vva = vva;
+				in[nb_in].gpa = iova;
+				in[nb_in++].len = chunk;
+				in_len += chunk;
+			} else {
+				if (unlikely(nb_in > 0 ||
+					     nb_out == RTE_DIM(out)))
+					return VIRTIO_CRYPTO_BADMSG;
+				out[nb_out].vva = vva;
+				out[nb_out].gpa = iova;
+				out[nb_out++].len = chunk;
+				out_len += chunk;
+			}
+
+			iova += chunk;
+			len -= chunk;
+		} while (len > 0);
+
+		if (!(desc->flags & VRING_DESC_F_NEXT))
+			break;
+		desc_idx = desc->next;
+	}
+
+	/* The status is the last device-writable byte */
+	while (nb_in > 0 && in[nb_in - 1].len == 0)
+		nb_in--;
+	if (unlikely(nb_in == 0))
+		return VIRTIO_CRYPTO_BADMSG;
+	in[nb_in - 1].len--;
+	in_len--;
+	inhdr->vva = in[nb_in - 1].vva + in[nb_in - 1].len;
+	inhdr->gpa = in[nb_in - 1].gpa + in[nb_in - 1].len;
+	inhdr->len = sizeof(struct virtio_crypto_inhdr);
+
+	/* The status may have been a descriptor of its own */
+	while (nb_in > 0 && in[nb_in - 1].len == 0)
+		nb_in--;
+	if (unlikely(nb_in > RTE_DIM(vc_req->wb)))
+		return VIRTIO_CRYPTO_BADMSG;
+
+	if (unlikely(out_len < sizeof(req)))
+		return VIRTIO_CRYPTO_BADMSG;
+	cur.seg = out;
+	cur.end = out + nb_out;
+	cur.off = 0;
+	cursor_copy(dev, vq, &cur, (uint8_t *)&req, sizeof(req), 0);
+	out_len -= sizeof(req);
+
+	if (req.header.opcode != VIRTIO_CRYPTO_CIPHER_ENCRYPT &&
+	    req.header.opcode != VIRTIO_CRYPTO_CIPHER_DECRYPT)
+		return VIRTIO_CRYPTO_NOTSUPP;
+
+	if (req.header.session_id >= VHOST_CRYPTO_MAX_SESSIONS ||
+	    vcrypto->sessions[req.header.session_id] == NULL)
+		return VIRTIO_CRYPTO_INVSESS;
+	session = vcrypto->sessions[req.header.session_id];
+
+	switch (req.u.sym_req.op_type) {
+	case VIRTIO_CRYPTO_SYM_OP_CIPHER:
+		iv_len = req.u.sym_req.u.cipher.para.iv_len;
+		src_len = req.u.sym_req.u.cipher.para.src_data_len;
+		dst_len = req.u.sym_req.u.cipher.para.dst_data_len;
+		cipher_len = src_len;
+		break;
+	case VIRTIO_CRYPTO_SYM_OP_ALGORITHM_CHAINING:
+		iv_len = req.u.sym_req.u.chain.para.iv_len;
+		src_len = req.u.sym_req.u.chain.para.src_data_len;
+		dst_len = req.u.sym_req.u.chain.para.dst_data_len;
+		cipher_off = req.u.sym_req.u.chain.para.cipher_start_src_offset;
+		cipher_len = req.u.sym_req.u.chain.para.len_to_cipher;
+		hash_off = req.u.sym_req.u.chain.para.hash_start_src_offset;
+		hash_len = req.u.sym_req.u.chain.para.len_to_hash;
+		aad_len = req.u.sym_req.u.chain.para.aad_len;
+		digest_len = req.u.sym_req.u.chain.para.hash_result_len;
+		break;
+	default:
+		return VIRTIO_CRYPTO_NOTSUPP;
+	}
+
+	if (unlikely(aad_len != 0))
+		return VIRTIO_CRYPTO_NOTSUPP;
+	if (unlikely(iv_len > VHOST_CRYPTO_MAX_IV_LEN ||
+		     digest_len > VHOST_CRYPTO_MAX_DIGEST_LEN ||
+		     src_len == 0 || dst_len < src_len ||
+		     (uint64_t)iv_len + src_len > out_len ||
+		     (uint64_t)dst_len + digest_len > in_len ||
+		     (uint64_t)cipher_off + cipher_len > src_len ||
+		     (uint64_t)hash_off + hash_len > src_len))
+		return VIRTIO_CRYPTO_BADMSG;
+
+	cursor_copy(dev, vq, &cur, rte_crypto_op_ctod_offset(op, uint8_t *,
+		    VHOST_CRYPTO_IV_OFFSET), iv_len, 0);
+
+	/*
+	 * With zero copy, the source is copied to the destination buffer,
+	 * where the cryptodev works in place. The buffer address may be an
+	 * IOVA: its guest physical address is found from our mapping.
+	 */
+	dst = NULL;
+	if (vcrypto->zero_copy && dst_len <= UINT16_MAX) {
+		struct vhost_crypto_cursor wcur = {
+			.seg = in, .end = in + nb_in, .off = 0 };
+
+		dst = cursor_contig(&wcur, dst_len);
+		if (dst != NULL) {
+			dst_gpa = hva_to_gpa(dev, dst->vva, dst_len);
+			if (dst_gpa != 0)
+				dst_hpa = gpa_to_hpa(dev, dst_gpa, dst_len);
+			if (dst_hpa == 0)
+				dst = NULL;
+		}
+	}
+
+	if (dst != NULL) {
+		m = rte_pktmbuf_alloc(vcrypto->mbuf_pool);
+		if (m == NULL)
+			return -ENOMEM;
+		m->buf_addr = (void *)(uintptr_t)dst->vva;
+		m->buf_physaddr = dst_hpa;
+		m->buf_len = dst_len;
+		m->data_off = 0;
+		m->data_len = src_len;
+		m->pkt_len = src_len;
+		cursor_copy(dev, vq, &cur, (uint8_t *)(uintptr_t)dst->vva,
+			    src_len, 0);
+		vhost_log_cache_write(dev, vq, dst_gpa, src_len);
+	} else {
+		m = vhost_crypto_copy_src(vcrypto, vq, &cur, src_len);
+		if (m == NULL)
+			return -ENOMEM;
+	}
+
+	vc_req = (struct vhost_crypto_data_req *)(m + 1);
+	vc_req->vcrypto = vcrypto;
+	vc_req->vq = vq;
+	vc_req->desc_idx = head;
+	vc_req->zero_copy = dst != NULL;
+	vc_req->dst_len = dst_len;
+	vc_req->digest_len = digest_len;
+	vc_req->inhdr = *inhdr;
+	vc_req->nb_wb = nb_in;
+	for (i = 0; i < nb_in; i++)
+		vc_req->wb[i] = in[i];
+
+	op->type = RTE_CRYPTO_OP_TYPE_SYMMETRIC;
+	op->sess_type = RTE_CRYPTO_OP_WITH_SESSION;
+	op->status = RTE_CRYPTO_OP_STATUS_NOT_PROCESSED;
+	op->sym->session = session;
+	op->sym->m_src = m;
+	op->sym->m_dst = NULL;
+	op->sym->cipher.data.offset = cipher_off;
+	op->sym->cipher.data.length = cipher_len;
+	if (digest_len != 0) {
+		op->sym->auth.data.offset = hash_off;
+		op->sym->auth.data.length = hash_len;
+		op->sym->auth.digest.data = rte_crypto_op_ctod_offset(op,
+			uint8_t *, VHOST_CRYPTO_DIGEST_OFFSET);
+		op->sym->auth.digest.phys_addr = rte_crypto_op_ctophys_offset(
+			op, VHOST_CRYPTO_DIGEST_OFFSET);
+	}
+
+	return 0;
+}
+
+/* Return a request to the guest, its used length covering the status */
+static void
+vhost_crypto_complete(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		      uint16_t desc_idx, struct vhost_crypto_seg *inhdr,
+		      uint8_t status, uint32_t len)
+{
+	uint16_t used_idx = vq->last_used_idx & (vq->size - 1);
+
+	if (inhdr->vva != 0) {
+		*(uint8_t *)(uintptr_t)inhdr->vva = status;
+		vhost_log_cache_write_iova(dev, vq, inhdr->gpa, inhdr->len);
+		len += inhdr->len;
+	}
+
+	vq->used->ring[used_idx].id = desc_idx;
+	vq->used->ring[used_idx].len = len;
+	vhost_log_cache_used_vring(dev, vq,
+			offsetof(struct vring_used, ring[used_idx]),
+			sizeof(vq->used->ring[used_idx]));
+	vq->last_used_idx++;
+}
+
+/* Publish the used index, and notify the guest if it asked for it */
+static void
+vhost_crypto_flush_used(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	rte_smp_wmb();
+	*(volatile uint16_t *)&vq->used->idx = vq->last_used_idx;
+	vhost_log_cache_used_vring(dev, vq, offsetof(struct vring_used, idx),
+			sizeof(vq->used->idx));
+
+	vhost_vring_call(dev, vq);
+}
+
+/*
+ * Take the virtqueue, and with an IOMMU the IOTLB, so that vhost-user
+ * messages cannot unmap the guest buffers we translate until
+ * vhost_crypto_access_end(). The rings are translated again if they were
+ * invalidated. Returns -1, with the locks released, while they cannot
+ * be, or when the queue is disabled.
+ */
+static int
+vhost_crypto_access_begin(struct virtio_net *dev, struct vhost_virtqueue *vq,
+			  int wait)
+{
+	if (wait)
+		rte_spinlock_lock(&vq->access_lock);
+	else if (unlikely(rte_spinlock_trylock(&vq->access_lock) == 0))
+		return -1;
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		vhost_user_iotlb_rd_lock(vq);
+
+	if (unlikely(vq->enabled == 0) ||
+	    (unlikely(vq->access_ok == 0) && vring_translate(dev, vq) < 0)) {
+		if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+			vhost_user_iotlb_rd_unlock(vq);
+		rte_spinlock_unlock(&vq->access_lock);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+vhost_crypto_access_end(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	vhost_log_cache_sync(dev, vq);
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		vhost_user_iotlb_rd_unlock(vq);
+
+	rte_spinlock_unlock(&vq->access_lock);
+}
+
+/*
+ * Translate again the device-writable buffers of a request, which the
+ * memory table or the IOTLB may have changed since it was fetched.
+ * Returns -1 if one of them is no longer mapped, the status included.
+ */
+static int
+vhost_crypto_translate_wb(struct virtio_net *dev, struct vhost_virtqueue *vq,
+			  struct vhost_crypto_data_req *vc_req)
+{
+	struct vhost_crypto_seg *seg;
+	uint64_t len;
+	uint8_t i;
+
+	seg = &vc_req->inhdr;
+	len = seg->len;
+	seg->vva = vhost_iova_to_vva(dev, vq, seg->gpa, &len,
+				     VHOST_ACCESS_WO);
+	if (unlikely(seg->vva == 0 || len != seg->len))
+		return -1;
+
+	/* each segment was contiguous, unless the mappings changed since */
+	for (i = 0; i < vc_req->nb_wb; i++) {
+		seg = &vc_req->wb[i];
+		if (seg->len == 0)
+			continue;
+		len = seg->len;
+		seg->vva = vhost_iova_to_vva(dev, vq, seg->gpa, &len,
+					     VHOST_ACCESS_WO);
+		if (unlikely(seg->vva == 0 || len != seg->len))
+			return -1;
+	}
+
+	return 0;
+}
+
+int
+rte_vhost_crypto_create(int vid, uint8_t cryptodev_id,
+		struct rte_mempool *sess_pool, int socket_id)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_crypto *vcrypto;
+	char name[RTE_MEMPOOL_NAMESIZE];
+
+	if (dev == NULL || sess_pool == NULL)
+		return -1;
+
+	if (dev->extern_data != NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) device already has a backend\n", vid);
+		return -1;
+	}
+
+	vcrypto = rte_zmalloc_socket(NULL, sizeof(*vcrypto),
+				     RTE_CACHE_LINE_SIZE, socket_id);
+	if (vcrypto == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) failed to allocate vhost crypto\n", vid);
+		return -1;
+	}
+
+	snprintf(name, sizeof(name), "vhost_crypto_%d", vid);
+	vcrypto->mbuf_pool = rte_pktmbuf_pool_create(name,
+			VHOST_CRYPTO_MBUF_POOL_SIZE,
+			VHOST_CRYPTO_MBUF_CACHE_SIZE,
+			RTE_ALIGN_CEIL(sizeof(struct vhost_crypto_data_req),
+				       RTE_MBUF_PRIV_ALIGN),
+			RTE_MBUF_DEFAULT_BUF_SIZE, socket_id);
+	if (vcrypto->mbuf_pool == NULL) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) failed to create mbuf pool\n", vid);
+		rte_free(vcrypto);
+		return -1;
+	}
+
+	vcrypto->dev = dev;
+	vcrypto->cid = cryptodev_id;
+	vcrypto->sess_pool = sess_pool;
+
+	dev->extern_data = vcrypto;
+	dev->extern_msg_handler = vhost_crypto_msg_handler;
+
+	return 0;
+}
+
+int
+rte_vhost_crypto_free(int vid)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_crypto *vcrypto;
+	uint32_t id;
+
+	if (dev == NULL || dev->extern_data == NULL)
+		return -1;
+	vcrypto = dev->extern_data;
+
+	for (id = 0; id < VHOST_CRYPTO_MAX_SESSIONS; id++)
+		if (vcrypto->sessions[id] != NULL)
+			vhost_crypto_close_sess(vcrypto, id);
+
+	dev->extern_msg_handler = NULL;
+	dev->extern_data = NULL;
+
+	rte_mempool_free(vcrypto->mbuf_pool);
+	rte_free(vcrypto);
+
+	return 0;
+}
+
+int
+rte_vhost_crypto_set_zero_copy(int vid, enum rte_vhost_crypto_zero_copy option)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_crypto *vcrypto;
+
+	if (dev == NULL || dev->extern_data == NULL)
+		return -1;
+	vcrypto = dev->extern_data;
+
+	if (option == RTE_VHOST_CRYPTO_ZERO_COPY_ENABLE &&
+	    !dev->dequeue_zero_copy) {
+		RTE_LOG(ERR, VHOST_CONFIG, "(%d) zero copy needs the "
+			"RTE_VHOST_USER_DEQUEUE_ZERO_COPY socket flag\n", vid);
+		return -1;
+	}
+
+	vcrypto->zero_copy = option == RTE_VHOST_CRYPTO_ZERO_COPY_ENABLE;
+
+	return 0;
+}
+
+uint16_t
+rte_vhost_crypto_fetch_requests(int vid, uint32_t qid,
+		struct rte_crypto_op **ops, uint16_t nb_ops)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_crypto *vcrypto;
+	struct vhost_virtqueue *vq;
+	struct vhost_crypto_seg inhdr;
+	uint16_t avail_idx, desc_idx, count, i;
+	uint16_t nb_fetched = 0, nb_failed = 0;
+	int ret;
+
+	if (dev == NULL || dev->extern_data == NULL)
+		return 0;
+	vcrypto = dev->extern_data;
+
+	if (unlikely(qid >= dev->nr_vring))
+		return 0;
+	vq = dev->virtqueue[qid];
+	if (unlikely(vq == NULL))
+		return 0;
+
+	if (unlikely(vhost_crypto_access_begin(dev, vq, 0) < 0))
+		return 0;
+
+	avail_idx = *((volatile uint16_t *)&vq->avail->idx);
+	count = RTE_MIN((uint16_t)(avail_idx - vq->last_avail_idx), nb_ops);
+	rte_smp_rmb();
+
+	for (i = 0; i < count; i++) {
+		desc_idx = vq->avail->ring[vq->last_avail_idx &
+					   (vq->size - 1)];
+		ret = vhost_crypto_process_one(vcrypto, vq, ops[nb_fetched],
+					       desc_idx, &inhdr);
+		if (ret < 0)
+			break;
+
+		vq->last_avail_idx++;
+		if (ret == 0) {
+			nb_fetched++;
+		} else {
+			vhost_crypto_complete(dev, vq, desc_idx, &inhdr,
+					      ret, 0);
+			nb_failed++;
+		}
+	}
+
+	if (nb_failed > 0)
+		vhost_crypto_flush_used(dev, vq);
+	vhost_vring_call_deferred(dev, vq);
+
+	vhost_crypto_access_end(dev, vq);
+
+	return nb_fetched;
+}
+
+uint16_t
+rte_vhost_crypto_finalize_requests(struct rte_crypto_op **ops,
+		uint16_t nb_ops)
+{
+	struct vhost_virtqueue *vqs[nb_ops];
+	struct virtio_net *devs[nb_ops];
+	struct virtio_net *dev;
+	struct vhost_virtqueue *vq;
+	struct vhost_crypto_data_req *vc_req;
+	struct vhost_crypto_cursor cur;
+	struct rte_mbuf *m, *seg;
+	uint16_t i, j, nb_vqs = 0;
+	uint8_t status;
+	uint32_t len;
+
+	for (i = 0; i < nb_ops; i++) {
+		m = ops[i]->sym->m_src;
+		vc_req = (struct vhost_crypto_data_req *)(m + 1);
+		dev = vc_req->vcrypto->dev;
+		vq = vc_req->vq;
+
+		/* the request is lost with the ring, if that was reset */
+		if (unlikely(vhost_crypto_access_begin(dev, vq, 1) < 0))
+			goto free;
+
+		switch (ops[i]->status) {
+		case RTE_CRYPTO_OP_STATUS_SUCCESS:
+			status = VIRTIO_CRYPTO_OK;
+			break;
+		case RTE_CRYPTO_OP_STATUS_AUTH_FAILED:
+			status = VIRTIO_CRYPTO_BADMSG;
+			break;
+		case RTE_CRYPTO_OP_STATUS_INVALID_SESSION:
+			status = VIRTIO_CRYPTO_INVSESS;
+			break;
+		default:
+			status = VIRTIO_CRYPTO_ERR;
+			break;
+		}
+
+		len = 0;
+		if (unlikely(vhost_crypto_translate_wb(dev, vq, vc_req) < 0)) {
+			RTE_LOG(ERR, VHOST_DATA, "(%d) request %u no longer "
+				"mapped\n", dev->vid, vc_req->desc_idx);
+			status = VIRTIO_CRYPTO_ERR;
+		} else if (status == VIRTIO_CRYPTO_OK) {
+			cur.seg = vc_req->wb;
+			cur.end = vc_req->wb + vc_req->nb_wb;
+			cur.off = 0;
+			/* with zero copy, the cryptodev wrote in place */
+			if (vc_req->zero_copy) {
+				cursor_copy(dev, vq, &cur, NULL,
+					    vc_req->dst_len, 1);
+			} else {
+				for (seg = m; seg != NULL; seg = seg->next)
+					cursor_copy(dev, vq, &cur,
+						rte_pktmbuf_mtod(seg, uint8_t *),
+						seg->data_len, 1);
+				cursor_copy(dev, vq, &cur, NULL,
+					    vc_req->dst_len - m->pkt_len, 0);
+			}
+			cursor_copy(dev, vq, &cur,
+				rte_crypto_op_ctod_offset(ops[i], uint8_t *,
+					VHOST_CRYPTO_DIGEST_OFFSET),
+				vc_req->digest_len, 1);
+			len = vc_req->dst_len + vc_req->digest_len;
+		}
+
+		vhost_crypto_complete(dev, vq, vc_req->desc_idx,
+				      &vc_req->inhdr, status, len);
+		vhost_crypto_access_end(dev, vq);
+
+		for (j = 0; j < nb_vqs; j++)
+			if (vqs[j] == vq)
+				break;
+		if (j == nb_vqs) {
+			devs[nb_vqs] = dev;
+			vqs[nb_vqs++] = vq;
+		}
+
+free:
+		if (vc_req->zero_copy)
+			vhost_crypto_restore_mbuf(m);
+		rte_pktmbuf_free(m);
+		ops[i]->sym->m_src = NULL;
+	}
+
+	for (j = 0; j < nb_vqs; j++) {
+		if (vhost_crypto_access_begin(devs[j], vqs[j], 1) < 0)
+			continue;
+		vhost_crypto_flush_used(devs[j], vqs[j]);
+		vhost_crypto_access_end(devs[j], vqs[j]);
+	}
+
+	return nb_ops;
+}
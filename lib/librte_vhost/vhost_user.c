@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -48,6 +49,7 @@
 #include <rte_malloc.h>
 #include <rte_log.h>
 
+#include "iotlb.h"
 #include "vhost.h"
 #include "vhost_user.h"
 
@@ -76,6 +78,10 @@ static const char *vhost_message_str[VHOST_USER_MAX] = {
 	[VHOST_USER_SET_VRING_ENABLE]  = "VHOST_USER_SET_VRING_ENABLE",
 	[VHOST_USER_SEND_RARP]  = "VHOST_USER_SEND_RARP",
 	[VHOST_USER_NET_SET_MTU]  = "VHOST_USER_NET_SET_MTU",
+	[VHOST_USER_SET_SLAVE_REQ_FD]  = "VHOST_USER_SET_SLAVE_REQ_FD",
+	[VHOST_USER_IOTLB_MSG]  = "VHOST_USER_IOTLB_MSG",
+	[VHOST_USER_CRYPTO_CREATE_SESS] = "VHOST_USER_CRYPTO_CREATE_SESS",
+	[VHOST_USER_CRYPTO_CLOSE_SESS] = "VHOST_USER_CRYPTO_CLOSE_SESS",
 };
 
 static uint64_t
@@ -180,6 +186,13 @@ vhost_user_set_features(struct virtio_net *dev, uint64_t features)
 			dev->notify_ops->features_changed(dev->vid, features);
 	}
 
+	if ((features & (1ULL << VIRTIO_F_RING_PACKED)) &&
+	    !(features & (1ULL << VIRTIO_F_VERSION_1))) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) packed ring requires virtio 1.\n", dev->vid);
+		return -1;
+	}
+
 	dev->features = features;
 	if (dev->features &
 		((1 << VIRTIO_NET_F_MRG_RXBUF) | (1ULL << VIRTIO_F_VERSION_1))) {
@@ -187,6 +200,22 @@ vhost_user_set_features(struct virtio_net *dev, uint64_t features)
 	} else {
 		dev->vhost_hlen = sizeof(struct virtio_net_hdr);
 	}
+	if (vq_is_packed(dev) && dev->dequeue_zero_copy) {
+		RTE_LOG(WARNING, VHOST_CONFIG,
+			"(%d) dequeue zero copy is not supported with the "
+			"packed ring; zero copy is force disabled\n",
+			dev->vid);
+		dev->dequeue_zero_copy = 0;
+	}
+	/* mbufs would point to guest buffers the IOMMU may unmap anytime */
+	if ((dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM)) &&
+	    dev->dequeue_zero_copy) {
+		RTE_LOG(WARNING, VHOST_CONFIG,
+			"(%d) dequeue zero copy is not supported with an "
+			"IOMMU; zero copy is force disabled\n",
+			dev->vid);
+		dev->dequeue_zero_copy = 0;
+	}
 	LOG_DEBUG(VHOST_CONFIG,
 		"(%d) mergeable RX buffers %s, virtio 1 %s\n",
 		dev->vid,
@@ -221,7 +250,12 @@ vhost_user_set_vring_num(struct virtio_net *dev,
 		}
 	}
 
-	vq->shadow_used_ring = rte_malloc(NULL,
+	if (vq_is_packed(dev))
+		vq->shadow_used_packed = rte_malloc(NULL, vq->size *
+				sizeof(struct vring_used_elem_packed),
+				RTE_CACHE_LINE_SIZE);
+	else
+		vq->shadow_used_ring = rte_malloc(NULL,
 				vq->size * sizeof(struct vring_used_elem),
 				RTE_CACHE_LINE_SIZE);
 	if (!vq->shadow_used_ring) {
@@ -230,6 +264,16 @@ vhost_user_set_vring_num(struct virtio_net *dev,
 		return -1;
 	}
 
+	vq->batch_copy_elems = rte_malloc(NULL,
+				vq->size * sizeof(struct batch_copy_elem),
+				RTE_CACHE_LINE_SIZE);
+	if (!vq->batch_copy_elems) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"failed to allocate memory for batching copy.\n");
+		return -1;
+	}
+	vq->batch_copy_nb_elems = 0;
+
 	return 0;
 }
 
@@ -309,10 +353,11 @@ numa_realloc(struct virtio_net *dev, int index __rte_unused)
 
 /*
  * Converts QEMU virtual address to Vhost virtual address. This function is
- * used to convert the ring addresses to our address space.
+ * used to convert the ring addresses to our address space. When len is
+ * given, it is cut down to what is left of the region from qva.
  */
 static uint64_t
-qva_to_vva(struct virtio_net *dev, uint64_t qva)
+qva_to_vva(struct virtio_net *dev, uint64_t qva, uint64_t *len)
 {
 	struct rte_vhost_mem_region *reg;
 	uint32_t i;
@@ -323,6 +368,9 @@ qva_to_vva(struct virtio_net *dev, uint64_t qva)
 
 		if (qva >= reg->guest_user_addr &&
 		    qva <  reg->guest_user_addr + reg->size) {
+			if (len && *len > reg->guest_user_addr + reg->size - qva)
+				*len = reg->guest_user_addr + reg->size - qva;
+
 			return qva - reg->guest_user_addr +
 			       reg->host_user_addr;
 		}
@@ -331,6 +379,81 @@ qva_to_vva(struct virtio_net *dev, uint64_t qva)
 	return 0;
 }
 
+/*
+ * With the packed ring, the desc address points to the single descriptor
+ * ring, and the avail and used addresses point to the driver and device
+ * event suppression areas respectively.
+ */
+static int
+vhost_user_set_vring_addr_packed(struct virtio_net *dev, VhostUserMsg *msg)
+{
+	struct vhost_virtqueue *vq = dev->virtqueue[msg->payload.addr.index];
+
+	vq->desc_packed = (struct vring_packed_desc *)(uintptr_t)qva_to_vva(dev,
+			msg->payload.addr.desc_user_addr, NULL);
+	if (vq->desc_packed == 0) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) failed to find packed desc ring address.\n",
+			dev->vid);
+		return -1;
+	}
+
+	dev = numa_realloc(dev, msg->payload.addr.index);
+	vq = dev->virtqueue[msg->payload.addr.index];
+
+	vq->driver_event = (struct vring_packed_desc_event *)(uintptr_t)
+		qva_to_vva(dev, msg->payload.addr.avail_user_addr, NULL);
+	if (vq->driver_event == 0) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) failed to find driver event area address.\n",
+			dev->vid);
+		return -1;
+	}
+
+	vq->device_event = (struct vring_packed_desc_event *)(uintptr_t)
+		qva_to_vva(dev, msg->payload.addr.used_user_addr, NULL);
+	if (vq->device_event == 0) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"(%d) failed to find device event area address.\n",
+			dev->vid);
+		return -1;
+	}
+
+	/* Used elements are written back in place, into the desc ring. */
+	vq->log_guest_addr = msg->payload.addr.log_guest_addr;
+	vq->access_ok = 1;
+
+	LOG_DEBUG(VHOST_CONFIG, "(%d) mapped address packed desc: %p\n",
+			dev->vid, vq->desc_packed);
+	LOG_DEBUG(VHOST_CONFIG, "(%d) mapped address driver event: %p\n",
+			dev->vid, vq->driver_event);
+	LOG_DEBUG(VHOST_CONFIG, "(%d) mapped address device event: %p\n",
+			dev->vid, vq->device_event);
+
+	return 0;
+}
+
+/*
+ * Behind an IOMMU, the ring addresses are IOVAs. They are kept aside and
+ * translated as soon as the IOTLB holds them; until then, the queue is
+ * not ready. The rings are not moved to their NUMA node in this case.
+ */
+static int
+vhost_user_set_vring_addr_iommu(struct virtio_net *dev, VhostUserMsg *msg)
+{
+	struct vhost_virtqueue *vq = dev->virtqueue[msg->payload.addr.index];
+
+	if (vq->iotlb == NULL && vhost_user_iotlb_init(vq) < 0)
+		return -1;
+
+	vhost_user_iotlb_wr_lock(vq);
+	vring_invalidate(dev, vq);
+	vring_translate(dev, vq);
+	vhost_user_iotlb_wr_unlock(vq);
+
+	return 0;
+}
+
 /*
  * The virtio device sends us the desc, used and avail ring addresses.
  * This function then converts these to our address space.
@@ -345,10 +468,17 @@ vhost_user_set_vring_addr(struct virtio_net *dev, VhostUserMsg *msg)
 
 	/* addr->index refers to the queue index. The txq 1, rxq is 0. */
 	vq = dev->virtqueue[msg->payload.addr.index];
+	memcpy(&vq->ring_addrs, &msg->payload.addr, sizeof(vq->ring_addrs));
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		return vhost_user_set_vring_addr_iommu(dev, msg);
+
+	if (vq_is_packed(dev))
+		return vhost_user_set_vring_addr_packed(dev, msg);
 
 	/* The addresses are converted from QEMU virtual to Vhost virtual. */
 	vq->desc = (struct vring_desc *)(uintptr_t)qva_to_vva(dev,
-			msg->payload.addr.desc_user_addr);
+			msg->payload.addr.desc_user_addr, NULL);
 	if (vq->desc == 0) {
 		RTE_LOG(ERR, VHOST_CONFIG,
 			"(%d) failed to find desc ring address.\n",
@@ -360,7 +490,7 @@ vhost_user_set_vring_addr(struct virtio_net *dev, VhostUserMsg *msg)
 	vq = dev->virtqueue[msg->payload.addr.index];
 
 	vq->avail = (struct vring_avail *)(uintptr_t)qva_to_vva(dev,
-			msg->payload.addr.avail_user_addr);
+			msg->payload.addr.avail_user_addr, NULL);
 	if (vq->avail == 0) {
 		RTE_LOG(ERR, VHOST_CONFIG,
 			"(%d) failed to find avail ring address.\n",
@@ -369,7 +499,7 @@ vhost_user_set_vring_addr(struct virtio_net *dev, VhostUserMsg *msg)
 	}
 
 	vq->used = (struct vring_used *)(uintptr_t)qva_to_vva(dev,
-			msg->payload.addr.used_user_addr);
+			msg->payload.addr.used_user_addr, NULL);
 	if (vq->used == 0) {
 		RTE_LOG(ERR, VHOST_CONFIG,
 			"(%d) failed to find used ring address.\n",
@@ -387,6 +517,7 @@ vhost_user_set_vring_addr(struct virtio_net *dev, VhostUserMsg *msg)
 	}
 
 	vq->log_guest_addr = msg->payload.addr.log_guest_addr;
+	vq->access_ok = 1;
 
 	LOG_DEBUG(VHOST_CONFIG, "(%d) mapped address desc: %p\n",
 			dev->vid, vq->desc);
@@ -407,10 +538,23 @@ static int
 vhost_user_set_vring_base(struct virtio_net *dev,
 			  VhostUserMsg *msg)
 {
-	dev->virtqueue[msg->payload.state.index]->last_used_idx  =
-			msg->payload.state.num;
-	dev->virtqueue[msg->payload.state.index]->last_avail_idx =
-			msg->payload.state.num;
+	struct vhost_virtqueue *vq = dev->virtqueue[msg->payload.state.index];
+	uint32_t num = msg->payload.state.num;
+
+	/*
+	 * For the packed ring, bit 15 carries the wrap counter and the
+	 * lower bits the ring position.
+	 */
+	if (vq_is_packed(dev)) {
+		vq->avail_wrap_counter = !!(num & (1 << 15));
+		vq->used_wrap_counter = vq->avail_wrap_counter;
+		num &= 0x7fff;
+	}
+
+	vq->last_used_idx  = num;
+	vq->last_avail_idx = num;
+	vq->signalled_used_valid = 0;
+	vq->notify_deferred = 0;
 
 	return 0;
 }
@@ -500,6 +644,70 @@ dump_guest_pages(struct virtio_net *dev)
 #define dump_guest_pages(dev)
 #endif
 
+/*
+ * Without an IOMMU, the rings point into the memory table: they can't be
+ * accessed while it is replaced, and are translated again from the
+ * addresses the frontend gave once the new one is mapped. With an
+ * IOMMU, the IOTLB updates take care of it.
+ */
+static void
+vhost_user_unmap_vrings(struct virtio_net *dev)
+{
+	uint32_t i;
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		return;
+
+	for (i = 0; i < dev->nr_vring; i++)
+		if (dev->virtqueue[i] != NULL)
+			dev->virtqueue[i]->access_ok = 0;
+}
+
+static void
+vhost_user_remap_vrings(struct virtio_net *dev)
+{
+	struct vhost_virtqueue *vq;
+	struct vhost_vring_addr *addr;
+	uint32_t i;
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		return;
+
+	for (i = 0; i < dev->nr_vring; i++) {
+		vq = dev->virtqueue[i];
+		if (vq == NULL || vq->ring_addrs.desc_user_addr == 0)
+			continue;
+		addr = &vq->ring_addrs;
+
+		if (vq_is_packed(dev)) {
+			vq->desc_packed = (struct vring_packed_desc *)
+				(uintptr_t)qva_to_vva(dev,
+					addr->desc_user_addr, NULL);
+			vq->driver_event = (struct vring_packed_desc_event *)
+				(uintptr_t)qva_to_vva(dev,
+					addr->avail_user_addr, NULL);
+			vq->device_event = (struct vring_packed_desc_event *)
+				(uintptr_t)qva_to_vva(dev,
+					addr->used_user_addr, NULL);
+			vq->access_ok = vq->desc_packed && vq->driver_event &&
+				vq->device_event;
+		} else {
+			vq->desc = (struct vring_desc *)(uintptr_t)qva_to_vva(
+				dev, addr->desc_user_addr, NULL);
+			vq->avail = (struct vring_avail *)(uintptr_t)
+				qva_to_vva(dev, addr->avail_user_addr, NULL);
+			vq->used = (struct vring_used *)(uintptr_t)qva_to_vva(
+				dev, addr->used_user_addr, NULL);
+			vq->access_ok = vq->desc && vq->avail && vq->used;
+		}
+
+		if (!vq->access_ok)
+			RTE_LOG(ERR, VHOST_CONFIG,
+				"(%d) vring %u is out of the new memory table\n",
+				dev->vid, i);
+	}
+}
+
 static int
 vhost_user_set_mem_table(struct virtio_net *dev, struct VhostUserMsg *pmsg)
 {
@@ -513,6 +721,7 @@ vhost_user_set_mem_table(struct virtio_net *dev, struct VhostUserMsg *pmsg)
 	int fd;
 
 	if (dev->mem) {
+		vhost_user_unmap_vrings(dev);
 		free_mem_region(dev);
 		rte_free(dev->mem);
 		dev->mem = NULL;
@@ -608,6 +817,8 @@ vhost_user_set_mem_table(struct virtio_net *dev, struct VhostUserMsg *pmsg)
 
 	dump_guest_pages(dev);
 
+	vhost_user_remap_vrings(dev);
+
 	return 0;
 
 err_mmap:
@@ -620,7 +831,7 @@ vhost_user_set_mem_table(struct virtio_net *dev, struct VhostUserMsg *pmsg)
 static int
 vq_is_ready(struct vhost_virtqueue *vq)
 {
-	return vq && vq->desc   &&
+	return vq && vq->desc   && vq->access_ok &&
 	       vq->kickfd != VIRTIO_UNINITIALIZED_EVENTFD &&
 	       vq->callfd != VIRTIO_UNINITIALIZED_EVENTFD;
 }
@@ -720,8 +931,13 @@ vhost_user_get_vring_base(struct virtio_net *dev,
 
 	dev->flags &= ~VIRTIO_DEV_READY;
 
+	/* the copy engine must be done with the guest buffers */
+	vhost_async_drain(dev, vq);
+
 	/* Here we are safe to get the last used index */
 	msg->payload.state.num = vq->last_used_idx;
+	if (vq_is_packed(dev))
+		msg->payload.state.num |= vq->used_wrap_counter << 15;
 
 	RTE_LOG(INFO, VHOST_CONFIG,
 		"vring base idx:%d file:%d\n", msg->payload.state.index,
@@ -741,6 +957,14 @@ vhost_user_get_vring_base(struct virtio_net *dev,
 	rte_free(vq->shadow_used_ring);
 	vq->shadow_used_ring = NULL;
 
+	rte_free(vq->batch_copy_elems);
+	vq->batch_copy_elems = NULL;
+
+	vhost_free_async(vq);
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		vhost_user_iotlb_flush_all(vq);
+
 	return 0;
 }
 
@@ -874,6 +1098,131 @@ vhost_user_net_set_mtu(struct virtio_net *dev, struct VhostUserMsg *msg)
 	return 0;
 }
 
+static int
+vhost_user_set_req_fd(struct virtio_net *dev, struct VhostUserMsg *msg)
+{
+	int fd = msg->fds[0];
+	int flags;
+
+	if (fd < 0) {
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"invalid file descriptor for slave channel (%d)\n",
+			fd);
+		return -1;
+	}
+
+	/* IOTLB misses are sent from the data path, which must not block */
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		RTE_LOG(WARNING, VHOST_CONFIG,
+			"failed to make slave channel non-blocking\n");
+
+	if (dev->slave_req_fd >= 0)
+		close(dev->slave_req_fd);
+	dev->slave_req_fd = fd;
+
+	return 0;
+}
+
+/* Tells whether [iova, iova + size) overlaps one of the rings of vq */
+static int
+vring_overlaps(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	       uint64_t iova, uint64_t size)
+{
+	struct vhost_vring_addr *ra = &vq->ring_addrs;
+	uint64_t start[4], len[4];
+	int i, n = 3;
+
+	if (vq->size == 0)
+		return 0;
+
+	start[0] = ra->desc_user_addr;
+	start[1] = ra->avail_user_addr;
+	start[2] = ra->used_user_addr;
+	if (vq_is_packed(dev)) {
+		len[0] = sizeof(struct vring_packed_desc) * vq->size;
+		len[1] = sizeof(struct vring_packed_desc_event);
+		len[2] = sizeof(struct vring_packed_desc_event);
+	} else {
+		len[0] = sizeof(struct vring_desc) * vq->size;
+		len[1] = sizeof(struct vring_avail) +
+			sizeof(uint16_t) * (vq->size + 1);
+		len[2] = sizeof(struct vring_used) +
+			sizeof(struct vring_used_elem) * vq->size +
+			sizeof(uint16_t);
+	}
+	if (ra->flags & (1 << VHOST_VRING_F_LOG)) {
+		start[n] = ra->log_guest_addr;
+		len[n++] = sizeof(uint64_t);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (start[i] < iova + size && iova < start[i] + len[i])
+			return 1;
+	}
+
+	return 0;
+}
+
+static int
+vhost_user_iotlb_msg(struct virtio_net *dev, struct VhostUserMsg *msg)
+{
+	struct vhost_iotlb_msg *imsg = &msg->payload.iotlb;
+	struct vhost_virtqueue *vq;
+	uint64_t vva, len;
+	uint32_t i;
+
+	if (!(dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM)))
+		return -1;
+
+	switch (imsg->type) {
+	case VHOST_IOTLB_UPDATE:
+		len = imsg->size;
+		vva = qva_to_vva(dev, imsg->uaddr, &len);
+		if (!vva)
+			return -1;
+
+		for (i = 0; i < dev->nr_vring; i++) {
+			vq = dev->virtqueue[i];
+			if (vq == NULL)
+				continue;
+
+			vhost_user_iotlb_cache_insert(vq, imsg->iova, vva,
+						      len, imsg->perm);
+
+			if (!vq->access_ok &&
+			    vring_overlaps(dev, vq, imsg->iova, len)) {
+				vhost_user_iotlb_wr_lock(vq);
+				vring_translate(dev, vq);
+				vhost_user_iotlb_wr_unlock(vq);
+			}
+		}
+		break;
+	case VHOST_IOTLB_INVALIDATE:
+		for (i = 0; i < dev->nr_vring; i++) {
+			vq = dev->virtqueue[i];
+			if (vq == NULL)
+				continue;
+
+			vhost_user_iotlb_cache_remove(vq, imsg->iova,
+						      imsg->size);
+
+			if (vring_overlaps(dev, vq, imsg->iova, imsg->size)) {
+				vhost_user_iotlb_wr_lock(vq);
+				vring_invalidate(dev, vq);
+				vhost_user_iotlb_wr_unlock(vq);
+			}
+		}
+		break;
+	default:
+		RTE_LOG(ERR, VHOST_CONFIG,
+			"invalid IOTLB message type (%d)\n", imsg->type);
+		return -1;
+	}
+
+	return 0;
+}
+
 /* return bytes# of read on success or negative val on failure. */
 static int
 read_vhost_message(int sockfd, struct VhostUserMsg *msg)
@@ -926,28 +1275,35 @@ send_vhost_message(int sockfd, struct VhostUserMsg *msg)
 /*
  * Allocate a queue pair if it hasn't been allocated yet
  */
+/* The vring a message is about, or -1 */
 static int
-vhost_user_check_and_alloc_queue_pair(struct virtio_net *dev, VhostUserMsg *msg)
+vhost_user_msg_vring_idx(VhostUserMsg *msg)
 {
-	uint16_t vring_idx;
-
-	switch (msg->request) {
+	switch (msg->request.master) {
 	case VHOST_USER_SET_VRING_KICK:
 	case VHOST_USER_SET_VRING_CALL:
 	case VHOST_USER_SET_VRING_ERR:
-		vring_idx = msg->payload.u64 & VHOST_USER_VRING_IDX_MASK;
-		break;
+		return msg->payload.u64 & VHOST_USER_VRING_IDX_MASK;
 	case VHOST_USER_SET_VRING_NUM:
 	case VHOST_USER_SET_VRING_BASE:
+	case VHOST_USER_GET_VRING_BASE:
 	case VHOST_USER_SET_VRING_ENABLE:
-		vring_idx = msg->payload.state.index;
-		break;
+		return msg->payload.state.index;
 	case VHOST_USER_SET_VRING_ADDR:
-		vring_idx = msg->payload.addr.index;
-		break;
+		return msg->payload.addr.index;
 	default:
-		return 0;
+		return -1;
 	}
+}
+
+static int
+vhost_user_check_and_alloc_queue_pair(struct virtio_net *dev, VhostUserMsg *msg)
+{
+	int vring_idx;
+
+	vring_idx = vhost_user_msg_vring_idx(msg);
+	if (vring_idx < 0)
+		return 0;
 
 	if (vring_idx >= VHOST_MAX_VRING) {
 		RTE_LOG(ERR, VHOST_CONFIG,
@@ -961,11 +1317,63 @@ vhost_user_check_and_alloc_queue_pair(struct virtio_net *dev, VhostUserMsg *msg)
 	return alloc_vring_queue(dev, vring_idx);
 }
 
+/*
+ * The messages changing what the data path reads wait for the bursts in
+ * flight: on their own vring for the per-vring ones, on all of them for
+ * the device-wide ones. Returns the number of vrings locked, the first
+ * of them in *first.
+ */
+static uint32_t
+vhost_user_lock_vrings(struct virtio_net *dev, VhostUserMsg *msg,
+		       uint32_t *first)
+{
+	uint32_t i, nr;
+
+	switch (msg->request.master) {
+	case VHOST_USER_SET_FEATURES:
+	case VHOST_USER_RESET_OWNER:
+	case VHOST_USER_SET_MEM_TABLE:
+	case VHOST_USER_SET_LOG_BASE:
+		*first = 0;
+		nr = dev->nr_vring;
+		break;
+	case VHOST_USER_SET_VRING_NUM:
+	case VHOST_USER_SET_VRING_ADDR:
+	case VHOST_USER_SET_VRING_BASE:
+	case VHOST_USER_GET_VRING_BASE:
+	case VHOST_USER_SET_VRING_KICK:
+	case VHOST_USER_SET_VRING_CALL:
+	case VHOST_USER_SET_VRING_ENABLE:
+		*first = vhost_user_msg_vring_idx(msg);
+		nr = 1;
+		break;
+	default:
+		return 0;
+	}
+
+	for (i = *first; i < *first + nr; i++)
+		if (dev->virtqueue[i] != NULL)
+			rte_spinlock_lock(&dev->virtqueue[i]->access_lock);
+
+	return nr;
+}
+
+static void
+vhost_user_unlock_vrings(struct virtio_net *dev, uint32_t first, uint32_t nr)
+{
+	uint32_t i;
+
+	for (i = first; i < first + nr; i++)
+		if (dev->virtqueue[i] != NULL)
+			rte_spinlock_unlock(&dev->virtqueue[i]->access_lock);
+}
+
 int
 vhost_user_msg_handler(int vid, int fd)
 {
 	struct virtio_net *dev;
 	struct VhostUserMsg msg;
+	uint32_t first_locked = 0, nr_locked;
 	int ret;
 
 	dev = get_device(vid);
@@ -983,7 +1391,7 @@ vhost_user_msg_handler(int vid, int fd)
 	}
 
 	ret = read_vhost_message(fd, &msg);
-	if (ret <= 0 || msg.request >= VHOST_USER_MAX) {
+	if (ret <= 0 || msg.request.master >= VHOST_USER_MAX) {
 		if (ret < 0)
 			RTE_LOG(ERR, VHOST_CONFIG,
 				"vhost read message failed\n");
@@ -999,7 +1407,7 @@ vhost_user_msg_handler(int vid, int fd)
 
 	ret = 0;
 	RTE_LOG(INFO, VHOST_CONFIG, "read message %s\n",
-		vhost_message_str[msg.request]);
+		vhost_message_str[msg.request.master]);
 
 	ret = vhost_user_check_and_alloc_queue_pair(dev, &msg);
 	if (ret < 0) {
@@ -1008,7 +1416,9 @@ vhost_user_msg_handler(int vid, int fd)
 		return -1;
 	}
 
-	switch (msg.request) {
+	nr_locked = vhost_user_lock_vrings(dev, &msg, &first_locked);
+
+	switch (msg.request.master) {
 	case VHOST_USER_GET_FEATURES:
 		msg.payload.u64 = vhost_user_get_features(dev);
 		msg.size = sizeof(msg.payload.u64);
@@ -1096,12 +1506,32 @@ vhost_user_msg_handler(int vid, int fd)
 		ret = vhost_user_net_set_mtu(dev, &msg);
 		break;
 
+	case VHOST_USER_SET_SLAVE_REQ_FD:
+		ret = vhost_user_set_req_fd(dev, &msg);
+		break;
+
+	case VHOST_USER_IOTLB_MSG:
+		ret = vhost_user_iotlb_msg(dev, &msg);
+		break;
+
 	default:
 		ret = -1;
+		if (dev->extern_msg_handler) {
+			uint32_t require_reply = 0;
+
+			ret = dev->extern_msg_handler(dev->vid, &msg,
+						      &require_reply);
+			if (ret == 0 && require_reply)
+				send_vhost_message(fd, &msg);
+		}
 		break;
 
 	}
 
+	/* the vring address may have moved the device to another node */
+	dev = get_device(vid);
+	vhost_user_unlock_vrings(dev, first_locked, nr_locked);
+
 	if (msg.flags & VHOST_USER_NEED_REPLY) {
 		msg.payload.u64 = !!ret;
 		msg.size = sizeof(msg.payload.u64);
@@ -1124,3 +1554,33 @@ vhost_user_msg_handler(int vid, int fd)
 
 	return 0;
 }
+
+/*
+ * Ask the master for the translation of iova, on the slave channel. The
+ * answer comes back as an IOTLB update on the main channel.
+ */
+int
+vhost_user_iotlb_miss(struct virtio_net *dev, uint64_t iova, uint8_t perm)
+{
+	int ret;
+	struct VhostUserMsg msg = {
+		.request.slave = VHOST_USER_SLAVE_IOTLB_MSG,
+		.flags = VHOST_USER_VERSION,
+		.size = sizeof(msg.payload.iotlb),
+		.payload.iotlb = {
+			.iova = iova,
+			.perm = perm,
+			.type = VHOST_IOTLB_MISS,
+		},
+	};
+
+	if (dev->slave_req_fd < 0)
+		return -1;
+
+	rte_spinlock_lock(&dev->slave_req_lock);
+	ret = send_fd_message(dev->slave_req_fd, (char *)&msg,
+			      VHOST_USER_HDR_SIZE + msg.size, NULL, 0);
+	rte_spinlock_unlock(&dev->slave_req_lock);
+
+	return ret < 0 ? -1 : 0;
+}
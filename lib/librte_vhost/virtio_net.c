@@ -37,6 +37,7 @@
 
 #include <rte_mbuf.h>
 #include <rte_memcpy.h>
+#include <rte_malloc.h>
 #include <rte_ether.h>
 #include <rte_ip.h>
 #include <rte_vhost.h>
@@ -45,6 +46,7 @@
 #include <rte_sctp.h>
 #include <rte_arp.h>
 
+#include "iotlb.h"
 #include "vhost.h"
 
 #define MAX_PKT_BURST 32
@@ -55,6 +57,44 @@ is_valid_virt_queue_idx(uint32_t idx, int is_tx, uint32_t nr_vring)
 	return (is_tx ^ (idx & 1)) == 0 && idx < nr_vring;
 }
 
+/*
+ * The access lock is held along a burst, so that vhost-user messages
+ * wait for it before changing the virtqueue or the memory table; the
+ * burst is skipped while one of them is being handled.
+ *
+ * With an IOMMU, the IOTLB lock is held too so that the guest buffers
+ * we translated stay mapped, and the rings are translated again if they
+ * were invalidated. Returns -1, with the locks released, while they
+ * cannot be. The end of a burst also flushes the dirty page log cache.
+ */
+static __rte_always_inline void
+vring_access_end(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	vhost_log_cache_sync(dev, vq);
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		vhost_user_iotlb_rd_unlock(vq);
+
+	rte_spinlock_unlock(&vq->access_lock);
+}
+
+static __rte_always_inline int
+vring_access_begin(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	if (unlikely(rte_spinlock_trylock(&vq->access_lock) == 0))
+		return -1;
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		vhost_user_iotlb_rd_lock(vq);
+
+	if (unlikely(vq->access_ok == 0) && vring_translate(dev, vq) < 0) {
+		vring_access_end(dev, vq);
+		return -1;
+	}
+
+	return 0;
+}
+
 static __rte_always_inline void
 do_flush_shadow_used_ring(struct virtio_net *dev, struct vhost_virtqueue *vq,
 			  uint16_t to, uint16_t from, uint16_t size)
@@ -62,7 +102,7 @@ do_flush_shadow_used_ring(struct virtio_net *dev, struct vhost_virtqueue *vq,
 	rte_memcpy(&vq->used->ring[to],
 			&vq->shadow_used_ring[from],
 			size * sizeof(struct vring_used_elem));
-	vhost_log_used_vring(dev, vq,
+	vhost_log_cache_used_vring(dev, vq,
 			offsetof(struct vring_used, ring[to]),
 			size * sizeof(struct vring_used_elem));
 }
@@ -91,7 +131,7 @@ flush_shadow_used_ring(struct virtio_net *dev, struct vhost_virtqueue *vq)
 	rte_smp_wmb();
 
 	*(volatile uint16_t *)&vq->used->idx += vq->shadow_used_idx;
-	vhost_log_used_vring(dev, vq, offsetof(struct vring_used, idx),
+	vhost_log_cache_used_vring(dev, vq, offsetof(struct vring_used, idx),
 		sizeof(vq->used->idx));
 }
 
@@ -105,6 +145,89 @@ update_shadow_used_ring(struct vhost_virtqueue *vq,
 	vq->shadow_used_ring[i].len = len;
 }
 
+static __rte_always_inline void
+update_shadow_used_packed(struct vhost_virtqueue *vq,
+			  uint16_t buf_id, uint32_t len, uint16_t count)
+{
+	uint16_t i = vq->shadow_used_idx++;
+
+	vq->shadow_used_packed[i].id    = buf_id;
+	vq->shadow_used_packed[i].len   = len;
+	vq->shadow_used_packed[i].count = count;
+}
+
+/*
+ * Write the used elements back into the packed desc ring. Ids and lengths
+ * go first; the flags hand the descriptors back to the driver, and the
+ * flags of the first one are written last so the driver never sees a
+ * partially updated batch.
+ */
+static __rte_always_inline void
+flush_shadow_used_ring_packed(struct virtio_net *dev,
+			      struct vhost_virtqueue *vq)
+{
+	struct vring_packed_desc *descs = vq->desc_packed;
+	uint16_t used_idx = vq->last_used_idx;
+	uint16_t head_idx = used_idx;
+	uint16_t head_flags = 0;
+	uint16_t flags;
+	uint16_t i;
+
+	for (i = 0; i < vq->shadow_used_idx; i++) {
+		descs[used_idx].id  = vq->shadow_used_packed[i].id;
+		descs[used_idx].len = vq->shadow_used_packed[i].len;
+
+		used_idx += vq->shadow_used_packed[i].count;
+		if (used_idx >= vq->size)
+			used_idx -= vq->size;
+	}
+
+	rte_smp_wmb();
+
+	used_idx = head_idx;
+	for (i = 0; i < vq->shadow_used_idx; i++) {
+		flags = vq->used_wrap_counter ?
+			VRING_DESC_F_AVAIL | VRING_DESC_F_USED : 0;
+		if (vq->shadow_used_packed[i].len)
+			flags |= VRING_DESC_F_WRITE;
+
+		if (i > 0) {
+			descs[used_idx].flags = flags;
+			vhost_log_cache_used_vring(dev, vq,
+				used_idx * sizeof(struct vring_packed_desc),
+				sizeof(struct vring_packed_desc));
+		} else {
+			head_flags = flags;
+		}
+
+		used_idx += vq->shadow_used_packed[i].count;
+		if (used_idx >= vq->size) {
+			used_idx -= vq->size;
+			vq->used_wrap_counter ^= 1;
+		}
+	}
+
+	rte_smp_wmb();
+
+	descs[head_idx].flags = head_flags;
+	vhost_log_cache_used_vring(dev, vq,
+			head_idx * sizeof(struct vring_packed_desc),
+			sizeof(struct vring_packed_desc));
+
+	vq->last_used_idx = used_idx;
+}
+
+static __rte_always_inline void
+vhost_vring_call_packed(struct vhost_virtqueue *vq)
+{
+	/* flush the used descs before we read the driver event flags. */
+	rte_mb();
+
+	if (vq->driver_event->flags != RING_EVENT_FLAGS_DISABLE &&
+			vq->callfd >= 0)
+		eventfd_write(vq->callfd, (eventfd_t)1);
+}
+
 /* avoid write operation when necessary, to lessen cache issues */
 #define ASSIGN_UNLESS_EQUAL(var, val) do {	\
 	if ((var) != (val))			\
@@ -167,20 +290,215 @@ virtio_enqueue_offload(struct rte_mbuf *m_buf, struct virtio_net_hdr *net_hdr)
 	}
 }
 
+/*
+ * Run the small copies gathered during an enqueue burst back to back,
+ * then mark the guest pages they wrote, merging adjacent ranges.
+ */
+static __rte_always_inline void
+do_data_copy_enqueue(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	struct batch_copy_elem *elem = vq->batch_copy_elems;
+	uint16_t count = vq->batch_copy_nb_elems;
+	uint64_t log_addr, log_len;
+	uint16_t i;
+
+	for (i = 0; i < count; i++) {
+		rte_memcpy(elem[i].dst, elem[i].src, elem[i].len);
+		PRINT_PACKET(dev, (uintptr_t)elem[i].dst, elem[i].len, 0);
+	}
+	vq->batch_copy_nb_elems = 0;
+
+	if (likely((dev->features & (1ULL << VHOST_F_LOG_ALL)) == 0) ||
+	    count == 0)
+		return;
+
+	log_addr = elem[0].log_addr;
+	log_len = elem[0].len;
+	for (i = 1; i < count; i++) {
+		if (elem[i].log_addr == log_addr + log_len) {
+			log_len += elem[i].len;
+			continue;
+		}
+		vhost_log_cache_write_iova(dev, vq, log_addr, log_len);
+		log_addr = elem[i].log_addr;
+		log_len = elem[i].len;
+	}
+	vhost_log_cache_write_iova(dev, vq, log_addr, log_len);
+}
+
+static __rte_always_inline void
+do_data_copy_dequeue(struct vhost_virtqueue *vq)
+{
+	struct batch_copy_elem *elem = vq->batch_copy_elems;
+	uint16_t count = vq->batch_copy_nb_elems;
+	uint16_t i;
+
+	for (i = 0; i < count; i++)
+		rte_memcpy(elem[i].dst, elem[i].src, elem[i].len);
+	vq->batch_copy_nb_elems = 0;
+}
+
+/*
+ * Copy cpy_len bytes to the guest, right away when the copy is large or
+ * the batch is full, otherwise at the end of the burst. On a queue bound
+ * to a copy engine, large copies are left to the engine.
+ */
+static __rte_always_inline void
+copy_to_desc(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	     uint64_t desc_addr, uint64_t desc_gpa, void *src,
+	     uint32_t cpy_len)
+{
+	struct batch_copy_elem *elem;
+
+	if (unlikely(vq->async != NULL) &&
+	    cpy_len >= vq->async->burst_threshold &&
+	    vq->async->copies_inflight_n + vq->async->nr_copies < vq->size) {
+		struct vhost_async *async = vq->async;
+		struct rte_vhost_async_copy *copy;
+		struct async_copy_log *log;
+
+		log = &async->copies_log[(async->log_idx + async->nr_copies) &
+					 (vq->size - 1)];
+		log->log_addr = desc_gpa;
+		log->len = cpy_len;
+		copy = &async->copies[async->nr_copies++];
+		copy->dst = (void *)((uintptr_t)desc_addr);
+		copy->src = src;
+		copy->len = cpy_len;
+		return;
+	}
+
+	if (likely(cpy_len > MAX_BATCH_LEN ||
+		   vq->batch_copy_nb_elems >= vq->size)) {
+		rte_memcpy((void *)((uintptr_t)desc_addr), src, cpy_len);
+		vhost_log_cache_write_iova(dev, vq, desc_gpa, cpy_len);
+		PRINT_PACKET(dev, (uintptr_t)desc_addr, cpy_len, 0);
+		return;
+	}
+
+	elem = &vq->batch_copy_elems[vq->batch_copy_nb_elems++];
+	elem->dst = (void *)((uintptr_t)desc_addr);
+	elem->src = src;
+	elem->len = cpy_len;
+	elem->log_addr = desc_gpa;
+}
+
+static __rte_always_inline void
+copy_from_desc(struct vhost_virtqueue *vq, void *dst, uint64_t desc_addr,
+	       uint32_t cpy_len, int batch)
+{
+	struct batch_copy_elem *elem;
+
+	if (likely(cpy_len > MAX_BATCH_LEN || !batch ||
+		   vq->batch_copy_nb_elems >= vq->size)) {
+		rte_memcpy(dst, (void *)((uintptr_t)desc_addr), cpy_len);
+		return;
+	}
+
+	elem = &vq->batch_copy_elems[vq->batch_copy_nb_elems++];
+	elem->dst = dst;
+	elem->src = (void *)((uintptr_t)desc_addr);
+	elem->len = cpy_len;
+}
+
+/*
+ * With an IOMMU, a guest buffer may be mapped in pieces which are not
+ * contiguous in our address space. The data is copied chunk by chunk;
+ * these two copy the small areas we otherwise access in place.
+ */
+static __rte_always_inline int
+copy_to_guest(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	      uint64_t iova, const void *src, uint64_t len)
+{
+	uint64_t dst, dlen;
+
+	while (len) {
+		dlen = len;
+		dst = vhost_iova_to_vva(dev, vq, iova, &dlen, VHOST_ACCESS_WO);
+		if (unlikely(!dst))
+			return -1;
+
+		rte_memcpy((void *)(uintptr_t)dst, src, dlen);
+		vhost_log_cache_write_iova(dev, vq, iova, dlen);
+		PRINT_PACKET(dev, (uintptr_t)dst, dlen, 0);
+
+		src = (const char *)src + dlen;
+		iova += dlen;
+		len -= dlen;
+	}
+
+	return 0;
+}
+
+static __rte_always_inline int
+copy_from_guest(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		void *dst, uint64_t iova, uint64_t len)
+{
+	uint64_t src, dlen;
+
+	while (len) {
+		dlen = len;
+		src = vhost_iova_to_vva(dev, vq, iova, &dlen, VHOST_ACCESS_RO);
+		if (unlikely(!src))
+			return -1;
+
+		rte_memcpy(dst, (void *)(uintptr_t)src, dlen);
+
+		dst = (char *)dst + dlen;
+		iova += dlen;
+		len -= dlen;
+	}
+
+	return 0;
+}
+
+/*
+ * Translate an indirect desc table. When it is not contiguous in our
+ * address space, it is copied in *copy, to be freed with rte_free().
+ */
+static __rte_always_inline void *
+ind_table_to_vva(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		 uint64_t iova, uint64_t len, void **copy)
+{
+	uint64_t dlen = len;
+	void *descs;
+
+	descs = (void *)(uintptr_t)vhost_iova_to_vva(dev, vq, iova, &dlen,
+						     VHOST_ACCESS_RO);
+	if (likely(descs == NULL || dlen == len))
+		return descs;
+
+	descs = rte_malloc(__func__, len, 0);
+	if (unlikely(descs == NULL))
+		return NULL;
+
+	if (unlikely(copy_from_guest(dev, vq, descs, iova, len) < 0)) {
+		rte_free(descs);
+		return NULL;
+	}
+
+	*copy = descs;
+	return descs;
+}
+
 static __rte_always_inline int
-copy_mbuf_to_desc(struct virtio_net *dev, struct vring_desc *descs,
-		  struct rte_mbuf *m, uint16_t desc_idx, uint32_t size)
+copy_mbuf_to_desc(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		  struct vring_desc *descs, struct rte_mbuf *m,
+		  uint16_t desc_idx, uint32_t size)
 {
 	uint32_t desc_avail, desc_offset;
 	uint32_t mbuf_avail, mbuf_offset;
 	uint32_t cpy_len;
 	struct vring_desc *desc;
-	uint64_t desc_addr;
+	uint64_t desc_addr, desc_iova, desc_chunk_len;
 	/* A counter to avoid desc dead loop chain */
 	uint16_t nr_desc = 1;
 
 	desc = &descs[desc_idx];
-	desc_addr = rte_vhost_gpa_to_vva(dev->mem, desc->addr);
+	desc_iova = desc->addr;
+	desc_chunk_len = desc->len;
+	desc_addr = vhost_iova_to_vva(dev, vq, desc_iova, &desc_chunk_len,
+				      VHOST_ACCESS_WO);
 	/*
 	 * Checking of 'desc_addr' placed outside of 'unlikely' macro to avoid
 	 * performance issue with some versions of gcc (4.8.4 and 5.3.0) which
@@ -191,9 +509,22 @@ copy_mbuf_to_desc(struct virtio_net *dev, struct vring_desc *descs,
 
 	rte_prefetch0((void *)(uintptr_t)desc_addr);
 
-	virtio_enqueue_offload(m, (struct virtio_net_hdr *)(uintptr_t)desc_addr);
-	vhost_log_write(dev, desc->addr, dev->vhost_hlen);
-	PRINT_PACKET(dev, (uintptr_t)desc_addr, dev->vhost_hlen, 0);
+	if (likely(desc_chunk_len >= dev->vhost_hlen)) {
+		virtio_enqueue_offload(m,
+			(struct virtio_net_hdr *)(uintptr_t)desc_addr);
+		vhost_log_cache_write_iova(dev, vq, desc_iova, dev->vhost_hlen);
+		PRINT_PACKET(dev, (uintptr_t)desc_addr, dev->vhost_hlen, 0);
+		desc_chunk_len -= dev->vhost_hlen;
+	} else {
+		struct virtio_net_hdr hdr;
+
+		memset(&hdr, 0, sizeof(hdr));
+		virtio_enqueue_offload(m, &hdr);
+		if (unlikely(copy_to_guest(dev, vq, desc_iova, &hdr,
+					   sizeof(hdr)) < 0))
+			return -1;
+		desc_chunk_len = 0;
+	}
 
 	desc_offset = dev->vhost_hlen;
 	desc_avail  = desc->len - dev->vhost_hlen;
@@ -219,26 +550,40 @@ copy_mbuf_to_desc(struct virtio_net *dev, struct vring_desc *descs,
 				return -1;
 
 			desc = &descs[desc->next];
-			desc_addr = rte_vhost_gpa_to_vva(dev->mem, desc->addr);
+			desc_iova = desc->addr;
+			desc_chunk_len = desc->len;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_WO);
 			if (unlikely(!desc_addr))
 				return -1;
 
 			desc_offset = 0;
 			desc_avail  = desc->len;
+		} else if (unlikely(desc_chunk_len == 0)) {
+			/* done with the mapped chunk, translate the next one */
+			desc_iova += desc_offset;
+			desc_chunk_len = desc_avail;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_WO);
+			if (unlikely(!desc_addr))
+				return -1;
+
+			desc_offset = 0;
 		}
 
-		cpy_len = RTE_MIN(desc_avail, mbuf_avail);
-		rte_memcpy((void *)((uintptr_t)(desc_addr + desc_offset)),
+		cpy_len = RTE_MIN(desc_chunk_len, mbuf_avail);
+		copy_to_desc(dev, vq, desc_addr + desc_offset,
+			desc_iova + desc_offset,
 			rte_pktmbuf_mtod_offset(m, void *, mbuf_offset),
 			cpy_len);
-		vhost_log_write(dev, desc->addr + desc_offset, cpy_len);
-		PRINT_PACKET(dev, (uintptr_t)(desc_addr + desc_offset),
-			     cpy_len, 0);
 
 		mbuf_avail  -= cpy_len;
 		mbuf_offset += cpy_len;
 		desc_avail  -= cpy_len;
 		desc_offset += cpy_len;
+		desc_chunk_len -= cpy_len;
 	}
 
 	return 0;
@@ -284,6 +629,8 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 	LOG_DEBUG(VHOST_DATA, "(%d) start_idx %d | end_idx %d\n",
 		dev->vid, start_idx, start_idx + count);
 
+	vq->batch_copy_nb_elems = 0;
+
 	/* Retrieve all of the desc indexes first to avoid caching issues. */
 	rte_prefetch0(&vq->avail->ring[start_idx & (vq->size - 1)]);
 	for (i = 0; i < count; i++) {
@@ -292,7 +639,7 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 		vq->used->ring[used_idx].id = desc_indexes[i];
 		vq->used->ring[used_idx].len = pkts[i]->pkt_len +
 					       dev->vhost_hlen;
-		vhost_log_used_vring(dev, vq,
+		vhost_log_cache_used_vring(dev, vq,
 			offsetof(struct vring_used, ring[used_idx]),
 			sizeof(vq->used->ring[used_idx]));
 	}
@@ -300,29 +647,35 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 	rte_prefetch0(&vq->desc[desc_indexes[0]]);
 	for (i = 0; i < count; i++) {
 		uint16_t desc_idx = desc_indexes[i];
+		uint16_t nb_copies = vq->batch_copy_nb_elems;
+		void *idesc = NULL;
 		int err;
 
 		if (vq->desc[desc_idx].flags & VRING_DESC_F_INDIRECT) {
-			descs = (struct vring_desc *)(uintptr_t)
-				rte_vhost_gpa_to_vva(dev->mem,
-					vq->desc[desc_idx].addr);
+			descs = ind_table_to_vva(dev, vq,
+					vq->desc[desc_idx].addr,
+					vq->desc[desc_idx].len, &idesc);
 			if (unlikely(!descs)) {
 				count = i;
 				break;
 			}
 
-			desc_idx = 0;
 			sz = vq->desc[desc_idx].len / sizeof(*descs);
+			desc_idx = 0;
 		} else {
 			descs = vq->desc;
 			sz = vq->size;
 		}
 
-		err = copy_mbuf_to_desc(dev, descs, pkts[i], desc_idx, sz);
+		err = copy_mbuf_to_desc(dev, vq, descs, pkts[i], desc_idx, sz);
+		if (unlikely(idesc != NULL))
+			rte_free(idesc);
 		if (unlikely(err)) {
+			/* the guest only gets the header of this packet */
+			vq->batch_copy_nb_elems = nb_copies;
 			used_idx = (start_idx + i) & (vq->size - 1);
 			vq->used->ring[used_idx].len = dev->vhost_hlen;
-			vhost_log_used_vring(dev, vq,
+			vhost_log_cache_used_vring(dev, vq,
 				offsetof(struct vring_used, ring[used_idx]),
 				sizeof(vq->used->ring[used_idx]));
 		}
@@ -331,21 +684,17 @@ virtio_dev_rx(struct virtio_net *dev, uint16_t queue_id,
 			rte_prefetch0(&vq->desc[desc_indexes[i+1]]);
 	}
 
+	do_data_copy_enqueue(dev, vq);
+
 	rte_smp_wmb();
 
 	*(volatile uint16_t *)&vq->used->idx += count;
 	vq->last_used_idx += count;
-	vhost_log_used_vring(dev, vq,
+	vhost_log_cache_used_vring(dev, vq,
 		offsetof(struct vring_used, idx),
 		sizeof(vq->used->idx));
 
-	/* flush used->idx update before we read avail->flags. */
-	rte_mb();
-
-	/* Kick the guest if necessary. */
-	if (!(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT)
-			&& (vq->callfd >= 0))
-		eventfd_write(vq->callfd, (eventfd_t)1);
+	vhost_vring_call(dev, vq);
 	return count;
 }
 
@@ -359,12 +708,13 @@ fill_vec_buf(struct virtio_net *dev, struct vhost_virtqueue *vq,
 	uint32_t vec_id = *vec_idx;
 	uint32_t len    = 0;
 	struct vring_desc *descs = vq->desc;
+	void *idesc = NULL;
 
 	*desc_chain_head = idx;
 
 	if (vq->desc[idx].flags & VRING_DESC_F_INDIRECT) {
-		descs = (struct vring_desc *)(uintptr_t)
-			rte_vhost_gpa_to_vva(dev->mem, vq->desc[idx].addr);
+		descs = ind_table_to_vva(dev, vq, vq->desc[idx].addr,
+					 vq->desc[idx].len, &idesc);
 		if (unlikely(!descs))
 			return -1;
 
@@ -372,8 +722,11 @@ fill_vec_buf(struct virtio_net *dev, struct vhost_virtqueue *vq,
 	}
 
 	while (1) {
-		if (unlikely(vec_id >= BUF_VECTOR_MAX || idx >= vq->size))
+		if (unlikely(vec_id >= BUF_VECTOR_MAX || idx >= vq->size)) {
+			if (unlikely(idesc != NULL))
+				rte_free(idesc);
 			return -1;
+		}
 
 		len += descs[idx].len;
 		buf_vec[vec_id].buf_addr = descs[idx].addr;
@@ -387,6 +740,9 @@ fill_vec_buf(struct virtio_net *dev, struct vhost_virtqueue *vq,
 		idx = descs[idx].next;
 	}
 
+	if (unlikely(idesc != NULL))
+		rte_free(idesc);
+
 	*desc_chain_len = len;
 	*vec_idx = vec_id;
 
@@ -438,12 +794,100 @@ reserve_avail_buf_mergeable(struct virtio_net *dev, struct vhost_virtqueue *vq,
 	return 0;
 }
 
+/*
+ * Gather the buffer starting at packed desc ring position 'avail_idx'
+ * into buf_vec. The buffer takes 'desc_count' ring entries: the length of
+ * the chain, or a single one for an indirect table.
+ */
+static __rte_always_inline int
+fill_vec_buf_packed(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		    uint16_t avail_idx, uint8_t wrap_counter,
+		    uint32_t *vec_idx, struct buf_vector *buf_vec,
+		    uint16_t *buf_id, uint32_t *len, uint16_t *desc_count)
+{
+	struct vring_packed_desc *descs = vq->desc_packed;
+	struct vring_packed_desc *idescs;
+	uint32_t vec_id = *vec_idx;
+	uint32_t nr_idesc, i;
+
+	if (!desc_is_avail(&descs[avail_idx], wrap_counter))
+		return -1;
+
+	/* read the desc body only after we know it's ours. */
+	rte_smp_rmb();
+
+	*len = 0;
+	*desc_count = 0;
+
+	if (descs[avail_idx].flags & VRING_DESC_F_INDIRECT) {
+		void *copy = NULL;
+
+		nr_idesc = descs[avail_idx].len / sizeof(*idescs);
+		if (unlikely(nr_idesc == 0 || nr_idesc > vq->size))
+			return -1;
+
+		idescs = ind_table_to_vva(dev, vq, descs[avail_idx].addr,
+					  descs[avail_idx].len, &copy);
+		if (unlikely(!idescs))
+			return -1;
+
+		for (i = 0; i < nr_idesc; i++) {
+			if (unlikely(vec_id >= BUF_VECTOR_MAX))
+				break;
+
+			*len += idescs[i].len;
+			buf_vec[vec_id].buf_addr = idescs[i].addr;
+			buf_vec[vec_id].buf_len  = idescs[i].len;
+			buf_vec[vec_id].desc_idx = i;
+			vec_id++;
+		}
+
+		if (unlikely(copy != NULL))
+			rte_free(copy);
+		if (unlikely(i < nr_idesc))
+			return -1;
+
+		*buf_id = descs[avail_idx].id;
+		*desc_count = 1;
+		*vec_idx = vec_id;
+
+		return 0;
+	}
+
+	while (1) {
+		if (unlikely(vec_id >= BUF_VECTOR_MAX ||
+			     *desc_count >= vq->size))
+			return -1;
+
+		*len += descs[avail_idx].len;
+		buf_vec[vec_id].buf_addr = descs[avail_idx].addr;
+		buf_vec[vec_id].buf_len  = descs[avail_idx].len;
+		buf_vec[vec_id].desc_idx = avail_idx;
+		vec_id++;
+
+		*desc_count += 1;
+		/* the buffer id lives in the last desc of the chain */
+		*buf_id = descs[avail_idx].id;
+
+		if ((descs[avail_idx].flags & VRING_DESC_F_NEXT) == 0)
+			break;
+
+		if (++avail_idx >= vq->size)
+			avail_idx -= vq->size;
+	}
+
+	*vec_idx = vec_id;
+
+	return 0;
+}
+
 static __rte_always_inline int
-copy_mbuf_to_desc_mergeable(struct virtio_net *dev, struct rte_mbuf *m,
-			    struct buf_vector *buf_vec, uint16_t num_buffers)
+copy_mbuf_to_desc_mergeable(struct virtio_net *dev, struct vhost_virtqueue *vq,
+			    struct rte_mbuf *m, struct buf_vector *buf_vec,
+			    uint16_t num_buffers)
 {
 	uint32_t vec_idx = 0;
-	uint64_t desc_addr;
+	uint64_t desc_addr, desc_iova, desc_chunk_len;
 	uint32_t mbuf_offset, mbuf_avail;
 	uint32_t desc_offset, desc_avail;
 	uint32_t cpy_len;
@@ -453,14 +897,32 @@ copy_mbuf_to_desc_mergeable(struct virtio_net *dev, struct rte_mbuf *m,
 	if (unlikely(m == NULL))
 		return -1;
 
-	desc_addr = rte_vhost_gpa_to_vva(dev->mem, buf_vec[vec_idx].buf_addr);
+	desc_iova = buf_vec[vec_idx].buf_addr;
+	desc_chunk_len = buf_vec[vec_idx].buf_len;
+	desc_addr = vhost_iova_to_vva(dev, vq, desc_iova, &desc_chunk_len,
+				      VHOST_ACCESS_WO);
 	if (buf_vec[vec_idx].buf_len < dev->vhost_hlen || !desc_addr)
 		return -1;
 
 	hdr_mbuf = m;
 	hdr_addr = desc_addr;
-	hdr_phys_addr = buf_vec[vec_idx].buf_addr;
-	rte_prefetch0((void *)(uintptr_t)hdr_addr);
+	hdr_phys_addr = desc_iova;
+	if (likely(desc_chunk_len >= dev->vhost_hlen)) {
+		rte_prefetch0((void *)(uintptr_t)hdr_addr);
+		desc_chunk_len -= dev->vhost_hlen;
+	} else {
+		struct virtio_net_hdr_mrg_rxbuf hdr;
+
+		/* the header is split, write it now through a copy */
+		memset(&hdr, 0, sizeof(hdr));
+		virtio_enqueue_offload(m, &hdr.hdr);
+		hdr.num_buffers = num_buffers;
+		if (unlikely(copy_to_guest(dev, vq, desc_iova, &hdr,
+					   dev->vhost_hlen) < 0))
+			return -1;
+		hdr_addr = 0;
+		desc_chunk_len = 0;
+	}
 
 	LOG_DEBUG(VHOST_DATA, "(%d) RX: num merge buffers %d\n",
 		dev->vid, num_buffers);
@@ -474,8 +936,11 @@ copy_mbuf_to_desc_mergeable(struct virtio_net *dev, struct rte_mbuf *m,
 		/* done with current desc buf, get the next one */
 		if (desc_avail == 0) {
 			vec_idx++;
-			desc_addr = rte_vhost_gpa_to_vva(dev->mem,
-					buf_vec[vec_idx].buf_addr);
+			desc_iova = buf_vec[vec_idx].buf_addr;
+			desc_chunk_len = buf_vec[vec_idx].buf_len;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_WO);
 			if (unlikely(!desc_addr))
 				return -1;
 
@@ -483,6 +948,17 @@ copy_mbuf_to_desc_mergeable(struct virtio_net *dev, struct rte_mbuf *m,
 			rte_prefetch0((void *)(uintptr_t)desc_addr);
 			desc_offset = 0;
 			desc_avail  = buf_vec[vec_idx].buf_len;
+		} else if (unlikely(desc_chunk_len == 0)) {
+			/* done with the mapped chunk, translate the next one */
+			desc_iova += desc_offset;
+			desc_chunk_len = desc_avail;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_WO);
+			if (unlikely(!desc_addr))
+				return -1;
+
+			desc_offset = 0;
 		}
 
 		/* done with current mbuf, get the next one */
@@ -501,42 +977,373 @@ copy_mbuf_to_desc_mergeable(struct virtio_net *dev, struct rte_mbuf *m,
 			virtio_enqueue_offload(hdr_mbuf, &hdr->hdr);
 			ASSIGN_UNLESS_EQUAL(hdr->num_buffers, num_buffers);
 
-			vhost_log_write(dev, hdr_phys_addr, dev->vhost_hlen);
+			vhost_log_cache_write_iova(dev, vq, hdr_phys_addr,
+					     dev->vhost_hlen);
 			PRINT_PACKET(dev, (uintptr_t)hdr_addr,
 				     dev->vhost_hlen, 0);
 
-			hdr_addr = 0;
-		}
+			hdr_addr = 0;
+		}
+
+		cpy_len = RTE_MIN(desc_chunk_len, mbuf_avail);
+		copy_to_desc(dev, vq, desc_addr + desc_offset,
+			desc_iova + desc_offset,
+			rte_pktmbuf_mtod_offset(m, void *, mbuf_offset),
+			cpy_len);
+
+		mbuf_avail  -= cpy_len;
+		mbuf_offset += cpy_len;
+		desc_avail  -= cpy_len;
+		desc_offset += cpy_len;
+		desc_chunk_len -= cpy_len;
+	}
+
+	return 0;
+}
+
+static __rte_always_inline uint32_t
+virtio_dev_merge_rx(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint32_t count)
+{
+	struct vhost_virtqueue *vq;
+	uint32_t pkt_idx = 0;
+	uint16_t num_buffers;
+	struct buf_vector buf_vec[BUF_VECTOR_MAX];
+	uint16_t avail_head;
+
+	LOG_DEBUG(VHOST_DATA, "(%d) %s\n", dev->vid, __func__);
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->nr_vring))) {
+		RTE_LOG(ERR, VHOST_DATA, "(%d) %s: invalid virtqueue idx %d.\n",
+			dev->vid, __func__, queue_id);
+		return 0;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (unlikely(vq->enabled == 0))
+		return 0;
+
+	/* a queue bound to a copy engine only takes async enqueues */
+	if (unlikely(vq->async != NULL))
+		return 0;
+
+	count = RTE_MIN((uint32_t)MAX_PKT_BURST, count);
+	if (count == 0)
+		return 0;
+
+	rte_prefetch0(&vq->avail->ring[vq->last_avail_idx & (vq->size - 1)]);
+
+	vq->shadow_used_idx = 0;
+	vq->batch_copy_nb_elems = 0;
+	avail_head = *((volatile uint16_t *)&vq->avail->idx);
+	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
+		uint32_t pkt_len = pkts[pkt_idx]->pkt_len + dev->vhost_hlen;
+		uint16_t nb_copies = vq->batch_copy_nb_elems;
+
+		if (unlikely(reserve_avail_buf_mergeable(dev, vq,
+						pkt_len, buf_vec, &num_buffers,
+						avail_head) < 0)) {
+			LOG_DEBUG(VHOST_DATA,
+				"(%d) failed to get enough desc from vring\n",
+				dev->vid);
+			vq->shadow_used_idx -= num_buffers;
+			break;
+		}
+
+		LOG_DEBUG(VHOST_DATA, "(%d) current index %d | end index %d\n",
+			dev->vid, vq->last_avail_idx,
+			vq->last_avail_idx + num_buffers);
+
+		if (copy_mbuf_to_desc_mergeable(dev, vq, pkts[pkt_idx],
+						buf_vec, num_buffers) < 0) {
+			vq->shadow_used_idx -= num_buffers;
+			vq->batch_copy_nb_elems = nb_copies;
+			break;
+		}
+
+		vq->last_avail_idx += num_buffers;
+	}
+
+	do_data_copy_enqueue(dev, vq);
+
+	if (likely(vq->shadow_used_idx)) {
+		flush_shadow_used_ring(dev, vq);
+		vhost_vring_call(dev, vq);
+	}
+
+	return pkt_idx;
+}
+
+/*
+ * Enqueue to a packed ring. A packet takes one buffer, or as many as it
+ * needs when mergeable Rx buffers are negotiated. Since virtio 1 is
+ * mandatory with the packed ring, the header always has room for
+ * num_buffers, so the mergeable copy routine serves both cases.
+ */
+static __rte_always_inline uint32_t
+virtio_dev_rx_packed(struct virtio_net *dev, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint32_t count)
+{
+	struct vhost_virtqueue *vq;
+	struct buf_vector buf_vec[BUF_VECTOR_MAX];
+	int mergeable = !!(dev->features & (1 << VIRTIO_NET_F_MRG_RXBUF));
+	uint32_t pkt_idx;
+
+	LOG_DEBUG(VHOST_DATA, "(%d) %s\n", dev->vid, __func__);
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->nr_vring))) {
+		RTE_LOG(ERR, VHOST_DATA, "(%d) %s: invalid virtqueue idx %d.\n",
+			dev->vid, __func__, queue_id);
+		return 0;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (unlikely(vq->enabled == 0))
+		return 0;
+
+	count = RTE_MIN((uint32_t)MAX_PKT_BURST, count);
+	if (count == 0)
+		return 0;
+
+	rte_prefetch0(&vq->desc_packed[vq->last_avail_idx]);
+
+	vq->shadow_used_idx = 0;
+	vq->batch_copy_nb_elems = 0;
+	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
+		uint32_t size = pkts[pkt_idx]->pkt_len + dev->vhost_hlen;
+		uint16_t nb_copies = vq->batch_copy_nb_elems;
+		uint16_t avail_idx = vq->last_avail_idx;
+		uint8_t wrap_counter = vq->avail_wrap_counter;
+		uint16_t num_buffers = 0;
+		uint32_t vec_idx = 0;
+		uint16_t buf_id, desc_count;
+		uint32_t len;
+		int dropped = 0;
+
+		while (size > 0) {
+			if (unlikely(fill_vec_buf_packed(dev, vq, avail_idx,
+					wrap_counter, &vec_idx, buf_vec,
+					&buf_id, &len, &desc_count) < 0))
+				break;
+
+			len = RTE_MIN(len, size);
+			size -= len;
+			/*
+			 * Like the split ring, a packet that doesn't fit in a
+			 * single non-mergeable buffer is dropped, and the
+			 * buffer is returned with nothing written.
+			 */
+			if (!mergeable && size > 0) {
+				len = 0;
+				size = 0;
+				dropped = 1;
+			}
+			update_shadow_used_packed(vq, buf_id, len, desc_count);
+			num_buffers += 1;
+
+			avail_idx += desc_count;
+			if (avail_idx >= vq->size) {
+				avail_idx -= vq->size;
+				wrap_counter ^= 1;
+			}
+		}
+
+		if (unlikely(size > 0)) {
+			LOG_DEBUG(VHOST_DATA,
+				"(%d) failed to get enough desc from vring\n",
+				dev->vid);
+			vq->shadow_used_idx -= num_buffers;
+			break;
+		}
+
+		if (likely(!dropped) &&
+		    copy_mbuf_to_desc_mergeable(dev, vq, pkts[pkt_idx],
+						buf_vec, num_buffers) < 0) {
+			vq->shadow_used_idx -= num_buffers;
+			vq->batch_copy_nb_elems = nb_copies;
+			break;
+		}
+
+		vq->last_avail_idx = avail_idx;
+		vq->avail_wrap_counter = wrap_counter;
+	}
+
+	do_data_copy_enqueue(dev, vq);
+
+	if (likely(vq->shadow_used_idx)) {
+		flush_shadow_used_ring_packed(dev, vq);
+		vhost_vring_call_packed(vq);
+	}
+
+	return pkt_idx;
+}
+
+/*
+ * Log the pages written by the oldest copies of the engine, once they
+ * are complete. Dirty logging may have been turned on since they were
+ * submitted.
+ */
+static __rte_always_inline void
+async_log_copies(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		 uint16_t nr_copies)
+{
+	struct vhost_async *async = vq->async;
+	struct async_copy_log *log;
+	uint16_t i;
+
+	for (i = 0; i < nr_copies; i++) {
+		log = &async->copies_log[(async->log_idx -
+					  async->copies_inflight_n) &
+					 (vq->size - 1)];
+		vhost_log_cache_write_iova(dev, vq, log->log_addr, log->len);
+		async->copies_inflight_n--;
+	}
+}
+
+uint16_t
+rte_vhost_submit_enqueue_burst(int vid, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint16_t count)
+{
+	struct virtio_net *dev = get_device(vid);
+	struct vhost_virtqueue *vq;
+	struct vhost_async *async;
+	struct async_inflight_info *info;
+	struct buf_vector buf_vec[BUF_VECTOR_MAX];
+	uint16_t num_buffers, avail_head;
+	uint16_t pkt_idx, i, n_xfer, excess;
+	uint16_t mask;
+
+	if (!dev)
+		return 0;
+
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->nr_vring))) {
+		RTE_LOG(ERR, VHOST_DATA, "(%d) %s: invalid virtqueue idx %d.\n",
+			dev->vid, __func__, queue_id);
+		return 0;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (unlikely(vq->enabled == 0))
+		return 0;
+
+	count = RTE_MIN((uint16_t)MAX_PKT_BURST, count);
+	if (count == 0)
+		return 0;
+
+	if (unlikely(vring_access_begin(dev, vq) < 0))
+		return 0;
+
+	async = vq->async;
+	if (unlikely(async == NULL)) {
+		pkt_idx = 0;
+		goto out;
+	}
+
+	mask = vq->size - 1;
+	rte_prefetch0(&vq->avail->ring[vq->last_avail_idx & mask]);
+
+	/*
+	 * With an IOMMU, the buffers may be unmapped as soon as this burst
+	 * releases the IOTLB lock, so copy everything here.
+	 */
+	if (unlikely(dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM)))
+		async->burst_threshold = UINT32_MAX;
+	else
+		async->burst_threshold = async->threshold;
+
+	vq->shadow_used_idx = 0;
+	vq->batch_copy_nb_elems = 0;
+	async->nr_copies = 0;
+	avail_head = *((volatile uint16_t *)&vq->avail->idx);
+	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
+		uint32_t pkt_len = pkts[pkt_idx]->pkt_len + dev->vhost_hlen;
+		uint16_t nb_copies = vq->batch_copy_nb_elems;
+		uint16_t nr_copies = async->nr_copies;
+
+		if (unlikely(reserve_avail_buf_mergeable(dev, vq,
+						pkt_len, buf_vec, &num_buffers,
+						avail_head) < 0)) {
+			vq->shadow_used_idx -= num_buffers;
+			break;
+		}
+
+		if (copy_mbuf_to_desc_mergeable(dev, vq, pkts[pkt_idx],
+						buf_vec, num_buffers) < 0) {
+			vq->shadow_used_idx -= num_buffers;
+			vq->batch_copy_nb_elems = nb_copies;
+			async->nr_copies = nr_copies;
+			break;
+		}
+
+		info = &async->pkts_info[(async->pkts_idx + pkt_idx) & mask];
+		info->mbuf = pkts[pkt_idx];
+		info->nr_copies = async->nr_copies - nr_copies;
+		info->nr_buffers = num_buffers;
+
+		vq->last_avail_idx += num_buffers;
+	}
+
+	do_data_copy_enqueue(dev, vq);
+
+	if (unlikely(pkt_idx == 0))
+		goto out;
+
+	/* hand the large copies to the engine, and do what it refuses */
+	n_xfer = 0;
+	if (async->nr_copies)
+		n_xfer = async->ops->submit(async->ctx, async->copies,
+					    async->nr_copies);
+	for (i = n_xfer; i < async->nr_copies; i++) {
+		rte_memcpy(async->copies[i].dst, async->copies[i].src,
+			   async->copies[i].len);
+		vhost_log_cache_write_iova(dev, vq,
+			async->copies_log[(async->log_idx + i) & mask].log_addr,
+			async->copies[i].len);
+	}
+	async->log_idx += n_xfer;
+	async->copies_inflight_n += n_xfer;
+
+	/* the refused copies were the last ones of the burst */
+	excess = async->nr_copies - n_xfer;
+	for (i = pkt_idx; excess != 0 && i-- > 0; ) {
+		uint16_t n;
+
+		info = &async->pkts_info[(async->pkts_idx + i) & mask];
+		n = RTE_MIN(excess, info->nr_copies);
+		info->nr_copies -= n;
+		excess -= n;
+	}
+
+	/* keep the used entries until the packets are complete */
+	for (i = 0; i < vq->shadow_used_idx; i++)
+		async->used_ring[(async->used_idx + i) & mask] =
+			vq->shadow_used_ring[i];
+	async->used_idx += vq->shadow_used_idx;
+	async->used_inflight_n += vq->shadow_used_idx;
+	vq->shadow_used_idx = 0;
 
-		cpy_len = RTE_MIN(desc_avail, mbuf_avail);
-		rte_memcpy((void *)((uintptr_t)(desc_addr + desc_offset)),
-			rte_pktmbuf_mtod_offset(m, void *, mbuf_offset),
-			cpy_len);
-		vhost_log_write(dev, buf_vec[vec_idx].buf_addr + desc_offset,
-			cpy_len);
-		PRINT_PACKET(dev, (uintptr_t)(desc_addr + desc_offset),
-			cpy_len, 0);
+	async->pkts_idx += pkt_idx;
+	async->pkts_inflight_n += pkt_idx;
 
-		mbuf_avail  -= cpy_len;
-		mbuf_offset += cpy_len;
-		desc_avail  -= cpy_len;
-		desc_offset += cpy_len;
-	}
+out:
+	vhost_vring_call_deferred(dev, vq);
+	vring_access_end(dev, vq);
 
-	return 0;
+	return pkt_idx;
 }
 
-static __rte_always_inline uint32_t
-virtio_dev_merge_rx(struct virtio_net *dev, uint16_t queue_id,
-	struct rte_mbuf **pkts, uint32_t count)
+uint16_t
+rte_vhost_poll_enqueue_completed(int vid, uint16_t queue_id,
+	struct rte_mbuf **pkts, uint16_t count)
 {
+	struct virtio_net *dev = get_device(vid);
 	struct vhost_virtqueue *vq;
-	uint32_t pkt_idx = 0;
-	uint16_t num_buffers;
-	struct buf_vector buf_vec[BUF_VECTOR_MAX];
-	uint16_t avail_head;
+	struct vhost_async *async;
+	struct async_inflight_info *info;
+	uint16_t start, n, i, nr_used, nr_copies, from;
+	uint16_t mask;
+
+	if (!dev)
+		return 0;
 
-	LOG_DEBUG(VHOST_DATA, "(%d) %s\n", dev->vid, __func__);
 	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->nr_vring))) {
 		RTE_LOG(ERR, VHOST_DATA, "(%d) %s: invalid virtqueue idx %d.\n",
 			dev->vid, __func__, queue_id);
@@ -544,56 +1351,140 @@ virtio_dev_merge_rx(struct virtio_net *dev, uint16_t queue_id,
 	}
 
 	vq = dev->virtqueue[queue_id];
-	if (unlikely(vq->enabled == 0))
-		return 0;
 
-	count = RTE_MIN((uint32_t)MAX_PKT_BURST, count);
-	if (count == 0)
+	if (unlikely(vring_access_begin(dev, vq) < 0))
 		return 0;
 
-	rte_prefetch0(&vq->avail->ring[vq->last_avail_idx & (vq->size - 1)]);
+	n = 0;
+	async = vq->async;
+	if (unlikely(async == NULL || async->pkts_inflight_n == 0))
+		goto out;
 
-	vq->shadow_used_idx = 0;
-	avail_head = *((volatile uint16_t *)&vq->avail->idx);
-	for (pkt_idx = 0; pkt_idx < count; pkt_idx++) {
-		uint32_t pkt_len = pkts[pkt_idx]->pkt_len + dev->vhost_hlen;
+	mask = vq->size - 1;
+	async->copies_done += async->ops->completed(async->ctx, UINT16_MAX);
 
-		if (unlikely(reserve_avail_buf_mergeable(dev, vq,
-						pkt_len, buf_vec, &num_buffers,
-						avail_head) < 0)) {
-			LOG_DEBUG(VHOST_DATA,
-				"(%d) failed to get enough desc from vring\n",
-				dev->vid);
-			vq->shadow_used_idx -= num_buffers;
+	/* packets complete in order, once all of their copies are done */
+	start = async->pkts_idx - async->pkts_inflight_n;
+	nr_used = 0;
+	nr_copies = 0;
+	for (n = 0; n < count && n < async->pkts_inflight_n; n++) {
+		info = &async->pkts_info[(start + n) & mask];
+		if (info->nr_copies > async->copies_done)
 			break;
-		}
 
-		LOG_DEBUG(VHOST_DATA, "(%d) current index %d | end index %d\n",
-			dev->vid, vq->last_avail_idx,
-			vq->last_avail_idx + num_buffers);
+		async->copies_done -= info->nr_copies;
+		nr_copies += info->nr_copies;
+		nr_used += info->nr_buffers;
+		pkts[n] = info->mbuf;
+	}
 
-		if (copy_mbuf_to_desc_mergeable(dev, pkts[pkt_idx],
-						buf_vec, num_buffers) < 0) {
-			vq->shadow_used_idx -= num_buffers;
-			break;
-		}
+	if (n == 0)
+		goto out;
 
-		vq->last_avail_idx += num_buffers;
+	async->pkts_inflight_n -= n;
+
+	/* engine writes must land before the used ring tells the guest */
+	rte_smp_rmb();
+
+	async_log_copies(dev, vq, nr_copies);
+
+	from = async->used_idx - async->used_inflight_n;
+	for (i = 0; i < nr_used; i++)
+		vq->shadow_used_ring[i] =
+			async->used_ring[(from + i) & mask];
+	async->used_inflight_n -= nr_used;
+	vq->shadow_used_idx = nr_used;
+
+	flush_shadow_used_ring(dev, vq);
+	vq->shadow_used_idx = 0;
+
+	vhost_vring_call(dev, vq);
+
+out:
+	vhost_vring_call_deferred(dev, vq);
+	vring_access_end(dev, vq);
+
+	return n;
+}
+
+/*
+ * Wait for the copy engine to complete the packets in flight on a
+ * virtqueue, publish them in the used ring and free them, before the
+ * async state of the virtqueue goes away. The data path must be stopped
+ * on the virtqueue. If the engine does not complete them in time, their
+ * mbufs are left to it and -1 is returned.
+ */
+int
+vhost_async_drain(struct virtio_net *dev, struct vhost_virtqueue *vq)
+{
+	struct vhost_async *async = vq->async;
+	uint32_t nr_copies = 0;
+	uint16_t start, from, nr_used, i;
+	uint16_t mask;
+	uint64_t deadline;
+
+	if (async == NULL || async->pkts_inflight_n == 0)
+		return 0;
+
+	mask = vq->size - 1;
+	start = async->pkts_idx - async->pkts_inflight_n;
+	for (i = 0; i < async->pkts_inflight_n; i++)
+		nr_copies += async->pkts_info[(start + i) & mask].nr_copies;
+
+	deadline = rte_get_timer_cycles() +
+		rte_get_timer_hz() * VHOST_ASYNC_DRAIN_TIMEOUT_MS / 1000;
+	while (async->copies_done < nr_copies) {
+		if (rte_get_timer_cycles() >= deadline) {
+			RTE_LOG(ERR, VHOST_DATA,
+				"(%d) %u packets still in flight in the copy engine, leaving them\n",
+				dev->vid, async->pkts_inflight_n);
+			async->pkts_inflight_n = 0;
+			async->used_inflight_n = 0;
+			async->copies_inflight_n = 0;
+			async->copies_done = 0;
+			return -1;
+		}
+		async->copies_done += async->ops->completed(async->ctx,
+							    UINT16_MAX);
+		rte_pause();
 	}
+	async->copies_done -= nr_copies;
 
-	if (likely(vq->shadow_used_idx)) {
-		flush_shadow_used_ring(dev, vq);
+	/* engine writes must land before the used ring tells the guest */
+	rte_smp_rmb();
+
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		vhost_user_iotlb_rd_lock(vq);
+
+	if (vq->shadow_used_ring != NULL &&
+	    (vq->access_ok || vring_translate(dev, vq) == 0)) {
+		async_log_copies(dev, vq, nr_copies);
+
+		nr_used = async->used_inflight_n;
+		from = async->used_idx - nr_used;
+		for (i = 0; i < nr_used; i++)
+			vq->shadow_used_ring[i] =
+				async->used_ring[(from + i) & mask];
+		vq->shadow_used_idx = nr_used;
 
-		/* flush used->idx update before we read avail->flags. */
-		rte_mb();
+		flush_shadow_used_ring(dev, vq);
+		vhost_log_cache_sync(dev, vq);
+		vq->shadow_used_idx = 0;
 
-		/* Kick the guest if necessary. */
-		if (!(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT)
-				&& (vq->callfd >= 0))
-			eventfd_write(vq->callfd, (eventfd_t)1);
+		vhost_vring_call(dev, vq);
 	}
 
-	return pkt_idx;
+	if (dev->features & (1ULL << VIRTIO_F_IOMMU_PLATFORM))
+		vhost_user_iotlb_rd_unlock(vq);
+
+	/* nobody can poll them back any more */
+	for (i = 0; i < async->pkts_inflight_n; i++)
+		rte_pktmbuf_free(async->pkts_info[(start + i) & mask].mbuf);
+	async->pkts_inflight_n = 0;
+	async->used_inflight_n = 0;
+	async->copies_inflight_n = 0;
+
+	return 0;
 }
 
 uint16_t
@@ -601,14 +1492,33 @@ rte_vhost_enqueue_burst(int vid, uint16_t queue_id,
 	struct rte_mbuf **pkts, uint16_t count)
 {
 	struct virtio_net *dev = get_device(vid);
+	struct vhost_virtqueue *vq;
+	uint16_t nb_tx;
 
 	if (!dev)
 		return 0;
 
-	if (dev->features & (1 << VIRTIO_NET_F_MRG_RXBUF))
-		return virtio_dev_merge_rx(dev, queue_id, pkts, count);
+	if (unlikely(!is_valid_virt_queue_idx(queue_id, 0, dev->nr_vring))) {
+		RTE_LOG(ERR, VHOST_DATA, "(%d) %s: invalid virtqueue idx %d.\n",
+			dev->vid, __func__, queue_id);
+		return 0;
+	}
+
+	vq = dev->virtqueue[queue_id];
+	if (unlikely(vring_access_begin(dev, vq) < 0))
+		return 0;
+
+	if (vq_is_packed(dev))
+		nb_tx = virtio_dev_rx_packed(dev, queue_id, pkts, count);
+	else if (dev->features & (1 << VIRTIO_NET_F_MRG_RXBUF))
+		nb_tx = virtio_dev_merge_rx(dev, queue_id, pkts, count);
 	else
-		return virtio_dev_rx(dev, queue_id, pkts, count);
+		nb_tx = virtio_dev_rx(dev, queue_id, pkts, count);
+
+	vhost_vring_call_deferred(dev, vq);
+	vring_access_end(dev, vq);
+
+	return nb_tx;
 }
 
 static inline bool
@@ -759,6 +1669,17 @@ make_rarp_packet(struct rte_mbuf *rarp_mbuf, const struct ether_addr *mac)
 	return 0;
 }
 
+/*
+ * Offload parsing reads the packet headers from the mbuf, so a packet
+ * asking for offloads is copied right away.
+ */
+static __rte_always_inline int
+dequeue_can_batch(struct virtio_net_hdr *hdr)
+{
+	return hdr == NULL || (hdr->flags == 0 &&
+			       hdr->gso_type == VIRTIO_NET_HDR_GSO_NONE);
+}
+
 static __rte_always_inline void
 put_zmbuf(struct zcopy_mbuf *zmbuf)
 {
@@ -766,33 +1687,48 @@ put_zmbuf(struct zcopy_mbuf *zmbuf)
 }
 
 static __rte_always_inline int
-copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
-		  uint16_t max_desc, struct rte_mbuf *m, uint16_t desc_idx,
+copy_desc_to_mbuf(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		  struct vring_desc *descs, uint16_t max_desc,
+		  struct rte_mbuf *m, uint16_t desc_idx,
 		  struct rte_mempool *mbuf_pool)
 {
 	struct vring_desc *desc;
-	uint64_t desc_addr;
+	uint64_t desc_addr, desc_iova, desc_chunk_len;
 	uint32_t desc_avail, desc_offset;
 	uint32_t mbuf_avail, mbuf_offset;
 	uint32_t cpy_len;
 	struct rte_mbuf *cur = m, *prev = m;
+	struct virtio_net_hdr tmp_hdr;
 	struct virtio_net_hdr *hdr = NULL;
 	/* A counter to avoid desc dead loop chain */
 	uint32_t nr_desc = 1;
+	int batch;
 
 	desc = &descs[desc_idx];
 	if (unlikely((desc->len < dev->vhost_hlen)) ||
 			(desc->flags & VRING_DESC_F_INDIRECT))
 		return -1;
 
-	desc_addr = rte_vhost_gpa_to_vva(dev->mem, desc->addr);
+	desc_iova = desc->addr;
+	desc_chunk_len = desc->len;
+	desc_addr = vhost_iova_to_vva(dev, vq, desc_iova, &desc_chunk_len,
+				      VHOST_ACCESS_RO);
 	if (unlikely(!desc_addr))
 		return -1;
 
 	if (virtio_net_with_host_offload(dev)) {
-		hdr = (struct virtio_net_hdr *)((uintptr_t)desc_addr);
-		rte_prefetch0(hdr);
+		if (likely(desc_chunk_len >= sizeof(*hdr))) {
+			hdr = (struct virtio_net_hdr *)((uintptr_t)desc_addr);
+			rte_prefetch0(hdr);
+		} else {
+			/* the header is split, read it through a copy */
+			if (unlikely(copy_from_guest(dev, vq, &tmp_hdr,
+					desc_iova, sizeof(tmp_hdr)) < 0))
+				return -1;
+			hdr = &tmp_hdr;
+		}
 	}
+	batch = dequeue_can_batch(hdr);
 
 	/*
 	 * A virtio driver normally uses at least 2 desc buffers
@@ -805,7 +1741,11 @@ copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
 		if (unlikely(desc->flags & VRING_DESC_F_INDIRECT))
 			return -1;
 
-		desc_addr = rte_vhost_gpa_to_vva(dev->mem, desc->addr);
+		desc_iova = desc->addr;
+		desc_chunk_len = desc->len;
+		desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+					      &desc_chunk_len,
+					      VHOST_ACCESS_RO);
 		if (unlikely(!desc_addr))
 			return -1;
 
@@ -815,18 +1755,36 @@ copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
 	} else {
 		desc_avail  = desc->len - dev->vhost_hlen;
 		desc_offset = dev->vhost_hlen;
+		if (likely(desc_chunk_len >= dev->vhost_hlen))
+			desc_chunk_len -= dev->vhost_hlen;
+		else
+			desc_chunk_len = 0;
 	}
 
 	rte_prefetch0((void *)(uintptr_t)(desc_addr + desc_offset));
 
-	PRINT_PACKET(dev, (uintptr_t)(desc_addr + desc_offset), desc_avail, 0);
+	PRINT_PACKET(dev, (uintptr_t)(desc_addr + desc_offset),
+		     desc_chunk_len, 0);
 
 	mbuf_offset = 0;
 	mbuf_avail  = m->buf_len - RTE_PKTMBUF_HEADROOM;
 	while (1) {
 		uint64_t hpa;
 
-		cpy_len = RTE_MIN(desc_avail, mbuf_avail);
+		if (unlikely(desc_chunk_len == 0 && desc_avail != 0)) {
+			/* done with the mapped chunk, translate the next one */
+			desc_iova += desc_offset;
+			desc_chunk_len = desc_avail;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_RO);
+			if (unlikely(!desc_addr))
+				return -1;
+
+			desc_offset = 0;
+		}
+
+		cpy_len = RTE_MIN(desc_chunk_len, mbuf_avail);
 
 		/*
 		 * A desc buf might across two host physical pages that are
@@ -834,7 +1792,7 @@ copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
 		 * will be copied even though zero copy is enabled.
 		 */
 		if (unlikely(dev->dequeue_zero_copy && (hpa = gpa_to_hpa(dev,
-					desc->addr + desc_offset, cpy_len)))) {
+					desc_iova + desc_offset, cpy_len)))) {
 			cur->data_len = cpy_len;
 			cur->data_off = 0;
 			cur->buf_addr = (void *)(uintptr_t)desc_addr;
@@ -846,16 +1804,17 @@ copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
 			 */
 			mbuf_avail = cpy_len;
 		} else {
-			rte_memcpy(rte_pktmbuf_mtod_offset(cur, void *,
-							   mbuf_offset),
-				(void *)((uintptr_t)(desc_addr + desc_offset)),
-				cpy_len);
+			copy_from_desc(vq,
+				rte_pktmbuf_mtod_offset(cur, void *,
+							mbuf_offset),
+				desc_addr + desc_offset, cpy_len, batch);
 		}
 
 		mbuf_avail  -= cpy_len;
 		mbuf_offset += cpy_len;
 		desc_avail  -= cpy_len;
 		desc_offset += cpy_len;
+		desc_chunk_len -= cpy_len;
 
 		/* This desc reaches to its end, get the next one */
 		if (desc_avail == 0) {
@@ -869,7 +1828,11 @@ copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
 			if (unlikely(desc->flags & VRING_DESC_F_INDIRECT))
 				return -1;
 
-			desc_addr = rte_vhost_gpa_to_vva(dev->mem, desc->addr);
+			desc_iova = desc->addr;
+			desc_chunk_len = desc->len;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_RO);
 			if (unlikely(!desc_addr))
 				return -1;
 
@@ -878,7 +1841,8 @@ copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
 			desc_offset = 0;
 			desc_avail  = desc->len;
 
-			PRINT_PACKET(dev, (uintptr_t)desc_addr, desc->len, 0);
+			PRINT_PACKET(dev, (uintptr_t)desc_addr,
+				     desc_chunk_len, 0);
 		}
 
 		/*
@@ -915,13 +1879,221 @@ copy_desc_to_mbuf(struct virtio_net *dev, struct vring_desc *descs,
 	return 0;
 }
 
+/*
+ * Copy a packed ring buffer, already gathered in buf_vec, into an mbuf
+ * chain. Indirect tables were flattened by fill_vec_buf_packed().
+ */
+static __rte_always_inline int
+copy_vec_to_mbuf(struct virtio_net *dev, struct vhost_virtqueue *vq,
+		 struct buf_vector *buf_vec, uint32_t nr_vec,
+		 struct rte_mbuf *m, struct rte_mempool *mbuf_pool)
+{
+	uint32_t vec_idx = 0;
+	uint64_t desc_addr, desc_iova, desc_chunk_len;
+	uint32_t desc_avail, desc_offset;
+	uint32_t mbuf_avail, mbuf_offset;
+	uint32_t cpy_len;
+	struct rte_mbuf *cur = m, *prev = m;
+	struct virtio_net_hdr tmp_hdr;
+	struct virtio_net_hdr *hdr = NULL;
+	int batch;
+
+	if (unlikely(buf_vec[0].buf_len < dev->vhost_hlen))
+		return -1;
+
+	desc_iova = buf_vec[0].buf_addr;
+	desc_chunk_len = buf_vec[0].buf_len;
+	desc_addr = vhost_iova_to_vva(dev, vq, desc_iova, &desc_chunk_len,
+				      VHOST_ACCESS_RO);
+	if (unlikely(!desc_addr))
+		return -1;
+
+	if (virtio_net_with_host_offload(dev)) {
+		if (likely(desc_chunk_len >= sizeof(*hdr))) {
+			hdr = (struct virtio_net_hdr *)((uintptr_t)desc_addr);
+			rte_prefetch0(hdr);
+		} else {
+			/* the header is split, read it through a copy */
+			if (unlikely(copy_from_guest(dev, vq, &tmp_hdr,
+					desc_iova, sizeof(tmp_hdr)) < 0))
+				return -1;
+			hdr = &tmp_hdr;
+		}
+	}
+	batch = dequeue_can_batch(hdr);
+
+	/* the header may come in a desc buf of its own */
+	if (buf_vec[0].buf_len == dev->vhost_hlen && nr_vec > 1) {
+		vec_idx = 1;
+		desc_iova = buf_vec[1].buf_addr;
+		desc_chunk_len = buf_vec[1].buf_len;
+		desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+					      &desc_chunk_len,
+					      VHOST_ACCESS_RO);
+		if (unlikely(!desc_addr))
+			return -1;
+
+		desc_offset = 0;
+		desc_avail  = buf_vec[1].buf_len;
+	} else {
+		desc_avail  = buf_vec[0].buf_len - dev->vhost_hlen;
+		desc_offset = dev->vhost_hlen;
+		if (likely(desc_chunk_len >= dev->vhost_hlen))
+			desc_chunk_len -= dev->vhost_hlen;
+		else
+			desc_chunk_len = 0;
+	}
+
+	rte_prefetch0((void *)(uintptr_t)(desc_addr + desc_offset));
+
+	PRINT_PACKET(dev, (uintptr_t)(desc_addr + desc_offset),
+		     desc_chunk_len, 0);
+
+	mbuf_offset = 0;
+	mbuf_avail  = m->buf_len - RTE_PKTMBUF_HEADROOM;
+	while (1) {
+		if (unlikely(desc_chunk_len == 0 && desc_avail != 0)) {
+			/* done with the mapped chunk, translate the next one */
+			desc_iova += desc_offset;
+			desc_chunk_len = desc_avail;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_RO);
+			if (unlikely(!desc_addr))
+				return -1;
+
+			desc_offset = 0;
+		}
+
+		cpy_len = RTE_MIN(desc_chunk_len, mbuf_avail);
+		copy_from_desc(vq,
+			rte_pktmbuf_mtod_offset(cur, void *, mbuf_offset),
+			desc_addr + desc_offset, cpy_len, batch);
+
+		mbuf_avail  -= cpy_len;
+		mbuf_offset += cpy_len;
+		desc_avail  -= cpy_len;
+		desc_offset += cpy_len;
+		desc_chunk_len -= cpy_len;
+
+		/* This desc reaches to its end, get the next one */
+		if (desc_avail == 0) {
+			if (++vec_idx >= nr_vec)
+				break;
+
+			desc_iova = buf_vec[vec_idx].buf_addr;
+			desc_chunk_len = buf_vec[vec_idx].buf_len;
+			desc_addr = vhost_iova_to_vva(dev, vq, desc_iova,
+						      &desc_chunk_len,
+						      VHOST_ACCESS_RO);
+			if (unlikely(!desc_addr))
+				return -1;
+
+			rte_prefetch0((void *)(uintptr_t)desc_addr);
+
+			desc_offset = 0;
+			desc_avail  = buf_vec[vec_idx].buf_len;
+
+			PRINT_PACKET(dev, (uintptr_t)desc_addr,
+				     desc_chunk_len, 0);
+		}
+
+		/*
+		 * This mbuf reaches to its end, get a new one
+		 * to hold more data.
+		 */
+		if (mbuf_avail == 0) {
+			cur = rte_pktmbuf_alloc(mbuf_pool);
+			if (unlikely(cur == NULL)) {
+				RTE_LOG(ERR, VHOST_DATA, "Failed to "
+					"allocate memory for mbuf.\n");
+				return -1;
+			}
+
+			prev->next = cur;
+			prev->data_len = mbuf_offset;
+			m->nb_segs += 1;
+			m->pkt_len += mbuf_offset;
+			prev = cur;
+
+			mbuf_offset = 0;
+			mbuf_avail  = cur->buf_len - RTE_PKTMBUF_HEADROOM;
+		}
+	}
+
+	prev->data_len = mbuf_offset;
+	m->pkt_len    += mbuf_offset;
+
+	if (hdr)
+		vhost_dequeue_offload(hdr, m);
+
+	return 0;
+}
+
+static __rte_always_inline uint16_t
+virtio_dev_tx_packed(struct virtio_net *dev, struct vhost_virtqueue *vq,
+	struct rte_mempool *mbuf_pool, struct rte_mbuf **pkts, uint16_t count)
+{
+	struct buf_vector buf_vec[BUF_VECTOR_MAX];
+	uint16_t i;
+
+	count = RTE_MIN(count, MAX_PKT_BURST);
+
+	rte_prefetch0(&vq->desc_packed[vq->last_avail_idx]);
+
+	vq->shadow_used_idx = 0;
+	vq->batch_copy_nb_elems = 0;
+	for (i = 0; i < count; i++) {
+		uint16_t nb_copies = vq->batch_copy_nb_elems;
+		uint32_t vec_idx = 0;
+		uint16_t buf_id, desc_count;
+		uint32_t len;
+
+		if (fill_vec_buf_packed(dev, vq, vq->last_avail_idx,
+				vq->avail_wrap_counter, &vec_idx, buf_vec,
+				&buf_id, &len, &desc_count) < 0)
+			break;
+
+		pkts[i] = rte_pktmbuf_alloc(mbuf_pool);
+		if (unlikely(pkts[i] == NULL)) {
+			RTE_LOG(ERR, VHOST_DATA,
+				"Failed to allocate memory for mbuf.\n");
+			break;
+		}
+
+		if (unlikely(copy_vec_to_mbuf(dev, vq, buf_vec, vec_idx,
+					      pkts[i], mbuf_pool) < 0)) {
+			vq->batch_copy_nb_elems = nb_copies;
+			rte_pktmbuf_free(pkts[i]);
+			break;
+		}
+
+		update_shadow_used_packed(vq, buf_id, 0, desc_count);
+
+		vq->last_avail_idx += desc_count;
+		if (vq->last_avail_idx >= vq->size) {
+			vq->last_avail_idx -= vq->size;
+			vq->avail_wrap_counter ^= 1;
+		}
+	}
+
+	do_data_copy_dequeue(vq);
+
+	if (likely(vq->shadow_used_idx)) {
+		flush_shadow_used_ring_packed(dev, vq);
+		vhost_vring_call_packed(vq);
+	}
+
+	return i;
+}
+
 static __rte_always_inline void
 update_used_ring(struct virtio_net *dev, struct vhost_virtqueue *vq,
 		 uint32_t used_idx, uint32_t desc_idx)
 {
 	vq->used->ring[used_idx].id  = desc_idx;
 	vq->used->ring[used_idx].len = 0;
-	vhost_log_used_vring(dev, vq,
+	vhost_log_cache_used_vring(dev, vq,
 			offsetof(struct vring_used, ring[used_idx]),
 			sizeof(vq->used->ring[used_idx]));
 }
@@ -937,13 +2109,10 @@ update_used_idx(struct virtio_net *dev, struct vhost_virtqueue *vq,
 	rte_smp_rmb();
 
 	vq->used->idx += count;
-	vhost_log_used_vring(dev, vq, offsetof(struct vring_used, idx),
+	vhost_log_cache_used_vring(dev, vq, offsetof(struct vring_used, idx),
 			sizeof(vq->used->idx));
 
-	/* Kick guest if required. */
-	if (!(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT)
-			&& (vq->callfd >= 0))
-		eventfd_write(vq->callfd, (eventfd_t)1);
+	vhost_vring_call(dev, vq);
 }
 
 static __rte_always_inline struct zcopy_mbuf *
@@ -1013,9 +2182,12 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 	}
 
 	vq = dev->virtqueue[queue_id];
-	if (unlikely(vq->enabled == 0))
+	if (unlikely(vring_access_begin(dev, vq) < 0))
 		return 0;
 
+	if (unlikely(vq->enabled == 0))
+		goto out;
+
 	if (unlikely(dev->dequeue_zero_copy)) {
 		struct zcopy_mbuf *zmbuf, *next;
 		int nr_updated = 0;
@@ -1064,7 +2236,7 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 		if (rarp_mbuf == NULL) {
 			RTE_LOG(ERR, VHOST_DATA,
 				"Failed to allocate memory for mbuf.\n");
-			return 0;
+			goto out;
 		}
 
 		if (make_rarp_packet(rarp_mbuf, &dev->mac)) {
@@ -1075,6 +2247,11 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 		}
 	}
 
+	if (vq_is_packed(dev)) {
+		i = virtio_dev_tx_packed(dev, vq, mbuf_pool, pkts, count);
+		goto out;
+	}
+
 	free_entries = *((volatile uint16_t *)&vq->avail->idx) -
 			vq->last_avail_idx;
 	if (free_entries == 0)
@@ -1103,10 +2280,14 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 			update_used_ring(dev, vq, used_idx, desc_indexes[i]);
 	}
 
+	vq->batch_copy_nb_elems = 0;
+
 	/* Prefetch descriptor index. */
 	rte_prefetch0(&vq->desc[desc_indexes[0]]);
 	for (i = 0; i < count; i++) {
+		uint16_t nb_copies = vq->batch_copy_nb_elems;
 		struct vring_desc *desc;
+		void *idesc = NULL;
 		uint16_t sz, idx;
 		int err;
 
@@ -1114,9 +2295,9 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 			rte_prefetch0(&vq->desc[desc_indexes[i + 1]]);
 
 		if (vq->desc[desc_indexes[i]].flags & VRING_DESC_F_INDIRECT) {
-			desc = (struct vring_desc *)(uintptr_t)
-				rte_vhost_gpa_to_vva(dev->mem,
-					vq->desc[desc_indexes[i]].addr);
+			desc = ind_table_to_vva(dev, vq,
+					vq->desc[desc_indexes[i]].addr,
+					vq->desc[desc_indexes[i]].len, &idesc);
 			if (unlikely(!desc))
 				break;
 
@@ -1133,11 +2314,17 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 		if (unlikely(pkts[i] == NULL)) {
 			RTE_LOG(ERR, VHOST_DATA,
 				"Failed to allocate memory for mbuf.\n");
+			if (unlikely(idesc != NULL))
+				rte_free(idesc);
 			break;
 		}
 
-		err = copy_desc_to_mbuf(dev, desc, sz, pkts[i], idx, mbuf_pool);
+		err = copy_desc_to_mbuf(dev, vq, desc, sz, pkts[i], idx,
+					mbuf_pool);
+		if (unlikely(idesc != NULL))
+			rte_free(idesc);
 		if (unlikely(err)) {
+			vq->batch_copy_nb_elems = nb_copies;
 			rte_pktmbuf_free(pkts[i]);
 			break;
 		}
@@ -1147,6 +2334,7 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 
 			zmbuf = get_zmbuf(vq);
 			if (!zmbuf) {
+				vq->batch_copy_nb_elems = nb_copies;
 				rte_pktmbuf_free(pkts[i]);
 				break;
 			}
@@ -1167,12 +2355,17 @@ rte_vhost_dequeue_burst(int vid, uint16_t queue_id,
 	}
 	vq->last_avail_idx += i;
 
+	do_data_copy_dequeue(vq);
+
 	if (likely(dev->dequeue_zero_copy == 0)) {
 		vq->last_used_idx += i;
 		update_used_idx(dev, vq, i);
 	}
 
 out:
+	vhost_vring_call_deferred(dev, vq);
+	vring_access_end(dev, vq);
+
 	if (unlikely(rarp_mbuf != NULL)) {
 		/*
 		 * Inject it to the head of "pkts" array, so that switch's mac
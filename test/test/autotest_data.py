@@ -384,6 +384,19 @@ def per_sockets(num):
             },
         ]
     },
+    {
+        "Prefix":    "vhost_user",
+        "Memory":    "256",
+        "Tests":
+        [
+            {
+                "Name":    "Vhost-user stress autotest",
+                "Command": "vhost_user_stress_autotest",
+                "Func":    default_autotest,
+                "Report":  None,
+            },
+        ]
+    },
     {
         "Prefix":    "mempool_perf",
         "Memory":    per_sockets(256),
@@ -1157,6 +1157,222 @@ test_mode4_tx_burst(void)
 	return remove_slaves_and_stop_bonded_device();
 }
 
+static int
+test_mode4_tx_burst_rss(void)
+{
+	struct slave_conf *slave;
+	uint16_t i, j;
+
+	uint16_t pkts_cnt, slave_cnt = 0;
+	struct rte_mbuf *pkts[MAX_PKT_BURST];
+	/* Hash class seen on each slave, all classes must be distinct */
+	int slave_class[TEST_TX_SLAVE_COUNT];
+	int retval;
+
+	struct ether_addr dst_mac = { { 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00 } };
+	struct ether_addr bonded_mac;
+
+	retval = initialize_bonded_device_with_slaves(TEST_TX_SLAVE_COUNT, 0);
+	TEST_ASSERT_SUCCESS(retval, "Failed to initialize bonded device");
+
+	retval = bond_handshake();
+	TEST_ASSERT_SUCCESS(retval, "Initial handshake failed");
+
+	TEST_ASSERT_SUCCESS(rte_eth_bond_xmit_policy_set(
+			test_params.bonded_port_id, BALANCE_XMIT_POLICY_RSS),
+			"Failed to set RSS xmit policy");
+
+	rte_eth_macaddr_get(test_params.bonded_port_id, &bonded_mac);
+
+	/* Same headers, but a different RSS hash in each packet */
+	retval = generate_packets(&bonded_mac, &dst_mac, RTE_DIM(pkts), pkts);
+	TEST_ASSERT_EQUAL(retval, (int)RTE_DIM(pkts),
+		"Failed to generate packets");
+	for (i = 0; i < RTE_DIM(pkts); i++) {
+		pkts[i]->ol_flags |= PKT_RX_RSS_HASH;
+		pkts[i]->hash.rss = i;
+	}
+
+	retval = bond_tx(pkts, RTE_DIM(pkts));
+	if (retval >= 0 && retval < (int)RTE_DIM(pkts))
+		free_pkts(&pkts[retval], RTE_DIM(pkts) - retval);
+
+	TEST_ASSERT_EQUAL(retval, (int)RTE_DIM(pkts), "TX on bonded device failed");
+
+	/* Hashes below 256 are not changed by the folding, so packets must be
+	 * spread by their hash modulo the number of slaves. */
+	pkts_cnt = 0;
+	FOR_EACH_SLAVE(i, slave) {
+		retval = slave_get_pkts(slave, pkts, RTE_DIM(pkts));
+		TEST_ASSERT(retval > 0, "slave %u did not transmit any packets",
+			slave->port_id);
+
+		slave_class[slave_cnt] = pkts[0]->hash.rss % TEST_TX_SLAVE_COUNT;
+		for (j = 0; j < retval; j++) {
+			if ((int)(pkts[j]->hash.rss % TEST_TX_SLAVE_COUNT) !=
+					slave_class[slave_cnt])
+				break;
+		}
+		free_pkts(pkts, retval);
+		TEST_ASSERT_EQUAL(j, retval,
+			"slave %u transmitted packets of several hash classes",
+			slave->port_id);
+
+		for (j = 0; j < slave_cnt; j++)
+			TEST_ASSERT_NOT_EQUAL(slave_class[j], slave_class[slave_cnt],
+				"hash class %d transmitted on two slaves",
+				slave_class[j]);
+
+		slave_cnt++;
+		pkts_cnt += retval;
+	}
+
+	TEST_ASSERT_EQUAL(pkts_cnt, RTE_DIM(pkts),
+		"Expected %u packets but transmitted only %u",
+		(unsigned int)RTE_DIM(pkts), pkts_cnt);
+
+	TEST_ASSERT_SUCCESS(rte_eth_bond_xmit_policy_set(
+			test_params.bonded_port_id, BALANCE_XMIT_POLICY_LAYER2),
+			"Failed to restore L2 xmit policy");
+
+	return remove_slaves_and_stop_bonded_device();
+}
+
+/* Returns the value of the named extended statistic of the bonded device */
+static int
+bond_xstat_get(const char *name, uint64_t *value)
+{
+	struct rte_eth_xstat_name names[256];
+	struct rte_eth_xstat xstats[256];
+	int i, n;
+
+	n = rte_eth_xstats_get_names(test_params.bonded_port_id, names,
+			RTE_DIM(names));
+	if (n < 0 || n > (int)RTE_DIM(names))
+		return -1;
+	if (rte_eth_xstats_get(test_params.bonded_port_id, xstats, n) != n)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		if (strcmp(names[i].name, name) == 0) {
+			*value = xstats[i].value;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+#define TEST_BALANCE_INTERVAL_MS	10
+#define TEST_BALANCE_ROUNDS		150
+#define TEST_BALANCE_CHECK_ROUNDS	50
+
+/*
+ * Sends an elephant flow, half of each burst, with mice flows spread over
+ * all the other hash buckets. Adaptive balancing must move all the mice off
+ * the slave carrying the elephant.
+ */
+static int
+test_mode4_tx_adaptive_balance(void)
+{
+	struct slave_conf *slave;
+	struct rte_mbuf *pkts[MAX_PKT_BURST];
+	uint16_t round, i, j, mouse = 0;
+	const uint16_t elephants = RTE_DIM(pkts) / 2;
+	int retval;
+
+	/* Slave port id carrying the elephant, and mice seen on it */
+	int elephant_port = -1;
+	unsigned int elephant_mice = 0;
+	uint64_t moves, buckets;
+	char name[RTE_ETH_XSTATS_NAME_SIZE];
+
+	struct ether_addr dst_mac = { { 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00 } };
+	struct ether_addr bonded_mac;
+
+	retval = initialize_bonded_device_with_slaves(TEST_TX_SLAVE_COUNT, 0);
+	TEST_ASSERT_SUCCESS(retval, "Failed to initialize bonded device");
+
+	retval = bond_handshake();
+	TEST_ASSERT_SUCCESS(retval, "Initial handshake failed");
+
+	/* Bucket of each packet is its RSS hash modulo the bucket count */
+	TEST_ASSERT_SUCCESS(rte_eth_bond_xmit_policy_set(
+			test_params.bonded_port_id, BALANCE_XMIT_POLICY_RSS),
+			"Failed to set RSS xmit policy");
+	TEST_ASSERT_SUCCESS(rte_eth_bond_adaptive_balance_set(
+			test_params.bonded_port_id, TEST_BALANCE_INTERVAL_MS),
+			"Failed to enable adaptive balancing");
+	TEST_ASSERT_EQUAL(rte_eth_bond_adaptive_balance_get(
+			test_params.bonded_port_id), TEST_BALANCE_INTERVAL_MS,
+			"Wrong adaptive balancing period");
+
+	rte_eth_macaddr_get(test_params.bonded_port_id, &bonded_mac);
+
+	for (round = 0; round < TEST_BALANCE_ROUNDS; round++) {
+		retval = generate_packets(&bonded_mac, &dst_mac, RTE_DIM(pkts),
+				pkts);
+		TEST_ASSERT_EQUAL(retval, (int)RTE_DIM(pkts),
+			"Failed to generate packets");
+		for (i = 0; i < RTE_DIM(pkts); i++) {
+			pkts[i]->ol_flags |= PKT_RX_RSS_HASH;
+			/* Elephant in bucket 0, mice in buckets 1 to 127 */
+			if (i < elephants)
+				pkts[i]->hash.rss = 0;
+			else
+				pkts[i]->hash.rss = 1 + mouse++ % 127;
+		}
+
+		retval = bond_tx(pkts, RTE_DIM(pkts));
+		if (retval >= 0 && retval < (int)RTE_DIM(pkts))
+			free_pkts(&pkts[retval], RTE_DIM(pkts) - retval);
+		TEST_ASSERT_EQUAL(retval, (int)RTE_DIM(pkts),
+			"TX on bonded device failed");
+
+		FOR_EACH_SLAVE(i, slave) {
+			retval = slave_get_pkts(slave, pkts, RTE_DIM(pkts));
+			for (j = 0; j < retval; j++) {
+				if (make_lacp_reply(slave, pkts[j]) != 1)
+					continue;
+
+				if (pkts[j]->hash.rss == 0)
+					elephant_port = slave->port_id;
+				else if (round >= TEST_BALANCE_ROUNDS -
+						TEST_BALANCE_CHECK_ROUNDS &&
+						slave->port_id == elephant_port)
+					elephant_mice++;
+			}
+			free_pkts(pkts, retval);
+		}
+
+		rte_delay_ms(1);
+	}
+
+	TEST_ASSERT(elephant_port >= 0, "Elephant flow was not transmitted");
+	TEST_ASSERT_EQUAL(elephant_mice, 0,
+		"%u mice still transmitted on elephant slave %d", elephant_mice,
+		elephant_port);
+
+	TEST_ASSERT_SUCCESS(bond_xstat_get("balance_bucket_moves", &moves),
+		"Failed to get bucket moves");
+	TEST_ASSERT(moves > 0, "No bucket moved");
+
+	snprintf(name, sizeof(name), "slave%d_tx_buckets", elephant_port);
+	TEST_ASSERT_SUCCESS(bond_xstat_get(name, &buckets),
+		"Failed to get %s", name);
+	TEST_ASSERT_EQUAL(buckets, 1,
+		"Elephant slave has %" PRIu64 " buckets", buckets);
+
+	TEST_ASSERT_SUCCESS(rte_eth_bond_adaptive_balance_set(
+			test_params.bonded_port_id, 0),
+			"Failed to disable adaptive balancing");
+	TEST_ASSERT_SUCCESS(rte_eth_bond_xmit_policy_set(
+			test_params.bonded_port_id, BALANCE_XMIT_POLICY_LAYER2),
+			"Failed to restore L2 xmit policy");
+
+	return remove_slaves_and_stop_bonded_device();
+}
+
 static void
 init_marker(struct rte_mbuf *pkt, struct slave_conf *slave)
 {
@@ -1631,6 +1847,18 @@ test_mode4_tx_burst_wrapper(void)
 	return test_mode4_executor(&test_mode4_tx_burst);
 }
 
+static int
+test_mode4_tx_burst_rss_wrapper(void)
+{
+	return test_mode4_executor(&test_mode4_tx_burst_rss);
+}
+
+static int
+test_mode4_tx_adaptive_balance_wrapper(void)
+{
+	return test_mode4_executor(&test_mode4_tx_adaptive_balance);
+}
+
 static int
 test_mode4_expired_wrapper(void)
 {
@@ -1659,6 +1887,10 @@ static struct unit_test_suite link_bonding_mode4_test_suite  = {
 		TEST_CASE_NAMED("test_mode4_lacp", test_mode4_lacp_wrapper),
 		TEST_CASE_NAMED("test_mode4_rx", test_mode4_rx_wrapper),
 		TEST_CASE_NAMED("test_mode4_tx_burst", test_mode4_tx_burst_wrapper),
+		TEST_CASE_NAMED("test_mode4_tx_burst_rss",
+				test_mode4_tx_burst_rss_wrapper),
+		TEST_CASE_NAMED("test_mode4_tx_adaptive_balance",
+				test_mode4_tx_adaptive_balance_wrapper),
 		TEST_CASE_NAMED("test_mode4_marker", test_mode4_marker_wrapper),
 		TEST_CASE_NAMED("test_mode4_expired", test_mode4_expired_wrapper),
 		TEST_CASE_NAMED("test_mode4_ext_ctrl",
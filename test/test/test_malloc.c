@@ -37,6 +37,7 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <sys/queue.h>
 
 #include <rte_common.h>
@@ -848,6 +849,147 @@ test_alloc_socket(void)
 	return 0;
 }
 
+/*
+ * Check that the per-lcore caches hand out zeroed, valid memory, and that
+ * requests they cannot serve still go to the heap.
+ */
+static int
+test_malloc_cache(void)
+{
+	const size_t size = 100;
+	size_t allocated_size;
+	char *p1, *p2 = NULL, *p3 = NULL;
+	size_t i;
+
+	rte_malloc_cache_enable();
+
+	p1 = rte_malloc(NULL, size, 0);
+	if (p1 == NULL)
+		err_return();
+	memset(p1, 0xa5, size);
+	rte_free(p1);
+
+	/* the last freed object of a size class is reused first */
+	p2 = rte_zmalloc(NULL, size, 0);
+	if (p2 != p1)
+		err_return();
+	for (i = 0; i < size; i++)
+		if (p2[i] != 0)
+			err_return();
+	if (rte_malloc_validate(p2, &allocated_size) == -1 ||
+			allocated_size < size)
+		err_return();
+
+	/* large alignment bypasses the cache */
+	p3 = rte_malloc(NULL, size, 4096);
+	if (p3 == NULL || !is_aligned(p3, 4096))
+		err_return();
+
+	rte_free(p2);
+	rte_free(p3);
+	rte_malloc_cache_flush();
+	rte_malloc_cache_disable();
+	return 0;
+
+err_return:
+	rte_free(p2);
+	rte_free(p3);
+	rte_malloc_cache_flush();
+	rte_malloc_cache_disable();
+	return -1;
+}
+
+#define MALLOC_PERF_ITERATIONS 2000
+#define MALLOC_PERF_BURST 64
+
+static uint64_t malloc_perf_cycles[RTE_MAX_LCORE];
+
+/* Allocate and free bursts of small objects of mixed sizes. */
+static int
+malloc_perf_per_lcore(__attribute__((unused)) void *arg)
+{
+	static const size_t sizes[] = { 48, 64, 128, 200, 256, 512, 1024 };
+	void *objs[MALLOC_PERF_BURST];
+	unsigned int lcore_id = rte_lcore_id();
+	uint64_t start;
+	unsigned int i, j;
+
+	start = rte_rdtsc();
+	for (i = 0; i < MALLOC_PERF_ITERATIONS; i++) {
+		for (j = 0; j < MALLOC_PERF_BURST; j++) {
+			objs[j] = rte_malloc(NULL,
+					sizes[(i + j) % RTE_DIM(sizes)], 0);
+			if (objs[j] == NULL) {
+				while (j > 0)
+					rte_free(objs[--j]);
+				rte_malloc_cache_flush();
+				return -1;
+			}
+		}
+		for (j = 0; j < MALLOC_PERF_BURST; j++)
+			rte_free(objs[j]);
+	}
+	malloc_perf_cycles[lcore_id] = rte_rdtsc() - start;
+
+	rte_malloc_cache_flush();
+	return 0;
+}
+
+/*
+ * Compare the alloc/free throughput of all lcores hammering the heaps
+ * with and without the per-lcore caches.
+ */
+static int
+test_malloc_cache_perf(void)
+{
+	static const char * const mode_str[] = { "without", "with" };
+	unsigned int lcore_id, nb_lcores, mode;
+	uint64_t cycles, hz = rte_get_timer_hz();
+	double mops;
+	int ret = 0;
+
+	for (mode = 0; mode < RTE_DIM(mode_str); mode++) {
+		if (mode)
+			rte_malloc_cache_enable();
+		else
+			rte_malloc_cache_disable();
+
+		memset(malloc_perf_cycles, 0, sizeof(malloc_perf_cycles));
+		if (rte_eal_mp_remote_launch(malloc_perf_per_lcore, NULL,
+				SKIP_MASTER) < 0)
+			break;
+		if (malloc_perf_per_lcore(NULL) < 0)
+			ret = -1;
+		RTE_LCORE_FOREACH_SLAVE(lcore_id) {
+			if (rte_eal_wait_lcore(lcore_id) < 0)
+				ret = -1;
+		}
+		if (ret < 0)
+			break;
+
+		cycles = 0;
+		nb_lcores = 0;
+		RTE_LCORE_FOREACH(lcore_id) {
+			cycles += malloc_perf_cycles[lcore_id];
+			nb_lcores++;
+		}
+
+		/* average cycles per lcore give the aggregate rate */
+		cycles /= nb_lcores;
+		mops = (double)MALLOC_PERF_ITERATIONS * MALLOC_PERF_BURST *
+			nb_lcores * hz / cycles / 1000000;
+		printf("%u lcores %s cache: %.2f M alloc+free/s, "
+			"%"PRIu64" cycles per pair\n", nb_lcores, mode_str[mode],
+			mops, cycles / (MALLOC_PERF_ITERATIONS *
+			MALLOC_PERF_BURST));
+	}
+	if (mode < RTE_DIM(mode_str))
+		ret = -1;
+
+	rte_malloc_cache_disable();
+	return ret;
+}
+
 static int
 test_malloc(void)
 {
@@ -955,6 +1097,22 @@ test_malloc(void)
 	else
 		printf("test_multi_alloc_statistics() passed\n");
 
+	ret = test_malloc_cache();
+	if (ret < 0) {
+		printf("test_malloc_cache() failed\n");
+		return ret;
+	}
+	else
+		printf("test_malloc_cache() passed\n");
+
+	ret = test_malloc_cache_perf();
+	if (ret < 0) {
+		printf("test_malloc_cache_perf() failed\n");
+		return ret;
+	}
+	else
+		printf("test_malloc_cache_perf() passed\n");
+
 	return 0;
 }
 
@@ -38,6 +38,7 @@
 #include <inttypes.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <unistd.h>
 #include <sys/queue.h>
 
 #include <rte_common.h>
@@ -500,6 +501,163 @@ test_mempool_xmem_misc(void)
 	return 0;
 }
 
+/* sum the length of the memory chunks of a pool */
+static void
+mem_footprint_cb(struct rte_mempool *mp __rte_unused, void *opaque,
+	struct rte_mempool_memhdr *memhdr, unsigned mem_idx __rte_unused)
+{
+	size_t *footprint = opaque;
+
+	*footprint += memhdr->len;
+}
+
+/* check that an object has no IO address */
+static void
+obj_no_phys_cb(struct rte_mempool *mp, void *opaque, void *obj,
+	unsigned obj_idx __rte_unused)
+{
+	int *ret = opaque;
+
+	if (rte_mempool_virt2phy(mp, obj) != RTE_BAD_PHYS_ADDR)
+		*ret = -1;
+}
+
+#define ANON_PERF_BULK 32
+#define ANON_PERF_ITERATIONS 100000
+
+/* cycles per get+put of ANON_PERF_BULK objects, bypassing the cache */
+static uint64_t
+anon_perf_cycles(struct rte_mempool *mp)
+{
+	void *objs[ANON_PERF_BULK];
+	uint64_t start;
+	unsigned int i;
+
+	start = rte_rdtsc();
+	for (i = 0; i < ANON_PERF_ITERATIONS; i++) {
+		if (rte_mempool_generic_get(mp, objs, ANON_PERF_BULK,
+				NULL, 0) < 0)
+			return 0;
+		rte_mempool_generic_put(mp, objs, ANON_PERF_BULK, NULL, 0);
+	}
+	return (rte_rdtsc() - start) / ANON_PERF_ITERATIONS;
+}
+
+/*
+ * Compare a pool populated by default (hugepages when available) with a
+ * pool packed in anonymous memory: footprint and get/put throughput.
+ */
+static int
+test_mempool_anon_compact(void)
+{
+	struct rte_mempool *mp_default = NULL, *mp_anon = NULL;
+	size_t default_footprint = 0, anon_footprint = 0;
+	int ret = -1, phys_ret = 0;
+
+	mp_default = rte_mempool_create_empty("test_anon_ref", MEMPOOL_SIZE,
+		MEMPOOL_ELT_SIZE, 0, 0, SOCKET_ID_ANY, 0);
+	mp_anon = rte_mempool_create_empty("test_anon_compact", MEMPOOL_SIZE,
+		MEMPOOL_ELT_SIZE, 0, 0, SOCKET_ID_ANY, 0);
+	if (mp_default == NULL || mp_anon == NULL)
+		GOTO_ERR(ret, exit);
+
+	if (rte_mempool_populate_default(mp_default) < 0)
+		GOTO_ERR(ret, exit);
+	if (rte_mempool_populate_anon_compact(mp_anon,
+			MEMPOOL_ANON_F_THP) != (int)mp_anon->size)
+		GOTO_ERR(ret, exit);
+	if (rte_mempool_populate_anon_compact(mp_anon, 0) != -EEXIST)
+		GOTO_ERR(ret, exit);
+	rte_mempool_obj_iter(mp_anon, my_obj_init, NULL);
+
+	if (mp_anon->nb_mem_chunks != 1 ||
+			(mp_anon->flags & MEMPOOL_F_NO_PHYS_CONTIG) == 0)
+		GOTO_ERR(ret, exit);
+	rte_mempool_obj_iter(mp_anon, obj_no_phys_cb, &phys_ret);
+	if (phys_ret != 0)
+		GOTO_ERR(ret, exit);
+
+	/* objects are packed, at most one page is lost at the end */
+	rte_mempool_mem_iter(mp_default, mem_footprint_cb, &default_footprint);
+	rte_mempool_mem_iter(mp_anon, mem_footprint_cb, &anon_footprint);
+	if (anon_footprint > (size_t)mp_anon->size *
+			(mp_anon->header_size + mp_anon->elt_size +
+			 mp_anon->trailer_size) + getpagesize())
+		GOTO_ERR(ret, exit);
+
+	printf("footprint of %u objects: default %zu bytes, "
+		"compact anonymous %zu bytes\n", mp_anon->size,
+		default_footprint, anon_footprint);
+	printf("cycles per bulk get/put of %u objects: default %"PRIu64", "
+		"compact anonymous %"PRIu64"\n", ANON_PERF_BULK,
+		anon_perf_cycles(mp_default), anon_perf_cycles(mp_anon));
+
+	if (test_mempool_basic(mp_anon, 0) < 0)
+		GOTO_ERR(ret, exit);
+
+	ret = 0;
+
+exit:
+	rte_mempool_free(mp_default);
+	rte_mempool_free(mp_anon);
+	return ret;
+}
+
+#define HANDOFF_POOL_SIZE 1024
+#define HANDOFF_CACHE_SIZE 32
+#define HANDOFF_BULK 16
+
+/*
+ * Free all the objects of a handoff pool through a producer cache, so
+ * that part of them wait in the handoff ring, and check that they can all
+ * be taken back without cache.
+ */
+static int
+test_mempool_handoff(void)
+{
+	static void *objs[HANDOFF_POOL_SIZE];
+	struct rte_mempool *mp;
+	struct rte_mempool_cache *cache = NULL;
+	unsigned int i;
+	int ret = -1;
+
+	mp = rte_mempool_create("test_handoff", HANDOFF_POOL_SIZE,
+		MEMPOOL_ELT_SIZE, HANDOFF_CACHE_SIZE, 0, NULL, NULL,
+		NULL, NULL, SOCKET_ID_ANY, MEMPOOL_F_CACHE_HANDOFF);
+	if (mp == NULL)
+		GOTO_ERR(ret, exit);
+	cache = rte_mempool_cache_create(HANDOFF_CACHE_SIZE, SOCKET_ID_ANY);
+	if (cache == NULL)
+		GOTO_ERR(ret, exit);
+
+	if (rte_mempool_generic_get(mp, objs, HANDOFF_POOL_SIZE, NULL, 0) < 0)
+		GOTO_ERR(ret, exit);
+	for (i = 0; i < HANDOFF_POOL_SIZE; i += HANDOFF_BULK)
+		rte_mempool_generic_put(mp, &objs[i], HANDOFF_BULK, cache, 0);
+	rte_mempool_cache_flush(cache, mp);
+
+	if (rte_mempool_avail_count(mp) != HANDOFF_POOL_SIZE)
+		GOTO_ERR(ret, exit);
+	if (rte_mempool_ops_get_count(mp) == HANDOFF_POOL_SIZE) {
+		printf("no object was handed off\n");
+		GOTO_ERR(ret, exit);
+	}
+
+	/* the handler alone cannot serve this */
+	if (rte_mempool_generic_get(mp, objs, HANDOFF_POOL_SIZE, NULL, 0) < 0)
+		GOTO_ERR(ret, exit);
+	if (rte_mempool_avail_count(mp) != 0)
+		GOTO_ERR(ret, exit);
+	rte_mempool_generic_put(mp, objs, HANDOFF_POOL_SIZE, NULL, 0);
+
+	ret = 0;
+
+exit:
+	rte_mempool_cache_free(cache);
+	rte_mempool_free(mp);
+	return ret;
+}
+
 static void
 walk_cb(struct rte_mempool *mp, void *userdata __rte_unused)
 {
@@ -629,6 +787,12 @@ test_mempool(void)
 	if (test_mempool_xmem_misc() < 0)
 		goto err;
 
+	if (test_mempool_anon_compact() < 0)
+		goto err;
+
+	if (test_mempool_handoff() < 0)
+		goto err;
+
 	/* test the stack handler */
 	if (test_mempool_basic(mp_stack, 1) < 0)
 		goto err;
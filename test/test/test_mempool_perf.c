@@ -55,6 +55,8 @@
 #include <rte_mempool.h>
 #include <rte_spinlock.h>
 #include <rte_malloc.h>
+#include <rte_random.h>
+#include <rte_ring.h>
 
 #include "test.h"
 
@@ -308,6 +310,204 @@ do_one_mempool_test(struct rte_mempool *mp, unsigned int cores)
 	return 0;
 }
 
+#define LAYOUT_N_OBJS 2048
+/* with the object header, objects fill exactly 2KB when packed */
+#define LAYOUT_ELT_SIZE (2048 - RTE_CACHE_LINE_SIZE)
+#define LAYOUT_PASSES 200
+
+static void
+layout_obj_cb(__rte_unused struct rte_mempool *mp, void *opaque, void *obj,
+	unsigned obj_idx)
+{
+	void **objs = opaque;
+
+	objs[obj_idx] = obj;
+}
+
+/*
+ * Walk the first cache line of all objects of a pool in random order, as
+ * done on mbuf headers when forwarding. When the object stride is a power
+ * of two, the lines compete for a few cache sets and the walk misses in
+ * L1/L2 even if they would fit in the cache.
+ */
+static int
+test_mempool_layout(void)
+{
+	static const struct {
+		const char *name;
+		unsigned int flags;
+	} layouts[] = {
+		{ "packed", MEMPOOL_F_NO_SPREAD },
+		{ "spread", 0 },
+	};
+	struct rte_mempool *mp;
+	volatile uint64_t *hdr;
+	uint64_t start, cycles;
+	void **objs, *tmp;
+	unsigned int i, j, k, pass;
+
+	objs = rte_malloc(NULL, LAYOUT_N_OBJS * sizeof(void *), 0);
+	if (objs == NULL)
+		return -1;
+
+	for (i = 0; i < RTE_DIM(layouts); i++) {
+		/* no IO address needed, so that objects are not kept within
+		 * pages when running without hugepages
+		 */
+		mp = rte_mempool_create(layouts[i].name, LAYOUT_N_OBJS,
+			LAYOUT_ELT_SIZE, 0, 0, NULL, NULL, NULL, NULL,
+			SOCKET_ID_ANY,
+			layouts[i].flags | MEMPOOL_F_NO_PHYS_CONTIG);
+		if (mp == NULL) {
+			rte_free(objs);
+			return -1;
+		}
+		rte_mempool_obj_iter(mp, layout_obj_cb, objs);
+
+		/* shuffle the objects to defeat the hardware prefetchers */
+		rte_srand(LAYOUT_N_OBJS);
+		for (j = LAYOUT_N_OBJS - 1; j > 0; j--) {
+			k = rte_rand() % (j + 1);
+			tmp = objs[j];
+			objs[j] = objs[k];
+			objs[k] = tmp;
+		}
+
+		start = rte_rdtsc();
+		for (pass = 0; pass < LAYOUT_PASSES; pass++) {
+			for (j = 0; j < LAYOUT_N_OBJS; j++) {
+				hdr = objs[j];
+				(void)*hdr;
+			}
+		}
+		cycles = rte_rdtsc() - start;
+
+		printf("%s layout: object stride %u bytes, "
+			"%"PRIu64" cycles per 100 header accesses\n",
+			layouts[i].name,
+			mp->header_size + mp->elt_size + mp->trailer_size,
+			cycles * 100 / (LAYOUT_PASSES * LAYOUT_N_OBJS));
+		rte_mempool_free(mp);
+	}
+
+	rte_free(objs);
+	return 0;
+}
+
+#define SPLIT_N_OBJS 8192
+#define SPLIT_BURST 32
+#define SPLIT_TOTAL (1 << 21)
+
+static struct rte_ring *split_xfer;
+
+/* "Rx" side of a split workload: only get objects from the pool */
+static int
+split_rx_lcore(void *arg)
+{
+	struct rte_mempool *mp = arg;
+	void *objs[SPLIT_BURST];
+	unsigned int done = 0, n;
+
+	while (done < SPLIT_TOTAL) {
+		if (rte_mempool_get_bulk(mp, objs, SPLIT_BURST) < 0) {
+			rte_pause();
+			continue;
+		}
+		n = 0;
+		while (n < SPLIT_BURST)
+			n += rte_ring_sp_enqueue_burst(split_xfer, &objs[n],
+				SPLIT_BURST - n, NULL);
+		done += SPLIT_BURST;
+	}
+	return 0;
+}
+
+/* "Tx" side of a split workload: only put objects to the pool */
+static int
+split_tx_lcore(void *arg)
+{
+	struct rte_mempool *mp = arg;
+	void *objs[SPLIT_BURST];
+	unsigned int done = 0, n;
+
+	while (done < SPLIT_TOTAL) {
+		n = rte_ring_sc_dequeue_burst(split_xfer, objs, SPLIT_BURST,
+			NULL);
+		if (n == 0) {
+			rte_pause();
+			continue;
+		}
+		rte_mempool_put_bulk(mp, objs, n);
+		done += n;
+	}
+	return 0;
+}
+
+/*
+ * One lcore only allocates objects and passes them to another lcore that
+ * only frees them, as in a pipeline where Rx and Tx run on different
+ * lcores. With classic caches, every burst goes through the mempool
+ * handler on both sides.
+ */
+static int
+test_mempool_split(void)
+{
+	static const struct {
+		const char *name;
+		unsigned int flags;
+	} modes[] = {
+		{ "classic", 0 },
+		{ "adaptive", MEMPOOL_F_CACHE_ADAPTIVE },
+		{ "handoff", MEMPOOL_F_CACHE_HANDOFF },
+	};
+	struct rte_mempool *mp;
+	unsigned int i, rx_lcore;
+	uint64_t start, cycles;
+	int ret = 0;
+
+	if (rte_lcore_count() < 2) {
+		printf("not enough lcores for split test\n");
+		return 0;
+	}
+	rx_lcore = rte_get_next_lcore(-1, 1, 0);
+
+	split_xfer = rte_ring_create("split_xfer", SPLIT_N_OBJS,
+		SOCKET_ID_ANY, RING_F_SP_ENQ | RING_F_SC_DEQ);
+	if (split_xfer == NULL)
+		return -1;
+
+	for (i = 0; i < RTE_DIM(modes); i++) {
+		mp = rte_mempool_create(modes[i].name, SPLIT_N_OBJS,
+			MEMPOOL_ELT_SIZE, RTE_MEMPOOL_CACHE_MAX_SIZE, 0,
+			NULL, NULL, NULL, NULL, SOCKET_ID_ANY, modes[i].flags);
+		if (mp == NULL) {
+			ret = -1;
+			break;
+		}
+
+		start = rte_rdtsc();
+		rte_eal_remote_launch(split_rx_lcore, mp, rx_lcore);
+		split_tx_lcore(mp);
+		rte_eal_wait_lcore(rx_lcore);
+		cycles = rte_rdtsc() - start;
+
+		printf("split rx/tx, %s cache: %"PRIu64" cycles per object\n",
+			modes[i].name, cycles / SPLIT_TOTAL);
+
+		if (rte_mempool_avail_count(mp) != SPLIT_N_OBJS) {
+			printf("objects lost in %s split test\n",
+				modes[i].name);
+			ret = -1;
+		}
+		rte_mempool_free(mp);
+		if (ret < 0)
+			break;
+	}
+
+	rte_ring_free(split_xfer);
+	return ret;
+}
+
 static int
 test_mempool_perf(void)
 {
@@ -365,6 +565,14 @@ test_mempool_perf(void)
 
 	rte_mempool_obj_iter(default_pool, my_obj_init, NULL);
 
+	/* cache behaviour of the object layouts */
+	if (test_mempool_layout() < 0)
+		goto err;
+
+	/* allocation and release on different lcores */
+	if (test_mempool_split() < 0)
+		goto err;
+
 	/* performance test with 1, 2 and max cores */
 	printf("start performance test (without cache)\n");
 
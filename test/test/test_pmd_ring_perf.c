@@ -43,6 +43,7 @@
 #include "test.h"
 
 #define RING_NAME "RING_PERF"
+#define MPMC_RING_NAME "RING_PERF_MPMC"
 #define RING_SIZE 4096
 #define MAX_BURST 32
 
@@ -56,6 +57,11 @@ static const volatile unsigned bulk_sizes[] = { 1, 8, 32 };
 static struct rte_ring *r;
 static uint8_t ring_ethdev_port;
 
+/* A multi-producer/consumer ring, used through ports in each mode */
+static struct rte_ring *r_mpmc;
+static uint8_t mpmc_ethdev_port;
+static uint8_t spsc_ethdev_port;
+
 /* Get cycle counts for dequeuing from an empty ring. Should be 2 or 3 cycles */
 static void
 test_empty_dequeue(void)
@@ -161,6 +167,62 @@ test_bulk_enqueue_dequeue(void)
 	}
 }
 
+/* Times ethdev enqueue and dequeue on a single lcore, for a given port */
+static double
+test_port_enqueue_dequeue(uint8_t port, unsigned int size)
+{
+	const unsigned iter_shift = 23;
+	const unsigned iterations = 1 << iter_shift;
+	struct rte_mbuf *burst[MAX_BURST] = {0};
+	unsigned i;
+
+	const uint64_t start = rte_rdtsc_precise();
+	rte_compiler_barrier();
+	for (i = 0; i < iterations; i++) {
+		rte_eth_tx_burst(port, 0, burst, size);
+		rte_eth_rx_burst(port, 0, burst, size);
+	}
+	const uint64_t end = rte_rdtsc_precise();
+	rte_compiler_barrier();
+
+	return (double)(end - start) / (iterations * size);
+}
+
+/* Compares the default and SP/SC modes of the ring PMD on a MP/MC ring */
+static void
+test_mode_enqueue_dequeue(void)
+{
+	unsigned sz;
+
+	for (sz = 0; sz < sizeof(bulk_sizes)/sizeof(bulk_sizes[0]); sz++) {
+		printf("ethdev auto bulk enq/deq (size: %u): %.1F\n",
+				bulk_sizes[sz], test_port_enqueue_dequeue(
+					mpmc_ethdev_port, bulk_sizes[sz]));
+		printf("ethdev spsc bulk enq/deq (size: %u): %.1F\n",
+				bulk_sizes[sz], test_port_enqueue_dequeue(
+					spsc_ethdev_port, bulk_sizes[sz]));
+		printf("\n");
+	}
+}
+
+static int
+create_ring_port(const char *name, const char *devargs, uint8_t *port)
+{
+	char port_name[RTE_ETH_NAME_MAX_LEN];
+	int ret;
+
+	ret = rte_eth_from_rings_devargs(name, &r_mpmc, 1, &r_mpmc, 1,
+			rte_socket_id(), devargs);
+	if (ret >= 0) {
+		*port = ret;
+		return 0;
+	}
+
+	/* already created by a previous run */
+	snprintf(port_name, sizeof(port_name), "net_ring_%s", name);
+	return rte_eth_dev_get_port_by_name(port_name, port);
+}
+
 static int
 test_ring_pmd_perf(void)
 {
@@ -171,6 +233,15 @@ test_ring_pmd_perf(void)
 
 	ring_ethdev_port = rte_eth_from_ring(r);
 
+	r_mpmc = rte_ring_create(MPMC_RING_NAME, RING_SIZE, rte_socket_id(), 0);
+	if (r_mpmc == NULL && (r_mpmc = rte_ring_lookup(MPMC_RING_NAME)) == NULL)
+		return -1;
+
+	if (create_ring_port("perf_mpmc", NULL, &mpmc_ethdev_port) < 0 ||
+			create_ring_port("perf_spsc", "mode=spsc",
+				&spsc_ethdev_port) < 0)
+		return -1;
+
 	printf("\n### Testing const single element enq/deq ###\n");
 	test_single_enqueue_dequeue();
 
@@ -180,6 +251,9 @@ test_ring_pmd_perf(void)
 	printf("\n### Testing using a single lcore ###\n");
 	test_bulk_enqueue_dequeue();
 
+	printf("\n### Testing ring PMD modes on a MP/MC ring ###\n");
+	test_mode_enqueue_dequeue();
+
 	return 0;
 }
 
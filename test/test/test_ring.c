@@ -836,6 +836,13 @@ test_ring_with_exact_size(void)
 end:
 	rte_ring_free(std_ring);
 	rte_ring_free(exact_sz_ring);
+
+	/* freed rings must no longer be found by name */
+	if (ret == 0 && (rte_ring_lookup("std") != NULL ||
+			rte_ring_lookup("exact sz") != NULL)) {
+		printf("%s: error, freed ring still found\n", __func__);
+		ret = -1;
+	}
 	return ret;
 }
 
@@ -33,6 +33,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
@@ -41,6 +42,8 @@
 #include <rte_eal.h>
 #include <rte_eal_memconfig.h>
 #include <rte_string_fns.h>
+#include <rte_malloc.h>
+#include <rte_cycles.h>
 
 #include "test.h"
 
@@ -144,6 +147,116 @@ test_tailq_lookup(void)
 	return 0;
 }
 
+#define NAME_INDEX_N_OBJS 50000
+#define NAME_INDEX_N_LINEAR 1000
+
+struct name_index_obj {
+	struct rte_tailq_entry te;
+	char name[RTE_TAILQ_NAMESIZE];
+};
+
+/*
+ * Look up all objects by name as a secondary process does when attaching,
+ * once through the name index and, for a subset, by walking the tailq.
+ */
+static int
+test_tailq_name_index(void)
+{
+	struct rte_tailq_entry_head *d_head;
+	struct rte_tailq_entry *d_ptr;
+	struct name_index_obj *objs;
+	uint64_t start, index_cycles, linear_cycles;
+	char name[RTE_TAILQ_NAMESIZE];
+	unsigned int i;
+	int ret = 1;
+
+	objs = rte_calloc(NULL, NAME_INDEX_N_OBJS, sizeof(*objs), 0);
+	if (objs == NULL)
+		do_return("Cannot allocate objects\n");
+
+	d_head = RTE_TAILQ_CAST(rte_dummy_tailq.head, rte_tailq_entry_head);
+
+	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
+	for (i = 0; i < NAME_INDEX_N_OBJS; i++) {
+		snprintf(objs[i].name, sizeof(objs[i].name), "obj_%u", i);
+		objs[i].te.data = &objs[i];
+		TAILQ_INSERT_TAIL(d_head, &objs[i].te, next);
+		rte_tailq_name_add(rte_dummy_tailq.head, &objs[i].te,
+			objs[i].name);
+	}
+	/* the same name in another tailq is another object */
+	rte_tailq_name_add(rte_dummy_dyn_tailq.head, &d_dyn_elem,
+		objs[0].name);
+	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
+
+	rte_rwlock_read_lock(RTE_EAL_TAILQ_RWLOCK);
+
+	start = rte_rdtsc();
+	for (i = 0; i < NAME_INDEX_N_OBJS; i++) {
+		snprintf(name, sizeof(name), "obj_%u", i);
+		if (rte_tailq_name_lookup(rte_dummy_tailq.head, name,
+				RTE_TAILQ_NAMESIZE) != &objs[i].te)
+			break;
+	}
+	index_cycles = rte_rdtsc() - start;
+	if (i != NAME_INDEX_N_OBJS) {
+		printf("Error, object %u not found in name index\n", i);
+		goto unlock;
+	}
+
+	start = rte_rdtsc();
+	for (i = 0; i < NAME_INDEX_N_LINEAR; i++) {
+		snprintf(name, sizeof(name), "obj_%u",
+			i * (NAME_INDEX_N_OBJS / NAME_INDEX_N_LINEAR));
+		TAILQ_FOREACH(d_ptr, d_head, next) {
+			if (d_ptr->name != NULL && strcmp(d_ptr->name, name) == 0)
+				break;
+		}
+		if (d_ptr == NULL)
+			break;
+	}
+	linear_cycles = rte_rdtsc() - start;
+	if (i != NAME_INDEX_N_LINEAR) {
+		printf("Error, object %s not found in tailq\n", name);
+		goto unlock;
+	}
+
+	printf("Lookup of %u objects: %"PRIu64" cycles with name index, "
+		"%"PRIu64" cycles (extrapolated) with tailq walk\n",
+		NAME_INDEX_N_OBJS, index_cycles,
+		linear_cycles * (NAME_INDEX_N_OBJS / NAME_INDEX_N_LINEAR));
+
+	if (rte_tailq_name_lookup(rte_dummy_dyn_tailq.head, objs[0].name,
+				RTE_TAILQ_NAMESIZE) != &d_dyn_elem ||
+			rte_tailq_name_lookup(rte_dummy_tailq.head, "obj_x",
+				RTE_TAILQ_NAMESIZE) != NULL) {
+		printf("Error, wrong name index lookup result\n");
+		goto unlock;
+	}
+	ret = 0;
+
+unlock:
+	rte_rwlock_read_unlock(RTE_EAL_TAILQ_RWLOCK);
+
+	rte_rwlock_write_lock(RTE_EAL_TAILQ_RWLOCK);
+	rte_tailq_name_del(&d_dyn_elem);
+	for (i = 0; i < NAME_INDEX_N_OBJS; i++) {
+		rte_tailq_name_del(&objs[i].te);
+		TAILQ_REMOVE(d_head, &objs[i].te, next);
+		if (ret == 0 && i == NAME_INDEX_N_OBJS / 2 &&
+				rte_tailq_name_lookup(rte_dummy_tailq.head,
+					objs[i].name,
+					RTE_TAILQ_NAMESIZE) != NULL) {
+			printf("Error, deleted object still in name index\n");
+			ret = 1;
+		}
+	}
+	rte_rwlock_write_unlock(RTE_EAL_TAILQ_RWLOCK);
+
+	rte_free(objs);
+	return ret;
+}
+
 static int
 test_tailq(void)
 {
@@ -151,6 +264,7 @@ test_tailq(void)
 	ret |= test_tailq_early();
 	ret |= test_tailq_create();
 	ret |= test_tailq_lookup();
+	ret |= test_tailq_name_index();
 	return ret;
 }
 
@@ -0,0 +1,1312 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright(c) 2017 Intel Corporation. All rights reserved.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <linux/vhost.h>
+#include <linux/virtio_ring.h>
+#include <linux/virtio_net.h>
+
+#include <rte_atomic.h>
+#include <rte_cycles.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_vhost.h>
+#include <rte_vhost_async.h>
+#ifdef RTE_LIBRTE_CRYPTODEV
+#include <linux/virtio_crypto.h>
+#include <rte_cryptodev.h>
+#include <rte_vhost_crypto.h>
+#endif
+
+#include "test.h"
+
+/*
+ * Stress of the vhost-user control path against the data path: a worker
+ * lcore enqueues packets to the Rx vring of a vhost-user device, while
+ * the test, acting as both the vhost-user master and the guest, replaces
+ * the memory table and toggles the vring, and checks every packet it
+ * receives. It also stops and restarts the vring under the traffic.
+ *
+ * The same harness checks the asynchronous enqueue with the software copy
+ * engine, and that a vring stopped with packets in flight gets them all,
+ * drives the crypto backend with the null crypto PMD, and moves packets
+ * through a buffer the IOMMU maps in pieces.
+ */
+
+#define SOCKET_PATH		"/tmp/vhost_user_stress.sock"
+#define NB_RECONF		200
+#define RING_SIZE		256
+#define BUF_SIZE		2048
+#define PKT_LEN			64
+#define BURST_SIZE		32
+
+/* packets large enough for the copy engine */
+#define ASYNC_PKT_LEN		1024
+#define ASYNC_THRESHOLD		256
+#define NB_ASYNC_BURSTS		64
+
+/*
+ * A buffer at IOTLB_BUF_IOVA is mapped in three pieces of region 0 which
+ * are not contiguous, the first one splitting the virtio-net header.
+ */
+#define IOTLB_BUF_IOVA		0x80000000ULL
+#define IOTLB_PKT_LEN		1500
+#define IOTLB_NB_PIECES		3
+
+/* guest memory layout; the buffers live in region 0 */
+#define REGION_SIZE		(1 << 20)
+#define REGION0_GPA		0x100000
+#define REGION1_GPA		0x400000
+#define RX_RING_OFF		0x0
+#define TX_RING_OFF		0x4000
+#define BUFS_OFF		0x10000
+
+/* vhost-user protocol, as seen from the master */
+#define MSG_GET_FEATURES	1
+#define MSG_SET_FEATURES	2
+#define MSG_SET_OWNER		3
+#define MSG_SET_MEM_TABLE	5
+#define MSG_SET_VRING_NUM	8
+#define MSG_SET_VRING_ADDR	9
+#define MSG_SET_VRING_BASE	10
+#define MSG_GET_VRING_BASE	11
+#define MSG_SET_VRING_KICK	12
+#define MSG_SET_VRING_CALL	13
+#define MSG_SET_VRING_ENABLE	18
+#define MSG_SET_SLAVE_REQ_FD	21
+#define MSG_IOTLB		22
+#define MSG_CRYPTO_CREATE_SESS	26
+#define MSG_CRYPTO_CLOSE_SESS	27
+#define MSG_VERSION		0x1
+#define MSG_NEED_REPLY		(1 << 3)
+
+struct test_mem_region {
+	uint64_t guest_phys_addr;
+	uint64_t memory_size;
+	uint64_t userspace_addr;
+	uint64_t mmap_offset;
+};
+
+/* VhostUserCryptoSession, as QEMU sends it */
+struct test_crypto_session {
+	int64_t session_id;
+	uint32_t op_code;
+	uint32_t cipher_alg;
+	uint32_t key_len;
+	uint32_t hash_alg;
+	uint32_t hash_result_len;
+	uint32_t auth_key_len;
+	uint32_t aad_len;
+	uint8_t op_type;
+	uint8_t direction;
+	uint8_t hash_mode;
+	uint8_t alg_chain_order;
+	uint64_t key;
+	uint64_t auth_key;
+	uint8_t key_buf[64];
+	uint8_t auth_key_buf[512];
+};
+
+/* struct vhost_iotlb_msg, which older kernel headers lack */
+struct test_iotlb_msg {
+	uint64_t iova;
+	uint64_t size;
+	uint64_t uaddr;
+	uint8_t perm;
+	uint8_t type;
+};
+
+#ifndef VIRTIO_F_IOMMU_PLATFORM
+#define VIRTIO_F_IOMMU_PLATFORM	33
+#endif
+
+#define IOTLB_MISS		1
+#define IOTLB_UPDATE		2
+#define IOTLB_ACCESS_RW		0x3
+
+struct test_vhost_msg {
+	uint32_t request;
+	uint32_t flags;
+	uint32_t size;
+	union {
+		uint64_t u64;
+		struct vhost_vring_state state;
+		struct vhost_vring_addr addr;
+		struct {
+			uint32_t nregions;
+			uint32_t padding;
+			struct test_mem_region regions[2];
+		} memory;
+		struct test_crypto_session crypto_session;
+		struct test_iotlb_msg iotlb;
+	} payload;
+} __attribute__((packed));
+
+#define MSG_HDR_SIZE	offsetof(struct test_vhost_msg, payload)
+
+struct test_vring {
+	struct vring_desc *desc;
+	struct vring_avail *avail;
+	struct vring_used *used;
+	uint16_t last_used;
+};
+
+static int region_fds[2] = { -1, -1 };
+static int call_fds[2] = { -1, -1 };
+static uint8_t *region_va[2];
+static struct test_vring rx_vring;
+static int sock = -1;
+
+static volatile int vid = -1;
+static volatile int stop_worker;
+static volatile int worker_busy;
+static uint32_t tx_seq;
+static struct rte_mempool *pool;
+
+/* virtio-net header and packet sizes of the running test */
+static uint32_t hdr_len;
+static uint32_t pkt_len;
+
+static int
+new_device(int id)
+{
+	vid = id;
+	return 0;
+}
+
+/* Like an application, wait for the data path to leave the device */
+static void
+destroy_device(int id __rte_unused)
+{
+	vid = -1;
+	rte_smp_mb();
+	while (worker_busy)
+		rte_pause();
+}
+
+static const struct vhost_device_ops stress_ops = {
+	.new_device = new_device,
+	.destroy_device = destroy_device,
+};
+
+/* Allocate packets numbered from tx_seq, in their first and last words */
+static int
+alloc_pkts(struct rte_mbuf **pkts, uint16_t count)
+{
+	uint32_t *data;
+	uint16_t i;
+
+	if (rte_pktmbuf_alloc_bulk(pool, pkts, count) != 0)
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		data = (uint32_t *)rte_pktmbuf_append(pkts[i], pkt_len);
+		memset(data, 0, pkt_len);
+		data[0] = tx_seq + i;
+		data[pkt_len / sizeof(uint32_t) - 1] = tx_seq + i;
+	}
+
+	return 0;
+}
+
+/* Vhost side: enqueue numbered packets as fast as the guest takes them */
+static int
+stress_worker(void *arg __rte_unused)
+{
+	struct rte_mbuf *pkts[BURST_SIZE];
+	uint16_t i, n;
+
+	while (!stop_worker) {
+		worker_busy = 1;
+		rte_smp_mb();
+		if (vid < 0 || alloc_pkts(pkts, BURST_SIZE) < 0) {
+			worker_busy = 0;
+			continue;
+		}
+
+		n = rte_vhost_enqueue_burst(vid, 0, pkts, BURST_SIZE);
+		tx_seq += n;
+		worker_busy = 0;
+
+		for (i = 0; i < BURST_SIZE; i++)
+			rte_pktmbuf_free(pkts[i]);
+	}
+
+	return 0;
+}
+
+static int
+send_msg(struct test_vhost_msg *msg, int *fds, int nb_fds)
+{
+	struct iovec iov = {
+		.iov_base = msg,
+		.iov_len = MSG_HDR_SIZE + msg->size,
+	};
+	char control[CMSG_SPACE(sizeof(int) * 2)];
+	struct msghdr mh = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	struct cmsghdr *cmsg;
+
+	if (nb_fds > 0) {
+		mh.msg_control = control;
+		mh.msg_controllen = CMSG_SPACE(sizeof(int) * nb_fds);
+		cmsg = CMSG_FIRSTHDR(&mh);
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nb_fds);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nb_fds);
+	}
+
+	if (sendmsg(sock, &mh, 0) != (ssize_t)iov.iov_len)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Send a message and wait until the backend has handled it. The replies
+ * to the requests getting a value are copied back in the message.
+ */
+static int
+send_msg_sync(struct test_vhost_msg *msg, int *fds, int nb_fds)
+{
+	struct test_vhost_msg reply;
+	int get = msg->request == MSG_GET_FEATURES ||
+		  msg->request == MSG_GET_VRING_BASE ||
+		  msg->request == MSG_CRYPTO_CREATE_SESS;
+	ssize_t n;
+
+	if (!get)
+		msg->flags |= MSG_NEED_REPLY;
+
+	if (send_msg(msg, fds, nb_fds) < 0)
+		return -1;
+
+	n = recv(sock, &reply, sizeof(reply), 0);
+	if (n < (ssize_t)MSG_HDR_SIZE ||
+	    n != (ssize_t)(MSG_HDR_SIZE + reply.size) ||
+	    reply.size < sizeof(uint64_t))
+		return -1;
+
+	if (get) {
+		memcpy(&msg->payload, &reply.payload, reply.size);
+		return 0;
+	}
+
+	return reply.payload.u64 == 0 ? 0 : -1;
+}
+
+static int
+send_u64(uint32_t request, uint64_t val, int fd)
+{
+	struct test_vhost_msg msg = {
+		.request = request,
+		.flags = MSG_VERSION,
+		.size = sizeof(uint64_t),
+		.payload.u64 = val,
+	};
+
+	return send_msg_sync(&msg, &fd, fd >= 0);
+}
+
+static int
+send_vring_state(uint32_t request, uint32_t index, uint32_t num)
+{
+	struct test_vhost_msg msg = {
+		.request = request,
+		.flags = MSG_VERSION,
+		.size = sizeof(struct vhost_vring_state),
+		.payload.state = { .index = index, .num = num },
+	};
+
+	return send_msg_sync(&msg, NULL, 0);
+}
+
+/* Stop a vring, and get the index of the next buffer it would have used */
+static int
+get_vring_base(uint32_t index, uint32_t *base)
+{
+	struct test_vhost_msg msg = {
+		.request = MSG_GET_VRING_BASE,
+		.flags = MSG_VERSION,
+		.size = sizeof(struct vhost_vring_state),
+		.payload.state = { .index = index },
+	};
+
+	if (send_msg_sync(&msg, NULL, 0) < 0)
+		return -1;
+
+	*base = msg.payload.state.num;
+	return 0;
+}
+
+/*
+ * Region 0 alone, or with the hotplugged region 1 listed first so that
+ * the backend maps region 0, holding the rings, somewhere else.
+ */
+static int
+send_mem_table(int nregions)
+{
+	struct test_vhost_msg msg = {
+		.request = MSG_SET_MEM_TABLE,
+		.flags = MSG_VERSION,
+		.size = sizeof(msg.payload.memory),
+	};
+	const uint64_t gpa[2] = { REGION0_GPA, REGION1_GPA };
+	int fds[2];
+	int i, r;
+
+	msg.payload.memory.nregions = nregions;
+	for (i = 0; i < nregions; i++) {
+		r = nregions - 1 - i;
+		msg.payload.memory.regions[i].guest_phys_addr = gpa[r];
+		msg.payload.memory.regions[i].memory_size = REGION_SIZE;
+		msg.payload.memory.regions[i].userspace_addr =
+			(uintptr_t)region_va[r];
+		msg.payload.memory.regions[i].mmap_offset = 0;
+		fds[i] = region_fds[r];
+	}
+
+	return send_msg_sync(&msg, fds, nregions);
+}
+
+static int
+setup_vring(uint32_t index, uint32_t ring_off, uint32_t base)
+{
+	struct test_vhost_msg msg = {
+		.request = MSG_SET_VRING_ADDR,
+		.flags = MSG_VERSION,
+		.size = sizeof(struct vhost_vring_addr),
+	};
+	uint8_t *ring = region_va[0] + ring_off;
+
+	msg.payload.addr.index = index;
+	msg.payload.addr.desc_user_addr = (uintptr_t)ring;
+	msg.payload.addr.avail_user_addr = (uintptr_t)ring + 0x1000;
+	msg.payload.addr.used_user_addr = (uintptr_t)ring + 0x2000;
+
+	if (send_vring_state(MSG_SET_VRING_NUM, index, RING_SIZE) < 0 ||
+	    send_msg_sync(&msg, NULL, 0) < 0 ||
+	    send_vring_state(MSG_SET_VRING_BASE, index, base) < 0 ||
+	    send_u64(MSG_SET_VRING_KICK, index, eventfd(0, 0)) < 0)
+		return -1;
+
+	if (call_fds[index] >= 0)
+		close(call_fds[index]);
+	call_fds[index] = eventfd(0, EFD_NONBLOCK);
+	if (send_u64(MSG_SET_VRING_CALL, index, call_fds[index]) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Guest side: check the received packets and give their buffers back */
+static int
+guest_rx(uint32_t *rx_seq)
+{
+	struct test_vring *vr = &rx_vring;
+	uint16_t used_idx = *(volatile uint16_t *)&vr->used->idx;
+	struct vring_used_elem *elem;
+	uint32_t *data;
+
+	rte_smp_rmb();
+	while (vr->last_used != used_idx) {
+		elem = &vr->used->ring[vr->last_used & (RING_SIZE - 1)];
+		data = (uint32_t *)(region_va[0] + BUFS_OFF +
+				    elem->id * BUF_SIZE + hdr_len);
+
+		if (elem->len != hdr_len + pkt_len ||
+		    data[0] != *rx_seq ||
+		    data[pkt_len / sizeof(uint32_t) - 1] != *rx_seq) {
+			printf("bad packet: len %u, seq %u instead of %u\n",
+			       elem->len, data[0], *rx_seq);
+			return -1;
+		}
+		(*rx_seq)++;
+
+		vr->avail->ring[vr->avail->idx & (RING_SIZE - 1)] = elem->id;
+		rte_smp_wmb();
+		vr->avail->idx++;
+		vr->last_used++;
+	}
+
+	return 0;
+}
+
+static int
+setup_guest(void)
+{
+	char path[] = "/tmp/vhost_user_stress_XXXXXX";
+	struct test_vring *vr = &rx_vring;
+	uint16_t i;
+	int r;
+
+	for (r = 0; r < 2; r++) {
+		region_fds[r] = mkstemp(path);
+		if (region_fds[r] < 0)
+			return -1;
+		unlink(path);
+		strcpy(path + strlen(path) - 6, "XXXXXX");
+
+		if (ftruncate(region_fds[r], REGION_SIZE) < 0)
+			return -1;
+		region_va[r] = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE,
+				    MAP_SHARED, region_fds[r], 0);
+		if (region_va[r] == MAP_FAILED)
+			return -1;
+	}
+
+	vr->desc = (struct vring_desc *)(region_va[0] + RX_RING_OFF);
+	vr->avail = (struct vring_avail *)(region_va[0] + RX_RING_OFF + 0x1000);
+	vr->used = (struct vring_used *)(region_va[0] + RX_RING_OFF + 0x2000);
+	for (i = 0; i < RING_SIZE; i++) {
+		vr->desc[i].addr = REGION0_GPA + BUFS_OFF + i * BUF_SIZE;
+		vr->desc[i].len = BUF_SIZE;
+		vr->desc[i].flags = VRING_DESC_F_WRITE;
+		vr->avail->ring[i] = i;
+	}
+	vr->avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+	vr->avail->idx = RING_SIZE;
+	vr->last_used = 0;
+	tx_seq = 0;
+
+	return 0;
+}
+
+static void
+cleanup_guest(void)
+{
+	int r;
+
+	for (r = 0; r < 2; r++) {
+		if (region_va[r] != NULL && region_va[r] != MAP_FAILED)
+			munmap(region_va[r], REGION_SIZE);
+		region_va[r] = NULL;
+		if (region_fds[r] >= 0)
+			close(region_fds[r]);
+		region_fds[r] = -1;
+	}
+}
+
+/* Map [iova, iova + size) to the master address uaddr */
+static int
+send_iotlb_update(uint64_t iova, uint64_t size, uint64_t uaddr)
+{
+	struct test_vhost_msg msg = {
+		.request = MSG_IOTLB,
+		.flags = MSG_VERSION,
+		.size = sizeof(struct test_iotlb_msg),
+		.payload.iotlb = {
+			.iova = iova,
+			.size = size,
+			.uaddr = uaddr,
+			.perm = IOTLB_ACCESS_RW,
+			.type = IOTLB_UPDATE,
+		},
+	};
+
+	return send_msg_sync(&msg, NULL, 0);
+}
+
+static int
+connect_master(uint64_t features)
+{
+	struct sockaddr_un un = { .sun_family = AF_UNIX };
+	struct test_vhost_msg msg = {
+		.request = MSG_GET_FEATURES,
+		.flags = MSG_VERSION,
+	};
+
+	snprintf(un.sun_path, sizeof(un.sun_path), "%s", SOCKET_PATH);
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0 || connect(sock, (struct sockaddr *)&un, sizeof(un)) < 0)
+		return -1;
+
+	if (send_msg_sync(&msg, NULL, 0) < 0 ||
+	    send_u64(MSG_SET_FEATURES, features, -1) < 0 ||
+	    send_u64(MSG_SET_OWNER, 0, -1) < 0 ||
+	    send_mem_table(1) < 0 ||
+	    setup_vring(0, RX_RING_OFF, 0) < 0 ||
+	    setup_vring(1, TX_RING_OFF, 0) < 0)
+		return -1;
+
+	/* with an IOMMU, the rings are reached through region 0 mapped 1:1 */
+	if ((features & (1ULL << VIRTIO_F_IOMMU_PLATFORM)) &&
+	    send_iotlb_update((uintptr_t)region_va[0], REGION_SIZE,
+			      (uintptr_t)region_va[0]) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Start the vhost-user driver and bring a device up through it */
+static int
+start_device(uint64_t flags, uint64_t features)
+{
+	uint64_t deadline;
+
+	unlink(SOCKET_PATH);
+	if (rte_vhost_driver_register(SOCKET_PATH, flags) < 0 ||
+	    rte_vhost_driver_callback_register(SOCKET_PATH,
+					       &stress_ops) < 0 ||
+	    rte_vhost_driver_start(SOCKET_PATH) < 0) {
+		printf("cannot start vhost-user driver\n");
+		return -1;
+	}
+
+	if (setup_guest() < 0 || connect_master(features) < 0) {
+		printf("cannot set up the vhost-user device\n");
+		return -1;
+	}
+
+	deadline = rte_get_timer_cycles() + rte_get_timer_hz();
+	while (vid < 0 && rte_get_timer_cycles() < deadline)
+		rte_pause();
+	if (vid < 0) {
+		printf("device did not come up\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+stop_device(void)
+{
+	uint64_t deadline;
+	int i;
+
+	if (sock >= 0)
+		close(sock);
+	sock = -1;
+	deadline = rte_get_timer_cycles() + rte_get_timer_hz();
+	while (vid >= 0 && rte_get_timer_cycles() < deadline)
+		rte_pause();
+	rte_vhost_driver_unregister(SOCKET_PATH);
+	cleanup_guest();
+
+	for (i = 0; i < 2; i++) {
+		if (call_fds[i] >= 0)
+			close(call_fds[i]);
+		call_fds[i] = -1;
+	}
+}
+
+static int
+test_vhost_user_stress(void)
+{
+	unsigned int worker = rte_get_next_lcore(-1, 1, 0);
+	uint32_t rx_seq = 0, last_seq, base;
+	uint64_t deadline;
+	int i, ret = -1;
+
+	if (worker >= RTE_MAX_LCORE) {
+		printf("at least 2 lcores are needed, skipping\n");
+		return TEST_SUCCESS;
+	}
+
+	pool = rte_pktmbuf_pool_create("vhost_stress", 1023, 32, 0,
+				       RTE_MBUF_DEFAULT_BUF_SIZE, SOCKET_ID_ANY);
+	if (pool == NULL) {
+		printf("cannot create mbuf pool\n");
+		return -1;
+	}
+
+	hdr_len = sizeof(struct virtio_net_hdr);
+	pkt_len = PKT_LEN;
+	if (start_device(0, 0) < 0)
+		goto out;
+
+	stop_worker = 0;
+	rte_eal_remote_launch(stress_worker, NULL, worker);
+
+	for (i = 0; i < NB_RECONF; i++) {
+		/* let some traffic through each configuration */
+		last_seq = rx_seq;
+		deadline = rte_get_timer_cycles() + rte_get_timer_hz();
+		while (rx_seq - last_seq < RING_SIZE &&
+		       rte_get_timer_cycles() < deadline) {
+			if (guest_rx(&rx_seq) < 0)
+				goto stop;
+		}
+		if (rx_seq == last_seq) {
+			printf("traffic stopped after %d reconfigurations\n",
+			       i);
+			goto stop;
+		}
+
+		if (send_mem_table(1 + (i & 1)) < 0) {
+			printf("cannot set memory table\n");
+			goto stop;
+		}
+
+		if ((i % 8) == 7 &&
+		    (send_vring_state(MSG_SET_VRING_ENABLE, 0, 0) < 0 ||
+		     send_vring_state(MSG_SET_VRING_ENABLE, 0, 1) < 0)) {
+			printf("cannot toggle the vring\n");
+			goto stop;
+		}
+
+		/* stop the vring, and start it again where it was */
+		if ((i % 8) == 3 &&
+		    (get_vring_base(0, &base) < 0 ||
+		     setup_vring(0, RX_RING_OFF, base) < 0)) {
+			printf("cannot restart the vring\n");
+			goto stop;
+		}
+	}
+	ret = 0;
+
+stop:
+	stop_worker = 1;
+	rte_eal_wait_lcore(worker);
+
+	if (ret == 0) {
+		ret = guest_rx(&rx_seq);
+		if (ret == 0 && rx_seq != tx_seq) {
+			printf("%u packets sent, %u received\n",
+			       tx_seq, rx_seq);
+			ret = -1;
+		}
+	}
+	printf("%u packets received across %d memory table changes and %d vring restarts\n",
+	       rx_seq, NB_RECONF, NB_RECONF / 8);
+
+out:
+	stop_device();
+	rte_mempool_free(pool);
+
+	return ret;
+}
+
+/* Enqueue a burst with the copy engine and wait for all of it */
+static int
+async_enqueue(uint16_t count)
+{
+	struct rte_mbuf *pkts[BURST_SIZE];
+	uint64_t deadline;
+	uint16_t i, n, n_done, done;
+
+	if (alloc_pkts(pkts, count) < 0)
+		return -1;
+
+	n = rte_vhost_submit_enqueue_burst(vid, 0, pkts, count);
+	for (i = n; i < count; i++)
+		rte_pktmbuf_free(pkts[i]);
+	tx_seq += n;
+
+	deadline = rte_get_timer_cycles() + rte_get_timer_hz();
+	for (done = 0; done < n && rte_get_timer_cycles() < deadline; ) {
+		n_done = rte_vhost_poll_enqueue_completed(vid, 0, pkts,
+							  BURST_SIZE);
+		for (i = 0; i < n_done; i++)
+			rte_pktmbuf_free(pkts[i]);
+		done += n_done;
+	}
+	if (done != n) {
+		printf("%u packets of %u completed\n", done, n);
+		return -1;
+	}
+
+	return n;
+}
+
+static int
+test_vhost_async(void)
+{
+	unsigned int worker = rte_get_next_lcore(-1, 1, 0);
+	struct rte_vhost_async_sw *sw = NULL;
+	struct rte_mbuf *pkts[BURST_SIZE];
+	uint32_t rx_seq = 0, base;
+	uint16_t i, n;
+	int ret = -1;
+
+	if (worker >= RTE_MAX_LCORE) {
+		printf("at least 2 lcores are needed, skipping\n");
+		return TEST_SUCCESS;
+	}
+
+	pool = rte_pktmbuf_pool_create("vhost_async", 1023, 0, 0,
+				       RTE_MBUF_DEFAULT_BUF_SIZE, SOCKET_ID_ANY);
+	sw = rte_vhost_async_sw_create(RING_SIZE, SOCKET_ID_ANY);
+	if (pool == NULL || sw == NULL) {
+		printf("cannot create mbuf pool or copy engine\n");
+		goto free;
+	}
+	rte_eal_remote_launch(rte_vhost_async_sw_worker, sw, worker);
+
+	hdr_len = sizeof(struct virtio_net_hdr_mrg_rxbuf);
+	pkt_len = ASYNC_PKT_LEN;
+	if (start_device(0, 1ULL << VIRTIO_NET_F_MRG_RXBUF) < 0)
+		goto out;
+
+	if (rte_vhost_async_channel_register(vid, 0, ASYNC_THRESHOLD,
+					     &rte_vhost_async_sw_ops,
+					     sw) < 0) {
+		printf("cannot register the copy engine\n");
+		goto out;
+	}
+
+	for (i = 0; i < NB_ASYNC_BURSTS; i++) {
+		if (async_enqueue(BURST_SIZE) <= 0 || guest_rx(&rx_seq) < 0)
+			goto out;
+	}
+	if (rx_seq != tx_seq) {
+		printf("%u packets sent, %u received\n", tx_seq, rx_seq);
+		goto out;
+	}
+
+	/* stop the vring with packets in flight: they must all be used */
+	if (alloc_pkts(pkts, BURST_SIZE) < 0)
+		goto out;
+	n = rte_vhost_submit_enqueue_burst(vid, 0, pkts, BURST_SIZE);
+	for (i = n; i < BURST_SIZE; i++)
+		rte_pktmbuf_free(pkts[i]);
+	tx_seq += n;
+
+	if (rte_vhost_async_channel_unregister(vid, 0) != -EBUSY) {
+		printf("copy engine unbound with packets in flight\n");
+		goto out;
+	}
+
+	if (get_vring_base(0, &base) < 0) {
+		printf("cannot stop the vring\n");
+		goto out;
+	}
+	if (guest_rx(&rx_seq) < 0)
+		goto out;
+	if (rx_seq != tx_seq || rx_vring.used->idx != (uint16_t)base) {
+		printf("%u packets sent, %u received, vring base %u\n",
+		       tx_seq, rx_seq, base);
+		goto out;
+	}
+	if (rte_mempool_avail_count(pool) != pool->size) {
+		printf("%u mbufs leaked\n",
+		       pool->size - rte_mempool_avail_count(pool));
+		goto out;
+	}
+	printf("%u packets received through the copy engine\n", rx_seq);
+	ret = 0;
+
+out:
+	stop_device();
+	rte_vhost_async_sw_stop(sw);
+	rte_eal_wait_lcore(worker);
+free:
+	rte_vhost_async_sw_free(sw);
+	rte_mempool_free(pool);
+
+	return ret;
+}
+
+/* Region 0 offsets and sizes of the pieces of the IOTLB test buffer */
+static const uint32_t iotlb_piece_off[IOTLB_NB_PIECES] = {
+	BUFS_OFF, BUFS_OFF + 0x1000, BUFS_OFF + 0x2000,
+};
+static const uint32_t iotlb_piece_len[IOTLB_NB_PIECES] = {
+	6, BUF_SIZE / 2 - 6, BUF_SIZE / 2,
+};
+
+/* Copy the IOTLB test buffer from or to its pieces */
+static void
+iotlb_buf_copy(uint8_t *buf, int to_guest)
+{
+	uint8_t *va;
+	int i;
+
+	for (i = 0; i < IOTLB_NB_PIECES; i++) {
+		va = region_va[0] + iotlb_piece_off[i];
+		if (to_guest)
+			memcpy(va, buf, iotlb_piece_len[i]);
+		else
+			memcpy(buf, va, iotlb_piece_len[i]);
+		buf += iotlb_piece_len[i];
+	}
+}
+
+/* Map the IOTLB test buffer, up to piece n excluded */
+static int
+iotlb_buf_map(int n)
+{
+	uint64_t iova = IOTLB_BUF_IOVA;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (send_iotlb_update(iova, iotlb_piece_len[i],
+			(uintptr_t)(region_va[0] + iotlb_piece_off[i])) < 0)
+			return -1;
+		iova += iotlb_piece_len[i];
+	}
+
+	return 0;
+}
+
+/* Number of IOTLB misses the backend sent, and the IOVA of the last one */
+static int
+iotlb_misses(int slave_fd, uint64_t *iova)
+{
+	struct test_vhost_msg msg;
+	int n = 0;
+
+	while (recv(slave_fd, &msg, sizeof(msg), MSG_DONTWAIT) > 0) {
+		if (msg.payload.iotlb.type == IOTLB_MISS)
+			*iova = msg.payload.iotlb.iova;
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * Enqueue a packet into the IOTLB test buffer, then dequeue it back from
+ * the Tx vring. The backend asks for the piece not mapped yet, and only
+ * for it, on the slave channel given by the socket pair slave_fds.
+ */
+static int
+iotlb_rx_tx(uint64_t features, int *slave_fds)
+{
+	struct test_vring tx_vring = {
+		.desc = (struct vring_desc *)(region_va[0] + TX_RING_OFF),
+		.avail = (struct vring_avail *)(region_va[0] + TX_RING_OFF +
+						0x1000),
+	};
+	uint8_t buf[BUF_SIZE];
+	const uint8_t *data;
+	struct rte_mbuf *m;
+	uint64_t iova = 0;
+	uint32_t i;
+	uint16_t n;
+	int misses, ret = -1;
+
+	if (send_u64(MSG_SET_SLAVE_REQ_FD, 0, slave_fds[1]) < 0 ||
+	    iotlb_buf_map(IOTLB_NB_PIECES - 1) < 0) {
+		printf("cannot set up the IOTLB\n");
+		return -1;
+	}
+
+	rx_vring.desc[0].addr = IOTLB_BUF_IOVA;
+	rx_vring.desc[0].len = BUF_SIZE;
+	rx_vring.desc[0].flags = VRING_DESC_F_WRITE;
+	rx_vring.avail->ring[0] = 0;
+	rte_smp_wmb();
+	rx_vring.avail->idx = 1;
+
+	m = rte_pktmbuf_alloc(pool);
+	if (m == NULL)
+		return -1;
+	for (i = 0; i < IOTLB_PKT_LEN; i++)
+		rte_pktmbuf_mtod(m, uint8_t *)[i] = i * 7;
+	m->data_len = IOTLB_PKT_LEN;
+	m->pkt_len = IOTLB_PKT_LEN;
+
+	/* without mergeable buffers, the packet is dropped in the buffer */
+	n = rte_vhost_enqueue_burst(vid, 0, &m, 1);
+	misses = iotlb_misses(slave_fds[0], &iova);
+	if (misses != 1 || iova != IOTLB_BUF_IOVA + BUF_SIZE / 2) {
+		printf("%d misses for a partly mapped buffer, last at 0x%" PRIx64 "\n",
+		       misses, iova);
+		goto out;
+	}
+	if (n != 0) {
+		rx_vring.avail->ring[1] = 0;
+		rte_smp_wmb();
+		rx_vring.avail->idx = 2;
+	}
+
+	if (iotlb_buf_map(IOTLB_NB_PIECES) < 0)
+		goto out;
+	n = rte_vhost_enqueue_burst(vid, 0, &m, 1);
+	iotlb_buf_copy(buf, 0);
+	if (n != 1 || rx_vring.used->ring[rx_vring.used->idx - 1].len !=
+			hdr_len + IOTLB_PKT_LEN ||
+	    memcmp(buf + hdr_len, rte_pktmbuf_mtod(m, uint8_t *),
+		   IOTLB_PKT_LEN) != 0 ||
+	    ((features & (1ULL << VIRTIO_NET_F_MRG_RXBUF)) &&
+	     ((struct virtio_net_hdr_mrg_rxbuf *)buf)->num_buffers != 1)) {
+		printf("enqueue: %u packets, %u buffers used\n",
+		       n, rx_vring.used->idx);
+		goto out;
+	}
+
+	/* the guest sends the packet back, with a header of its own */
+	memset(buf, 0, hdr_len);
+	iotlb_buf_copy(buf, 1);
+	tx_vring.desc[0].addr = IOTLB_BUF_IOVA;
+	tx_vring.desc[0].len = hdr_len + IOTLB_PKT_LEN;
+	tx_vring.desc[0].flags = 0;
+	tx_vring.avail->ring[0] = 0;
+	rte_smp_wmb();
+	tx_vring.avail->idx = 1;
+
+	rte_pktmbuf_free(m);
+	m = NULL;
+	n = rte_vhost_dequeue_burst(vid, 1, pool, &m, 1);
+	if (n != 1 || m->pkt_len != IOTLB_PKT_LEN) {
+		printf("dequeue: %u packets\n", n);
+		goto out;
+	}
+	data = rte_pktmbuf_read(m, 0, IOTLB_PKT_LEN, buf);
+	for (i = 0; i < IOTLB_PKT_LEN; i++) {
+		if (data[i] != (uint8_t)(i * 7)) {
+			printf("dequeue: bad byte %u\n", i);
+			goto out;
+		}
+	}
+
+	if (iotlb_misses(slave_fds[0], &iova) != 0) {
+		printf("miss at 0x%" PRIx64 " for a mapped buffer\n", iova);
+		goto out;
+	}
+	ret = 0;
+
+out:
+	rte_pktmbuf_free(m);
+	return ret;
+}
+
+static int
+test_vhost_iotlb(void)
+{
+	const uint64_t features[] = {
+		1ULL << VIRTIO_F_IOMMU_PLATFORM,
+		(1ULL << VIRTIO_F_IOMMU_PLATFORM) |
+		(1ULL << VIRTIO_NET_F_MRG_RXBUF),
+	};
+	int fds[2];
+	unsigned int i;
+	int ret = 0;
+
+	pool = rte_pktmbuf_pool_create("vhost_iotlb", 63, 0, 0,
+				       RTE_MBUF_DEFAULT_BUF_SIZE, SOCKET_ID_ANY);
+	if (pool == NULL) {
+		printf("cannot create mbuf pool\n");
+		return -1;
+	}
+
+	for (i = 0; i < RTE_DIM(features) && ret == 0; i++) {
+		hdr_len = (features[i] & (1ULL << VIRTIO_NET_F_MRG_RXBUF)) ?
+			sizeof(struct virtio_net_hdr_mrg_rxbuf) :
+			sizeof(struct virtio_net_hdr);
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+			break;
+		ret = start_device(RTE_VHOST_USER_IOMMU_SUPPORT, features[i]);
+		if (ret == 0)
+			ret = iotlb_rx_tx(features[i], fds);
+		stop_device();
+		close(fds[0]);
+		close(fds[1]);
+	}
+	if (i != RTE_DIM(features))
+		ret = -1;
+
+	rte_mempool_free(pool);
+
+	return ret;
+}
+
+#ifdef RTE_LIBRTE_CRYPTODEV
+
+#define CRYPTO_DEV_NAME		"crypto_null"
+#define CRYPTO_SLOT_SIZE	0x4000
+#define CRYPTO_SRC_OFF		0x100
+#define CRYPTO_DST_OFF		0x1000
+#define CRYPTO_STATUS_OFF	0x2000
+#define CRYPTO_SLOT_DESCS	40
+#define CRYPTO_BIG_LEN		3000
+#define CRYPTO_MAX_DST_DESCS	32
+#define CRYPTO_NB_REQS		4
+
+static int64_t
+create_crypto_session(uint8_t op_type, uint32_t cipher_alg)
+{
+	struct test_vhost_msg msg = {
+		.request = MSG_CRYPTO_CREATE_SESS,
+		.flags = MSG_VERSION,
+		.size = sizeof(struct test_crypto_session),
+	};
+	struct test_crypto_session sess = {
+		.op_code = VIRTIO_CRYPTO_CIPHER_CREATE_SESSION,
+		.cipher_alg = cipher_alg,
+		.direction = VIRTIO_CRYPTO_OP_ENCRYPT,
+		.op_type = op_type,
+	};
+
+	if (op_type == VIRTIO_CRYPTO_SYM_OP_ALGORITHM_CHAINING) {
+		sess.hash_mode = VIRTIO_CRYPTO_SYM_HASH_MODE_PLAIN;
+		sess.hash_alg = VIRTIO_CRYPTO_NO_HASH;
+		sess.alg_chain_order =
+			VIRTIO_CRYPTO_SYM_ALG_CHAIN_ORDER_HASH_THEN_CIPHER;
+	}
+	msg.payload.crypto_session = sess;
+
+	if (send_msg_sync(&msg, NULL, 0) < 0)
+		return INT64_MIN;
+
+	return msg.payload.crypto_session.session_id;
+}
+
+/*
+ * Guest side: post a request of session id on the data queue, in slot
+ * of the buffers area. The header and source are device-readable, the
+ * destination, split in nb_dst descriptors, and status device-writable.
+ */
+static void
+guest_crypto_req(uint16_t slot, uint64_t id, uint8_t op_type, uint32_t len,
+		 uint16_t nb_dst)
+{
+	struct test_vring *vr = &rx_vring;
+	uint64_t gpa = REGION0_GPA + BUFS_OFF + slot * CRYPTO_SLOT_SIZE;
+	uint8_t *va = region_va[0] + BUFS_OFF + slot * CRYPTO_SLOT_SIZE;
+	struct virtio_crypto_op_data_req *req = (void *)va;
+	struct vring_desc *desc = &vr->desc[slot * CRYPTO_SLOT_DESCS];
+	uint16_t head = slot * CRYPTO_SLOT_DESCS;
+	uint32_t i, off, n;
+
+	memset(va, 0, CRYPTO_SLOT_SIZE);
+	req->header.opcode = VIRTIO_CRYPTO_CIPHER_ENCRYPT;
+	req->header.session_id = id;
+	req->u.sym_req.op_type = op_type;
+	if (op_type == VIRTIO_CRYPTO_SYM_OP_ALGORITHM_CHAINING) {
+		req->u.sym_req.u.chain.para.src_data_len = len;
+		req->u.sym_req.u.chain.para.dst_data_len = len;
+		req->u.sym_req.u.chain.para.len_to_cipher = len;
+		req->u.sym_req.u.chain.para.len_to_hash = len;
+	} else {
+		req->u.sym_req.u.cipher.para.src_data_len = len;
+		req->u.sym_req.u.cipher.para.dst_data_len = len;
+	}
+	for (i = 0; i < len; i++)
+		va[CRYPTO_SRC_OFF + i] = slot + i;
+	va[CRYPTO_STATUS_OFF] = 0xff;
+
+	desc[0].addr = gpa;
+	desc[0].len = sizeof(*req);
+	desc[0].flags = VRING_DESC_F_NEXT;
+	desc[0].next = head + 1;
+	desc[1].addr = gpa + CRYPTO_SRC_OFF;
+	desc[1].len = len;
+	desc[1].flags = VRING_DESC_F_NEXT;
+	desc[1].next = head + 2;
+	for (i = 0, off = 0; i < nb_dst; i++, off += n) {
+		n = i == nb_dst - 1U ? len - off : len / nb_dst;
+		desc[2 + i].addr = gpa + CRYPTO_DST_OFF + off;
+		desc[2 + i].len = n;
+		desc[2 + i].flags = VRING_DESC_F_WRITE | VRING_DESC_F_NEXT;
+		desc[2 + i].next = head + 3 + i;
+	}
+	desc[2 + i].addr = gpa + CRYPTO_STATUS_OFF;
+	desc[2 + i].len = sizeof(struct virtio_crypto_inhdr);
+	desc[2 + i].flags = VRING_DESC_F_WRITE;
+
+	vr->avail->ring[vr->avail->idx & (RING_SIZE - 1)] = head;
+	rte_smp_wmb();
+	vr->avail->idx++;
+}
+
+/* Guest side: check the status, length and data of a completed request */
+static int
+guest_crypto_check(uint16_t slot, uint8_t status, uint32_t len)
+{
+	struct test_vring *vr = &rx_vring;
+	uint8_t *va = region_va[0] + BUFS_OFF + slot * CRYPTO_SLOT_SIZE;
+	uint16_t i;
+
+	for (i = 0; i < vr->used->idx; i++)
+		if (vr->used->ring[i].id == slot * CRYPTO_SLOT_DESCS)
+			break;
+	if (i == vr->used->idx) {
+		printf("request %u not completed\n", slot);
+		return -1;
+	}
+
+	if (va[CRYPTO_STATUS_OFF] != status ||
+	    vr->used->ring[i].len != len + sizeof(struct virtio_crypto_inhdr) ||
+	    memcmp(va + CRYPTO_SRC_OFF, va + CRYPTO_DST_OFF, len) != 0) {
+		printf("request %u: status %u, len %u\n", slot,
+		       va[CRYPTO_STATUS_OFF], vr->used->ring[i].len);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+test_vhost_crypto(void)
+{
+	struct rte_mempool *sess_pool = NULL, *op_pool = NULL;
+	struct rte_crypto_op *ops[CRYPTO_NB_REQS], *done[CRYPTO_NB_REQS];
+	struct rte_cryptodev_config conf = {
+		.socket_id = SOCKET_ID_ANY,
+		.nb_queue_pairs = 1,
+	};
+	struct rte_cryptodev_qp_conf qp_conf = { .nb_descriptors = 128 };
+	unsigned int sess_size;
+	int64_t cipher_id, chain_id;
+	uint16_t n, nb_done;
+	uint64_t deadline;
+	eventfd_t ev;
+	int cid, i, ret = -1;
+
+	if (rte_vdev_init(CRYPTO_DEV_NAME, NULL) < 0) {
+		printf("cannot create the null crypto device\n");
+		return -1;
+	}
+	cid = rte_cryptodev_get_dev_id(CRYPTO_DEV_NAME);
+
+	sess_size = RTE_MAX(rte_cryptodev_get_private_session_size(cid),
+			    rte_cryptodev_get_header_session_size());
+	sess_pool = rte_mempool_create("vhost_crypto_sess", 64, sess_size,
+				       0, 0, NULL, NULL, NULL, NULL,
+				       SOCKET_ID_ANY, 0);
+	op_pool = rte_crypto_op_pool_create("vhost_crypto_ops",
+					    RTE_CRYPTO_OP_TYPE_SYMMETRIC, 64, 0,
+					    VHOST_CRYPTO_OP_PRIV_SIZE,
+					    SOCKET_ID_ANY);
+	if (sess_pool == NULL || op_pool == NULL ||
+	    rte_cryptodev_configure(cid, &conf) < 0 ||
+	    rte_cryptodev_queue_pair_setup(cid, 0, &qp_conf, SOCKET_ID_ANY,
+					   sess_pool) < 0 ||
+	    rte_cryptodev_start(cid) < 0) {
+		printf("cannot set up the null crypto device\n");
+		goto free;
+	}
+
+	if (start_device(0, 0) < 0 ||
+	    rte_vhost_crypto_create(vid, cid, sess_pool, SOCKET_ID_ANY) < 0)
+		goto out;
+
+	/* the data queue starts empty, and wants to be notified */
+	rx_vring.avail->idx = 0;
+	rx_vring.avail->flags = 0;
+
+	cipher_id = create_crypto_session(VIRTIO_CRYPTO_SYM_OP_CIPHER,
+					  VIRTIO_CRYPTO_NO_CIPHER);
+	chain_id = create_crypto_session(VIRTIO_CRYPTO_SYM_OP_ALGORITHM_CHAINING,
+					 VIRTIO_CRYPTO_NO_CIPHER);
+	if (cipher_id < 0 || chain_id < 0) {
+		printf("cannot create sessions: %" PRId64 ", %" PRId64 "\n",
+		       cipher_id, chain_id);
+		goto out;
+	}
+	if (create_crypto_session(VIRTIO_CRYPTO_SYM_OP_CIPHER,
+				  VIRTIO_CRYPTO_CIPHER_DES_ECB) !=
+	    -VIRTIO_CRYPTO_NOTSUPP) {
+		printf("unsupported cipher accepted\n");
+		goto out;
+	}
+
+	/* the big source does not fit in one mbuf */
+	guest_crypto_req(0, cipher_id, VIRTIO_CRYPTO_SYM_OP_CIPHER,
+			 CRYPTO_BIG_LEN, 1);
+	guest_crypto_req(1, chain_id, VIRTIO_CRYPTO_SYM_OP_ALGORITHM_CHAINING,
+			 PKT_LEN, 1);
+	guest_crypto_req(2, chain_id + 1, VIRTIO_CRYPTO_SYM_OP_CIPHER,
+			 PKT_LEN, 1);
+	/* as many destination buffers as a request can have, then status */
+	guest_crypto_req(3, cipher_id, VIRTIO_CRYPTO_SYM_OP_CIPHER,
+			 CRYPTO_MAX_DST_DESCS, CRYPTO_MAX_DST_DESCS);
+
+	if (rte_crypto_op_bulk_alloc(op_pool, RTE_CRYPTO_OP_TYPE_SYMMETRIC,
+				     ops, CRYPTO_NB_REQS) == 0)
+		goto out;
+	n = rte_vhost_crypto_fetch_requests(vid, 0, ops, CRYPTO_NB_REQS);
+	if (n != 3) {
+		printf("%u requests fetched instead of 3\n", n);
+		goto free_ops;
+	}
+
+	n = rte_cryptodev_enqueue_burst(cid, 0, ops, n);
+	deadline = rte_get_timer_cycles() + rte_get_timer_hz();
+	for (nb_done = 0; nb_done < n && rte_get_timer_cycles() < deadline; )
+		nb_done += rte_cryptodev_dequeue_burst(cid, 0, done + nb_done,
+						       n - nb_done);
+	if (nb_done != 3 ||
+	    rte_vhost_crypto_finalize_requests(done, nb_done) != nb_done) {
+		printf("%u requests processed instead of 3\n", nb_done);
+		goto free_ops;
+	}
+
+	if (rx_vring.used->idx != CRYPTO_NB_REQS ||
+	    guest_crypto_check(0, VIRTIO_CRYPTO_OK, CRYPTO_BIG_LEN) < 0 ||
+	    guest_crypto_check(1, VIRTIO_CRYPTO_OK, PKT_LEN) < 0 ||
+	    guest_crypto_check(2, VIRTIO_CRYPTO_INVSESS, 0) < 0 ||
+	    guest_crypto_check(3, VIRTIO_CRYPTO_OK, CRYPTO_MAX_DST_DESCS) < 0)
+		goto free_ops;
+
+	if (eventfd_read(call_fds[0], &ev) < 0) {
+		printf("guest not notified\n");
+		goto free_ops;
+	}
+
+	if (send_u64(MSG_CRYPTO_CLOSE_SESS, cipher_id, -1) < 0 ||
+	    send_u64(MSG_CRYPTO_CLOSE_SESS, chain_id, -1) < 0 ||
+	    send_u64(MSG_CRYPTO_CLOSE_SESS, chain_id, -1) == 0) {
+		printf("cannot close sessions\n");
+		goto free_ops;
+	}
+	ret = 0;
+
+free_ops:
+	for (i = 0; i < CRYPTO_NB_REQS; i++)
+		rte_crypto_op_free(ops[i]);
+out:
+	if (vid >= 0)
+		rte_vhost_crypto_free(vid);
+	stop_device();
+	rte_cryptodev_stop(cid);
+free:
+	rte_mempool_free(op_pool);
+	rte_mempool_free(sess_pool);
+	rte_vdev_uninit(CRYPTO_DEV_NAME);
+
+	return ret;
+}
+
+REGISTER_TEST_COMMAND(vhost_crypto_autotest, test_vhost_crypto);
+
+#endif /* RTE_LIBRTE_CRYPTODEV */
+
+REGISTER_TEST_COMMAND(vhost_user_stress_autotest, test_vhost_user_stress);
+REGISTER_TEST_COMMAND(vhost_async_autotest, test_vhost_async);
+REGISTER_TEST_COMMAND(vhost_iotlb_autotest, test_vhost_iotlb);